@@ -1,63 +1,283 @@
+#include <csignal>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <thread>
 
 #include "model/Model.h"
 #include "sample/sltk/SLTKDataSet.h"
 #include "sample/sltk/SLTKModel.h"
+#include "sample/sltk/SLTKPipeline.h"
+#include "sample/sltk/SLTKRegistry.h"
+#include "sample/sltk/SLTKTest.h"
 #include "sample/sltk/StringUtil.h"
+#include "tensor/XMemStat.h"
+#include "tensor/XNuma.h"
+#include "tensor/XPRunner.h"
 #include "tensor/core/getandset/SetData.h"
 #include "tensor/core/movement/CopyIndexed.h"
+#include "tensor/test/Bench.h"
 
 using namespace std;
 using namespace nts;
 
-shared_ptr<SequenceTagger> BuildModel(const int argc, const char** argv)
+/* load the configuration of a tagger from the arguments */
+TaggerConfig LoadConfig(const int argc, const char** argv)
 {
-    int devID = LoadParamInt(argc, argv, "devID", 0);
-    int tagNum = LoadParamInt(argc, argv, "tagNum", 29);
-    int embSize = LoadParamInt(argc, argv, "embSize", 400);
-    int rnnLayer = LoadParamInt(argc, argv, "rnnLayer", 1);
-    int hiddenSize = LoadParamInt(argc, argv, "hiddenSize", 256);
-
-    auto embFile = LoadParamString(argc, argv, "embFile", "wnut17.emb");
-    auto tagVocab = LoadParamString(argc, argv, "tagVocab", "wnut17.tag.vocab");
-    auto modelFile = LoadParamString(argc, argv, "modelFile", "wnut17.model");
+    TaggerConfig config;
+    config.devID = LoadParamInt(argc, argv, "devID", 0);
+    config.tagNum = LoadParamInt(argc, argv, "tagNum", 29);
+    config.embSize = LoadParamInt(argc, argv, "embSize", 400);
+    config.rnnLayer = LoadParamInt(argc, argv, "rnnLayer", 1);
+    config.hiddenSize = LoadParamInt(argc, argv, "hiddenSize", 256);
+    config.isConstrained = LoadParamBool(argc, argv, "constrained", false);
+    config.isPruned = LoadParamBool(argc, argv, "prune", false);
+    config.pruneThreshold = LoadParamFloat(argc, argv, "pruneThreshold", -1000.0F);
+
+    config.tagVocab = LoadParamString(argc, argv, "tagVocab", "wnut17.tag.vocab");
+    config.modelFile = LoadParamString(argc, argv, "modelFile", "wnut17.model");
     auto emb1 = LoadParamString(argc, argv, "modelFile", "wnut17crawl.emb");
     auto emb2 = LoadParamString(argc, argv, "modelFile", "wnut17twitter.emb");
+    config.embFiles = { emb1, emb2 };
+
+    /* the character language models (the character vocabulary files) */
+    config.lmForward = LoadParamString(argc, argv, "lmForward", "");
+    config.lmBackward = LoadParamString(argc, argv, "lmBackward", "");
+    config.lmCharSize = LoadParamInt(argc, argv, "lmCharSize", 100);
+    config.lmHiddenSize = LoadParamInt(argc, argv, "lmHiddenSize", 2048);
 
-    auto embeddings = make_shared<StackEmbedding>(devID, vector<const char*>{emb1, emb2});
-    auto model = make_shared<SequenceTagger>(devID, rnnLayer, hiddenSize, tagNum, embSize, embeddings, tagVocab);
+    /* use the product-quantized embeddings (made by tool/quantize_embeddings.py) */
+    config.isQuantized = LoadParamBool(argc, argv, "pq", false);
 
-    model->Load(modelFile);
-    model->ToDevice(0);
+    /* the weights and the tables have a copy on each of the NUMA nodes (e.g., "0,1") */
+    config.numaNodes = LoadParamString(argc, argv, "numa", "");
+    return config;
+}
+
+/*
+build a tagger in the registry. The embedding tables are loaded once
+in a process and are shared by all the taggers that use them.
+*/
+shared_ptr<SequenceTagger> BuildModel(ModelRegistry& registry, const char* name, const TaggerConfig& config)
+{
+    auto model = registry.Load(name, config);
+    for (const auto& emb : model->GetEmbedding()->staticEmbeddings)
+        fprintf(stderr, "[embedding] %zu x %zu, %.2f MB%s\n", emb->vocabSize, emb->embSize,
+                emb->GetTableSize() / 1048576.0, emb->isQuantized ? " (product-quantized)" : "");
     return model;
 }
 
+/* a batch that goes through the pipeline */
+struct Batch
+{
+    /* position of the batch in the input */
+    size_t id = 0;
+
+    /* input sequences */
+    vector<vector<string>> src;
+
+    /* label sequences */
+    vector<vector<int>> labels;
+
+    /* confidences of the labels */
+    vector<vector<float>> confidences;
+
+    /* the k best label sequences (if k > 1) */
+    vector<vector<ScoredPath>> kbest;
+
+    /* the version of the tagger that labels the batch */
+    shared_ptr<SequenceTagger> model;
+};
+
+/* set by SIGHUP to reload the tagger */
+static volatile sig_atomic_t reloadRequested = 0;
+
+static void RequestReload(int)
+{
+    reloadRequested = 1;
+}
+
+/* set by SIGUSR1 to dump a snapshot of the memory usage */
+static volatile sig_atomic_t memDumpRequested = 0;
+
+static void RequestMemDump(int)
+{
+    memDumpRequested = 1;
+}
+
+/*
+tag the input file with a pipeline of three stages:
+1) the reader thread loads and batches the input ahead of the inference,
+2) the inference runs in the current thread,
+3) the writer thread dumps the results (in the original order) through one file handle.
+The stages are linked by bounded queues so that reading and writing overlap the
+computation, and the memory is bounded by the queue size.
+The tagger is reloaded from its files (e.g., after a rollout replaces them) on SIGHUP.
+The new version is built in the background and swapped in by the inference stage
+between two batches, and the batches move to the new version after that.
+With -memStat, the peak memory usage is shown at exit, and with -memDump, a snapshot
+of the memory usage is dumped to the file on SIGUSR1 and at the end.
+With -nthread, the operations run on a pool of threads, and with -numa (e.g., "0,1"),
+the threads are pinned to the cores of the NUMA nodes and read the copies of the
+weights and the tables on their nodes.
+*/
 void Predict(const int argc, const char** argv)
 {
-    auto model = BuildModel(argc, argv);
+    /* the requests are routed to the tagger of this name */
+    auto modelName = LoadParamString(argc, argv, "modelName", "wnut17");
+
+    /* the memory accounting starts before the tagger is loaded */
+    bool memStat = LoadParamBool(argc, argv, "memStat", false);
+    auto memDumpFile = LoadParamString(argc, argv, "memDump", "");
+    if (memStat || strlen(memDumpFile) > 0)
+        GMemStat.Enable();
+
+    /* the threads are pinned before the tagger is loaded and the stages are started */
+    int threadNum = LoadParamInt(argc, argv, "nthread", 1);
+    auto numaNodes = LoadParamString(argc, argv, "numa", "");
+    if (strlen(numaNodes) > 0) {
+        int nodes[MAX_NUMA_NODE_NUM];
+        int nodeNum = XParseNumaNodes(numaNodes, nodes, MAX_NUMA_NODE_NUM);
+        GetNumaTopology()->Show();
+
+        /* a thread for each core of the nodes by default */
+        if (threadNum <= 1) {
+            threadNum = 0;
+            for (int i = 0; i < nodeNum; i++)
+                threadNum += GetNumaTopology()->nodeCPUNum[nodes[i]];
+            threadNum = MIN(threadNum, MAX_THREAD_NUM);
+        }
+    }
+    if (threadNum > 1) {
+        globalPRunner = new XPRunner();
+        globalPRunner->Init(threadNum);
+        if (strlen(numaNodes) > 0 && !globalPRunner->Pin(numaNodes))
+            fprintf(stderr, "[numa] cannot pin the threads to the nodes %s\n", numaNodes);
+    }
+
+    ModelRegistry registry;
+    TaggerConfig config = LoadConfig(argc, argv);
+    BuildModel(registry, modelName, config);
     int batchSize = LoadParamInt(argc, argv, "batchSize", 1);
+    int queueSize = LoadParamInt(argc, argv, "queueSize", 8);
+    int cacheSize = LoadParamInt(argc, argv, "cacheSize", 0);
+    bool withConfidence = LoadParamBool(argc, argv, "confidence", false);
+    int kbest = LoadParamInt(argc, argv, "kbest", 1);
     auto srcFile = LoadParamString(argc, argv, "src", "tiny.txt");
     auto tgtFile = LoadParamString(argc, argv, "tgt", "res.txt");
 
+    /* the result cache for duplicated sentences (in MB) */
+    if (cacheSize > 0)
+        registry.Get(modelName)->SetCache(make_shared<ResultCache>(size_t(cacheSize) << 20));
+    signal(SIGHUP, RequestReload);
+    signal(SIGUSR1, RequestMemDump);
+
     DataSet dataSet(srcFile);
 
-    for (auto i = 0; i < dataSet.bufferSize; i += batchSize) {
-        /* input sequences */
-        auto src = dataSet.LoadBatch(batchSize);
+    BoundedQueue<Batch> inputQueue(queueSize);
+    BoundedQueue<Batch> outputQueue(queueSize);
+
+    /* the read stage */
+    thread reader([&]() {
+        for (size_t id = 0;; id++) {
+            Batch batch;
+            batch.id = id;
+            batch.src = dataSet.LoadBatch(batchSize);
+            if (batch.src.empty())
+                break;
+            inputQueue.Push(move(batch));
+        }
+        inputQueue.Close();
+    });
+
+    /* the write stage */
+    thread writer([&]() {
+        ofstream file(tgtFile, ios::app);
+        map<size_t, Batch> pending;
+        size_t next = 0;
+        Batch batch;
+        while (outputQueue.Pop(batch)) {
+            pending[batch.id] = move(batch);
 
-        /* label sequences */
-        auto labels = model->Predict(src);
+            /* dump the batches that are ready in order */
+            for (auto it = pending.find(next); it != pending.end(); it = pending.find(++next)) {
+                const auto& model = it->second.model;
+                if (kbest > 1)
+                    model->DumpKBest(it->second.src, it->second.kbest, file);
+                else
+                    model->DumpResult(it->second.src, it->second.labels, file,
+                                      withConfidence ? &it->second.confidences : NULL);
+                pending.erase(it);
+            }
+        }
+        CheckNTErrors(pending.empty(), "some batches are not written");
+    });
 
-        /* dump tag results to a file */
-        model->DumpResult(src, labels, tgtFile);
+    /* the inference stage. The first batch is kept to validate the reloaded versions */
+    Batch batch;
+    vector<vector<string>> smokeBatch;
+    future<bool> reloading;
+    while (inputQueue.Pop(batch)) {
+        if (smokeBatch.empty())
+            smokeBatch = batch.src;
+        if (reloadRequested) {
+            reloadRequested = 0;
+            if (!reloading.valid() || reloading.wait_for(chrono::seconds(0)) == future_status::ready)
+                reloading = registry.ReloadAsync(modelName, config, smokeBatch);
+        }
+
+        /* the new versions that are built are validated and swapped in here */
+        registry.FinishReloads();
+
+        if (memDumpRequested) {
+            memDumpRequested = 0;
+            if (strlen(memDumpFile) > 0)
+                GMemStat.Dump(memDumpFile);
+        }
+
+        batch.model = registry.Get(modelName);
+        if (kbest > 1)
+            batch.kbest = batch.model->PredictKBest(batch.src, kbest);
+        else
+            batch.labels = batch.model->Predict(batch.src, withConfidence ? &batch.confidences : NULL);
+        outputQueue.Push(move(batch));
     }
+    registry.FinishReloads(true);
+    outputQueue.Close();
+
+    reader.join();
+    writer.join();
+    if (reloading.valid())
+        reloading.get();
+
+    auto model = registry.Get(modelName);
+
+    inputQueue.ShowStat("read -> infer");
+    outputQueue.ShowStat("infer -> write");
+    if (model->GetCache() != NULL)
+        model->GetCache()->ShowStat("result cache");
+    registry.ShowStat();
+    if (strlen(memDumpFile) > 0)
+        GMemStat.Dump(memDumpFile);
 }
 
 int main(const int argc, const char** argv)
 {
+    /* run the benchmarks of the tensor library instead of tagging */
+    if (LoadParamBool(argc, argv, "bench", false))
+        return Bench() ? 0 : 1;
+
+    /* run the tests of the tagger */
+    if (LoadParamBool(argc, argv, "test", false))
+        return TestRegistry() ? 0 : 1;
+
     Predict(argc, argv);
 
+    delete globalPRunner;
+    globalPRunner = NULL;
+
     return 0;
 }
\ No newline at end of file
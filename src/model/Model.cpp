@@ -1,5 +1,6 @@
 #include <vector>
 #include "Model.h"
+#include "../tensor/XMemStat.h"
 #include "../sample/sltk/StringUtil.h"
 #include <iostream>
 
@@ -16,6 +17,7 @@ void Model::Register(const string& prefix, const Model& module)
         string name = prefix + "." + module.parameters.nameList[i];
         parameters.paramList.push_back(module.parameters.paramList[i]);
         parameters.nameList.emplace_back(name);
+        parameters.replicaList.push_back(module.parameters.replicaList[i]);
     }
 }
 
@@ -44,12 +46,31 @@ void Model::Print()
 /* set devices for all parameters */
 void Model::ToDevice(int devID)
 {
+    XMemCategoryScope scope(MEM_PARAMETER);
+
     for (size_t i = 0; i < parameters.paramList.size(); i++) {
         if(parameters.paramList[i]->devID != devID)
             parameters.paramList[i]->SetDevice(devID);
     }
 }
 
+/*
+make a copy of the parameters (on CPUs) on each NUMA node. Then Get returns
+the copy of the node that the thread runs on. The parameters are read-only
+after that, so it is called after Load and ToDevice.
+>>> nodes - the nodes (NULL for all the nodes that have cpus)
+>>> nodeNum - number of the nodes
+*/
+void Model::Replicate(const int* nodes, int nodeNum)
+{
+    XMemCategoryScope scope(MEM_PARAMETER);
+
+    for (size_t i = 0; i < parameters.paramList.size(); i++) {
+        if (parameters.paramList[i]->devID < 0)
+            parameters.replicaList[i]->Init(parameters.paramList[i].get(), nodes, nodeNum);
+    }
+}
+
 /* get a parameter by its name */
 shared_ptr<XTensor> Model::operator[](const string& name)
 {
@@ -108,10 +129,20 @@ void Model::Save(const char* fn)
     fclose(file);
 }
 
-/* get a parameter by its name */
+/* get a parameter by its name (the copy of the NUMA node of the thread if it is replicated) */
 shared_ptr<XTensor> Model::Get(const string& name)
 {
-    return parameters.GetParameter(name);
+    for (int i = 0; i < parameters.paramList.size(); i++) {
+        if (name == parameters.nameList[i]) {
+            const auto& replica = parameters.replicaList[i];
+            if (replica->copyNum > 0)
+                return shared_ptr<XTensor>(replica, replica->GetTensor());
+            return parameters.paramList[i];
+        }
+    }
+
+    /* if miss, return a null pointer */
+    return nullptr;
 }
 
 /* add a parameter to the list */
@@ -123,10 +154,12 @@ void Parameter::AddParameter(const string& name, Dim dims, TENSOR_DATA_TYPE data
     for (int i : dims) {
         dim.Add(i);
     }
+    XMemCategoryScope scope(MEM_PARAMETER);
     auto p = make_shared<XTensor>();
     InitTensorV2(p.get(), int(dim.Size()), dim.items, dataType);
     nameList.push_back(name);
     paramList.push_back(p);
+    replicaList.push_back(make_shared<XNumaReplica>());
 }
 
 /* get a parameter by its name */
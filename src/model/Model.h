@@ -31,6 +31,7 @@
 #include <utility>
 #include "../tensor/XGlobal.h"
 #include "../tensor/XTensor.h"
+#include "../tensor/XNuma.h"
 
 using namespace std;
 using namespace nts;
@@ -47,6 +48,10 @@ public:
     /* the name list for parameters */
     vector<string> nameList;
 
+    /* the copies of the parameters on the NUMA nodes (they are shared with
+       the modules, so a module reads the copies made by its owner) */
+    vector<shared_ptr<XNumaReplica>> replicaList;
+
 public:
     /* add a parameter to the list */
     void AddParameter(const string& name, Dim dims, TENSOR_DATA_TYPE dataType);
@@ -89,4 +94,7 @@ public:
 
     /* load the model on device */
     void ToDevice(int devID);
+
+    /* make a copy of the parameters (on CPUs) on each NUMA node */
+    void Replicate(const int* nodes = NULL, int nodeNum = 0);
 };
\ No newline at end of file
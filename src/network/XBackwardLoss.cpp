@@ -73,6 +73,12 @@ void XLossGrad::MakeGrad(XTensor * node, bool isEfficient)
         CheckNTErrors(leadingDim >= 0 && leadingDim < output->order, "wrong leading dimension in logsoftmax!");
         _CrossEntropyBackward(dedy, output, gold, weight, padding, leadingDim);
     }
+    else if(operID == LOSS_CROSSENTROPY_LOGITS) {
+        if (income.tailNum == 3)
+            padding = income.tails[2];
+        DTYPE labelSmoothingP = income.GetParam(0);
+        _CrossEntropyWithLogitsBackward(dedy, output, gold, labelSmoothingP, padding);
+    }
     else{
         ShowNTErrors("Wrong activation function type!");
     }
@@ -20,6 +20,7 @@
  */
 
 #include "XNoder.h"
+#include "../tensor/XMemStat.h"
 
 namespace nts{
 
@@ -30,6 +31,7 @@ void XNoder::MakeGrad(XTensor * node)
         return;
 
     if(!_IsSameShaped(node, node->grad)){
+        XMemCategoryScope scope(MEM_GRADIENT);
         delete node->grad;
         node->grad = NewTensor(node);
         node->grad->SetZeroAll();
@@ -22,7 +22,11 @@
 #include <algorithm>
 #include "SLTKCRF.h"
 #include "SLTKNNUtil.h"
+#include "../../tensor/XHeap.h"
+#include "../../tensor/XElementWise.h"
+#include "../../tensor/XExpression.h"
 #include "../../tensor/core/CHeader.h"
+#include "../../tensor/core/utilities/XMatrixSegment.h"
 
 /*
 constructor
@@ -36,6 +40,7 @@ CRF::CRF(int myTagNum)
     stopID = myTagNum - 1;
     Register("Transitions", { tagNum, tagNum }, X_FLOAT);
     ResetParams();
+    ResetConstraints();
 }
 
 /* initializer */
@@ -44,96 +49,530 @@ void CRF::ResetParams()
     Get("Transitions")->SetDataRand(-0.1f, 0.1f);
 }
 
+/* allow all transitions */
+void CRF::ResetConstraints()
+{
+    preds.assign(tagNum, vector<int>());
+    for (int to = 0; to < tagNum; to++) {
+        for (int from = 0; from < tagNum; from++)
+            preds[to].push_back(from);
+    }
+}
+
+/*
+is the transition legal in the tag scheme
+>>> from - name of the previous tag (or "<START>")
+>>> to - name of the next tag (or "<STOP>")
+>>> isBIOES - is it the BIOES scheme (otherwise BIO)
+*/
+static bool IsLegalTransition(const string& from, const string& to, bool isBIOES)
+{
+    if (to == "<START>" || from == "<STOP>")
+        return false;
+
+    /* the prefix (B, I, E, S or O) and the type of entity */
+    char fromPrefix = from.size() > 2 && from[1] == '-' ? from[0] : (from == "O" ? 'O' : 0);
+    char toPrefix = to.size() > 2 && to[1] == '-' ? to[0] : (to == "O" ? 'O' : 0);
+    string fromType = fromPrefix && fromPrefix != 'O' ? from.substr(2) : "";
+    string toType = toPrefix && toPrefix != 'O' ? to.substr(2) : "";
+
+    if (from == "<START>")
+        fromPrefix = 'S';
+    if (to == "<STOP>")
+        toPrefix = 'B';
+
+    /* unknown tags (e.g., <unk>) are not constrained */
+    if (fromPrefix == 0 || toPrefix == 0)
+        return true;
+
+    /* I-X and E-X continue an entity of type X */
+    if (toPrefix == 'I' || toPrefix == 'E')
+        return (fromPrefix == 'B' || fromPrefix == 'I') && fromType == toType;
+
+    /* B-X and I-X must be continued in BIOES */
+    if (isBIOES)
+        return fromPrefix != 'B' && fromPrefix != 'I';
+
+    return true;
+}
+
+/*
+allow only the transitions that are legal in the tag scheme, e.g., I-X can only
+follow B-X or I-X. The scheme is BIOES if there are E- or S- tags, and BIO otherwise.
+It guarantees well-formed spans, and the decoding goes only over the allowed transitions.
+>>> tagVocab - the tag vocabulary
+*/
+void CRF::ConstrainTransitions(const Vocab& tagVocab)
+{
+    vector<string> names(tagNum);
+    bool isBIOES = false;
+    for (int i = 0; i < tagNum; i++) {
+        auto it = tagVocab.id2word.find(i);
+        names[i] = it != tagVocab.id2word.end() ? it->second : "";
+        if (names[i].size() > 2 && names[i][1] == '-' && (names[i][0] == 'E' || names[i][0] == 'S'))
+            isBIOES = true;
+    }
+    names[startID] = "<START>";
+    names[stopID] = "<STOP>";
+
+    for (int to = 0; to < tagNum; to++) {
+        vector<int> allowed;
+        for (int from : preds[to]) {
+            if (IsLegalTransition(names[from], names[to], isBIOES))
+                allowed.push_back(from);
+        }
+        preds[to].swap(allowed);
+    }
+}
+
+/*
+remove the transitions whose scores are below a threshold, e.g., the transitions
+that are forbidden in training usually have scores around -1e4
+>>> threshold - the threshold
+*/
+void CRF::PruneTransitions(float threshold)
+{
+    XTensor trans;
+    InitTensor2DV2(&trans, tagNum, tagNum, X_FLOAT, -1);
+    _CopyValues(Get("Transitions").get(), &trans);
+    const float* t = (float*)trans.data;
+
+    for (int to = 0; to < tagNum; to++) {
+        vector<int> allowed;
+        for (int from : preds[to]) {
+            if (t[to * tagNum + from] >= threshold)
+                allowed.push_back(from);
+        }
+        preds[to].swap(allowed);
+    }
+}
+
+/* get the number of allowed transitions */
+int CRF::GetTransitionNum()
+{
+    int num = 0;
+    for (const auto& p : preds)
+        num += int(p.size());
+    return num;
+}
+
 /*
 decoding
 >>> emissions - the input, (bsz, len, tagNum)
 >>> mask - the mask, (bsz, len)
-<<< the best tag sequence, (bsz, len)
+<<< the best tag sequence of each sentence (its length is the number of
+    unmasked tokens in the sentence)
 */
 vector<vector<int>> CRF::Decode(const XTensor& emissions, const XTensor& mask)
 {
-    TensorList batch;
-    Split(emissions, batch, 0);
-    vector<vector<int>> bestPaths;
+    int bsz = emissions.GetDim(0);
+    int maxLen = emissions.GetDim(1);
 
-    for (int i = 0; i < batch.Size(); i++)
-        bestPaths.emplace_back(ViterbiDecode(*batch[i], mask));
+    /* we decode on CPUs */
+    XTensor emissionsCPU, maskCPU, trans;
+    InitTensor3DV2(&emissionsCPU, bsz, maxLen, tagNum, X_FLOAT, -1);
+    InitTensor2DV2(&maskCPU, bsz, maxLen, X_INT, -1);
+    InitTensor2DV2(&trans, tagNum, tagNum, X_FLOAT, -1);
+    _CopyValues(&emissions, &emissionsCPU);
+    _CopyValues(&mask, &maskCPU);
+    _CopyValues(Get("Transitions").get(), &trans);
+
+    const float* e = (float*)emissionsCPU.data;
+    const int* m = (int*)maskCPU.data;
+
+    vector<vector<int>> bestPaths;
+    for (int i = 0; i < bsz; i++) {
+        int len = 0;
+        for (int j = 0; j < maxLen; j++)
+            len += m[i * maxLen + j] != 0;
+        bestPaths.emplace_back(ViterbiDecode(e + (long)i * maxLen * tagNum, len, (float*)trans.data));
+    }
     return bestPaths;
 }
 
-/* Return a tensor of elements selected from either x or y, depending on condition. */
+/*
+Return a tensor of elements selected from either x or y, depending on condition.
+It is a lazy expression, so it runs in one pass without temporary tensors.
+*/
 XTensor Where(const XTensor& condition, const XTensor& x, const XTensor& y)
 {
-    return condition * x + (1 - condition) * y;
+    return Lazy(condition) * x + (1 - Lazy(condition)) * y;
 }
 
 /*
-viterbi decoding on a sequence
->>> emissions - the input, shape: (len, tagNum)
->>> mask - the mask, shape: (len)
-<<< the best tag sequence, shape: (len)
+viterbi decoding on a sequence. The scores are accumulated over the allowed
+transitions only, so the cost of a timestep is the number of allowed
+transitions rather than tagNum * tagNum.
+>>> emissions - the emission scores, (len, tagNum)
+>>> len - length of the sequence
+>>> trans - the transition scores, (tagNum, tagNum), trans[i][j] is the
+            score of moving from tag j to tag i
+<<< the best tag sequence, (len)
 */
-vector<int> CRF::ViterbiDecode(const XTensor& emissions, const XTensor& mask)
+vector<int> CRF::ViterbiDecode(const float* emissions, int len, const float* trans) const
 {
-    int seqLen = emissions.GetDim(0);
-    auto trans = Get("Transitions");
+    const float minScore = -1e30F;
 
-    XTensor backpointers;
-    InitTensor2DV2(&backpointers, seqLen, tagNum, X_INT, trans->devID);
+    if (len == 0)
+        return vector<int>();
 
-    /* forwardVar shape: (1, tagNum) */
-    XTensor forwardVar;
-    InitTensor1DV2(&forwardVar, tagNum, X_FLOAT, trans->devID);
-    SetDataFixed(forwardVar, -1e4);
-    forwardVar.Set1D(0, startID);
+    vector<float> forwardVar(tagNum, minScore);
+    vector<float> nextVar(tagNum);
+    vector<int> backpointers(len * tagNum, -1);
+    forwardVar[startID] = 0;
 
-    TensorList timeSteps;
-    Split(emissions, timeSteps, 0);
+    /* iterations on timesteps */
+    for (int t = 0; t < len; t++) {
+        const float* feature = emissions + t * tagNum;
+        int* bp = backpointers.data() + t * tagNum;
 
-    /* iterations on timesteps  */
-    for (int t = 0; t < seqLen; t++) {
-        /* feature shape: (tagNum) */
-        XTensor& feature = *(timeSteps[t]);
+        for (int to = 0; to < tagNum; to++) {
+            /* no token is tagged with <START> or <STOP> */
+            if (to == startID || to == stopID) {
+                nextVar[to] = minScore;
+                continue;
+            }
 
-        /* nextTagVar shape: (tagNum, tagNum) */
-        XTensor nextTagVar = SumDim(*trans, forwardVar, 0);
+            const float* transTo = trans + to * tagNum;
+            float bestScore = minScore;
+            for (int from : preds[to]) {
+                float score = forwardVar[from] + transTo[from];
+                if (score > bestScore) {
+                    bestScore = score;
+                    bp[to] = from;
+                }
+            }
+            nextVar[to] = bestScore + feature[to];
+        }
+        forwardVar.swap(nextVar);
+    }
 
-        XTensor bestTag, bestScore;
-        InitTensor2DV2(&bestTag, tagNum, 1, X_INT, trans->devID);
-        InitTensor2DV2(&bestScore, tagNum, 1, X_FLOAT, trans->devID);
-        TopK(nextTagVar, bestScore, bestTag, 1, 1);
-        bestScore.Reshape(tagNum);
-        forwardVar = bestScore + feature;
+    /* get the best tag for the last token */
+    int bestTagID = -1;
+    float bestScore = minScore;
+    for (int from : preds[stopID]) {
+        float score = forwardVar[from] + trans[stopID * tagNum + from];
+        if (from != startID && from != stopID && (bestTagID < 0 || score > bestScore)) {
+            bestScore = score;
+            bestTagID = from;
+        }
+    }
+    CheckNTErrors(bestTagID >= 0, "no tag can end a sequence!");
 
-        /* save the best tag */
-        int srcIdx[]{ 0 };
-        int tgtIdx[]{ t };
-        bestTag.Reshape(1, tagNum);
-        _CopyIndexed(&bestTag, &backpointers, 0, srcIdx, 1, tgtIdx);
+    vector<int> bestPath(len);
+    bestPath[len - 1] = bestTagID;
+    for (int t = len - 1; t > 0; t--) {
+        bestTagID = backpointers[t * tagNum + bestTagID];
+        bestPath[t - 1] = bestTagID >= 0 ? bestTagID : 0;
+        bestTagID = bestPath[t - 1];
     }
 
-    /* todo: optimize this section */
-    XTensor stopIdx;
-    InitTensor1DV2(&stopIdx, 1, X_INT, trans->devID);
-    stopIdx.Set1DInt(stopID, 0);
-    XTensor stopTransition = Select(*trans, stopIdx, 0);
+    return bestPath;
+}
 
-    /* get the best tag for the last token */
-    XTensor terminalVar = Squeeze(forwardVar) + stopTransition;
-    terminalVar.Set1D(-1e4, startID);
-    terminalVar.Set1D(-1e4, stopID);
+/*
+k-best decoding
+>>> emissions - the input, (bsz, len, tagNum)
+>>> mask - the mask, (bsz, len)
+>>> k - number of the sequences for each sentence
+<<< the k best tag sequences (with their scores) of each sentence, in the descending
+    order of the scores (there might be less than k sequences for short sentences)
+*/
+vector<vector<ScoredPath>> CRF::DecodeKBest(const XTensor& emissions, const XTensor& mask, int k)
+{
+    int bsz = emissions.GetDim(0);
+    int maxLen = emissions.GetDim(1);
+
+    /* we decode on CPUs */
+    XTensor emissionsCPU, maskCPU, trans;
+    InitTensor3DV2(&emissionsCPU, bsz, maxLen, tagNum, X_FLOAT, -1);
+    InitTensor2DV2(&maskCPU, bsz, maxLen, X_INT, -1);
+    InitTensor2DV2(&trans, tagNum, tagNum, X_FLOAT, -1);
+    _CopyValues(&emissions, &emissionsCPU);
+    _CopyValues(&mask, &maskCPU);
+    _CopyValues(Get("Transitions").get(), &trans);
 
-    XTensor bestTag, bestScore;
-    InitTensor1DV2(&bestTag, 1, X_INT, trans->devID);
-    InitTensor1DV2(&bestScore, 1, X_FLOAT, trans->devID);
-    TopK(terminalVar, bestScore, bestTag, 0, 1);
+    const float* e = (float*)emissionsCPU.data;
+    const int* m = (int*)maskCPU.data;
 
-    int bestTagID = bestTag.Get1DInt(0);
-    vector<int> bestPath{ bestTagID };
+    vector<vector<ScoredPath>> bestPaths;
+    for (int i = 0; i < bsz; i++) {
+        int len = 0;
+        for (int j = 0; j < maxLen; j++)
+            len += m[i * maxLen + j] != 0;
+        bestPaths.emplace_back(KBestViterbiDecode(e + (long)i * maxLen * tagNum, len, (float*)trans.data, k));
+    }
+    return bestPaths;
+}
 
-    for (int i = backpointers.GetDim(0) - 1; i > 0; i--)
-        bestPath.push_back(backpointers.Get2DInt(i, bestTagID));
+/*
+k-best viterbi decoding on a sequence. We keep the k best partial paths (score and
+backpointer) for each (timestep, tag). The partial paths of a previous tag are sorted,
+and so are they after the transition score is added. So the k best ones of the next
+tag are obtained by merging the sorted lists of its previous tags with a heap, i.e.,
+in O((p + k) log p) time where p is the number of allowed previous tags.
+>>> emissions - the emission scores, (len, tagNum)
+>>> len - length of the sequence
+>>> trans - the transition scores, (tagNum, tagNum), trans[i][j] is the
+            score of moving from tag j to tag i
+>>> k - number of the sequences
+<<< the k best tag sequences and their scores
+*/
+vector<ScoredPath> CRF::KBestViterbiDecode(const float* emissions, int len, const float* trans, int k) const
+{
+    CheckNTErrors(k > 0, "k must be positive!");
 
-    reverse(bestPath.begin(), bestPath.end());
-    return bestPath;
-}
\ No newline at end of file
+    if (len == 0)
+        return vector<ScoredPath>();
+
+    /* the partial paths of (t, tag) are kept in [(t * tagNum + tag) * k, (t * tagNum + tag + 1) * k) */
+    vector<float> scores(len * tagNum * k);
+    vector<int> prevTags(len * tagNum * k);
+    vector<int> prevRanks(len * tagNum * k);
+    vector<int> counts(len * tagNum, 0);
+
+    /* the next position of each previous tag in the merge */
+    vector<int> positions(tagNum);
+    XHeap<MAX_HEAP, float> heap(tagNum);
+
+    /* merge the sorted lists of the previous tags into the k best ones */
+    auto merge = [&](int t, int to, float* outScores, int* outTags, int* outRanks) -> int {
+        const float* transTo = trans + to * tagNum;
+        heap.count = 0;
+        for (int from : preds[to]) {
+            int count = t > 0 ? counts[(t - 1) * tagNum + from] : (from == startID ? 1 : 0);
+            positions[from] = 0;
+            if (count > 0) {
+                float score = t > 0 ? scores[((t - 1) * tagNum + from) * k] : 0;
+                heap.Push(HeapNode<float>(from, score + transTo[from]));
+            }
+        }
+
+        int num = 0;
+        while (num < k && heap.Count() > 0) {
+            HeapNode<float> node = heap.Pop();
+            int from = (int)node.index;
+            outScores[num] = node.value;
+            outTags[num] = from;
+            outRanks[num] = positions[from]++;
+            num++;
+
+            int count = t > 0 ? counts[(t - 1) * tagNum + from] : 1;
+            if (positions[from] < count)
+                heap.Push(HeapNode<float>(from, scores[((t - 1) * tagNum + from) * k + positions[from]] + transTo[from]));
+        }
+        return num;
+    };
+
+    /* iterations on timesteps */
+    for (int t = 0; t < len; t++) {
+        for (int to = 0; to < tagNum; to++) {
+            /* no token is tagged with <START> or <STOP> */
+            if (to == startID || to == stopID)
+                continue;
+
+            int offset = (t * tagNum + to) * k;
+            int num = merge(t, to, scores.data() + offset, prevTags.data() + offset, prevRanks.data() + offset);
+            for (int r = 0; r < num; r++)
+                scores[offset + r] += emissions[t * tagNum + to];
+            counts[t * tagNum + to] = num;
+        }
+    }
+
+    /* the k best paths that end with <STOP> */
+    vector<float> finalScores(k);
+    vector<int> finalTags(k);
+    vector<int> finalRanks(k);
+    int num = merge(len, stopID, finalScores.data(), finalTags.data(), finalRanks.data());
+
+    vector<ScoredPath> bestPaths(num);
+    for (int i = 0; i < num; i++) {
+        bestPaths[i].score = finalScores[i];
+        bestPaths[i].tags.resize(len);
+
+        int tag = finalTags[i];
+        int rank = finalRanks[i];
+        for (int t = len - 1; t >= 0; t--) {
+            bestPaths[i].tags[t] = tag;
+            int offset = (t * tagNum + tag) * k + rank;
+            tag = prevTags[offset];
+            rank = prevRanks[offset];
+        }
+    }
+
+    return bestPaths;
+}
+
+/* the score of impossible transitions in the forward-backward algorithm */
+#define CRF_MIN_SCORE -1e30F
+
+/* c[i] = a[i] + b[i] */
+static void AddVector(const float* a, const float* b, float* c, int n)
+{
+    for (int i = 0; i < n; i++)
+        c[i] = a[i] + b[i];
+}
+
+/* log(sum_i e^{x_i}) */
+static float LogSumExp(const float* x, int n)
+{
+    float max, sum;
+    XEWMaxSumExp(x, n, &max, &sum);
+    return max + logf(sum);
+}
+
+/*
+forward-backward in log space on a sequence. The log-sum-exp of a tag is
+computed over a row of the transition matrix (or its transpose), i.e., over
+contiguous memory with SIMD instructions.
+>>> emissions - the emission scores, (len, tagNum)
+>>> len - length of the sequence
+>>> trans - the transition scores, (tagNum, tagNum), trans[i][j] is the score of
+            moving from tag j to tag i (CRF_MIN_SCORE for forbidden transitions)
+>>> transT - the transpose of trans
+>>> marginals - p(y_t = i) for each token t and tag i, (len, tagNum)
+<<< return - the log-partition, i.e., log of the sum of the scores of all paths
+*/
+float CRF::ForwardBackward(const float* emissions, int len, const float* trans, const float* transT, float* marginals) const
+{
+    if (len == 0)
+        return 0;
+
+    int n = tagNum;
+    vector<float> alpha(len * n);
+    vector<float> beta(len * n);
+    vector<float> next(n);
+    vector<float> buf(n);
+
+    /* alpha_t(i) = log sum_j e^{alpha_{t-1}(j) + trans(i, j)} + emission_t(i).
+       No token is tagged with <START> or <STOP> */
+    for (int t = 0; t < len; t++) {
+        for (int to = 0; to < n; to++) {
+            if (to == startID || to == stopID)
+                alpha[t * n + to] = CRF_MIN_SCORE;
+            else if (t == 0)
+                alpha[to] = trans[to * n + startID] + emissions[to];
+            else {
+                AddVector(alpha.data() + (t - 1) * n, trans + to * n, buf.data(), n);
+                alpha[t * n + to] = LogSumExp(buf.data(), n) + emissions[t * n + to];
+            }
+        }
+    }
+
+    /* log Z = log sum_j e^{alpha_{len-1}(j) + trans(<STOP>, j)} */
+    AddVector(alpha.data() + (len - 1) * n, trans + stopID * n, buf.data(), n);
+    float logZ = LogSumExp(buf.data(), n);
+
+    /* beta_t(j) = log sum_i e^{trans(i, j) + emission_{t+1}(i) + beta_{t+1}(i)} */
+    for (int from = 0; from < n; from++)
+        beta[(len - 1) * n + from] = trans[stopID * n + from];
+    for (int t = len - 2; t >= 0; t--) {
+        AddVector(emissions + (t + 1) * n, beta.data() + (t + 1) * n, next.data(), n);
+        next[startID] = CRF_MIN_SCORE;
+        next[stopID] = CRF_MIN_SCORE;
+        for (int from = 0; from < n; from++) {
+            AddVector(transT + from * n, next.data(), buf.data(), n);
+            beta[t * n + from] = LogSumExp(buf.data(), n);
+        }
+    }
+
+    /* p(y_t = i) = e^{alpha_t(i) + beta_t(i) - log Z} */
+    for (int i = 0; i < len * n; i++)
+        marginals[i] = XEWExp(alpha[i] + beta[i] - logZ);
+
+    return logZ;
+}
+
+/*
+forward-backward for the sentences in [x1, x2] (a job of RunParallel2D)
+argument0: the crf
+argument1: emissions, (bsz, maxLen, tagNum)
+argument2: transitions, (tagNum, tagNum)
+argument3: transpose of the transitions
+argument4: length of each sentence
+argument5: the marginals, (bsz, maxLen, tagNum)
+argument6: the log-partition, (bsz)
+*/
+static void ForwardBackwardJob(TensorList* args)
+{
+    IntList* indexArgs = (IntList*)args->GetItem(0);
+    TensorList* tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(tensorArgs->count == 7, "invalid argument number!");
+
+    const CRF* crf = (const CRF*)tensorArgs->GetItem(0);
+    XTensor* emissions = tensorArgs->GetItem(1);
+    XTensor* trans = tensorArgs->GetItem(2);
+    XTensor* transT = tensorArgs->GetItem(3);
+    int* lengths = (int*)tensorArgs->GetItem(4);
+    XTensor* marginals = tensorArgs->GetItem(5);
+    XTensor* logPartition = tensorArgs->GetItem(6);
+
+    int x1 = indexArgs->GetItem(0);
+    int x2 = indexArgs->GetItem(2);
+    long blockSize = (long)emissions->GetDim(1) * emissions->GetDim(2);
+
+    for (int i = x1; i <= x2; i++) {
+        float* m = (float*)marginals->data + i * blockSize;
+        ((float*)logPartition->data)[i] =
+            crf->ForwardBackward((float*)emissions->data + i * blockSize, lengths[i],
+                                 (float*)trans->data, (float*)transT->data, m);
+    }
+}
+
+/*
+token marginals and log-partition of a batch with the forward-backward algorithm.
+Only the allowed transitions are taken into account (see ConstrainTransitions),
+so that the marginals agree with the decoder. The sentences are processed in parallel.
+>>> emissions - the input, (bsz, len, tagNum)
+>>> mask - the mask, (bsz, len)
+>>> logPartition - the log-partition of each sentence, (bsz)
+<<< the marginals, i.e., p(y_t = i) for each token t and tag i, (bsz, len, tagNum),
+    and they are zeros for padding
+*/
+XTensor CRF::Marginals(const XTensor& emissions, const XTensor& mask, XTensor& logPartition)
+{
+    int bsz = emissions.GetDim(0);
+    int maxLen = emissions.GetDim(1);
+
+    /* we run on CPUs */
+    XTensor emissionsCPU, maskCPU, transCPU, marginals;
+    InitTensor3DV2(&emissionsCPU, bsz, maxLen, tagNum, X_FLOAT, -1);
+    InitTensor2DV2(&maskCPU, bsz, maxLen, X_INT, -1);
+    InitTensor2DV2(&transCPU, tagNum, tagNum, X_FLOAT, -1);
+    InitTensor3DV2(&marginals, bsz, maxLen, tagNum, X_FLOAT, -1);
+    InitTensor1DV2(&logPartition, bsz, X_FLOAT, -1);
+    _CopyValues(&emissions, &emissionsCPU);
+    _CopyValues(&mask, &maskCPU);
+    _CopyValues(Get("Transitions").get(), &transCPU);
+    marginals.SetZeroAll();
+
+    /* the forbidden transitions get CRF_MIN_SCORE */
+    XTensor trans, transT;
+    InitTensor2DV2(&trans, tagNum, tagNum, X_FLOAT, -1);
+    InitTensor2DV2(&transT, tagNum, tagNum, X_FLOAT, -1);
+    float* t = (float*)trans.data;
+    float* tT = (float*)transT.data;
+    for (int i = 0; i < tagNum * tagNum; i++)
+        t[i] = CRF_MIN_SCORE;
+    for (int to = 0; to < tagNum; to++) {
+        for (int from : preds[to])
+            t[to * tagNum + from] = ((float*)transCPU.data)[to * tagNum + from];
+    }
+    for (int i = 0; i < tagNum; i++) {
+        for (int j = 0; j < tagNum; j++)
+            tT[j * tagNum + i] = t[i * tagNum + j];
+    }
+
+    vector<int> lengths(bsz, 0);
+    const int* m = (int*)maskCPU.data;
+    for (int i = 0; i < bsz; i++) {
+        for (int j = 0; j < maxLen; j++)
+            lengths[i] += m[i * maxLen + j] != 0;
+    }
+
+    RunParallel2D(globalPRunner, (void*)ForwardBackwardJob, bsz * maxLen * tagNum * tagNum,
+                  bsz, 1, 7,
+                  this, &emissionsCPU, &trans, &transT, lengths.data(), &marginals, &logPartition);
+
+    return marginals;
+}
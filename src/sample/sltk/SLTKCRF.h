@@ -22,12 +22,23 @@
 #pragma once
 
 #include <vector>
+#include "SLTKDataSet.h"
 #include "..//..//model/Model.h"
 #include "../../tensor/XTensor.h"
 
 using namespace nts;
 using namespace std;
 
+/* a tag sequence and its score */
+struct ScoredPath
+{
+    /* score of the sequence */
+    float score;
+
+    /* the tags */
+    vector<int> tags;
+};
+
 /* This module implements a conditional random field.
  * The forward computation computes the log likelihood
  * of the given sequence of tags and emission score tensor.
@@ -50,17 +61,46 @@ public:
     /* id for the stop id */
     int stopID;
 
+    /* the allowed transitions, i.e., preds[i] keeps the tags that can be followed by tag i.
+       It is built in the constructor (and by SequenceTagger::SetDecoder) and is read-only
+       in decoding */
+    vector<vector<int>> preds;
+
     /* constructor */
     CRF(int myTagNum);
 
     /* initializer */
     void ResetParams();
 
+    /* allow all transitions */
+    void ResetConstraints();
+
+    /* allow only the transitions that are legal in the tag scheme (BIO or BIOES) */
+    void ConstrainTransitions(const Vocab& tagVocab);
+
+    /* remove the transitions whose scores are below a threshold */
+    void PruneTransitions(float threshold);
+
+    /* get the number of allowed transitions */
+    int GetTransitionNum();
+
     /* decoder */
     vector<vector<int>> Decode(const XTensor& emissions, const XTensor& mask);
 
     /* viterbi decoder */
-    vector<int> ViterbiDecode(const XTensor& emissions, const XTensor& mask);
+    vector<int> ViterbiDecode(const float* emissions, int len, const float* trans) const;
+
+    /* k-best decoder */
+    vector<vector<ScoredPath>> DecodeKBest(const XTensor& emissions, const XTensor& mask, int k);
+
+    /* k-best viterbi decoder */
+    vector<ScoredPath> KBestViterbiDecode(const float* emissions, int len, const float* trans, int k) const;
+
+    /* token marginals and log-partition of a batch (forward-backward) */
+    XTensor Marginals(const XTensor& emissions, const XTensor& mask, XTensor& logPartition);
+
+    /* forward-backward on a sequence */
+    float ForwardBackward(const float* emissions, int len, const float* trans, const float* transT, float* marginals) const;
 };
 
 /* Return a tensor of elements selected from either x or y, depending on condition. */
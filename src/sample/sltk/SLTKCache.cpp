@@ -0,0 +1,217 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <cstdio>
+#include "SLTKCache.h"
+
+/* the finalizer of splitmix64 */
+static uint64_t Mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+constructor
+>>> myBudget - max number of bytes the entries can use
+*/
+ResultCache::ResultCache(size_t myBudget)
+{
+    budget = myBudget;
+}
+
+/* memory footprint of an entry (the slot, the results and the node in the index) */
+size_t ResultCache::EntryCost(const Entry& entry)
+{
+    return sizeof(Entry) + entry.tags.size() * sizeof(int) + entry.confidences.size() * sizeof(float) +
+           sizeof(CacheKey) + sizeof(size_t) + 2 * sizeof(void*);
+}
+
+/*
+make the key of a sentence. The two halves are computed by FNV-1a and by
+a multiply-xorshift hash, and each token is ended by its length so that
+e.g. ("ab", "c") and ("a", "bc") have different keys.
+>>> tokens - the sentence
+>>> version - version of the model
+<<< the key
+*/
+CacheKey ResultCache::MakeKey(const vector<string>& tokens, uint64_t version)
+{
+    uint64_t h1 = 0xcbf29ce484222325ULL;
+    uint64_t h2 = Mix64(version + 0x9e3779b97f4a7c15ULL);
+
+    for (const auto& token : tokens) {
+        for (unsigned char c : token) {
+            h1 = (h1 ^ c) * 0x100000001b3ULL;
+            h2 = (h2 ^ c) * 0x9e3779b97f4a7c15ULL;
+            h2 ^= h2 >> 29;
+        }
+        h1 = (h1 ^ token.size()) * 0x100000001b3ULL;
+        h2 = (h2 ^ token.size()) * 0x9e3779b97f4a7c15ULL;
+        h2 ^= h2 >> 29;
+    }
+
+    CacheKey key;
+    key.h1 = Mix64(h1 ^ Mix64(version) ^ tokens.size());
+    key.h2 = Mix64(h2 + tokens.size());
+    return key;
+}
+
+/*
+look up a sentence
+>>> key - key of the sentence
+>>> tags - the tag ids (if it is found)
+>>> confidences - the confidences of the tags (NULL if they are not required). An entry
+                  without confidences is regarded as a miss if they are required
+<<< return - whether the sentence is found
+*/
+bool ResultCache::Get(const CacheKey& key, vector<int>& tags, vector<float>* confidences)
+{
+    lock_guard<mutex> guard(lock);
+    stat.lookupNum++;
+
+    auto it = index.find(key);
+    if (it == index.end())
+        return false;
+
+    Entry& entry = slots[it->second];
+    if (confidences != NULL && entry.confidences.size() != entry.tags.size())
+        return false;
+
+    entry.isReferenced = true;
+    tags = entry.tags;
+    if (confidences != NULL)
+        *confidences = entry.confidences;
+
+    stat.hitNum++;
+    stat.savedTokenNum += tags.size();
+    return true;
+}
+
+/*
+remove the entry in a slot
+>>> slot - the slot
+*/
+void ResultCache::Remove(size_t slot)
+{
+    Entry& entry = slots[slot];
+    index.erase(entry.key);
+    stat.usedBytes -= EntryCost(entry);
+    stat.entryNum--;
+    entry.isUsed = false;
+    vector<int>().swap(entry.tags);
+    vector<float>().swap(entry.confidences);
+    freeSlots.push_back(slot);
+}
+
+/* evict an entry. The clock hand skips (and clears) the entries that are visited recently */
+void ResultCache::Evict()
+{
+    while (true) {
+        if (hand >= slots.size())
+            hand = 0;
+
+        Entry& entry = slots[hand];
+        if (entry.isUsed && entry.isReferenced) {
+            entry.isReferenced = false;
+        }
+        else if (entry.isUsed) {
+            Remove(hand++);
+            stat.evictNum++;
+            return;
+        }
+        hand++;
+    }
+}
+
+/*
+put the result of a sentence in the cache. Old entries are evicted if
+the budget is exceeded.
+>>> key - key of the sentence
+>>> tags - the tag ids
+>>> confidences - the confidences of the tags (it can be empty)
+*/
+void ResultCache::Put(const CacheKey& key, const vector<int>& tags, const vector<float>& confidences)
+{
+    Entry newEntry;
+    newEntry.tags = tags;
+    newEntry.confidences = confidences;
+    size_t cost = EntryCost(newEntry);
+
+    lock_guard<mutex> guard(lock);
+    if (cost > budget)
+        return;
+
+    /* replace the old result */
+    auto it = index.find(key);
+    if (it != index.end())
+        Remove(it->second);
+
+    while (stat.usedBytes + cost > budget)
+        Evict();
+
+    size_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = slots.size();
+        slots.emplace_back();
+    }
+
+    Entry& entry = slots[slot];
+    entry.key = key;
+    entry.tags.swap(newEntry.tags);
+    entry.confidences.swap(newEntry.confidences);
+    entry.isUsed = true;
+    entry.isReferenced = false;
+    index[key] = slot;
+
+    stat.usedBytes += cost;
+    stat.entryNum++;
+    stat.insertNum++;
+}
+
+/* get the statistics */
+CacheStat ResultCache::GetStat()
+{
+    lock_guard<mutex> guard(lock);
+    return stat;
+}
+
+/*
+show the statistics
+>>> name - name of the cache
+*/
+void ResultCache::ShowStat(const char* name)
+{
+    CacheStat s = GetStat();
+    fprintf(stderr, "[%s] budget=%zuB, used=%zuB, entries=%zu, lookups=%zu, hits=%zu (%.2f%%), "
+            "saved tokens=%zu, insertions=%zu, evictions=%zu\n",
+            name, budget, s.usedBytes, s.entryNum, s.lookupNum, s.hitNum,
+            s.lookupNum > 0 ? 100.0 * s.hitNum / s.lookupNum : 0.0,
+            s.savedTokenNum, s.insertNum, s.evictNum);
+}
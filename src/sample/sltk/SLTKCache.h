@@ -0,0 +1,146 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A sentence-level cache of the tagging results. Duplicated inputs (e.g., retweets
+ * and templates) are looked up by a 128-bit hash of the tokens and the model version,
+ * and are dropped from the batch before the tensors are built. The memory is bounded
+ * and the entries are evicted with the CLOCK (second-chance) algorithm.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+/* key of a sentence (a 128-bit hash of the tokens and the model version) */
+struct CacheKey
+{
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    bool operator==(const CacheKey& other) const { return h1 == other.h1 && h2 == other.h2; }
+};
+
+/* hash function of the keys for unordered_map */
+struct CacheKeyHash
+{
+    size_t operator()(const CacheKey& key) const { return size_t(key.h1); }
+};
+
+/* statistics of a cache */
+struct CacheStat
+{
+    /* number of lookups */
+    size_t lookupNum = 0;
+
+    /* number of hits */
+    size_t hitNum = 0;
+
+    /* number of tokens we do not compute because of the hits */
+    size_t savedTokenNum = 0;
+
+    /* number of insertions */
+    size_t insertNum = 0;
+
+    /* number of evicted entries */
+    size_t evictNum = 0;
+
+    /* number of entries in the cache */
+    size_t entryNum = 0;
+
+    /* bytes used by the entries */
+    size_t usedBytes = 0;
+};
+
+/* the result cache */
+class ResultCache
+{
+private:
+    /* an entry (a slot of the clock) */
+    struct Entry
+    {
+        CacheKey key;
+
+        /* tag ids of the sentence */
+        vector<int> tags;
+
+        /* confidences of the tags (empty if they are not computed) */
+        vector<float> confidences;
+
+        /* is the slot occupied */
+        bool isUsed = false;
+
+        /* is the entry visited since the clock hand passed it last time */
+        bool isReferenced = false;
+    };
+
+    /* max number of bytes the entries can use */
+    size_t budget;
+
+    /* the slots of the clock */
+    vector<Entry> slots;
+
+    /* the free slots */
+    vector<size_t> freeSlots;
+
+    /* position of the clock hand */
+    size_t hand = 0;
+
+    /* key -> slot */
+    unordered_map<CacheKey, size_t, CacheKeyHash> index;
+
+    /* statistics */
+    CacheStat stat;
+
+    mutex lock;
+
+    /* memory footprint of an entry */
+    static size_t EntryCost(const Entry& entry);
+
+    /* remove the entry in a slot */
+    void Remove(size_t slot);
+
+    /* evict an entry with the clock algorithm */
+    void Evict();
+
+public:
+    /* constructor */
+    explicit ResultCache(size_t myBudget);
+
+    /* make the key of a sentence */
+    static CacheKey MakeKey(const vector<string>& tokens, uint64_t version);
+
+    /* look up a sentence */
+    bool Get(const CacheKey& key, vector<int>& tags, vector<float>* confidences = NULL);
+
+    /* put the result of a sentence in the cache */
+    void Put(const CacheKey& key, const vector<int>& tags, const vector<float>& confidences = vector<float>());
+
+    /* get the statistics */
+    CacheStat GetStat();
+
+    /* show the statistics */
+    void ShowStat(const char* name);
+};
@@ -23,6 +23,7 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 #include "StringUtil.h"
 #include "SLTKDataSet.h"
@@ -31,63 +32,169 @@
 
 using namespace std;
 
-/* load data from column-format file */
+/*
+open a column-format file. Nothing is read until a batch is required.
+>>> src - the file name
+*/
 void DataSet::LoadFromFile(const string& src)
 {
-    ifstream f(src, ios::in);
+    file = fopen(src.c_str(), "rb");
+    CheckNTErrors(file != nullptr, "cannot open the input file");
+
+    begin = 0;
+    end = 0;
+    isEOF = false;
+    scanPos = 0;
+    loadedNum = 0;
+}
 
-    /* read tokens */
-    int pos = 0;
-    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-    auto sentences = SplitString(str, "\n\n");
+/*
+read more data into the buffer. The characters that have not been parsed are
+moved to the front, and the buffer is enlarged only if a sentence does not fit
+in it.
+*/
+void DataSet::Fill()
+{
+    if (begin > 0) {
+        memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        scanPos = scanPos > begin ? scanPos - begin : 0;
+        begin = 0;
+    }
 
-    buffers.reserve(sentences.size());
+    if (end == buffer.size())
+        buffer.resize(buffer.size() * 2);
 
-    /* convert tokens to ids */
-    for (const auto& sent : sentences)
-        buffers.emplace_back(SplitString(sent, "\n"));
+    size_t n = fread(buffer.data() + end, 1, buffer.size() - end, file);
+    end += n;
 
-    bufferSize = buffers.size();
+    if (n == 0 || feof(file))
+        isEOF = true;
 }
 
 /*
-load a batch of sentences from the buffer
+parse the next sentence from the buffer. The tokens (lines) are kept in
+"tokens" as views over the buffer, and they are valid until the next call.
+<<< return - false if there are no more sentences
+*/
+bool DataSet::NextSentence()
+{
+    tokens.clear();
+
+    while (true) {
+        /* skip the empty lines */
+        while (begin < end && (buffer[begin] == '\n' || buffer[begin] == '\r'))
+            begin++;
+
+        /* find an empty line (or the end of the data) that ends the sentence. After
+           a Fill we go on from the last line we have seen (from its '\n', so that
+           the empty line after it is checked again), rather than from begin */
+        const char* data = buffer.data();
+        size_t pos = scanPos > begin ? scanPos - 1 : begin;
+        bool isComplete = false;
+        while (pos < end) {
+            const char* p = (const char*)memchr(data + pos, '\n', end - pos);
+            if (p == nullptr)
+                break;
+            pos = p - data + 1;
+            size_t next = pos;
+            if (next < end && data[next] == '\r')
+                next++;
+            if (next < end && data[next] == '\n') {
+                isComplete = true;
+                break;
+            }
+        }
+
+        if (!isComplete && !isEOF) {
+            scanPos = pos;
+            Fill();
+            continue;
+        }
+        scanPos = 0;
+
+        if (!isComplete)
+            pos = end;
+
+        /* split the sentence into lines */
+        size_t lineBegin = begin;
+        while (lineBegin < pos) {
+            const char* p = (const char*)memchr(data + lineBegin, '\n', pos - lineBegin);
+            size_t lineEnd = p != nullptr ? p - data : pos;
+            size_t size = lineEnd - lineBegin;
+            if (size > 0 && data[lineBegin + size - 1] == '\r')
+                size--;
+            if (size > 0)
+                tokens.emplace_back(data + lineBegin, size);
+            lineBegin = lineEnd + 1;
+        }
+
+        begin = pos;
+
+        if (!tokens.empty())
+            return true;
+        if (begin >= end && isEOF)
+            return false;
+    }
+}
+
+/*
+load a batch of sentences from the file
 >>> batchSize - as it is
+<<< return - the sentences (an empty batch means the end of the data)
 */
 vector<vector<string>> DataSet::LoadBatch(int batchSize)
 {
-    CheckNTErrors(batchSize > 0 && batchSize <= bufferSize, "invalid batch size");
-
-    /* calculate the real batch size */
-    int bsz = (cur + batchSize) > int(bufferSize) ? int(bufferSize) - cur : batchSize;
-
-    /* load data to a mini-batch */
-    vector<vector<string>> batch(buffers.begin() + cur, buffers.begin() + cur + bsz);
-
-    cur += bsz;
+    CheckNTErrors(batchSize > 0, "invalid batch size");
+
+    vector<vector<string>> batch;
+    batch.reserve(batchSize);
+
+    /* the tokens are copied out before the buffer is refilled */
+    while (int(batch.size()) < batchSize && NextSentence()) {
+        batch.emplace_back();
+        auto& sent = batch.back();
+        sent.reserve(tokens.size());
+        for (const auto& token : tokens)
+            sent.emplace_back(token.data, token.size);
+    }
 
-    //sort(batch.begin(), batch.end(), [](auto& a, auto& b) {return a.size() > b.size();});
+    loadedNum += batch.size();
 
     return batch;
 }
 
-/* reset index of the current data entry */
+/* reset to the beginning of the file */
 void DataSet::Reset()
 {
-    cur = 0;
+    fseek(file, 0, SEEK_SET);
+    begin = 0;
+    end = 0;
+    isEOF = false;
+    scanPos = 0;
+    loadedNum = 0;
 }
 
 /*
 constructor
->>> myDev - device id
+>>> src - the file name
 >>> myShuffle - shuffle the data or not
+>>> myBufferSize - size of the input buffer (in bytes)
 */
-DataSet::DataSet(const string& src, bool myShuffle)
+DataSet::DataSet(const string& src, bool myShuffle, size_t myBufferSize)
 {
     isShuffled = myShuffle;
+    buffer.resize(myBufferSize > 0 ? myBufferSize : DATASET_BUFFER_SIZE);
     LoadFromFile(src);
 }
 
+/* de-constructor */
+DataSet::~DataSet()
+{
+    if (file != nullptr)
+        fclose(file);
+}
+
 /* load a vocabulary from a file */
 void Vocab::Load(const string& src)
 {
@@ -24,6 +24,7 @@
 #include <cstdio>
 #include <memory>
 #include <unordered_map>
+#include "StringUtil.h"
 #include "../../tensor/XTensor.h"
 
 using namespace std;
@@ -55,33 +56,66 @@ struct Vocab
     void Save(const string& src);
 };
 
-/* the dataset class for sequence labeling */
+/* default size of the input buffer (in bytes) */
+constexpr size_t DATASET_BUFFER_SIZE = 1 << 20;
+
+/* the dataset class for sequence labeling. The input file (column-format, one
+   token per line and sentences separated by empty lines) is read in a streaming
+   manner, that is, we keep a fixed-size buffer of the file and parse sentences from
+   it when a batch is required. So the memory footprint is proportional to the
+   batch rather than the corpus. */
 class DataSet
 {
 private:
-    /* tokens and tags */
-    vector<vector<string>> buffers;
+    /* the input file */
+    FILE* file = nullptr;
+
+    /* the input buffer */
+    vector<char> buffer;
+
+    /* the characters in [begin, end) of the buffer have not been parsed */
+    size_t begin = 0;
+    size_t end = 0;
 
-    /* current index for batching */
-    int cur = 0;
+    /* where the search for the end of the current sentence goes on after a
+       Fill, i.e., the start of the last line that is not known to end it */
+    size_t scanPos = 0;
+
+    /* indicates whether all the data has been read into the buffer */
+    bool isEOF = false;
+
+    /* tokens of the current sentence (views over the input buffer) */
+    vector<StringPiece> tokens;
 
     /* use shuffled batch or not */
     bool isShuffled = false;
 
-    /* load dataset from a text file (column-fomat) */
+    /* open a text file (column-fomat) for streaming */
     void LoadFromFile(const string& src);
 
-    /* reset index of the current data entry */
-    void Reset();
+    /* read more data into the buffer */
+    void Fill();
+
+    /* parse the next sentence from the buffer */
+    bool NextSentence();
 
 public:
 
-    /* buffer size */
-    size_t bufferSize;
+    /* number of sentences that have been loaded (since the file is opened or reset) */
+    size_t loadedNum = 0;
 
-    /* load a batch of sentences from the buffer */
+    /* load a batch of sentences (an empty batch means the end of the data) */
     vector<vector<string>> LoadBatch(int batchSize);
 
+    /* reset to the beginning of the file */
+    void Reset();
+
     /* constructor */
-    DataSet(const string& src, bool myShuffle = false);
+    DataSet(const string& src, bool myShuffle = false, size_t myBufferSize = DATASET_BUFFER_SIZE);
+
+    /* de-constructor */
+    ~DataSet();
+
+    DataSet(const DataSet&) = delete;
+    DataSet& operator=(const DataSet&) = delete;
 };
\ No newline at end of file
@@ -22,6 +22,8 @@
 #include "StringUtil.h"
 #include "SLTKEmbedding.h"
 #include "../../tensor/core/CHeader.h"
+#include "../../tensor/XMemStat.h"
+#include <algorithm>
 #include <iostream>
 
 /*
@@ -38,28 +40,102 @@ void Embedding::LoadWordEmbedding(const char* file)
     fread(&vocabSize, sizeof(vocabSize), 1, embFile);
     fread(&embSize, sizeof(embSize), 1, embFile);
 
+    XMemCategoryScope scope(MEM_EMBEDDING);
     InitTensor2DV2(&vec, vocabSize, embSize, X_FLOAT, devID);
     vec.BinaryRead(embFile, vocabSize * embSize);
     fclose(embFile);
 }
 
+/*
+load product-quantized embeddings from file. The file is made by
+tool/quantize_embeddings.py, and it consists of
+vocabSize, embSize, subNum, centroidNum (size_t),
+the codebooks, (subNum, centroidNum, embSize / subNum) (float),
+the codes, (vocabSize, subNum) (uint8).
+The word i is approximated by the concatenation of codebooks[m][codes[i][m]] over the sub-spaces.
+>>> file - the quantized embeddings file
+*/
+void Embedding::LoadQuantizedEmbedding(const char* file)
+{
+    FILE* embFile = fopen(file, "rb");
+    CheckNTErrors(embFile != NULL, "cannot open the quantized embeddings!");
+
+    fread(&vocabSize, sizeof(vocabSize), 1, embFile);
+    fread(&embSize, sizeof(embSize), 1, embFile);
+    fread(&subNum, sizeof(subNum), 1, embFile);
+    fread(&centroidNum, sizeof(centroidNum), 1, embFile);
+    CheckNTErrors(subNum > 0 && embSize % subNum == 0, "the sub-spaces do not divide the embedding!");
+    CheckNTErrors(centroidNum > 0 && centroidNum <= 256, "there are at most 256 centroids in a sub-space!");
+
+    codebooks.resize(centroidNum * embSize);
+    codes.resize(vocabSize * subNum);
+    size_t n = fread(codebooks.data(), sizeof(float), codebooks.size(), embFile);
+    n += fread(codes.data(), sizeof(uint8_t), codes.size(), embFile);
+    CheckNTErrors(n == codebooks.size() + codes.size(), "the quantized embeddings are incomplete!");
+    fclose(embFile);
+}
+
+/* memory footprint of the table (in bytes) */
+size_t Embedding::GetTableSize() const
+{
+    if (isQuantized)
+        return centroidNum * embSize * sizeof(float) + vocabSize * subNum * sizeof(uint8_t);
+    return vocabSize * embSize * sizeof(float);
+}
+
+/*
+make a copy of the table on each NUMA node. Embed reads the rows from the
+copy of the node that the thread runs on. The table is read-only (inference),
+so the source is released if it is not one of the copies.
+>>> nodes - the nodes (NULL for all the nodes that have cpus)
+>>> nodeNum - number of the nodes
+*/
+void Embedding::Replicate(const int* nodes, int nodeNum)
+{
+    XMemCategoryScope scope(MEM_EMBEDDING);
+    CheckNTErrors(!vecReplica.isReady && !codesReplica.isReady, "The table is replicated already!");
+
+    if (isQuantized) {
+        codesReplica.Init(codes.data(), codes.size() * sizeof(uint8_t), nodes, nodeNum);
+        codebooksReplica.Init(codebooks.data(), codebooks.size() * sizeof(float), nodes, nodeNum);
+        if (codesReplica.copyNum > 0 && codesReplica.sourceNode < 0)
+            vector<uint8_t>().swap(codes);
+        if (codebooksReplica.copyNum > 0 && codebooksReplica.sourceNode < 0)
+            vector<float>().swap(codebooks);
+    }
+    else if (devID < 0) {
+        vecReplica.Init(&vec, nodes, nodeNum);
+        if (vecReplica.copyNum > 0 && vecReplica.sourceNode < 0)
+            vec.DestroyData();
+    }
+}
+
 /*
 constructor
 >>> myDevID - device
 >>> file - the pre-trained embeddings file
+>>> myIsQuantized - use the product-quantized table (in file + ".pq") or not
 */
-Embedding::Embedding(int myDevID, const char* file)
+Embedding::Embedding(int myDevID, const char* file, bool myIsQuantized)
 {
     devID = myDevID;
+    isQuantized = myIsQuantized;
+    subNum = 0;
+    centroidNum = 0;
 
-    LoadWordEmbedding(file);
+    if (isQuantized) {
+        embVocab.Load(ConcatString(file, ".vocab"));
+        LoadQuantizedEmbedding(ConcatString(file, ".pq").c_str());
+    }
+    else
+        LoadWordEmbedding(file);
 }
 
 /*
 set word embeddings for a batch of sentences
 >>> input - the input sentences
 */
-XTensor Embedding::Embed(const vector<vector<string>>& input)
+XTensor Embedding::Embed(const vector<vector<string>>& input) const
 {
     XTensor idx;
     int bsz = input.size();
@@ -72,14 +148,61 @@ XTensor Embedding::Embed(const vector<vector<string>>& input)
     memset(indices, 0, sizeof(int) * bsz * maxLen);
     for (int i = 0; i < bsz; i++) {
         for (int j = 0; j < input[i].size(); j++) {
-            if (embVocab.word2id.find(input[i][j]) != embVocab.word2id.end())
-                indices[i * maxLen + j] = embVocab.word2id[input[i][j]];
+            auto it = embVocab.word2id.find(input[i][j]);
+            if (it != embVocab.word2id.end())
+                indices[i * maxLen + j] = it->second;
         }
     }
-    idx.SetData(indices, bsz * maxLen);
+    if (!isQuantized && !vecReplica.isReady) {
+        idx.SetData(indices, bsz * maxLen);
+        delete[] indices;
+        return Gather(vec, idx);
+    }
+
+    /* the rows are copied (or decoded) by the threads, and each of them reads
+       the copy of the table of its NUMA node */
+    XTensor output;
+    InitTensor3DV2(&output, bsz, maxLen, embSize, X_FLOAT, devID);
+
+    if (!isQuantized) {
+        float* data = (float*)output.data;
+        XParallelFor(0, bsz * maxLen, 64, [&](int begin, int end) {
+            const float* table = (const float*)vecReplica.Get();
+            for (int i = begin; i < end; i++)
+                memcpy(data + (size_t)i * embSize, table + (size_t)indices[i] * embSize, sizeof(float) * embSize);
+        });
+        delete[] indices;
+        return output;
+    }
+
+    /* gather and decode the quantized vectors into the output */
+    vector<float> buffer;
+    float* data = (float*)output.data;
+    if (devID >= 0) {
+        buffer.resize(bsz * maxLen * embSize);
+        data = buffer.data();
+    }
+
+    size_t subSize = embSize / subNum;
+    XParallelFor(0, bsz * maxLen, 64, [&](int begin, int end) {
+        const uint8_t* codeTable = codesReplica.isReady ? (const uint8_t*)codesReplica.Get() : codes.data();
+        const float* books = codebooksReplica.isReady ? (const float*)codebooksReplica.Get() : codebooks.data();
+        for (int i = begin; i < end; i++) {
+            const uint8_t* code = codeTable + indices[i] * subNum;
+            float* v = data + (size_t)i * embSize;
+            for (size_t m = 0; m < subNum; m++) {
+                const float* centroid = books + (m * centroidNum + code[m]) * subSize;
+                for (size_t k = 0; k < subSize; k++)
+                    v[m * subSize + k] = centroid[k];
+            }
+        }
+    });
     delete[] indices;
 
-    return Gather(vec, idx);
+    if (devID >= 0)
+        output.SetData(buffer.data(), output.unitNum);
+
+    return output;
 }
 
 /* get embeddings of the inputs */
@@ -89,46 +212,184 @@ XTensor StackEmbedding::Embed(const vector<vector<string>>& input)
     for (int i = 1; i < staticEmbeddings.size(); i++) {
         emb = Concatenate(emb, staticEmbeddings[i]->Embed(input), 2);
     }
+    for (auto lm : languageModels) {
+        emb = Concatenate(emb, lm->GetRepresentation(input), 2);
+    }
     return emb;
 }
 
+/*
+add a character language model
+>>> file - the character vocabulary of the LM
+>>> inSize - the character embedding size
+>>> outSize - the hidden size of the LM
+>>> isForward - does the LM read the sentences from left to right
+*/
+void StackEmbedding::AddLanguageModel(const char* file, int inSize, int outSize, bool isForward)
+{
+    languageModels.push_back(new LanguageModel(devID, file, inSize, outSize, isForward));
+}
+
 /*
 constructor
 >>> myDevID - device
 >>> files - a list of pre-trained embedding files
+>>> isQuantized - use the product-quantized tables or not
 */
-StackEmbedding::StackEmbedding(int myDevID, vector<const char*> files)
+StackEmbedding::StackEmbedding(int myDevID, vector<const char*> files, bool isQuantized)
 {
     devID = myDevID;
     for (auto file : files)
-        staticEmbeddings.push_back(new Embedding(devID, file));
+        staticEmbeddings.push_back(make_shared<Embedding>(devID, file, isQuantized));
+}
+
+/*
+constructor
+>>> myDevID - device
+>>> embeddings - the loaded embeddings (e.g., the shared ones of a model registry)
+*/
+StackEmbedding::StackEmbedding(int myDevID, const vector<shared_ptr<const Embedding>>& embeddings)
+{
+    devID = myDevID;
+    staticEmbeddings = embeddings;
+    for (const auto& emb : staticEmbeddings)
+        CheckNTErrors(emb->devID == devID, "the embeddings are on another device!");
 }
 
 /* de-constructor */
 StackEmbedding::~StackEmbedding()
 {
-    for (auto emb : staticEmbeddings)
-        delete emb;
+    for (auto lm : languageModels)
+        delete lm;
 }
 
-/* load pretrained LM from files */
+/*
+load pretrained LM from files. Here we load the character vocabulary, and the
+weights are registered in (and loaded with) the model that uses the LM.
+The vocabulary has the same format as the others, where the line break and
+the space are written as \n and \s (a backslash and a letter) respectively.
+>>> file - the character vocabulary file
+*/
 void LanguageModel::LoadPretrainedLM(const char* file)
 {
+    charVocab.Load(file);
+    CheckNTErrors(charVocab.vocabSize > 0, "empty character vocabulary!");
 }
 
-/* get the contextual representation of inputs */
-void LanguageModel::GetRepresentation(const vector<vector<string>>& input)
+/*
+split a (UTF-8) token into characters
+>>> token - the token
+<<< the characters
+*/
+vector<string> SplitCharacters(const string& token)
+{
+    vector<string> chars;
+    for (size_t i = 0; i < token.size();) {
+        unsigned char c = token[i];
+        size_t n = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 1;
+        chars.push_back(token.substr(i, n));
+        i += n;
+    }
+    return chars;
+}
+
+/*
+get the contextual representation of inputs. Each sentence is turned into a
+sequence of characters, i.e., "\n" + the tokens separated by " " + " " (reversed for
+the backward LM), and the character sequences of the batch go through the LSTM as
+packed sequences in one pass. The representation of a token is the hidden state at
+the space that follows it (in the reading direction).
+>>> input - the input sentences
+<<< the representations, (bsz, maxLen, outSize), zeros for padding
+*/
+XTensor LanguageModel::GetRepresentation(const vector<vector<string>>& input)
 {
+    int bsz = input.size();
+    int maxLen = 0;
+    for (const auto& sent : input)
+        maxLen = max(maxLen, int(sent.size()));
+
+    auto unk = charVocab.word2id.find("<unk>");
+    int unkID = unk != charVocab.word2id.end() ? unk->second : 0;
+    auto GetID = [&](const string& c) {
+        auto it = charVocab.word2id.find(c);
+        return it != charVocab.word2id.end() ? it->second : unkID;
+    };
+    int startID = GetID("\\n");
+    int spaceID = GetID("\\s");
+
+    /* the characters of each sentence and the positions of the word boundaries */
+    vector<vector<int>> chars(bsz);
+    vector<vector<int>> bounds(bsz);
+    vector<int> lengths(bsz);
+    int maxChars = 0;
+    for (int i = 0; i < bsz; i++) {
+        int len = input[i].size();
+        bounds[i].resize(len);
+        chars[i].push_back(startID);
+        for (int k = 0; k < len; k++) {
+            int j = isForward ? k : len - 1 - k;
+            auto token = SplitCharacters(input[i][j]);
+            if (!isForward)
+                reverse(token.begin(), token.end());
+            for (const auto& c : token)
+                chars[i].push_back(GetID(c));
+            bounds[i][j] = chars[i].size();
+            chars[i].push_back(spaceID);
+        }
+        lengths[i] = chars[i].size();
+        maxChars = max(maxChars, lengths[i]);
+    }
+
+    XTensor idx;
+    InitTensor2DV2(&idx, bsz, maxChars, X_INT, devID);
+    vector<int> indices(bsz * maxChars, 0);
+    for (int i = 0; i < bsz; i++)
+        copy(chars[i].begin(), chars[i].end(), indices.begin() + i * maxChars);
+    idx.SetData(indices.data(), bsz * maxChars);
+
+    XTensor hiddens = rnn->Forward(Gather(*Get("CharEmbedding"), idx), lengths);
+    hiddens.Reshape(bsz * maxChars, outSize);
+
+    /* gather the states at the word boundaries */
+    XTensor output;
+    InitTensor2DV2(&output, bsz * maxLen, outSize, X_FLOAT, devID);
+    output.SetZeroAll();
+
+    vector<int> srcIdx;
+    vector<int> tgtIdx;
+    for (int i = 0; i < bsz; i++) {
+        for (int j = 0; j < bounds[i].size(); j++) {
+            srcIdx.push_back(i * maxChars + bounds[i][j]);
+            tgtIdx.push_back(i * maxLen + j);
+        }
+    }
+    if (!srcIdx.empty())
+        _CopyIndexed(&hiddens, &output, 0, srcIdx.data(), int(srcIdx.size()), tgtIdx.data());
+
+    int dims[] = { bsz, maxLen, outSize };
+    output.Reshape(3, dims);
+    return output;
 }
 
 /*
 constructor
 >>> myDevID - device
->>> file - the pre-trained embeddings file
+>>> file - the character vocabulary file
+>>> myInSize - the character embedding size
+>>> myOutSize - the hidden size of the LM
+>>> myIsForward - does the LM read the sentences from left to right
 */
-LanguageModel::LanguageModel(int myDevID, const char* file)
+LanguageModel::LanguageModel(int myDevID, const char* file, int myInSize, int myOutSize, bool myIsForward)
 {
     devID = myDevID;
+    inSize = myInSize;
+    outSize = myOutSize;
+    isForward = myIsForward;
 
     LoadPretrainedLM(file);
+
+    rnn = make_shared<LSTM>(inSize, outSize, 1, false);
+    Register("CharEmbedding", { charVocab.vocabSize, inSize }, X_FLOAT);
+    Register("RNN", *rnn);
 }
\ No newline at end of file
@@ -21,10 +21,14 @@
 
 #pragma once
 
+#include <memory>
 #include <initializer_list>
 #include "SLTKDataSet.h"
+#include "SLTKLSTMCell.h"
+#include "../../model/Model.h"
 #include "../../tensor/XTensor.h"
 #include "../../tensor/XGlobal.h"
+#include "../../tensor/XNuma.h"
 
 using namespace nts;
 using namespace std;
@@ -46,35 +50,73 @@ struct Embedding
     /* the pre-trained word embeddings */
     XTensor vec;
 
+    /* is the table product-quantized (the codes and codebooks are used instead of vec) */
+    bool isQuantized;
+
+    /* number of sub-spaces of the product quantization */
+    size_t subNum;
+
+    /* number of centroids in each sub-space */
+    size_t centroidNum;
+
+    /* the codebooks, (subNum, centroidNum, embSize / subNum) */
+    vector<float> codebooks;
+
+    /* the codes of the words, (vocabSize, subNum) */
+    vector<uint8_t> codes;
+
+    /* the copies of vec (or of the codes and codebooks) on the NUMA nodes */
+    XNumaReplica vecReplica;
+    XNumaReplica codesReplica;
+    XNumaReplica codebooksReplica;
+
     /* constructor */
-    explicit Embedding(int myDevID, const char* embFile);
+    explicit Embedding(int myDevID, const char* embFile, bool myIsQuantized = false);
 
     /* load embeddings from files */
     void LoadWordEmbedding(const char* file);
 
-    /* set word embeddings for a batch of sentences */
-    XTensor Embed(const vector<vector<string>>& input);
+    /* load product-quantized embeddings from files */
+    void LoadQuantizedEmbedding(const char* file);
+
+    /* memory footprint of the table (in bytes) */
+    size_t GetTableSize() const;
+
+    /* make a copy of the table (on CPUs) on each NUMA node (once, for inference) */
+    void Replicate(const int* nodes = NULL, int nodeNum = 0);
+
+    /* set word embeddings for a batch of sentences (the table is read-only, so
+       an embedding can be shared by the models and threads) */
+    XTensor Embed(const vector<vector<string>>& input) const;
 };
 
-struct LanguageModel
+/* a character-level language model (e.g., the forward and backward LMs of flair),
+   whose hidden states at the word boundaries are used as contextual embeddings */
+struct LanguageModel : public Model
 {
-    /* device id */
-    int devID;
-
-    /* input size */
+    /* input size (the character embedding size) */
     int inSize;
 
-    /* output size */
+    /* output size (the hidden size of the LSTM) */
     int outSize;
 
+    /* does the LM read the sentences from left to right */
+    bool isForward;
+
+    /* the character vocabulary */
+    Vocab charVocab;
+
+    /* the LSTM */
+    shared_ptr<LSTM> rnn;
+
     /* constructor */
-    LanguageModel(int myDevID, const char* file);
+    LanguageModel(int myDevID, const char* file, int myInSize, int myOutSize, bool myIsForward);
 
     /* load pretrained LM from files */
     void LoadPretrainedLM(const char* file);
 
     /* get the contextual representation of inputs */
-    void GetRepresentation(const vector<vector<string>>& input);
+    XTensor GetRepresentation(const vector<vector<string>>& input);
 };
 
 struct StackEmbedding
@@ -82,14 +124,23 @@ struct StackEmbedding
 public:
     int devID;
 
-    /* stack of multiple embeddings */
-    vector<Embedding*> staticEmbeddings;
+    /* stack of multiple embeddings (they can be shared with other models) */
+    vector<shared_ptr<const Embedding>> staticEmbeddings;
+
+    /* character language models (their embeddings follow the static ones) */
+    vector<LanguageModel*> languageModels;
 
     /* get embeddings of inputs */
     XTensor Embed(const vector<vector<string>>& input);
 
+    /* add a character language model */
+    void AddLanguageModel(const char* file, int inSize, int outSize, bool isForward);
+
     /* constructor */
-    StackEmbedding(int myDevID, vector<const char*> files);
+    StackEmbedding(int myDevID, vector<const char*> files, bool isQuantized = false);
+
+    /* constructor (with the loaded embeddings) */
+    StackEmbedding(int myDevID, const vector<shared_ptr<const Embedding>>& embeddings);
 
     /* de-constructor */
     ~StackEmbedding();
@@ -26,6 +26,7 @@
 #include "SLTKLSTMCell.h"
 #include "../../tensor/core/CHeader.h"
 #include "../../tensor/function/FHeader.h"
+#include "../../tensor/XExpression.h"
 
 /*
 constructor
@@ -42,10 +43,14 @@ LSTM::LSTM(int myInputDim, int myHiddenDim, int myLayerNum, bool myBidirectional
     layerNum = myLayerNum;
     bidirectional = myBidirectional;
 
+    CheckNTErrors(layerNum > 0, "the lstm needs at least one layer!");
+
     int numPerLayer = bidirectional ? 2 : 1;
 
+    /* the first layer reads the input, and the others read the output of the previous layer */
     for (int i = 0; i < layerNum * numPerLayer; i++) {
-        auto cell = make_shared<LSTMCell>(inputDim, hiddenDim, i);
+        int cellInputDim = i < numPerLayer ? inputDim : hiddenDim * numPerLayer;
+        auto cell = make_shared<LSTMCell>(cellInputDim, hiddenDim, i);
         cells.push_back(cell);
         Register("LSTMCell", *cell);
     }
@@ -63,74 +68,128 @@ vector<int> GetRange(int size, bool isReversed)
 }
 
 /*
-lstm forward function
+lstm forward function over packed sequences. Sentences are visited in the
+descending order of their lengths, so that the sentences that are still
+active at a timestep are always a prefix of the batch. The batch shrinks
+(forward direction) or grows (backward direction) as sentences end or start,
+and no computation is spent on padding. The backward direction starts each
+sentence at its own last token.
 >>> input - (batchSize, maxLen, inputDim)
-<<< hiddens - (batchSize, maxLen, hiddenDim (x2 if bidirectional is true))
+>>> lengths - length of each sentence (all sentences have maxLen tokens if it is empty)
+<<< hiddens - (batchSize, maxLen, hiddenDim (x2 if bidirectional is true)),
+              the hidden states of padding positions are zeros
 */
-XTensor LSTM::Forward(const XTensor& input)
+XTensor LSTM::Forward(const XTensor& input, const vector<int>& lengths)
 {
-    TensorList timeSteps;
-    Split(input, timeSteps, 1);
-
-    bool isReversed = false;
     int bsz = input.GetDim(0);
     int maxLen = input.GetDim(1);
 
-    /* input of a lstm */
-    XTensor fwdHidden, bwdHidden;
-    XTensor fwdMemory, bwdMemory;
-
-    /* output of a lstm */
-    XTensor fwdHiddens, bwdHiddens;
-
-    /* initialize the hidden and memory */
-    InitTensor2DV2(&fwdHidden, bsz, hiddenDim, X_FLOAT, input.devID);
-    InitTensor2DV2(&fwdMemory, bsz, hiddenDim, X_FLOAT, input.devID);
-    InitTensor3DV2(&fwdHiddens, bsz, maxLen, hiddenDim, X_FLOAT, input.devID);
-    fwdHidden.SetZeroAll();
-    fwdMemory.SetZeroAll();
-
-    if (bidirectional) {
-        InitTensor2DV2(&bwdHidden, bsz, hiddenDim, X_FLOAT, input.devID);
-        InitTensor2DV2(&bwdMemory, bsz, hiddenDim, X_FLOAT, input.devID);
-        InitTensor3DV2(&bwdHiddens, bsz, maxLen, hiddenDim, X_FLOAT, input.devID);
-        bwdHidden.SetZeroAll();
-        bwdMemory.SetZeroAll();
+    /* sort the sentences by length (longest first) */
+    vector<int> lens(bsz, maxLen);
+    for (int i = 0; i < bsz && i < lengths.size(); i++)
+        lens[i] = min(lengths[i], maxLen);
+
+    vector<int> order = GetRange(bsz, false);
+    stable_sort(order.begin(), order.end(), [&lens](int a, int b) { return lens[a] > lens[b]; });
+
+    /* number of active sentences at each timestep */
+    vector<int> batchSizes(maxLen, 0);
+    for (int t = 0; t < maxLen; t++) {
+        while (batchSizes[t] < bsz && lens[order[batchSizes[t]]] > t)
+            batchSizes[t]++;
     }
 
+    /* rows of (batchSize * maxLen, dim) tensors for each sentence at each timestep */
+    vector<int> rows(bsz);
+    vector<int> prefix = GetRange(bsz, false);
+
+    /* input of the current layer, (batchSize * maxLen, dim) */
+    XTensor layerInput;
+    InitTensor2DV2(&layerInput, bsz * maxLen, inputDim, X_FLOAT, input.devID);
+    _CopyValues(&input, &layerInput);
+
+    int numPerLayer = bidirectional ? 2 : 1;
+    int dims[] = { bsz, maxLen, hiddenDim };
+
     /* iteration of layers */
-    for (int i = 0; i < cells.size(); i++) {
-        XTensor* hidden = &fwdHidden;
-        XTensor* memory = &fwdMemory;
-        XTensor* hiddens = &fwdHiddens;
-        isReversed = ((i % 2 == 0) && bidirectional) ? true : false;
-        if (isReversed)
-        {
-            hidden = &bwdHidden;
-            memory = &bwdMemory;
-            hiddens = &bwdHiddens;
+    for (int l = 0; l < layerNum; l++) {
+        int layerInputDim = layerInput.GetDim(1);
+
+        /* output of the layer */
+        XTensor fwdHiddens, bwdHiddens;
+        InitTensor2DV2(&fwdHiddens, bsz * maxLen, hiddenDim, X_FLOAT, input.devID);
+        fwdHiddens.SetZeroAll();
+        if (bidirectional) {
+            InitTensor2DV2(&bwdHiddens, bsz * maxLen, hiddenDim, X_FLOAT, input.devID);
+            bwdHiddens.SetZeroAll();
         }
-        auto range = GetRange(input.GetDim(1), isReversed);
-
-        /* iteration of timesteps */
-        for (int idx = 0; idx < range.size(); idx++) {
-            cells[i]->Forward(*timeSteps[idx], *hidden, *memory, i);
-
-            /* collect hidden states of the last layer */
-            if (i == (cells.size() - 1) || (bidirectional && i == cells.size() - 2)) {
-                int srcIdx[]{ 0 };
-                int tgtIdx[]{ idx };
-                int newDim[] = { bsz, 1, hiddenDim };
-                hidden->Reshape(3, newDim);
-                _CopyIndexed(hidden, hiddens, 1, srcIdx, 1, tgtIdx);
-                hidden->Reshape(bsz, hiddenDim);
+
+        /* iteration of directions (the backward one comes first) */
+        for (int d = 0; d < numPerLayer; d++) {
+            int i = l * numPerLayer + d;
+            bool isReversed = (d == 0 && bidirectional) ? true : false;
+            XTensor* hiddens = isReversed ? &bwdHiddens : &fwdHiddens;
+
+            /* hidden and memory states of the active sentences */
+            XTensor hidden, memory;
+            int activeNum = 0;
+
+            auto range = GetRange(maxLen, isReversed);
+
+            /* iteration of timesteps */
+            for (int idx = 0; idx < range.size(); idx++) {
+                int t = range[idx];
+                int batchSize = batchSizes[t];
+                if (batchSize == 0)
+                    continue;
+
+                if (batchSize < activeNum) {
+                    /* some sentences end here */
+                    hidden = SelectRange(hidden, 0, 0, batchSize);
+                    memory = SelectRange(memory, 0, 0, batchSize);
+                }
+                else if (batchSize > activeNum) {
+                    /* some sentences start here (with zero states) */
+                    XTensor newHidden, newMemory;
+                    InitTensor2DV2(&newHidden, batchSize - activeNum, hiddenDim, X_FLOAT, input.devID);
+                    InitTensor2DV2(&newMemory, batchSize - activeNum, hiddenDim, X_FLOAT, input.devID);
+                    newHidden.SetZeroAll();
+                    newMemory.SetZeroAll();
+                    hidden = activeNum > 0 ? Concatenate(hidden, newHidden, 0) : newHidden;
+                    memory = activeNum > 0 ? Concatenate(memory, newMemory, 0) : newMemory;
+                }
+                activeNum = batchSize;
+
+                for (int k = 0; k < batchSize; k++)
+                    rows[k] = order[k] * maxLen + t;
+
+                XTensor step;
+                InitTensor2DV2(&step, batchSize, layerInputDim, X_FLOAT, input.devID);
+                _CopyIndexed(&layerInput, &step, 0, rows.data(), batchSize, prefix.data());
+
+                cells[i]->Forward(step, hidden, memory, i);
+
+                /* collect the hidden states of the layer */
+                _CopyIndexed(&hidden, hiddens, 0, prefix.data(), batchSize, rows.data());
             }
         }
+
+        if (l < layerNum - 1) {
+            /* the next layer reads the hidden states of both directions */
+            layerInput = bidirectional ? Concatenate(fwdHiddens, bwdHiddens, 1) : fwdHiddens;
+            continue;
+        }
+
+        fwdHiddens.Reshape(3, dims);
+        if (bidirectional) {
+            bwdHiddens.Reshape(3, dims);
+            return Concatenate(fwdHiddens, bwdHiddens, 2);
+        }
+        else
+            return fwdHiddens;
     }
-    if (bidirectional)
-        return Concatenate(fwdHiddens, bwdHiddens, 2);
-    else
-        return fwdHiddens;
+
+    return XTensor();
 }
 
 /*
@@ -176,7 +235,7 @@ void LSTMCell::Forward(const XTensor& x, XTensor& h, XTensor& c, int index)
 
     /* apply gating to the transformed tensor */
 
-    /* update memory state and hidden state */
-    c = Sigmoid(f) * c + Sigmoid(i) * HardTanH(g);
-    h = HardTanH(c) * Sigmoid(o);
+    /* update memory state and hidden state (in one pass each, see XExpression.h) */
+    c = Sigmoid(Lazy(f)) * c + Sigmoid(Lazy(i)) * HardTanH(Lazy(g));
+    h = HardTanH(Lazy(c)) * Sigmoid(Lazy(o));
 }
\ No newline at end of file
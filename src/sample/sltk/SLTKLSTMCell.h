@@ -58,8 +58,8 @@ struct LSTM : public Model
     /* constructor */
     LSTM(int inputDim, int hiddenDim, int layerNum, bool bidirectional);
 
-    /* lstm forward function */
-    XTensor Forward(const XTensor& input);
+    /* lstm forward function over packed sequences */
+    XTensor Forward(const XTensor& input, const vector<int>& lengths = vector<int>());
 };
 
 /* generate a range of number */
@@ -20,6 +20,7 @@
  * happy coding 2020~
  */
 
+#include <atomic>
 #include <fstream>
 #include "SLTKModel.h"
 #include "StringUtil.h"
@@ -29,7 +30,11 @@ XTensor SequenceTagger::Forward(const vector<vector<string>>& sentences)
 {
     auto input = embedding2NN->Forward(embedding->Embed(sentences));
 
-    auto rnnOutput = rnns->Forward(input);
+    vector<int> lengths;
+    for (const auto& sent : sentences)
+        lengths.push_back(int(sent.size()));
+
+    auto rnnOutput = rnns->Forward(input, lengths);
 
     auto tags = rnn2tag->Forward(rnnOutput);
 
@@ -47,18 +52,15 @@ XTensor SequenceTagger::GetMask(const vector<vector<string>>& input)
 
     int maxLen = 0;
     for (const auto sent : input)
-        maxLen = max(maxLen, sent.size());
+        maxLen = max(maxLen, int(sent.size()));
     InitTensor2DV2(&mask, bsz, maxLen, X_INT, devID);
 
     int* indices = new int[bsz * maxLen];
     memset(indices, 0, bsz * maxLen * sizeof(int));
 
-    int i = 0;
-    int sentID = 0;
-    for (const auto sent : input) {
-        for (const auto token : sent)
-            indices[i++] = 1;
-        i = maxLen * sentID++;
+    for (int i = 0; i < bsz; i++) {
+        for (int j = 0; j < input[i].size(); j++)
+            indices[i * maxLen + j] = 1;
     }
     mask.SetData(indices, mask.unitNum);
     delete[] indices;
@@ -66,27 +68,236 @@ XTensor SequenceTagger::GetMask(const vector<vector<string>>& input)
     return mask;
 }
 
+/* the version of the latest loaded model */
+static atomic<uint64_t> modelVersion(0);
+
+/*
+get the confidences (marginal probabilities) of the predicted tags
+>>> features - the emission scores, (bsz, len, tagNum)
+>>> mask - the mask, (bsz, len)
+>>> tags - the predicted tags
+<<< the confidence of each tag
+*/
+vector<vector<float>> SequenceTagger::GetConfidences(const XTensor& features, const XTensor& mask,
+                                                     const vector<vector<int>>& tags)
+{
+    XTensor logPartition;
+    XTensor marginals = crf->Marginals(features, mask, logPartition);
+
+    int maxLen = marginals.GetDim(1);
+    int tagNum = marginals.GetDim(2);
+    const float* m = (float*)marginals.data;
+
+    vector<vector<float>> confidences(tags.size());
+    for (int i = 0; i < tags.size(); i++) {
+        for (int j = 0; j < tags[i].size(); j++)
+            confidences[i].push_back(m[((long)i * maxLen + j) * tagNum + tags[i][j]]);
+    }
+    return confidences;
+}
+
+/*
+predict tags. If the cache is enabled, the sentences that are found in the cache
+(or are the same as another sentence in the batch) are dropped before the
+tensors are built, and only the rest go through the network.
+>>> input - the input sentences
+>>> confidences - the confidences of the predicted tags (NULL if they are not required)
+*/
+vector<vector<int>> SequenceTagger::Predict(const vector<vector<string>>& input, vector<vector<float>>* confidences)
+{
+    if (cache == NULL) {
+        auto mask = GetMask(input);
+        auto features = Forward(input);
+        auto tags = crf->Decode(features, mask);
+        if (confidences != NULL)
+            *confidences = GetConfidences(features, mask, tags);
+        return tags;
+    }
+
+    vector<vector<int>> results(input.size());
+    vector<vector<float>> scores(input.size());
+
+    /* the sentences we need to compute */
+    vector<vector<string>> misses;
+    vector<CacheKey> missKeys;
+
+    /* index of each sentence in the misses (-1 if it is a hit) */
+    vector<int> missIDs(input.size(), -1);
+    unordered_map<CacheKey, int, CacheKeyHash> batchIndex;
+
+    for (int i = 0; i < input.size(); i++) {
+        CacheKey key = ResultCache::MakeKey(input[i], version);
+        auto it = batchIndex.find(key);
+        if (it != batchIndex.end())
+            missIDs[i] = it->second;
+        else if (!cache->Get(key, results[i], confidences != NULL ? &scores[i] : NULL)) {
+            missIDs[i] = int(misses.size());
+            batchIndex[key] = missIDs[i];
+            misses.push_back(input[i]);
+            missKeys.push_back(key);
+        }
+    }
+
+    if (!misses.empty()) {
+        auto mask = GetMask(misses);
+        auto features = Forward(misses);
+        auto tags = crf->Decode(features, mask);
+        vector<vector<float>> missScores(misses.size());
+        if (confidences != NULL)
+            missScores = GetConfidences(features, mask, tags);
+
+        for (int i = 0; i < misses.size(); i++)
+            cache->Put(missKeys[i], tags[i], missScores[i]);
+        for (int i = 0; i < input.size(); i++) {
+            if (missIDs[i] >= 0) {
+                results[i] = tags[missIDs[i]];
+                scores[i] = missScores[missIDs[i]];
+            }
+        }
+    }
+
+    if (confidences != NULL)
+        confidences->swap(scores);
+
+    return results;
+}
+
 /*
-predict tags
+predict the k best tag sequences (the cache is not used)
 >>> input - the input sentences
+>>> k - number of the sequences for each sentence
+<<< the k best sequences of each sentence with their scores
 */
-vector<vector<int>> SequenceTagger::Predict(const vector<vector<string>>& input)
+vector<vector<ScoredPath>> SequenceTagger::PredictKBest(const vector<vector<string>>& input, int k)
 {
     auto mask = GetMask(input);
     auto features = Forward(input);
-    return crf->Decode(features, mask);
+    return crf->DecodeKBest(features, mask, k);
+}
+
+/*
+restrict the transitions the decoder goes over. It should be called after
+the parameters are loaded.
+>>> isConstrained - allow only the transitions that are legal in the tag scheme (BIO or BIOES)
+>>> isPruned - remove the transitions whose scores are below pruneThreshold
+>>> pruneThreshold - the threshold of the transition scores
+*/
+void SequenceTagger::SetDecoder(bool isConstrained, bool isPruned, float pruneThreshold)
+{
+    int denseNum = crf->tagNum * crf->tagNum;
+    crf->ResetConstraints();
+    if (isConstrained)
+        crf->ConstrainTransitions(*tagVocab);
+    if (isPruned)
+        crf->PruneTransitions(pruneThreshold);
+
+    if (isConstrained || isPruned)
+        fprintf(stderr, "[decoder] %d of %d transitions are allowed\n", crf->GetTransitionNum(), denseNum);
+
+    /* the cached results of the old decoder are not used */
+    version = ++modelVersion;
+}
+
+/*
+load the parameters from a binary file. The model gets a new version so that
+the results cached for the old parameters are not used.
+>>> fn - the model file
+*/
+void SequenceTagger::Load(const char* fn)
+{
+    Model::Load(fn);
+    version = ++modelVersion;
+}
+
+/*
+set the result cache. A cache can be shared by models, and the results are
+distinguished by the model versions.
+>>> myCache - the cache (NULL to disable the cache)
+*/
+void SequenceTagger::SetCache(shared_ptr<ResultCache> myCache)
+{
+    cache = myCache;
+}
+
+/* get the result cache */
+shared_ptr<ResultCache> SequenceTagger::GetCache()
+{
+    return cache;
+}
+
+/* get the embeddings */
+shared_ptr<StackEmbedding> SequenceTagger::GetEmbedding()
+{
+    return embedding;
 }
 
 /* dump input sequences and label sequences to a file */
 void SequenceTagger::DumpResult(vector<vector<string>>& src, vector<vector<int>>& tgt, const char* file)
 {
     ofstream f(file, ios::app);
-    ostringstream buffer;
+    DumpResult(src, tgt, f);
+}
+
+/*
+dump input sequences and label sequences to a stream. The batch is formatted
+in memory and written at once.
+>>> src - input sequences
+>>> tgt - label sequences
+>>> out - the output stream
+>>> confidences - confidences of the labels, which are appended to the labels
+                  (NULL if they are not dumped)
+*/
+void SequenceTagger::DumpResult(const vector<vector<string>>& src, const vector<vector<int>>& tgt, ostream& out,
+                                const vector<vector<float>>* confidences)
+{
+    string buffer;
+    char score[32];
+    for (int i = 0; i < src.size(); i++) {
+        for (int j = 0; j < src[i].size(); j++) {
+            buffer += src[i][j];
+            buffer += '\t';
+            buffer += tagVocab->id2word[tgt[i][j]];
+            if (confidences != NULL) {
+                snprintf(score, sizeof(score), "\t%.4f", (*confidences)[i][j]);
+                buffer += score;
+            }
+            buffer += '\n';
+        }
+        buffer += '\n';
+    }
+    out.write(buffer.data(), buffer.size());
+}
+
+/*
+dump input sequences and the k best label sequences to a stream. Each sentence
+starts with a line of the scores, and the i-th label column is the i-th best sequence.
+>>> src - input sequences
+>>> paths - the k best label sequences of each sentence
+>>> out - the output stream
+*/
+void SequenceTagger::DumpKBest(const vector<vector<string>>& src, const vector<vector<ScoredPath>>& paths, ostream& out)
+{
+    string buffer;
+    char score[32];
     for (int i = 0; i < src.size(); i++) {
-        for (int j = 0; j < src[i].size(); j++)
-            f << src[i][j] << "\t" << tagVocab->id2word[tgt[i][j]] << "\n";
-        f << "\n";
+        buffer += "# scores";
+        for (const auto& path : paths[i]) {
+            snprintf(score, sizeof(score), "\t%.4f", path.score);
+            buffer += score;
+        }
+        buffer += '\n';
+
+        for (int j = 0; j < src[i].size(); j++) {
+            buffer += src[i][j];
+            for (const auto& path : paths[i]) {
+                buffer += '\t';
+                buffer += tagVocab->id2word[path.tags[j]];
+            }
+            buffer += '\n';
+        }
+        buffer += '\n';
     }
+    out.write(buffer.data(), buffer.size());
 }
 
 /*
@@ -104,6 +315,7 @@ SequenceTagger::SequenceTagger(int myDevID, int rnnLayer, int hiddenSize,
                                float myDropout, float myWordropout, float myLockedropout)
 {
     devID = myDevID;
+    version = ++modelVersion;
 
     embedding = myEmbedding;
     crf = make_shared<CRF>(tagNum);
@@ -118,6 +330,10 @@ SequenceTagger::SequenceTagger(int myDevID, int rnnLayer, int hiddenSize,
     Register(ConcatString(prefix, "Embedding2NN"), *embedding2NN);
     Register(ConcatString(prefix, "RNN"), *rnns);
     Register(ConcatString(prefix, "RNN2Tag"), *rnn2tag);
+
+    /* the weights of the language models are kept in the model file */
+    for (int i = 0; i < embedding->languageModels.size(); i++)
+        Register(ConcatString(prefix, "LanguageModel", i), *embedding->languageModels[i]);
 }
 
 /* de-constructor */
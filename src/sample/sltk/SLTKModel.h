@@ -23,6 +23,7 @@
 
 #include <memory>
 #include "SLTKCRF.h"
+#include "SLTKCache.h"
 #include "SLTKLSTMCell.h"
 #include "SLTKEmbedding.h"
 #include "SLTKDataSet.h"
@@ -74,6 +75,13 @@ private:
     /* CRF layer */
     shared_ptr<CRF> crf;
 
+    /* the result cache (NULL if it is disabled) */
+    shared_ptr<ResultCache> cache;
+
+public:
+    /* version of the model (it changes whenever the parameters are loaded) */
+    uint64_t version;
+
 public:
 
     /* forward function */
@@ -82,12 +90,41 @@ public:
     /* get the mask of sentences */
     XTensor GetMask(const vector<vector<string>>& input);
 
+    /* get the confidences of the predicted tags */
+    vector<vector<float>> GetConfidences(const XTensor& features, const XTensor& mask,
+                                         const vector<vector<int>>& tags);
+
     /* predict tags */
-    vector<vector<int>> Predict(const vector<vector<string>>& input);
+    vector<vector<int>> Predict(const vector<vector<string>>& input, vector<vector<float>>* confidences = NULL);
+
+    /* predict the k best tag sequences */
+    vector<vector<ScoredPath>> PredictKBest(const vector<vector<string>>& input, int k);
+
+    /* restrict the transitions the decoder goes over */
+    void SetDecoder(bool isConstrained, bool isPruned, float pruneThreshold);
+
+    /* load the parameters from a binary file */
+    void Load(const char* fn);
+
+    /* set the result cache */
+    void SetCache(shared_ptr<ResultCache> myCache);
+
+    /* get the result cache */
+    shared_ptr<ResultCache> GetCache();
+
+    /* get the embeddings */
+    shared_ptr<StackEmbedding> GetEmbedding();
 
     /* dump input sequences and label sequences to a file */
     void DumpResult(vector<vector<string>>& src, vector<vector<int>>& tgt, const char* file);
 
+    /* dump input sequences and label sequences to a stream */
+    void DumpResult(const vector<vector<string>>& src, const vector<vector<int>>& tgt, ostream& out,
+                    const vector<vector<float>>* confidences = NULL);
+
+    /* dump input sequences and the k best label sequences to a stream */
+    void DumpKBest(const vector<vector<string>>& src, const vector<vector<ScoredPath>>& paths, ostream& out);
+
     /* constructor */
     explicit SequenceTagger(int myDevID, int rnnLayer, int hiddenSize,
                             int tagNum, int embSize, shared_ptr<StackEmbedding> myEmbedding, const char* tagVocabF,
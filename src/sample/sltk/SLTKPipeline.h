@@ -0,0 +1,164 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A bounded blocking queue that links the stages (read -> infer -> write)
+ * of the tagging pipeline. It keeps the statistics of its occupancy so that
+ * we can see which stage is the bottleneck.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+/* statistics of a queue */
+struct QueueStat
+{
+    /* number of items that are pushed */
+    size_t pushNum = 0;
+
+    /* sum of the queue size when an item is pushed (for the average occupancy) */
+    size_t sizeSum = 0;
+
+    /* max number of items in the queue */
+    size_t maxSize = 0;
+
+    /* time (in seconds) the producers wait because the queue is full */
+    double fullWait = 0;
+
+    /* time (in seconds) the consumers wait because the queue is empty */
+    double emptyWait = 0;
+};
+
+/* a bounded blocking queue for multiple producers and consumers */
+template<typename T>
+class BoundedQueue
+{
+private:
+    /* the items */
+    deque<T> items;
+
+    /* max number of items in the queue */
+    size_t capacity;
+
+    /* indicates whether no more items will be pushed */
+    bool isClosed = false;
+
+    /* statistics */
+    QueueStat stat;
+
+    mutex lock;
+    condition_variable notFull;
+    condition_variable notEmpty;
+
+    /* time since a given point (in seconds) */
+    static double Since(const chrono::steady_clock::time_point& t)
+    {
+        return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+    }
+
+public:
+    /* constructor */
+    explicit BoundedQueue(size_t myCapacity) : capacity(myCapacity > 0 ? myCapacity : 1) {}
+
+    /*
+    put an item in the tail of the queue (wait if the queue is full)
+    >>> item - the item
+    */
+    void Push(T&& item)
+    {
+        unique_lock<mutex> guard(lock);
+        if (items.size() >= capacity) {
+            auto t = chrono::steady_clock::now();
+            notFull.wait(guard, [this] { return items.size() < capacity; });
+            stat.fullWait += Since(t);
+        }
+
+        stat.pushNum++;
+        stat.sizeSum += items.size();
+        items.push_back(move(item));
+        if (items.size() > stat.maxSize)
+            stat.maxSize = items.size();
+
+        guard.unlock();
+        notEmpty.notify_one();
+    }
+
+    /*
+    fetch an item from the head of the queue (wait if the queue is empty)
+    >>> item - the item
+    <<< return - false if the queue is closed and there are no more items
+    */
+    bool Pop(T& item)
+    {
+        unique_lock<mutex> guard(lock);
+        if (items.empty() && !isClosed) {
+            auto t = chrono::steady_clock::now();
+            notEmpty.wait(guard, [this] { return !items.empty() || isClosed; });
+            stat.emptyWait += Since(t);
+        }
+
+        if (items.empty())
+            return false;
+
+        item = move(items.front());
+        items.pop_front();
+
+        guard.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    /* no more items will be pushed. The consumers stop when the queue is drained */
+    void Close()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            isClosed = true;
+        }
+        notEmpty.notify_all();
+    }
+
+    /* get the statistics */
+    QueueStat GetStat()
+    {
+        lock_guard<mutex> guard(lock);
+        return stat;
+    }
+
+    /*
+    show the occupancy of the queue. A queue that is usually full means the
+    consumer is the bottleneck, and one that is usually empty means the producer is.
+    >>> name - name of the queue
+    */
+    void ShowStat(const char* name)
+    {
+        QueueStat s = GetStat();
+        fprintf(stderr, "[%s] capacity=%zu, items=%zu, avg occupancy=%.2f, max occupancy=%zu, "
+                "producer waits %.3fs (full), consumer waits %.3fs (empty)\n",
+                name, capacity, s.pushNum, s.pushNum > 0 ? double(s.sizeSum) / s.pushNum : 0.0,
+                s.maxSize, s.fullWait, s.emptyWait);
+    }
+};
@@ -0,0 +1,474 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <sys/stat.h>
+#include "SLTKRegistry.h"
+#include "StringUtil.h"
+
+/*
+the stamp of a file: the device, the inode, the size and the modification
+time. A new version of the file (even one of the same size) has another
+stamp, and the file is not read, so a lookup that hits the cache is cheap.
+>>> file - the file
+<<< the stamp (empty if the file does not exist)
+*/
+string ModelRegistry::StampFile(const string& file)
+{
+    struct ::stat st;
+    if (::stat(file.c_str(), &st) != 0)
+        return "";
+
+#if defined(__linux__)
+    long long nsec = (long long)st.st_mtim.tv_nsec;
+#else
+    long long nsec = 0;
+#endif
+
+    char stamp[128];
+    sprintf(stamp, "%llx:%llx:%llx:%llx.%09lld", (unsigned long long)st.st_dev,
+            (unsigned long long)st.st_ino, (unsigned long long)st.st_size,
+            (unsigned long long)st.st_mtime, nsec);
+    return stamp;
+}
+
+/*
+get an embedding table. The table is identified by the (canonical) path, the stamps
+of the table and its vocabulary, the device and the format, and it is loaded only
+if no tagger holds it.
+>>> devID - device
+>>> file - the pre-trained embeddings file
+>>> isQuantized - use the product-quantized table (in file + ".pq") or not
+>>> numaNodes - the NUMA nodes to replicate the table on, e.g., "0,1" (empty if it is not replicated)
+<<< the table
+*/
+shared_ptr<const Embedding> ModelRegistry::GetEmbedding(int devID, const string& file, bool isQuantized,
+                                                        const string& numaNodes)
+{
+    char path[PATH_MAX];
+    string name = realpath(file.c_str(), path) != NULL ? string(path) : file;
+
+    string tableStamp = StampFile(isQuantized ? file + ".pq" : file);
+    string vocabStamp = StampFile(file + ".vocab");
+    string key = ConcatString(name, "#", tableStamp, "#", vocabStamp, "#", devID, isQuantized ? "#pq" : "",
+                              numaNodes.empty() ? "" : "#numa", numaNodes);
+
+    lock_guard<mutex> loadGuard(loadLock);
+    {
+        lock_guard<mutex> guard(lock);
+        stat.requestNum++;
+        auto it = embeddings.find(key);
+        if (it != embeddings.end()) {
+            auto emb = it->second.lock();
+            if (emb != NULL) {
+                stat.shareNum++;
+                stat.savedBytes += emb->GetTableSize();
+                return emb;
+            }
+        }
+    }
+
+    auto table = make_shared<Embedding>(devID, file.c_str(), isQuantized);
+    if (!numaNodes.empty()) {
+        int nodes[MAX_NUMA_NODE_NUM];
+        int nodeNum = XParseNumaNodes(numaNodes.c_str(), nodes, MAX_NUMA_NODE_NUM);
+        table->Replicate(nodes, nodeNum);
+    }
+    shared_ptr<const Embedding> emb = table;
+
+    lock_guard<mutex> guard(lock);
+
+    /* forget the tables that are released */
+    for (auto it = embeddings.begin(); it != embeddings.end();) {
+        if (it->second.expired())
+            it = embeddings.erase(it);
+        else
+            it++;
+    }
+    embeddings[key] = emb;
+    return emb;
+}
+
+/*
+check whether the files of a tagger are ready, so that a bad rollout is
+rejected before it is loaded
+>>> config - configuration of the tagger
+<<< return - whether all the files can be opened
+*/
+bool ModelRegistry::CheckFiles(const TaggerConfig& config)
+{
+    vector<string> files = { config.modelFile, config.tagVocab };
+    for (const auto& file : config.embFiles) {
+        files.push_back(config.isQuantized ? file + ".pq" : file);
+        files.push_back(file + ".vocab");
+    }
+    if (!config.lmForward.empty())
+        files.push_back(config.lmForward);
+    if (!config.lmBackward.empty())
+        files.push_back(config.lmBackward);
+
+    for (const auto& file : files) {
+        FILE* fp = fopen(file.c_str(), "rb");
+        if (fp == NULL) {
+            fprintf(stderr, "[registry] cannot open %s\n", file.c_str());
+            return false;
+        }
+        fclose(fp);
+    }
+    return true;
+}
+
+/*
+check whether a parameter file matches a tagger, i.e., it has the same number
+of parameters and the size of the file is what Model::Load reads
+>>> model - the tagger
+>>> file - the parameter file
+<<< return - whether they match
+*/
+bool ModelRegistry::CheckModelFile(SequenceTagger& model, const string& file)
+{
+    const auto& params = model.parameters.paramList;
+
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (fp == NULL)
+        return false;
+
+    int64_t number = 0;
+    bool isMatched = fread(&number, sizeof(number), 1, fp) == 1 && number == int64_t(params.size());
+
+    /* the header (the number and the offsets) and the data */
+    int64_t expected = sizeof(int64_t) * (1 + params.size());
+    for (const auto& param : params)
+        expected += int64_t(param->unitNum) * sizeof(float);
+    fseek(fp, 0, SEEK_END);
+    isMatched = isMatched && int64_t(ftell(fp)) == expected;
+    fclose(fp);
+
+    if (!isMatched)
+        fprintf(stderr, "[registry] %s does not match the model\n", file.c_str());
+    return isMatched;
+}
+
+/*
+check the results of a smoke batch: each sentence has a tag per token,
+and all the tags are real tags (not the START and STOP of the CRF)
+>>> model - the tagger
+>>> smokeBatch - the sentences
+>>> tagNum - number of tags (including START and STOP)
+>>> tags - the tags of the sentences (they are kept for the caller)
+<<< return - whether the results are well-formed
+*/
+bool ModelRegistry::Validate(SequenceTagger& model, const vector<vector<string>>& smokeBatch, int tagNum,
+                             vector<vector<int>>& tags)
+{
+    tags.clear();
+    if (smokeBatch.empty())
+        return true;
+
+    tags = model.Predict(smokeBatch);
+    if (tags.size() != smokeBatch.size())
+        return false;
+
+    for (int i = 0; i < tags.size(); i++) {
+        if (tags[i].size() != smokeBatch[i].size())
+            return false;
+        for (int tag : tags[i]) {
+            if (tag < 0 || tag >= tagNum - 2)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+build a tagger. The embedding tables are shared with the other taggers of the registry.
+With config.numaNodes, the parameters and the tables have a copy on each of the nodes.
+>>> config - configuration of the tagger
+<<< the tagger (NULL if the files are not ready)
+*/
+shared_ptr<SequenceTagger> ModelRegistry::Build(const TaggerConfig& config)
+{
+    if (!CheckFiles(config))
+        return NULL;
+
+    vector<shared_ptr<const Embedding>> tables;
+    for (const auto& file : config.embFiles)
+        tables.push_back(GetEmbedding(config.devID, file, config.isQuantized, config.numaNodes));
+
+    auto embedding = make_shared<StackEmbedding>(config.devID, tables);
+    if (!config.lmForward.empty())
+        embedding->AddLanguageModel(config.lmForward.c_str(), config.lmCharSize, config.lmHiddenSize, true);
+    if (!config.lmBackward.empty())
+        embedding->AddLanguageModel(config.lmBackward.c_str(), config.lmCharSize, config.lmHiddenSize, false);
+
+    auto model = make_shared<SequenceTagger>(config.devID, config.rnnLayer, config.hiddenSize, config.tagNum,
+                                             config.embSize, embedding, config.tagVocab.c_str());
+    if (!CheckModelFile(*model, config.modelFile))
+        return NULL;
+
+    model->Load(config.modelFile.c_str());
+    model->ToDevice(config.devID);
+    if (!config.numaNodes.empty()) {
+        int nodes[MAX_NUMA_NODE_NUM];
+        int nodeNum = XParseNumaNodes(config.numaNodes.c_str(), nodes, MAX_NUMA_NODE_NUM);
+        model->Replicate(nodes, nodeNum);
+    }
+    model->SetDecoder(config.isConstrained, config.isPruned, config.pruneThreshold);
+    return model;
+}
+
+/*
+build a tagger and register it
+>>> name - name of the tagger
+>>> config - configuration of the tagger
+<<< the tagger
+*/
+shared_ptr<SequenceTagger> ModelRegistry::Load(const string& name, const TaggerConfig& config)
+{
+    auto model = Build(config);
+    if (model == NULL)
+        ShowNTErrors(ConcatString("cannot load model: ", name).c_str());
+    Add(name, model);
+    return model;
+}
+
+/*
+validate a new version of a tagger and swap it in. The old version and the
+new one predict the smoke batch, so it must run on the thread that runs
+the taggers. The result cache (if any) moves to the new version, and its
+entries of the old version are never hit again since the keys include the
+version.
+>>> name - name of the tagger
+>>> model - the new version (NULL if it cannot be built)
+>>> tagNum - number of tags
+>>> smokeBatch - the sentences to validate the new version with
+>>> start - when the reload starts
+<<< return - whether the new version is swapped in (the old one keeps serving if not)
+*/
+bool ModelRegistry::Swap(const string& name, shared_ptr<SequenceTagger> model, int tagNum,
+                         const vector<vector<string>>& smokeBatch, chrono::steady_clock::time_point start)
+{
+    vector<vector<int>> newTags;
+    if (model == NULL || !Validate(*model, smokeBatch, tagNum, newTags)) {
+        fprintf(stderr, "[reload] %s: the new version is rejected, the old one keeps serving\n", name.c_str());
+        return false;
+    }
+
+    /* agreement of the versions on the smoke batch (the new tags are those of Validate) */
+    auto old = Get(name);
+    size_t tokenNum = 0;
+    size_t agreedNum = 0;
+    if (old != NULL && !smokeBatch.empty()) {
+        auto oldTags = old->Predict(smokeBatch);
+        for (int i = 0; i < smokeBatch.size(); i++) {
+            for (int j = 0; j < smokeBatch[i].size(); j++)
+                agreedNum += oldTags[i][j] == newTags[i][j];
+            tokenNum += smokeBatch[i].size();
+        }
+    }
+
+    if (old != NULL && old->GetCache() != NULL)
+        model->SetCache(old->GetCache());
+
+    uint64_t oldVersion = old != NULL ? old->version : 0;
+    Add(name, model);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "[reload] %s: version %llu -> %llu in %.2fs, agreement on the smoke batch %.2f%%\n",
+            name.c_str(), (unsigned long long)oldVersion, (unsigned long long)model->version, seconds,
+            tokenNum > 0 ? 100.0 * agreedNum / tokenNum : 100.0);
+    return true;
+}
+
+/*
+rebuild a tagger, validate it and swap it in. The tables that do not change are
+shared with the old version rather than loaded again. The requests that are
+running keep the old version until they finish, and the old one is released
+when its last reference is dropped. Everything runs on the calling thread, so
+it must be the thread that runs the taggers (see ReloadAsync otherwise).
+>>> name - name of the tagger
+>>> config - configuration of the new version
+>>> smokeBatch - the sentences to validate the new version with
+<<< return - whether the new version is swapped in (the old one keeps serving if not)
+*/
+bool ModelRegistry::Reload(const string& name, const TaggerConfig& config, const vector<vector<string>>& smokeBatch)
+{
+    auto start = chrono::steady_clock::now();
+    shared_ptr<SequenceTagger> model;
+    {
+        lock_guard<mutex> reloadGuard(reloadLock);
+        model = Build(config);
+    }
+    return Swap(name, model, config.tagNum, smokeBatch, start);
+}
+
+/*
+reload a tagger in the background. Only the new version is built (i.e., its
+files are read) on another thread. The requests are served by the old version
+until the serving thread calls FinishReloads, which validates the new version
+and swaps it in.
+>>> name - name of the tagger
+>>> config - configuration of the new version
+>>> smokeBatch - the sentences to validate the new version with
+<<< whether the new version is swapped in (it is ready after FinishReloads handles the reload)
+*/
+future<bool> ModelRegistry::ReloadAsync(const string& name, const TaggerConfig& config,
+                                        const vector<vector<string>>& smokeBatch)
+{
+    unique_ptr<PendingReload> reload(new PendingReload());
+    reload->name = name;
+    reload->tagNum = config.tagNum;
+    reload->smokeBatch = smokeBatch;
+    reload->start = chrono::steady_clock::now();
+    reload->candidate = async(launch::async, [this, config]() {
+        lock_guard<mutex> reloadGuard(reloadLock);
+        return Build(config);
+    });
+
+    future<bool> result = reload->result.get_future();
+    lock_guard<mutex> guard(pendingLock);
+    pendingReloads.push_back(move(reload));
+    return result;
+}
+
+/*
+swap in the new versions of the background reloads that are built. It
+predicts with the taggers, so it is called by the thread that runs them,
+e.g., between two batches.
+>>> isWaiting - wait for the reloads that are still being built
+<<< return - number of the reloads that are finished
+*/
+int ModelRegistry::FinishReloads(bool isWaiting)
+{
+    vector<unique_ptr<PendingReload>> ready;
+    {
+        lock_guard<mutex> guard(pendingLock);
+        for (auto it = pendingReloads.begin(); it != pendingReloads.end();) {
+            auto& candidate = (*it)->candidate;
+            if (isWaiting || candidate.wait_for(chrono::seconds(0)) == future_status::ready) {
+                ready.push_back(move(*it));
+                it = pendingReloads.erase(it);
+            }
+            else
+                it++;
+        }
+    }
+
+    for (auto& reload : ready) {
+        auto model = reload->candidate.get();
+        bool isSwapped = Swap(reload->name, model, reload->tagNum, reload->smokeBatch, reload->start);
+        reload->result.set_value(isSwapped);
+    }
+    return (int)ready.size();
+}
+
+/*
+register a tagger. The old tagger of the name (if any) is replaced, and
+it is released when the requests that hold it are finished.
+>>> name - name of the tagger
+>>> model - the tagger
+*/
+void ModelRegistry::Add(const string& name, shared_ptr<SequenceTagger> model)
+{
+    CheckNTErrors(model != NULL, "no tagger is given!");
+    lock_guard<mutex> guard(lock);
+    models[name] = model;
+}
+
+/*
+unregister a tagger
+>>> name - name of the tagger
+<<< return - whether the tagger is found
+*/
+bool ModelRegistry::Remove(const string& name)
+{
+    lock_guard<mutex> guard(lock);
+    return models.erase(name) > 0;
+}
+
+/*
+get a tagger by its name
+>>> name - name of the tagger
+<<< the tagger (NULL if it is not found)
+*/
+shared_ptr<SequenceTagger> ModelRegistry::Get(const string& name)
+{
+    lock_guard<mutex> guard(lock);
+    auto it = models.find(name);
+    return it != models.end() ? it->second : NULL;
+}
+
+/* names of the taggers */
+vector<string> ModelRegistry::GetNames()
+{
+    lock_guard<mutex> guard(lock);
+    vector<string> names;
+    for (const auto& it : models)
+        names.push_back(it.first);
+    return names;
+}
+
+/*
+predict tags with the tagger of a name
+>>> name - name of the tagger
+>>> input - the input sentences
+>>> confidences - the confidences of the predicted tags (NULL if they are not required)
+*/
+vector<vector<int>> ModelRegistry::Predict(const string& name, const vector<vector<string>>& input,
+                                           vector<vector<float>>* confidences)
+{
+    auto model = Get(name);
+    if (model == NULL)
+        ShowNTErrors(ConcatString("unknown model: ", name).c_str());
+    return model->Predict(input, confidences);
+}
+
+/* get the statistics */
+RegistryStat ModelRegistry::GetStat()
+{
+    lock_guard<mutex> guard(lock);
+    RegistryStat s = stat;
+    s.modelNum = models.size();
+    s.tableNum = 0;
+    s.tableBytes = 0;
+    for (const auto& it : embeddings) {
+        auto emb = it.second.lock();
+        if (emb != NULL) {
+            s.tableNum++;
+            s.tableBytes += emb->GetTableSize();
+        }
+    }
+    return s;
+}
+
+/* show the statistics */
+void ModelRegistry::ShowStat()
+{
+    RegistryStat s = GetStat();
+    fprintf(stderr, "[registry] models=%zu, embedding tables=%zu (%.2f MB), requests=%zu, "
+            "shared=%zu (%.2f MB saved)\n",
+            s.modelNum, s.tableNum, s.tableBytes / 1048576.0, s.requestNum,
+            s.shareNum, s.savedBytes / 1048576.0);
+}
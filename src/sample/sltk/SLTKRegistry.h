@@ -0,0 +1,226 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A registry of the sequence taggers in a process. Task-specific taggers usually
+ * stack the same pre-trained embeddings, which are the bulk of the memory. The
+ * registry loads each distinct table once (keyed by the path and the stat() stamps
+ * of the files) and hands read-only references of it to all the taggers, and the
+ * requests are routed to a tagger by its name.
+ *
+ * A tagger can be reloaded while it is serving. The new version is built (the files
+ * are read) in the background, and then it is validated with a smoke batch and
+ * swapped in by the thread that runs the taggers, since the taggers and the memory
+ * pools are not thread-safe. The requests hold a reference of the tagger they
+ * started with, so in-flight batches finish on the old version, which is released
+ * (with the tables only it uses) when they drain.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#pragma once
+
+#include <map>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SLTKModel.h"
+
+using namespace std;
+
+/* configuration of a tagger */
+struct TaggerConfig
+{
+    /* device id */
+    int devID = 0;
+
+    /* number of tags */
+    int tagNum = 29;
+
+    /* size of the stacked embeddings */
+    int embSize = 400;
+
+    /* number of RNN layers */
+    int rnnLayer = 1;
+
+    /* hidden size of the RNN */
+    int hiddenSize = 256;
+
+    /* the tag vocabulary */
+    string tagVocab;
+
+    /* the parameters */
+    string modelFile;
+
+    /* the pre-trained embedding files */
+    vector<string> embFiles;
+
+    /* use the product-quantized tables or not */
+    bool isQuantized = false;
+
+    /* the character vocabularies of the forward and backward LMs (empty if not used) */
+    string lmForward;
+    string lmBackward;
+
+    /* the character embedding size and the hidden size of the LMs */
+    int lmCharSize = 100;
+    int lmHiddenSize = 2048;
+
+    /* the NUMA nodes to replicate the weights and the tables on, e.g., "0,1" (empty if they are not replicated) */
+    string numaNodes;
+
+    /* the decoder settings */
+    bool isConstrained = false;
+    bool isPruned = false;
+    float pruneThreshold = -1000.0F;
+};
+
+/* statistics of a registry */
+struct RegistryStat
+{
+    /* number of taggers */
+    size_t modelNum = 0;
+
+    /* number of embedding tables in memory */
+    size_t tableNum = 0;
+
+    /* bytes of the embedding tables in memory */
+    size_t tableBytes = 0;
+
+    /* number of times a table is requested */
+    size_t requestNum = 0;
+
+    /* number of requests served by a table in memory */
+    size_t shareNum = 0;
+
+    /* bytes we do not load because of the sharing */
+    size_t savedBytes = 0;
+};
+
+/* a reload whose new version is being built in the background */
+struct PendingReload
+{
+    /* name of the tagger */
+    string name;
+
+    /* number of tags */
+    int tagNum = 0;
+
+    /* the sentences to validate the new version with */
+    vector<vector<string>> smokeBatch;
+
+    /* when the reload starts */
+    chrono::steady_clock::time_point start;
+
+    /* the new version (NULL if its files are not ready) */
+    future<shared_ptr<SequenceTagger>> candidate;
+
+    /* whether the new version is swapped in */
+    promise<bool> result;
+};
+
+/* the model registry */
+class ModelRegistry
+{
+private:
+    /* the loaded embedding tables. They are weak references, so a table is
+       released when no tagger uses it */
+    map<string, weak_ptr<const Embedding>> embeddings;
+
+    /* name -> tagger */
+    map<string, shared_ptr<SequenceTagger>> models;
+
+    /* statistics */
+    RegistryStat stat;
+
+    mutex lock;
+
+    /* a table can be loaded by one thread only */
+    mutex loadLock;
+
+    /* the taggers are reloaded one at a time */
+    mutex reloadLock;
+
+    /* the reloads that wait for the serving thread to swap them in */
+    vector<unique_ptr<PendingReload>> pendingReloads;
+
+    /* mutex of the pending reloads */
+    mutex pendingLock;
+
+    /* check whether the files of a tagger are ready */
+    static bool CheckFiles(const TaggerConfig& config);
+
+    /* check whether a parameter file matches a tagger */
+    static bool CheckModelFile(SequenceTagger& model, const string& file);
+
+    /* check the results of a smoke batch (the tags are returned) */
+    static bool Validate(SequenceTagger& model, const vector<vector<string>>& smokeBatch, int tagNum,
+                         vector<vector<int>>& tags);
+
+    /* validate a new version of a tagger and swap it in */
+    bool Swap(const string& name, shared_ptr<SequenceTagger> model, int tagNum,
+              const vector<vector<string>>& smokeBatch, chrono::steady_clock::time_point start);
+
+public:
+    /* the stamp of a file (device, inode, size and modification time) */
+    static string StampFile(const string& file);
+
+    /* get an embedding table (it is loaded if it is not in memory) */
+    shared_ptr<const Embedding> GetEmbedding(int devID, const string& file, bool isQuantized,
+                                             const string& numaNodes = "");
+
+    /* build a tagger (without registering it). It returns NULL if the files are not ready */
+    shared_ptr<SequenceTagger> Build(const TaggerConfig& config);
+
+    /* build a tagger and register it */
+    shared_ptr<SequenceTagger> Load(const string& name, const TaggerConfig& config);
+
+    /* rebuild a tagger, validate it and swap it in */
+    bool Reload(const string& name, const TaggerConfig& config, const vector<vector<string>>& smokeBatch);
+
+    /* build a new version of a tagger in the background (FinishReloads swaps it in) */
+    future<bool> ReloadAsync(const string& name, const TaggerConfig& config,
+                             const vector<vector<string>>& smokeBatch);
+
+    /* swap in the new versions that are built (on the thread that runs the taggers) */
+    int FinishReloads(bool isWaiting = false);
+
+    /* register a tagger (the old one of the name is replaced) */
+    void Add(const string& name, shared_ptr<SequenceTagger> model);
+
+    /* unregister a tagger */
+    bool Remove(const string& name);
+
+    /* get a tagger by its name */
+    shared_ptr<SequenceTagger> Get(const string& name);
+
+    /* names of the taggers */
+    vector<string> GetNames();
+
+    /* predict tags with the tagger of a name */
+    vector<vector<int>> Predict(const string& name, const vector<vector<string>>& input,
+                                vector<vector<float>>* confidences = NULL);
+
+    /* get the statistics */
+    RegistryStat GetStat();
+
+    /* show the statistics */
+    void ShowStat();
+};
@@ -0,0 +1,247 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <cstdio>
+#include <unistd.h>
+#include "SLTKTest.h"
+#include "SLTKRegistry.h"
+#include "StringUtil.h"
+#include "../../tensor/XUtility.h"
+
+/* the words of the tiny tagger */
+static const int testWordNum = 50;
+
+/*
+make the files of a tiny tagger in a directory
+>>> dir - the directory
+<<< the configuration of the tagger
+*/
+static TaggerConfig MakeTestFiles(const string& dir)
+{
+    TaggerConfig config;
+    config.devID = -1;
+    config.tagNum = 5;
+    config.embSize = 16;
+    config.hiddenSize = 8;
+    config.tagVocab = dir + "/tag.vocab";
+    config.modelFile = dir + "/tagger.model";
+    config.embFiles = { dir + "/words.emb" };
+
+    FILE* fp = fopen(config.tagVocab.c_str(), "w");
+    fprintf(fp, "5\nO 0\nB-X 1\nI-X 2\n<START> 3\n<STOP> 4\n");
+    fclose(fp);
+
+    /* the id 0 is kept for the unknown words */
+    fp = fopen((config.embFiles[0] + ".vocab").c_str(), "w");
+    fprintf(fp, "%d\n", testWordNum);
+    for (int i = 0; i < testWordNum; i++)
+        fprintf(fp, "w%d %d\n", i, i + 1);
+    fclose(fp);
+
+    size_t vocabSize = testWordNum + 1;
+    size_t embSize = config.embSize;
+    fp = fopen(config.embFiles[0].c_str(), "wb");
+    fwrite(&vocabSize, sizeof(vocabSize), 1, fp);
+    fwrite(&embSize, sizeof(embSize), 1, fp);
+    for (size_t i = 0; i < vocabSize * embSize; i++) {
+        float v = (float)rand() / RAND_MAX - 0.5F;
+        fwrite(&v, sizeof(v), 1, fp);
+    }
+    fclose(fp);
+
+    return config;
+}
+
+/*
+save a tagger with random parameters (a new version of the model file)
+>>> registry - the registry that keeps the embedding table
+>>> config - configuration of the tagger
+<<< the tagger
+*/
+static shared_ptr<SequenceTagger> SaveRandomTagger(ModelRegistry& registry, const TaggerConfig& config)
+{
+    vector<shared_ptr<const Embedding>> tables;
+    for (const auto& file : config.embFiles)
+        tables.push_back(registry.GetEmbedding(config.devID, file, false));
+
+    auto embedding = make_shared<StackEmbedding>(config.devID, tables);
+    auto model = make_shared<SequenceTagger>(config.devID, config.rnnLayer, config.hiddenSize, config.tagNum,
+                                             config.embSize, embedding, config.tagVocab.c_str());
+    for (auto& param : model->parameters.paramList)
+        param->SetDataRand(-0.5F, 0.5F);
+    model->SetDecoder(config.isConstrained, config.isPruned, config.pruneThreshold);
+    model->Save(config.modelFile.c_str());
+    return model;
+}
+
+/* a batch of random sentences */
+static vector<vector<string>> MakeTestBatch(int sentNum)
+{
+    vector<vector<string>> batch(sentNum);
+    for (auto& sent : batch) {
+        int len = rand() % 12 + 1;
+        for (int i = 0; i < len; i++)
+            sent.push_back(ConcatString("w", rand() % (testWordNum + 10)));
+    }
+    return batch;
+}
+
+/* are the tags well-formed */
+static bool IsWellFormed(const vector<vector<string>>& batch, const vector<vector<int>>& tags, int tagNum)
+{
+    if (tags.size() != batch.size())
+        return false;
+    for (int i = 0; i < batch.size(); i++) {
+        if (tags[i].size() != batch[i].size())
+            return false;
+        for (int tag : tags[i]) {
+            if (tag < 0 || tag >= tagNum - 2)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+case 1: reload a tagger in the background while the requests are served. The
+new version is built while the old one predicts, and it is swapped in between
+two batches. The batches after that are tagged by the new version.
+*/
+static bool TestRegistryCase1(const string& dir)
+{
+    bool ok = true;
+
+    ModelRegistry registry;
+    TaggerConfig config = MakeTestFiles(dir);
+    SaveRandomTagger(registry, config);
+    auto oldModel = registry.Load("test", config);
+
+    /* a new version of the parameters */
+    auto newModel = SaveRandomTagger(registry, config);
+
+    auto smokeBatch = MakeTestBatch(8);
+    auto reloading = registry.ReloadAsync("test", config, smokeBatch);
+
+    /* the requests are served when the new version is being built */
+    int batchNum = 0;
+    while (batchNum < 20 || reloading.wait_for(chrono::seconds(0)) != future_status::ready) {
+        if (batchNum >= 20)
+            registry.FinishReloads();
+
+        auto batch = MakeTestBatch(16);
+        auto model = registry.Get("test");
+        auto tags = model->Predict(batch);
+        ok = ok && IsWellFormed(batch, tags, config.tagNum);
+        ok = ok && (model == oldModel || batchNum >= 20);
+        batchNum++;
+    }
+
+    ok = ok && reloading.get();
+
+    /* the new version serves the requests, and it is the one in the file */
+    auto model = registry.Get("test");
+    ok = ok && model != oldModel && model->version != oldModel->version;
+    for (int k = 0; k < 5; k++) {
+        auto batch = MakeTestBatch(16);
+        ok = ok && model->Predict(batch) == newModel->Predict(batch);
+    }
+
+    return ok;
+}
+
+/*
+case 2: a broken version is rejected when it is swapped in, and the
+old version keeps serving
+*/
+static bool TestRegistryCase2(const string& dir)
+{
+    bool ok = true;
+
+    ModelRegistry registry;
+    TaggerConfig config = MakeTestFiles(dir);
+    SaveRandomTagger(registry, config);
+    auto oldModel = registry.Load("test", config);
+
+    FILE* fp = fopen(config.modelFile.c_str(), "wb");
+    fprintf(fp, "not a model");
+    fclose(fp);
+
+    auto batch = MakeTestBatch(4);
+    auto reloading = registry.ReloadAsync("test", config, batch);
+    auto tags = registry.Get("test")->Predict(batch);
+
+    ok = ok && registry.FinishReloads(true) == 1;
+    ok = ok && !reloading.get();
+    ok = ok && registry.Get("test") == oldModel;
+    ok = ok && registry.Get("test")->Predict(batch) == tags;
+
+    return ok;
+}
+
+/* test for the model registry */
+bool TestRegistry()
+{
+    XPRINT(0, stdout, "[Test] Model registry ... Began\n");
+    bool returnFlag = true;
+    bool caseFlag = true;
+
+    double startT = GetClock();
+
+    char dir[] = "/tmp/sltk-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        XPRINT(0, stdout, ">> cannot make the temporary directory!\n");
+        return false;
+    }
+
+    /* case 1 test */
+    caseFlag = TestRegistryCase1(dir);
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 1 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 1 passed!\n");
+
+    /* case 2 test */
+    caseFlag = TestRegistryCase2(dir);
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    for (const char* file : { "tag.vocab", "tagger.model", "words.emb", "words.emb.vocab" })
+        remove((string(dir) + "/" + file).c_str());
+    rmdir(dir);
+
+    if (returnFlag) {
+        XPRINT(0, stdout, ">> All Passed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> Failed!\n");
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Test] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return returnFlag;
+}
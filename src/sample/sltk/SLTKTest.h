@@ -0,0 +1,29 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northeastern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Tests of the sequence tagger. They make a tiny tagger (the embedding table,
+ * the vocabularies and the parameters) in a temporary directory, so no data
+ * files are needed.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#pragma once
+
+/* test for the model registry */
+bool TestRegistry();
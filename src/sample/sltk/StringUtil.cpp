@@ -21,6 +21,7 @@
 
 #include "StringUtil.h"
 #include <algorithm>
+#include <cstring>
 
 /*
 split string by delimiter, this will return indices of all sub-strings
@@ -88,7 +89,7 @@ vector<string> Transform(const string& src)
     /* get the lower string */
     string lower;
     lower.resize(src.size());
-    std::transform(src.begin(), src.end(), lower.begin(), tolower);
+    std::transform(src.begin(), src.end(), lower.begin(), ::tolower);
 
     /* remove blanks */
     string noBlanks;
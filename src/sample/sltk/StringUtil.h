@@ -27,6 +27,19 @@
 
 using namespace std;
 
+/* a piece of characters in a buffer, i.e., a string that does not own (or copy) the data */
+struct StringPiece
+{
+    const char* data;
+    size_t size;
+
+    StringPiece() : data(nullptr), size(0) {}
+    StringPiece(const char* myData, size_t mySize) : data(myData), size(mySize) {}
+
+    /* make a copy of it as a string */
+    string ToString() const { return string(data, size); }
+};
+
 /* Splits a string based on the given delimiter string. Each pair in the
  * returned vector has the start and past-the-end positions for each of the
  * parts of the original string. Empty fields are not represented in the output. */
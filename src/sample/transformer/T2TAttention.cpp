@@ -20,6 +20,9 @@
  */
 
 #include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <string.h>
 #include "T2TAttention.h"
 #include "T2TUtility.h"
 #include "T2TEmbedding.h"
@@ -28,6 +31,10 @@
 namespace transformer
 {
 
+/* tile sizes of the fused attention kernel (queries * keys) */
+#define FUSED_ATT_QTILE 16
+#define FUSED_ATT_KTILE 64
+
 /* constructor */
 T2TAttention::T2TAttention()
 {
@@ -37,6 +44,7 @@ T2TAttention::T2TAttention()
     d  = -1;
     isMasked = false;
     ignored = 0;
+    isFused = true;
 }
 
 /* deconstructor */
@@ -68,6 +76,7 @@ void T2TAttention::InitModel(int argc, char ** argv,
     LoadParamInt(argc, argv, "d", &d, DEFAULT_EMBEDDING_SIZE);
     LoadParamFloat(argc, argv, "attminmax", &minmax, 0.1F);
     LoadParamFloat(argc, argv, "dropoutatt", &dropoutP, 0);
+    LoadParamBool(argc, argv, "fusedatt", &isFused, true);
 
     InitTensor2D(&wk, d, dk, X_FLOAT, devID);
     InitTensor2D(&wq, d, dk, X_FLOAT, devID);
@@ -123,6 +132,17 @@ XTensor T2TAttention::MakeBig(XTensor &kqv, XTensor &mask, bool isTraining)
     TensorList split;
     
     kqv2 = MMul(kqv, wbig);
+
+    /* in inference we run the fused kernel on the packed tensor directly,
+       i.e., no splits of K, Q and V and no merge of the heads */
+    if(isFused && !isTraining && kqv2.devID < 0 && kqv2.dataType == X_FLOAT){
+        bool maskOK = !isMasked ||
+                      (mask.order == 4 && mask.dataType == X_FLOAT &&
+                       mask.GetDim(0) == nhead && mask.GetDim(1) == kqv2.GetDim(0) &&
+                       mask.GetDim(2) == kqv2.GetDim(1) && mask.GetDim(3) == kqv2.GetDim(1));
+        if(maskOK)
+            return MMul(MakeFusedAttention(kqv2, mask), wa);
+    }
     
     int d1 = kqv2.GetDim(0);
     int d2 = kqv2.GetDim(1);
@@ -185,4 +205,166 @@ XTensor T2TAttention::MakeAttention(XTensor &k, XTensor &q, XTensor &v, XTensor
     return MMul(Merge(att, att.order - 1), wa);
 }
 
+/*
+fused attention for a block of (batch * head, query) pairs (x1,y1) - (x2,y2).
+For each query we go over the keys tile by tile and keep the running max and sum of the
+softmax (i.e., online softmax), so the attention matrix of size L * L is never made.
+NOTE: this is a instance of the TFunction type and would be used in XThread
+(see more information in XThread.h/cpp)
+>> args - arguments
+argument0: x1 - index of (batch, head) (upper-left corner)
+argument1: y1 - index of query (upper-left corner)
+argument2: x2 - index of (batch, head) (bottom-right corner)
+argument3: y2 - index of query (bottom-right corner)
+argument4: kqv - packed queries, keys and values of size B * L * 3d
+argument5: mask - the mask of size nhead * B * L * L (NULL if no mask is used)
+argument6: att - the result of size B * L * d
+argument7: number of heads
+argument8: scalar of the dot-product
+*/
+void _FusedAttentionJob(TensorList * args)
+{
+    CheckNTErrors(args->count == 2, "invalid argument number!");
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(indexArgs->count == 4, "invalid argument number!");
+    CheckNTErrors(tensorArgs->count == 5, "invalid argument number!");
+
+    XTensor * kqv = tensorArgs->GetItem(0);
+    XTensor * mask = tensorArgs->GetItem(1);
+    XTensor * att = tensorArgs->GetItem(2);
+    int nhead = *(int*)(tensorArgs->GetItem(3));
+    DTYPE scalar = *(DTYPE*)(tensorArgs->GetItem(4));
+    int x1 = indexArgs->GetItem(0);
+    int y1 = indexArgs->GetItem(1);
+    int x2 = indexArgs->GetItem(2);
+    int y2 = indexArgs->GetItem(3);
+
+    int bsz = kqv->GetDim(0);
+    int len = kqv->GetDim(1);
+    int d = kqv->GetDim(2) / 3;
+    int dh = d / nhead;
+    int kqvStride = 3 * d;
+
+    DTYPE * score = new DTYPE[FUSED_ATT_QTILE * FUSED_ATT_KTILE];
+    DTYPE * acc = new DTYPE[FUSED_ATT_QTILE * dh];
+    DTYPE maxScore[FUSED_ATT_QTILE];
+    DTYPE sumScore[FUSED_ATT_QTILE];
+
+    for(int bh = x1; bh <= x2; bh++){
+        /* the heads are the leading dimension of the mask */
+        int b = bh / nhead;
+        int h = bh % nhead;
+        DTYPE * base = (DTYPE*)kqv->data + (MTYPE)b * len * kqvStride;
+        DTYPE * qBase = base + h * dh;
+        DTYPE * kBase = base + d + h * dh;
+        DTYPE * vBase = base + 2 * d + h * dh;
+        DTYPE * oBase = (DTYPE*)att->data + (MTYPE)b * len * d + h * dh;
+        DTYPE * mBase = mask != NULL ? (DTYPE*)mask->data + ((MTYPE)h * bsz + b) * len * len : NULL;
+
+        for(int i0 = y1; i0 <= y2; i0 += FUSED_ATT_QTILE){
+            int qNum = MIN(FUSED_ATT_QTILE, y2 - i0 + 1);
+
+            for(int i = 0; i < qNum; i++){
+                maxScore[i] = -FLT_MAX;
+                sumScore[i] = 0;
+            }
+            memset(acc, 0, sizeof(DTYPE) * qNum * dh);
+
+            for(int j0 = 0; j0 < len; j0 += FUSED_ATT_KTILE){
+                int kNum = MIN(FUSED_ATT_KTILE, len - j0);
+
+                for(int i = 0; i < qNum; i++){
+                    DTYPE * q = qBase + (MTYPE)(i0 + i) * kqvStride;
+                    DTYPE * s = score + i * FUSED_ATT_KTILE;
+                    DTYPE * m = mBase != NULL ? mBase + (MTYPE)(i0 + i) * len + j0 : NULL;
+
+                    /* s = (q * k^T + mask) * scalar */
+                    DTYPE tileMax = -FLT_MAX;
+                    for(int j = 0; j < kNum; j++){
+                        DTYPE * k = kBase + (MTYPE)(j0 + j) * kqvStride;
+                        DTYPE dot = 0;
+                        for(int o = 0; o < dh; o++)
+                            dot += q[o] * k[o];
+                        if(m != NULL)
+                            dot += m[j];
+                        s[j] = dot * scalar;
+                        tileMax = MAX(tileMax, s[j]);
+                    }
+
+                    /* rescale what we have accumulated if the max changes */
+                    DTYPE newMax = MAX(maxScore[i], tileMax);
+                    DTYPE correction = (DTYPE)exp(maxScore[i] - newMax);
+                    DTYPE * a = acc + i * dh;
+                    if(correction != 1.0F){
+                        sumScore[i] *= correction;
+                        for(int o = 0; o < dh; o++)
+                            a[o] *= correction;
+                    }
+                    maxScore[i] = newMax;
+
+                    /* acc += e^{s - max} * v */
+                    DTYPE sum = 0;
+                    for(int j = 0; j < kNum; j++){
+                        DTYPE p = (DTYPE)exp(s[j] - newMax);
+                        DTYPE * v = vBase + (MTYPE)(j0 + j) * kqvStride;
+                        for(int o = 0; o < dh; o++)
+                            a[o] += p * v[o];
+                        sum += p;
+                    }
+                    sumScore[i] += sum;
+                }
+            }
+
+            /* normalize and write the heads back to where they are in the merged tensor */
+            for(int i = 0; i < qNum; i++){
+                DTYPE * a = acc + i * dh;
+                DTYPE * o = oBase + (MTYPE)(i0 + i) * d;
+                DTYPE r = sumScore[i] > 0 ? 1.0F / sumScore[i] : 0;
+                for(int k = 0; k < dh; k++)
+                    o[k] = a[k] * r;
+            }
+        }
+    }
+
+    delete[] score;
+    delete[] acc;
+}
+
+/*
+make the attention network on the packed queries, keys and values (after linear
+transformation). It is the same as splitting "kqv" and calling MakeAttention(...) in
+inference, but all heads are processed in one pass without splitting and merging them.
+>> kqv - the packed queries, keys and values. It is of size B * L * 3H
+          where B = batch size, L = sequence length,
+          and H = vector size of each position
+>> mask - as it is
+<< return - the attention result (before the transformation of "wa")
+*/
+XTensor T2TAttention::MakeFusedAttention(XTensor &kqv, XTensor &mask)
+{
+    CheckNTErrors(kqv.order == 3, "The packed tensor must be of size B * L * 3H!");
+    CheckNTErrors(kqv.devID < 0 && kqv.dataType == X_FLOAT, "TODO!");
+    CheckNTErrors(kqv.GetDim(2) % (3 * nhead) == 0, "Illegal head number!");
+
+    int bsz = kqv.GetDim(0);
+    int len = kqv.GetDim(1);
+    int dModel = kqv.GetDim(2) / 3;
+
+    XTensor att;
+    InitTensor3D(&att, bsz, len, dModel, X_FLOAT, devID);
+
+    XTensor * maskP = isMasked ? &mask : NULL;
+    DTYPE scalar = 1.0F/(float)sqrt((float)dk/nhead);
+
+    double opNum = (double)bsz * len * len * dModel;
+
+    /* each job works on a block of (batch * head, query) */
+    RunParallel2D(globalPRunner, (void*)_FusedAttentionJob, (int)MIN(opNum, (double)INT_MAX),
+                  bsz * nhead, len, 5,
+                  &kqv, maskP, &att, &nhead, &scalar);
+
+    return att;
+}
+
 }
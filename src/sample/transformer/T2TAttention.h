@@ -81,6 +81,9 @@ public:
     /* dropout probability */
     DTYPE dropoutP;
 
+    /* indicates whether the fused attention kernel is used in inference (CPU only) */
+    bool isFused;
+
 public:
     /* constructor */
     T2TAttention();
@@ -101,6 +104,9 @@ public:
     
     /* make the attention network given keys, queries and values (after linear transformation) */
     XTensor MakeAttention(XTensor &k, XTensor &q, XTensor &v, XTensor &mask, bool isTraining);
+
+    /* make the attention network on the packed queries, keys and values in one fused pass */
+    XTensor MakeFusedAttention(XTensor &kqv, XTensor &mask);
 };
 
 }
@@ -22,6 +22,7 @@
 #include "T2TBatchLoader.h"
 #include "T2TUtility.h"
 #include "../../tensor/XUtility.h"
+#include "../../tensor/XSort.h"
 #include "../../tensor/core/CHeader.h"
 #include "../../network/XNoder.h"
 
@@ -89,14 +90,35 @@ struct SampleNode
     int key;
 };
 
-int CompareSampleNode(const void * a, const void * b)
+/* 
+sort samples in descending order of their lengths (or of their random keys)
+>> nodes - the samples
+>> count - number of the samples
+>> byLength - indicates whether the samples are sorted by length
+*/
+void SortSampleNodes(SampleNode * nodes, int count, bool byLength)
 {
-   return ((SampleNode*)b)->value - ((SampleNode*)a)->value;
-}
+    if (count < 2)
+        return;
 
-int CompareSampleNodeV2(const void * a, const void * b)
-{
-    return ((SampleNode*)b)->key - ((SampleNode*)a)->key;
+    int * keys = new int[count];
+    int * order = new int[count];
+    SampleNode * sorted = new SampleNode[count];
+
+    for (int i = 0; i < count; i++) {
+        keys[i] = byLength ? nodes[i].value : nodes[i].key;
+        order[i] = i;
+    }
+
+    XSortInt(keys, order, 1, count, 1, true);
+
+    for (int i = 0; i < count; i++)
+        sorted[i] = nodes[order[i]];
+    memcpy(nodes, sorted, sizeof(SampleNode) * count);
+
+    delete[] keys;
+    delete[] order;
+    delete[] sorted;
 }
 
 /* 
@@ -196,7 +218,7 @@ int T2TBatchLoader::LoadBuf(FILE * file, bool isSorted, int step)
             offset += node.size;
         }
 
-        qsort(nodes, count, sizeof(SampleNode), CompareSampleNode);
+        SortSampleNodes(nodes, count, true);
 
         /* distribute samples into buckets. In each bucket, sequences have
            similar a length */
@@ -212,7 +234,7 @@ int T2TBatchLoader::LoadBuf(FILE * file, bool isSorted, int step)
                         break;
                 }
 
-                qsort(nodes + m + 1, n - m, sizeof(SampleNode), CompareSampleNodeV2);
+                SortSampleNodes(nodes + m + 1, n - m, false);
                 num += (n - m);
                 n = m;
                 low += bucketSize;
@@ -454,9 +476,34 @@ int T2TBatchLoader::LoadBatchLM(FILE * file,
     return sc;
 }
 
-int CompareBatchNode(const void * a, const void * b)
+/* 
+shuffle batches, i.e., sort them in descending order of their random keys
+>> nodes - the batches
+>> count - number of the batches
+*/
+void ShuffleBatchNodes(BatchNode * nodes, int count)
 {
-    return ((BatchNode*)b)->key - ((BatchNode*)a)->key;
+    if (count < 2)
+        return;
+
+    int * keys = new int[count];
+    int * order = new int[count];
+    BatchNode * sorted = new BatchNode[count];
+
+    for (int i = 0; i < count; i++) {
+        keys[i] = nodes[i].key;
+        order[i] = i;
+    }
+
+    XSortInt(keys, order, 1, count, 1, true);
+
+    for (int i = 0; i < count; i++)
+        sorted[i] = nodes[order[i]];
+    memcpy(nodes, sorted, sizeof(BatchNode) * count);
+
+    delete[] keys;
+    delete[] order;
+    delete[] sorted;
 }
 
 
@@ -546,7 +593,7 @@ int T2TBatchLoader::LoadBatchMT(FILE * file,
         }
 
         if(isRandomBatch)
-            qsort(bufBatch, bufBatchSize, sizeof(BatchNode), CompareBatchNode);
+            ShuffleBatchNodes(bufBatch, bufBatchSize);
     }
 
     if(bufBatchSize <= 0)
@@ -23,6 +23,7 @@
 #include "T2TEmbedding.h"
 #include "T2TUtility.h"
 #include "../../tensor/core/CHeader.h"
+#include "../../tensor/XMemStat.h"
 
 namespace transformer
 {
@@ -61,6 +62,7 @@ void T2TEmbedder::InitModel(int argc, char ** argv, int myDevID, bool isEnc)
     LoadParamInt(argc, argv, "d", &eSize, DEFAULT_EMBEDDING_SIZE);
     LoadParamInt(argc, argv, "d", &d, DEFAULT_EMBEDDING_SIZE);
 
+    XMemCategoryScope scope(MEM_EMBEDDING);
     InitTensor2D(&w, vSize, eSize, X_FLOAT, devID);
 
     DTYPE v = 1.0F/(float)sqrt((float)eSize);
@@ -24,6 +24,7 @@
 #include "T2TUtility.h"
 #include "../../tensor/core/CHeader.h"
 #include "../../tensor/XUtility.h"
+#include "../../tensor/XMemStat.h"
 
 namespace transformer
 {
@@ -61,6 +62,8 @@ void T2TModel::InitModel(int argc, char ** argv)
     LoadParamBool(argc, argv, "lm", &isLM, !isMT);
     LoadParamInt(argc, argv, "nhead", &nhead, 8);
 
+    XMemCategoryScope scope(MEM_PARAMETER);
+
     encoder->InitModel(argc, argv, true, 0, devID);
     outputLayer->InitModel(argc, argv, devID);
 
@@ -108,7 +111,7 @@ XTensor T2TModel::MakeDecoder(XTensor &inputDec, XTensor &outputEnc, XTensor &ma
 /* 
 make the network for language modeling (with the output softmax layer) 
 >> input - input tensor
->> output - output tensor (distribution)
+>> output - output tensor (distribution, or logits in training with the fused loss)
 >> padding - padding of the sequences
 >> isTraining - indicates whether the model is for training
 */
@@ -165,7 +168,10 @@ void T2TModel::MakeLM(XTensor &input, XTensor &output, XTensor &padding, bool is
     ////_Sum(&mask, padding3, &mask);
 
     encoding = MakeEncoder(input, mask, isTraining);
-    outputLayer->Make(encoding, output);
+    if(isTraining && outputLayer->isFusedLoss)
+        outputLayer->MakeLogits(encoding, output);
+    else
+        outputLayer->Make(encoding, output);
 
     delete[] dims;
     delete[] dimsPadding;
@@ -178,7 +184,7 @@ void T2TModel::MakeLM(XTensor &input, XTensor &output, XTensor &padding, bool is
 make the network for machine translation (with the output softmax layer) 
 >> inputEnc - input tensor of the encoder
 >> inputDec - input tensor of the decoder
->> output - output tensor (distribution)
+>> output - output tensor (distribution, or logits in training with the fused loss)
 >> paddingEnc - padding of the sequences (on the encoder side)
 >> paddingDec - padding of the sequences (on the decoder side)
 >> isTraining - indicates whether the model is for training
@@ -201,7 +207,10 @@ void T2TModel::MakeMT(XTensor &inputEnc, XTensor &inputDec, XTensor &output, XTe
 
     decoding = MakeDecoder(inputDec, encoding, maskDec, maskEncDec, isTraining);
 
-    outputLayer->Make(decoding, output);
+    if(isTraining && outputLayer->isFusedLoss)
+        outputLayer->MakeLogits(decoding, output);
+    else
+        outputLayer->Make(decoding, output);
 }
 
 /* 
@@ -34,6 +34,7 @@ T2TOutput::T2TOutput()
     vSize = -1;
     inSize = -1;
     hSize = -1;
+    isFusedLoss = false;
 }
 
 /* de-constructor */
@@ -57,6 +58,11 @@ void T2TOutput::InitModel(int argc, char ** argv, int myDevID)
     LoadParamInt(argc, argv, "d", &inSize, DEFAULT_EMBEDDING_SIZE);
     LoadParamInt(argc, argv, "d", &hSize, DEFAULT_EMBEDDING_SIZE);
     LoadParamFloat(argc, argv, "outputminmax", &minmax, 0.08F);
+    LoadParamBool(argc, argv, "fusedloss", &isFusedLoss, true);
+
+    /* the fused loss is available on CPUs only */
+    if(devID >= 0)
+        isFusedLoss = false;
 
     InitTensor2D(&w, hSize, vSize, X_FLOAT, devID);
     
@@ -95,4 +101,18 @@ void T2TOutput::Make(XTensor &input, XTensor &output)
     output.SetName(OUTPUT_NAME);
 }
 
+/* 
+make the network without the softmax function (redefined output tensor)
+y = x * w
+>> input - input tensor
+>> output - output tensor (logits)
+*/
+void T2TOutput::MakeLogits(XTensor &input, XTensor &output)
+{
+    XTensor &x = input;
+
+    output = MMul(x, w);
+    output.SetName(OUTPUT_NAME);
+}
+
 }
@@ -50,6 +50,10 @@ public:
     /* transformation matrix */
     XTensor w;
 
+    /* indicates whether we output the logits in training (the softmax
+       function is then computed with the loss, see CrossEntropyWithLogits) */
+    bool isFusedLoss;
+
 public:
     /* constructor */
     T2TOutput();
@@ -65,6 +69,9 @@ public:
 
     /* make the network (redefined output tensor) */
     void Make(XTensor &input, XTensor &output);
+
+    /* make the network without the softmax function (redefined output tensor) */
+    void MakeLogits(XTensor &input, XTensor &output);
 };
 
 
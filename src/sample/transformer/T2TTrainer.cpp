@@ -23,9 +23,12 @@
 #include "T2TTrainer.h"
 #include "T2TUtility.h"
 #include "../../tensor/XUtility.h"
+#include "../../tensor/XMemStat.h"
+#include "../../tensor/XElementWise.h"
 #include "../../tensor/core/CHeader.h"
 #include "../../tensor/loss/LHeader.h"
 #include "../../network/XNoder.h"
+#include "../../tensor/core/utilities/XMatrixSegment.h"
 
 #ifndef WIN32
 #include <sys/time.h>
@@ -40,6 +43,11 @@ T2TTrainer::T2TTrainer()
 {
     argNum = 0;
     argArray = NULL;
+    flatParam = NULL;
+    flatGrad = NULL;
+    flatMoment = NULL;
+    flatMoment2nd = NULL;
+    flatSize = 0;
 }
 
 /* de-constructor */
@@ -59,6 +67,12 @@ T2TTrainer::~T2TTrainer()
         delete[] argArray[i];
     delete[] argArray;
 
+    if(flatParam != NULL){
+        XMemFree(-1, flatParam);
+        XMemFree(-1, flatGrad);
+        XMemFree(-1, flatMoment);
+        XMemFree(-1, flatMoment2nd);
+    }
 }
 
 /* 
@@ -89,6 +103,9 @@ void T2TTrainer::Init(int argc, char ** argv)
     LoadParamFloat(argc, argv, "adambeta1", &adamBeta1, 0.9F);
     LoadParamFloat(argc, argv, "adambeta2", &adamBeta2, 0.98F);
     LoadParamFloat(argc, argv, "adamdelta", &adamDelta, 1e-9F);
+    LoadParamFloat(argc, argv, "adamweightdecay", &adamWeightDecay, 0);
+    LoadParamBool(argc, argv, "fusedadam", &isFusedAdam, true);
+    LoadParamBool(argc, argv, "flatupdate", &isFlatUpdate, false);
     LoadParamBool(argc, argv, "shuffled", &isShuffled, false);
     LoadParamFloat(argc, argv, "labelsmoothing", &labelSmoothingP, 0);
     LoadParamInt(argc, argv, "nstepcheckpoint", &nStepCheckpoint, -1);
@@ -202,17 +219,23 @@ void T2TTrainer::Train(const char * fn, const char * validFN, const char * model
             //    LabelSmooth(&gold, &goldSmoothed, labelSmoothingP);
 
             XTensor labelOnehot;
+            XTensor lossTensor;
 
-            labelOnehot = IndexToOnehot(label, vSizeTgt, labelSmoothingP);
+            /* the output is the logits and the loss is computed from the
+               label indices directly, i.e., no one-hot tensor is generated */
+            if(model->outputLayer->isFusedLoss)
+                lossTensor = CrossEntropyWithLogits(output, label, paddingDec, labelSmoothingP);
+            else{
+                labelOnehot = IndexToOnehot(label, vSizeTgt, labelSmoothingP);
             
-            /* make paddings for the output */
-            //if (output.GetDim(0) > 0)
-                //PadOutput(&output, &labelOnehot, &paddingDec);
+                /* make paddings for the output */
+                //if (output.GetDim(0) > 0)
+                    //PadOutput(&output, &labelOnehot, &paddingDec);
 
-            /* get probabilities */
-            //float prob = GetProb(&output, &labelOnehot, NULL);
-            XTensor lossTensor;
-            lossTensor = CrossEntropy(output, labelOnehot, paddingDec);
+                /* get probabilities */
+                //float prob = GetProb(&output, &labelOnehot, NULL);
+                lossTensor = CrossEntropy(output, labelOnehot, paddingDec);
+            }
             float prob = ReduceSumAll(lossTensor);
 
             DTYPE lossLocal = prob / wc;
@@ -481,6 +504,78 @@ float T2TTrainer::GetProb(XTensor * output, XTensor * gold, XTensor * wordProbs)
     return result.Get1D(0);
 }
 
+/* number of items that are processed by a job of the adam update */
+#define ADAM_BLOCK_SIZE 16384
+
+/*
+the adam (or AdamW) update on a number of blocks of the arrays. For each item
+we read the parameter, gradient and moments once, and write them back once:
+m = beta_1 * m + (1-beta_1) * grad
+v = beta_2 * v + (1-beta_2) * grad * grad
+para = para * (1 - lr * weightDecay) - e * m / (sqrt(v) + delta)
+grad = 0
+NOTE: this is a instance of the TFunction type and would be used in XThread
+(see more information in XThread.h/cpp)
+>> args - arguments
+argument0: x1 - block index (upper-left corner)
+argument1: y1 - column index (upper-left corner)
+argument2: x2 - block index (bottom-right corner)
+argument3: y2 - column index (bottom-right corner)
+argument4: para - the parameters
+argument5: grad - the gradients
+argument6: m - the 1st order moments
+argument7: v - the 2nd order moments
+argument8: number of items in the arrays
+argument9: hyper parameters {beta_1, beta_2, e, delta, 1 - lr * weightDecay}
+*/
+void _AdamUpdateJob(TensorList * args)
+{
+    CheckNTErrors(args->count == 2, "invalid argument number!");
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(indexArgs->count == 4, "invalid argument number!");
+    CheckNTErrors(tensorArgs->count == 6, "invalid argument number!");
+
+    DTYPE * para = (DTYPE*)tensorArgs->GetItem(0);
+    DTYPE * grad = (DTYPE*)tensorArgs->GetItem(1);
+    DTYPE * m = (DTYPE*)tensorArgs->GetItem(2);
+    DTYPE * v = (DTYPE*)tensorArgs->GetItem(3);
+    int n = *(int*)tensorArgs->GetItem(4);
+    DTYPE * hyper = (DTYPE*)tensorArgs->GetItem(5);
+    int x1 = indexArgs->GetItem(0);
+    int x2 = indexArgs->GetItem(2);
+
+    DTYPE beta1 = hyper[0];
+    DTYPE beta2 = hyper[1];
+    DTYPE e = hyper[2];
+    DTYPE delta = hyper[3];
+    DTYPE decay = hyper[4];
+
+    int begin = x1 * ADAM_BLOCK_SIZE;
+    int end = MIN((x2 + 1) * ADAM_BLOCK_SIZE, n);
+
+    XEWAdam(para + begin, grad + begin, m + begin, v + begin, end - begin,
+            beta1, beta2, e, delta, decay);
+}
+
+/*
+the adam update on arrays (in parallel)
+>> para - the parameters
+>> grad - the gradients (set to zero after the update)
+>> m - the 1st order moments
+>> v - the 2nd order moments
+>> n - number of items in the arrays
+>> hyper - hyper parameters {beta_1, beta_2, e, delta, 1 - lr * weightDecay}
+*/
+void AdamUpdate(DTYPE * para, DTYPE * grad, DTYPE * m, DTYPE * v, int n, DTYPE * hyper)
+{
+    int blockNum = (n + ADAM_BLOCK_SIZE - 1) / ADAM_BLOCK_SIZE;
+
+    RunParallel2D(globalPRunner, (void*)_AdamUpdateJob, n,
+                  blockNum, 1, 6,
+                  para, grad, m, v, &n, hyper);
+}
+
 /* 
 update the model by delta rule
 \theta_new = \theta - \lrate * grad
@@ -495,6 +590,24 @@ void T2TTrainer::Update(T2TModel * model, const float lr)
 
     model->GetParams(ws);
 
+    /* the step number of adam goes forward once for each update of the model */
+    DTYPE hyper[5];
+    if(useAdam){
+        adamBeta1T *= adamBeta1;
+        adamBeta2T *= adamBeta2;
+        hyper[0] = adamBeta1;
+        hyper[1] = adamBeta2;
+        hyper[2] = lr * (DTYPE)sqrt(1 - adamBeta2T) / (1 - adamBeta1T);
+        hyper[3] = adamDelta * (DTYPE)sqrt(1 - adamBeta2T);
+        hyper[4] = 1.0F - lr * adamWeightDecay;
+    }
+
+    /* all parameters are updated in one loop */
+    if(useAdam && flatParam != NULL){
+        AdamUpdate(flatParam, flatGrad, flatMoment, flatMoment2nd, flatSize, hyper);
+        return;
+    }
+
     for(int i = 0; i < ws.count; i++){
         XTensor * para = (XTensor*)ws.Get(i);
         XTensor * paraGrad = para->grad;
@@ -506,18 +619,23 @@ void T2TTrainer::Update(T2TModel * model, const float lr)
         CheckNTErrors(paraGrad != NULL, "NULL gradient tensor!");
 
         if(useAdam){
-            adamBeta1T *= adamBeta1;
-            adamBeta2T *= adamBeta2;
-            DTYPE e = lr * (DTYPE)sqrt(1 - adamBeta2T) / (1 - adamBeta1T);
-            DTYPE d = adamDelta * (DTYPE)sqrt(1 - adamBeta2T);
+            XTensor * m = (XTensor*)moments.Get(i);
+            XTensor * v = (XTensor*)moments2nd.Get(i);
+
+            if(isFusedAdam && para->devID < 0 && para->dataType == X_FLOAT){
+                AdamUpdate((DTYPE*)para->data, (DTYPE*)paraGrad->data,
+                           (DTYPE*)m->data, (DTYPE*)v->data, para->unitNum, hyper);
+                continue;
+            }
+
+            DTYPE e = hyper[2];
+            DTYPE d = hyper[3];
 
             /* m = beta_1 * m + (1-beta_1) * grad */
-            XTensor * m = (XTensor*)moments.Get(i);
             _ScaleAndShiftMe(m, adamBeta1, 0);
             _Sum(m, paraGrad, m, (1.0F - adamBeta1));
             
             /* v = beta_2 * v + (1-beta_2) * grad * grad*/
-            XTensor * v = (XTensor*)moments2nd.Get(i);
             _Multiply(paraGrad, paraGrad, v, adamBeta2/(1.0F - adamBeta2));
             _ScaleAndShiftMe(v, (1.0F - adamBeta2), 0);
 
@@ -527,6 +645,10 @@ void T2TTrainer::Update(T2TModel * model, const float lr)
             _ScaleAndShiftMe(v2, 1.0F, d);
             _Div(m, v2, v2);
 
+            /* weight decay (AdamW) */
+            if(adamWeightDecay != 0)
+                _ScaleAndShiftMe(para, hyper[4], 0);
+
             /* the delta rule */
             _Sum(para, v2, para, -e);
 
@@ -556,11 +678,15 @@ void T2TTrainer::PrepareModel(T2TModel * model)
 
     model->GetParams(ws);
 
+    /* the flat update is available on CPUs only */
+    bool isFlat = useAdam && isFlatUpdate && model->devID < 0;
+
     for(int i = 0; i < ws.count; i++){
         XTensor * para = (XTensor*)ws.Get(i);
         XNoder::MakeGrad(para);
 
-        if(useAdam){
+        if(useAdam && !isFlat){
+            XMemCategoryScope scope(MEM_OPTIMIZER);
             XTensor * m = new XTensor(para);
             XTensor * m2 = new XTensor(para);
             m->SetZeroAll();
@@ -570,10 +696,84 @@ void T2TTrainer::PrepareModel(T2TModel * model)
         }
     }
 
+    if(isFlat)
+        FlattenModel(ws);
+
     adamBeta1T = 1.0F;
     adamBeta2T = 1.0F;
 }
 
+/*
+move the data of a tensor to a given place of a buffer. The tensor then shares
+the buffer (out of the memory pool) and does not free the data by itself.
+>> tensor - the tensor
+>> buf - where we put the data
+*/
+void MoveToBuffer(XTensor * tensor, DTYPE * buf)
+{
+    memcpy(buf, tensor->data, tensor->GetDataSizeInChar());
+
+    if(!tensor->isShared)
+        tensor->DestroyData();
+
+    /* the tensor is now out of the memory pool */
+    tensor->data = buf;
+    tensor->mem = NULL;
+    tensor->signature = 0;
+    tensor->isInGlobalMem = false;
+    tensor->isShared = true;
+}
+
+/*
+put the parameters and gradients in contiguous buffers (and create the moments
+of adam there). Then an update of the model is a single loop over the buffers
+rather than a loop for each parameter matrix.
+>> ws - the parameters (with gradients)
+*/
+void T2TTrainer::FlattenModel(TensorList &ws)
+{
+    DTYPE * oldParam = flatParam;
+    DTYPE * oldGrad = flatGrad;
+
+    flatSize = 0;
+    for(int i = 0; i < ws.count; i++){
+        XTensor * para = (XTensor*)ws.Get(i);
+        CheckNTErrors(para->devID < 0 && para->dataType == X_FLOAT, "The flat update is for float parameters on CPUs!");
+        CheckNTErrors(para->grad != NULL, "NULL gradient tensor!");
+        flatSize += para->unitNum;
+    }
+
+    {
+        XMemCategoryScope scope(MEM_PARAMETER);
+        flatParam = (DTYPE*)XMemAlloc(-1, sizeof(DTYPE) * flatSize);
+    }
+    {
+        XMemCategoryScope scope(MEM_GRADIENT);
+        flatGrad = (DTYPE*)XMemAlloc(-1, sizeof(DTYPE) * flatSize);
+    }
+
+    int offset = 0;
+    for(int i = 0; i < ws.count; i++){
+        XTensor * para = (XTensor*)ws.Get(i);
+        MoveToBuffer(para, flatParam + offset);
+        MoveToBuffer(para->grad, flatGrad + offset);
+        offset += para->unitNum;
+    }
+
+    if(oldParam != NULL){
+        XMemFree(-1, oldParam);
+        XMemFree(-1, oldGrad);
+        XMemFree(-1, flatMoment);
+        XMemFree(-1, flatMoment2nd);
+    }
+
+    XMemCategoryScope scope(MEM_OPTIMIZER);
+    flatMoment = (DTYPE*)XMemAlloc(-1, sizeof(DTYPE) * flatSize);
+    flatMoment2nd = (DTYPE*)XMemAlloc(-1, sizeof(DTYPE) * flatSize);
+    memset(flatMoment, 0, sizeof(DTYPE) * flatSize);
+    memset(flatMoment2nd, 0, sizeof(DTYPE) * flatSize);
+}
+
 /* 
 do padding on the output 
 >> output - output tensor of the network
@@ -81,12 +81,31 @@ public:
     float adamBeta1T;
     float adamBeta2T;
 
+    /* weight decay of adam (decoupled from the gradient, i.e., AdamW) */
+    float adamWeightDecay;
+
+    /* indicates whether we update the parameters in one sweep (CPU only) */
+    bool isFusedAdam;
+
+    /* indicates whether the parameters, gradients and moments are kept in
+       contiguous buffers so that the update is a single loop (CPU only) */
+    bool isFlatUpdate;
+
     /* list of the moment of the parameter matrics */
     TensorList moments;
 
     /* list of the 2nd order moment of the parameter matrics */
     TensorList moments2nd;
 
+    /* the contiguous buffers of the parameters, gradients and moments */
+    DTYPE * flatParam;
+    DTYPE * flatGrad;
+    DTYPE * flatMoment;
+    DTYPE * flatMoment2nd;
+
+    /* number of items in each contiguous buffer */
+    int flatSize;
+
     /* indicates whether the data file is shuffled for training */
     bool isShuffled;
     
@@ -139,6 +158,9 @@ public:
     /* prepare model for training */
     void PrepareModel(T2TModel * model);
 
+    /* put the parameters and gradients in contiguous buffers */
+    void FlattenModel(TensorList &ws);
+
     /* do padding on the output */
     void PadOutput(XTensor * output, XTensor * gold, XTensor * padding);
     
@@ -30,6 +30,9 @@
 #include "../../tensor/XDevice.h"
 #include "../../tensor/XUtility.h"
 #include "../../tensor/XGlobal.h"
+#include "../../tensor/XMemStat.h"
+#include "../../tensor/XRand.h"
+#include "../../tensor/XNuma.h"
 
 namespace transformer
 {
@@ -50,18 +53,44 @@ int TransformerMain(int argc, const char ** argv)
     ShowParams(argc, args);
 
     bool isBeamSearch = false;
+    bool isMemStat = false;
+    int seed = 0;
+    int threadNum = 1;
     char * trainFN = new char[MAX_LINE_LENGTH];
     char * modelFN = new char[MAX_LINE_LENGTH];
     char * testFN = new char[MAX_LINE_LENGTH];
     char * outputFN = new char[MAX_LINE_LENGTH];
+    char * memDumpFN = new char[MAX_LINE_LENGTH];
+    char * numaNodes = new char[MAX_LINE_LENGTH];
 
     LoadParamString(argc, args, "train", trainFN, "");
     LoadParamString(argc, args, "model", modelFN, "");
     LoadParamString(argc, args, "test", testFN, "");
     LoadParamString(argc, args, "output", outputFN, "");
     LoadParamBool(argc, args, "beamsearch", &isBeamSearch, false);
-
-    srand((unsigned int)time(NULL));
+    LoadParamBool(argc, args, "memstat", &isMemStat, false);
+    LoadParamString(argc, args, "memdump", memDumpFN, "");
+    LoadParamInt(argc, args, "seed", &seed, (int)time(NULL));
+    LoadParamInt(argc, args, "nthread", &threadNum, 1);
+    LoadParamString(argc, args, "numa", numaNodes, "");
+
+    /* the memory accounting (the peak is shown at exit) */
+    if(isMemStat || strcmp(memDumpFN, ""))
+        GMemStat.Enable();
+
+    /* the same seed gives the same initial model and dropout masks */
+    srand((unsigned int)seed);
+    XRandSeed((unsigned long long)seed);
+
+    /* the threads of the parallel jobs on CPUs */
+    if(threadNum > 1){
+        globalPRunner = new XPRunner();
+        globalPRunner->Init(threadNum);
+
+        /* pin the threads to the cores of the NUMA nodes, e.g., "0,1" */
+        if(strcmp(numaNodes, "") && !globalPRunner->Pin(numaNodes))
+            XPRINT1(0, stderr, "[WARNING] cannot pin the threads to the nodes %s\n", numaNodes);
+    }
 
     T2TTrainer trainer;
     trainer.Init(argc, args);
@@ -98,10 +127,19 @@ int TransformerMain(int argc, const char ** argv)
         }
     }
 
+    /* a snapshot of the memory usage */
+    if(strcmp(memDumpFN, ""))
+        GMemStat.Dump(memDumpFN);
+
+    delete globalPRunner;
+    globalPRunner = NULL;
+
     delete[] trainFN;
     delete[] modelFN;
     delete[] testFN;
     delete[] outputFN;
+    delete[] memDumpFN;
+    delete[] numaNodes;
 
     for(int i = 0; i < argc; i++)
         delete[] args[i];
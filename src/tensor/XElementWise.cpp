@@ -0,0 +1,466 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * The element-wise engine on CPUs (see XElementWise.h). The kernels in
+ * XElementWiseKernel.h are compiled three times, each in a namespace that
+ * wraps an instruction set. The AVX-512 and AVX2 versions are compiled with
+ * "#pragma GCC target", so the rest of the code needs no special flags.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "XElementWise.h"
+#include "XGlobal.h"
+#include "XPRunner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EW_X86
+#include <immintrin.h>
+#endif
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* number of items a thread processes at least */
+#define EW_GRAIN 16384
+
+/* number of vectors we go over before the running max is updated (see RunMaxSumExp) */
+#define EW_TILE_VECTOR_NUM 8
+
+/* scalar code (one float a "vector") */
+namespace ew_scalar{
+
+typedef float VF;
+typedef int32_t VI;
+typedef bool VM;
+const int N = 1;
+
+inline VF Load(const float * p) { return *p; }
+inline void Store(float * p, VF x) { *p = x; }
+inline VF Set(float x) { return x; }
+inline VI SetI(int x) { return x; }
+inline VF Add(VF a, VF b) { return a + b; }
+inline VF Sub(VF a, VF b) { return a - b; }
+inline VF Mul(VF a, VF b) { return a * b; }
+inline VF Div(VF a, VF b) { return a / b; }
+inline VF MulAdd(VF a, VF b, VF c) { return fmaf(a, b, c); }
+inline VF Min(VF a, VF b) { return a < b ? a : b; }
+inline VF Max(VF a, VF b) { return a > b ? a : b; }
+inline VF Sqrt(VF a) { return sqrtf(a); }
+inline VF Floor(VF a) { return floorf(a); }
+inline VF Ceil(VF a) { return ceilf(a); }
+inline VF Trunc(VF a) { return truncf(a); }
+inline VF RoundNearest(VF a) { return nearbyintf(a); }
+inline VF Abs(VF a) { return fabsf(a); }
+inline VF Neg(VF a) { return -a; }
+inline VM CmpLT(VF a, VF b) { return a < b; }
+inline VM CmpLE(VF a, VF b) { return a <= b; }
+inline VM CmpGT(VF a, VF b) { return a > b; }
+inline VM CmpEQ(VF a, VF b) { return a == b; }
+inline VM CmpNEQ(VF a, VF b) { return a != b; }
+inline VM IsNaN(VF a) { return a != a; }
+inline VM MOr(VM a, VM b) { return a || b; }
+inline VM MAndNot(VM a, VM b) { return a && !b; }
+inline VF Select(VM m, VF a, VF b) { return m ? a : b; }
+inline VI AsInt(VF a) { VI i; memcpy(&i, &a, sizeof(i)); return i; }
+inline VF AsFloat(VI i) { VF a; memcpy(&a, &i, sizeof(a)); return a; }
+inline VI ToInt(VF a) { return (VI)nearbyintf(a); }
+inline VF ToFloat(VI i) { return (VF)i; }
+inline VI AddI(VI a, VI b) { return a + b; }
+inline VI SubI(VI a, VI b) { return a - b; }
+inline VI AndI(VI a, VI b) { return a & b; }
+inline VI OrI(VI a, VI b) { return a | b; }
+inline VI Srl23(VI a) { return (VI)((uint32_t)a >> 23); }
+inline VI Sll23(VI a) { return (VI)((uint32_t)a << 23); }
+inline float ReduceMax(VF a) { return a; }
+inline float ReduceSum(VF a) { return a; }
+
+#include "XElementWiseKernel.h"
+
+} /* end of ew_scalar */
+
+#ifdef EW_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+/* AVX2 (8 floats a vector) */
+namespace ew_avx2{
+
+typedef __m256 VF;
+typedef __m256i VI;
+typedef __m256 VM;
+const int N = 8;
+
+inline VF Load(const float * p) { return _mm256_loadu_ps(p); }
+inline void Store(float * p, VF x) { _mm256_storeu_ps(p, x); }
+inline VF Set(float x) { return _mm256_set1_ps(x); }
+inline VI SetI(int x) { return _mm256_set1_epi32(x); }
+inline VF Add(VF a, VF b) { return _mm256_add_ps(a, b); }
+inline VF Sub(VF a, VF b) { return _mm256_sub_ps(a, b); }
+inline VF Mul(VF a, VF b) { return _mm256_mul_ps(a, b); }
+inline VF Div(VF a, VF b) { return _mm256_div_ps(a, b); }
+inline VF MulAdd(VF a, VF b, VF c) { return _mm256_fmadd_ps(a, b, c); }
+inline VF Min(VF a, VF b) { return _mm256_min_ps(a, b); }
+inline VF Max(VF a, VF b) { return _mm256_max_ps(a, b); }
+inline VF Sqrt(VF a) { return _mm256_sqrt_ps(a); }
+inline VF Floor(VF a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+inline VF Ceil(VF a) { return _mm256_round_ps(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+inline VF Trunc(VF a) { return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+inline VF RoundNearest(VF a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline VF Abs(VF a) { return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF))); }
+inline VF Neg(VF a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0F)); }
+inline VM CmpLT(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline VM CmpLE(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline VM CmpGT(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline VM CmpEQ(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline VM CmpNEQ(VF a, VF b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+inline VM IsNaN(VF a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+inline VM MOr(VM a, VM b) { return _mm256_or_ps(a, b); }
+inline VM MAndNot(VM a, VM b) { return _mm256_andnot_ps(b, a); }
+inline VF Select(VM m, VF a, VF b) { return _mm256_blendv_ps(b, a, m); }
+inline VI AsInt(VF a) { return _mm256_castps_si256(a); }
+inline VF AsFloat(VI i) { return _mm256_castsi256_ps(i); }
+inline VI ToInt(VF a) { return _mm256_cvtps_epi32(a); }
+inline VF ToFloat(VI i) { return _mm256_cvtepi32_ps(i); }
+inline VI AddI(VI a, VI b) { return _mm256_add_epi32(a, b); }
+inline VI SubI(VI a, VI b) { return _mm256_sub_epi32(a, b); }
+inline VI AndI(VI a, VI b) { return _mm256_and_si256(a, b); }
+inline VI OrI(VI a, VI b) { return _mm256_or_si256(a, b); }
+inline VI Srl23(VI a) { return _mm256_srli_epi32(a, 23); }
+inline VI Sll23(VI a) { return _mm256_slli_epi32(a, 23); }
+
+inline float ReduceMax(VF a)
+{
+    __m128 r = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+    r = _mm_max_ss(r, _mm_shuffle_ps(r, r, 1));
+    return _mm_cvtss_f32(r);
+}
+
+inline float ReduceSum(VF a)
+{
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+    r = _mm_add_ps(r, _mm_movehl_ps(r, r));
+    r = _mm_add_ss(r, _mm_shuffle_ps(r, r, 1));
+    return _mm_cvtss_f32(r);
+}
+
+#include "XElementWiseKernel.h"
+
+} /* end of ew_avx2 */
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+
+/* AVX-512 (16 floats a vector) */
+namespace ew_avx512{
+
+typedef __m512 VF;
+typedef __m512i VI;
+typedef __mmask16 VM;
+const int N = 16;
+
+inline VF Load(const float * p) { return _mm512_loadu_ps(p); }
+inline void Store(float * p, VF x) { _mm512_storeu_ps(p, x); }
+inline VF Set(float x) { return _mm512_set1_ps(x); }
+inline VI SetI(int x) { return _mm512_set1_epi32(x); }
+inline VF Add(VF a, VF b) { return _mm512_add_ps(a, b); }
+inline VF Sub(VF a, VF b) { return _mm512_sub_ps(a, b); }
+inline VF Mul(VF a, VF b) { return _mm512_mul_ps(a, b); }
+inline VF Div(VF a, VF b) { return _mm512_div_ps(a, b); }
+inline VF MulAdd(VF a, VF b, VF c) { return _mm512_fmadd_ps(a, b, c); }
+inline VF Min(VF a, VF b) { return _mm512_min_ps(a, b); }
+inline VF Max(VF a, VF b) { return _mm512_max_ps(a, b); }
+inline VF Sqrt(VF a) { return _mm512_sqrt_ps(a); }
+inline VF Floor(VF a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+inline VF Ceil(VF a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+inline VF Trunc(VF a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+inline VF RoundNearest(VF a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline VF Abs(VF a) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7FFFFFFF))); }
+inline VF Neg(VF a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32((int)0x80000000U))); }
+inline VM CmpLT(VF a, VF b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+inline VM CmpLE(VF a, VF b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+inline VM CmpGT(VF a, VF b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+inline VM CmpEQ(VF a, VF b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+inline VM CmpNEQ(VF a, VF b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+inline VM IsNaN(VF a) { return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+inline VM MOr(VM a, VM b) { return (VM)(a | b); }
+inline VM MAndNot(VM a, VM b) { return (VM)(a & ~b); }
+inline VF Select(VM m, VF a, VF b) { return _mm512_mask_blend_ps(m, b, a); }
+inline VI AsInt(VF a) { return _mm512_castps_si512(a); }
+inline VF AsFloat(VI i) { return _mm512_castsi512_ps(i); }
+inline VI ToInt(VF a) { return _mm512_cvtps_epi32(a); }
+inline VF ToFloat(VI i) { return _mm512_cvtepi32_ps(i); }
+inline VI AddI(VI a, VI b) { return _mm512_add_epi32(a, b); }
+inline VI SubI(VI a, VI b) { return _mm512_sub_epi32(a, b); }
+inline VI AndI(VI a, VI b) { return _mm512_and_si512(a, b); }
+inline VI OrI(VI a, VI b) { return _mm512_or_si512(a, b); }
+inline VI Srl23(VI a) { return _mm512_srli_epi32(a, 23); }
+inline VI Sll23(VI a) { return _mm512_slli_epi32(a, 23); }
+inline float ReduceMax(VF a) { return _mm512_reduce_max_ps(a); }
+inline float ReduceSum(VF a) { return _mm512_reduce_add_ps(a); }
+
+#include "XElementWiseKernel.h"
+
+} /* end of ew_avx512 */
+
+#pragma GCC pop_options
+
+#endif
+
+/* run a kernel of the instruction set in use. This is the only place where the set is chosen */
+#ifdef EW_X86
+#define EW_DISPATCH(isa, call)              \
+    if(isa == XSIMD_AVX512)                 \
+        ew_avx512::call;                    \
+    else if(isa == XSIMD_AVX2)              \
+        ew_avx2::call;                      \
+    else                                    \
+        ew_scalar::call
+#else
+#define EW_DISPATCH(isa, call) ew_scalar::call
+#endif
+
+/* the instruction set in use (-1 means it is not chosen yet) */
+static int ewISA = -1;
+
+/* the best instruction set of the CPU */
+int XEWDetectISA()
+{
+#ifdef EW_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return XSIMD_AVX512;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return XSIMD_AVX2;
+#endif
+    return XSIMD_SCALAR;
+}
+
+/* the instruction set in use */
+int XEWGetISA()
+{
+    if(ewISA < 0)
+        ewISA = XEWDetectISA();
+    return ewISA;
+}
+
+/*
+use another instruction set, e.g., to compare the results of the sets
+>> isa - the instruction set (lowered to the best one of the CPU)
+*/
+void XEWSetISA(int isa)
+{
+    int best = XEWDetectISA();
+    ewISA = isa < XSIMD_SCALAR ? XSIMD_SCALAR : (isa > best ? best : isa);
+}
+
+/* name of an instruction set */
+const char * XEWGetISAName(int isa)
+{
+    if(isa == XSIMD_AVX512)
+        return "avx512";
+    if(isa == XSIMD_AVX2)
+        return "avx2";
+    return "scalar";
+}
+
+/*
+number of floats in a vector of the instruction set in use. A call on fewer
+items than this runs no vector code but still pays for the dispatch, so
+callers that go over many short rows had better use a plain loop
+*/
+int XEWGetWidth()
+{
+    int isa = XEWGetISA();
+    if(isa == XSIMD_AVX512)
+        return 16;
+    if(isa == XSIMD_AVX2)
+        return 8;
+    return 1;
+}
+
+/*
+b = f(a) over n items. The items are split over the threads if there are many.
+>> op - the function
+>> a - the input array
+>> b - the output array (it can be a)
+>> n - number of items
+>> p0 - the first parameter (e.g., the scale or the exponent)
+>> p1 - the second parameter (e.g., the shift)
+*/
+void XEWUnary(EW_UNARY op, const float * a, float * b, int n, float p0, float p1)
+{
+    int isa = XEWGetISA();
+
+    XParallelFor(0, n, EW_GRAIN, [&](int begin, int end) {
+        EW_DISPATCH(isa, RunUnary(op, a + begin, b + begin, end - begin, p0, p1));
+    });
+}
+
+/*
+c = f(a, b) over n items
+>> op - the function
+>> a - the first input array
+>> b - the second input array
+>> c - the output array (it can be a or b)
+>> n - number of items
+>> alpha - the coefficient of c (for multiplication and division)
+*/
+void XEWBinary(EW_BINARY op, const float * a, const float * b, float * c, int n, float alpha)
+{
+    int isa = XEWGetISA();
+
+    XParallelFor(0, n, EW_GRAIN, [&](int begin, int end) {
+        EW_DISPATCH(isa, RunBinary(op, a + begin, b + begin, c + begin, end - begin, alpha));
+    });
+}
+
+/*
+e^x of a number. It is the same approximation as EW_EXP (a lane of the vector
+code gives the same bits)
+>> x - the number
+<< return - e^x
+*/
+float XEWExp(float x)
+{
+    return ew_scalar::Exp(x);
+}
+
+/*
+max of x and sum_i e^{x_i - max} over an array in one pass (online softmax),
+so there is one exp for each item and one pass over the memory
+>> x - the input array
+>> n - size of the array
+>> max - max_i x_i
+>> sum - sum_i e^{x_i - max}
+>> total - sum_i x_i (we skip it if total == NULL)
+*/
+void XEWMaxSumExp(const float * x, int n, float * max, float * sum, float * total)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunMaxSumExp(x, n, max, sum, total));
+}
+
+/*
+the same thing for the columns of a matrix, i.e., over x[i * stride + j] for
+i in [0, n) and j in [0, colNum)
+>> x - the input matrix
+>> n - number of rows
+>> stride - distance between two rows in x
+>> colNum - number of columns
+>> max - max of each column
+>> sum - sum_i e^{x_i - max} of each column
+*/
+void XEWMaxSumExpCol(const float * x, int n, int stride, int colNum, float * max, float * sum)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunMaxSumExpCol(x, n, stride, colNum, max, sum));
+}
+
+/*
+y = e^{x - shift} * alpha + beta (e.g., the output of softmax)
+>> x - the input array
+>> y - the output array (it can be x)
+>> n - size of the arrays
+>> shift - the shift
+>> alpha - the scale
+>> beta - the bias
+*/
+void XEWExpAffine(const float * x, float * y, int n, float shift, float alpha, float beta)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunExpAffine(x, y, n, shift, alpha, beta));
+}
+
+/*
+y_i = e^{x_i - shift_i} * alpha_i (e.g., a row of softmax along the columns)
+>> x - the input array
+>> y - the output array (it can be x)
+>> n - size of the arrays
+>> shift - the shifts
+>> alpha - the scales
+*/
+void XEWExpAffineV(const float * x, float * y, int n, const float * shift, const float * alpha)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunExpAffineV(x, y, n, shift, alpha));
+}
+
+/*
+y = max(x - shift, lower) (e.g., the output of log-softmax)
+>> x - the input array
+>> y - the output array (it can be x)
+>> n - size of the arrays
+>> shift - the shift
+>> lower - the lower bound
+*/
+void XEWShiftMax(const float * x, float * y, int n, float shift, float lower)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunShiftMax(x, y, n, shift, lower));
+}
+
+/*
+y_i = max(x_i - shift_i, lower)
+>> x - the input array
+>> y - the output array (it can be x)
+>> n - size of the arrays
+>> shift - the shifts
+>> lower - the lower bound
+*/
+void XEWShiftMaxV(const float * x, float * y, int n, const float * shift, float lower)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunShiftMaxV(x, y, n, shift, lower));
+}
+
+/*
+the Adam update (with decoupled weight decay)
+m = beta1 * m + (1 - beta1) * grad
+v = beta2 * v + (1 - beta2) * grad^2
+para = para * decay - e * m / (sqrt(v) + delta)
+and the gradients are set to zero
+>> para - the parameters
+>> grad - the gradients
+>> m - the 1st order moments
+>> v - the 2nd order moments
+>> n - number of items
+>> beta1 - beta_1
+>> beta2 - beta_2
+>> e - the learning rate (with the bias correction)
+>> delta - delta
+>> decay - 1 - lr * weightDecay
+*/
+void XEWAdam(float * para, float * grad, float * m, float * v, int n,
+             float beta1, float beta2, float e, float delta, float decay)
+{
+    int isa = XEWGetISA();
+    EW_DISPATCH(isa, RunAdam(para, grad, m, v, n, beta1, beta2, e, delta, decay));
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
@@ -0,0 +1,128 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * The element-wise engine on CPUs. The unary, binary and activation functions
+ * of float arrays run here. The kernels are compiled for AVX-512, AVX2 and
+ * scalar code, and the best one that the CPU supports is chosen when the
+ * program runs (so that a binary built without -march=native still uses
+ * AVX-512 if it is there). The arrays need not be aligned and of any size, and
+ * large ones are split over the threads of globalPRunner.
+ *
+ * exp, log, tanh, sigmoid and pow are polynomial approximations (Cephes) rather
+ * than libm calls. The max errors that TXElementWise measures on the normal
+ * range are 1 ulp for exp, log and tanh, 2 ulp for sigmoid, and at most
+ * (2 + |p|) ulp for x^p. The test allows 2 ulp for exp and log, and 3 ulp for
+ * tanh and sigmoid (see MaxULP).
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XELEMENTWISE_H__
+#define __XELEMENTWISE_H__
+
+#include <stddef.h>
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* instruction sets of the engine */
+enum XSIMD_ISA {XSIMD_SCALAR, XSIMD_AVX2, XSIMD_AVX512};
+
+/* unary functions b = f(a) (p0 and p1 are the parameters) */
+enum EW_UNARY {
+    EW_ABSOLUTE, EW_CEIL, EW_EXP, EW_FLOOR, EW_ISNONZERO, EW_ISZERO, EW_LOG,
+    EW_NEGATE, EW_ROUND, EW_SIGN, EW_SQRT, EW_SQUARE, EW_SIN, EW_COS, EW_TAN,
+    EW_TANH, EW_SIGMOID, EW_RECTIFY, EW_HARDTANH,
+    EW_SCALE,           /* a * p0 */
+    EW_DESCALE,         /* a / p0 */
+    EW_SHIFT,           /* a + p0 */
+    EW_SCALE_AND_SHIFT, /* a * p0 + p1 */
+    EW_POWER,           /* a ^ p0 */
+    EW_UNARY_NUM
+};
+
+/* binary functions c = f(a, b) */
+enum EW_BINARY {
+    EW_MULTIPLY,           /* a * b + alpha * c */
+    EW_DIV,                /* a / b + alpha * c */
+    EW_SIGMOID_BACKWARD,   /* a = y, b = dE/dy */
+    EW_RECTIFY_BACKWARD,   /* a = x, b = dE/dy */
+    EW_HARDTANH_BACKWARD,  /* a = x, b = dE/dy */
+    EW_SUM,                /* a + b */
+    EW_SUB,                /* a - b */
+    EW_SUM_SCALED,         /* a + b * alpha */
+    EW_BINARY_NUM
+};
+
+/* the best instruction set of the CPU */
+int XEWDetectISA();
+
+/* the instruction set in use */
+int XEWGetISA();
+
+/* use another instruction set (it is lowered to the best one of the CPU) */
+void XEWSetISA(int isa);
+
+/* name of an instruction set */
+const char * XEWGetISAName(int isa);
+
+/* number of floats in a vector of the instruction set in use */
+int XEWGetWidth();
+
+/* b = f(a) over n items */
+void XEWUnary(EW_UNARY op, const float * a, float * b, int n, float p0 = 0, float p1 = 0);
+
+/* c = f(a, b) over n items */
+void XEWBinary(EW_BINARY op, const float * a, const float * b, float * c, int n, float alpha = 0);
+
+/* e^x of a number (the same approximation as EW_EXP) */
+float XEWExp(float x);
+
+/*
+The compound kernels below run on the calling thread (the callers split their
+work over rows already), but use the same instruction set and the same exp
+as XEWUnary.
+*/
+
+/* max of x and sum_i e^{x_i - max} in one pass (and sum_i x_i if total != NULL) */
+void XEWMaxSumExp(const float * x, int n, float * max, float * sum, float * total = NULL);
+
+/* XEWMaxSumExp for each of the colNum columns of a (n, stride) matrix */
+void XEWMaxSumExpCol(const float * x, int n, int stride, int colNum, float * max, float * sum);
+
+/* y = e^{x - shift} * alpha + beta */
+void XEWExpAffine(const float * x, float * y, int n, float shift, float alpha, float beta);
+
+/* y_i = e^{x_i - shift_i} * alpha_i */
+void XEWExpAffineV(const float * x, float * y, int n, const float * shift, const float * alpha);
+
+/* y = max(x - shift, lower) */
+void XEWShiftMax(const float * x, float * y, int n, float shift, float lower);
+
+/* y_i = max(x_i - shift_i, lower) */
+void XEWShiftMaxV(const float * x, float * y, int n, const float * shift, float lower);
+
+/* the Adam update of n parameters (the gradients are set to zero) */
+void XEWAdam(float * para, float * grad, float * m, float * v, int n,
+             float beta1, float beta2, float e, float delta, float decay);
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
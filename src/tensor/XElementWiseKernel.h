@@ -0,0 +1,581 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * The kernels of the element-wise engine. This file has no include guard: it
+ * is included by XElementWise.cpp once for each instruction set, in a namespace
+ * that defines the vector type VF (of N floats), the int vector VI, the mask
+ * VM and the basic operations on them.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+/* copy the sign of s to x */
+inline VF CopySign(VF x, VF s)
+{
+    return AsFloat(OrI(AndI(AsInt(x), SetI(0x7FFFFFFF)), AndI(AsInt(s), SetI((int)0x80000000U))));
+}
+
+/* 2^n for an integral-valued n in [-126, 127] */
+inline VF Pow2n(VF n)
+{
+    return AsFloat(Sll23(AddI(ToInt(n), SetI(127))));
+}
+
+/*
+p * 2^n for an integral-valued n in [-160, 140]. The scaling is done in two
+steps, so the results are right when they overflow or are subnormal
+*/
+inline VF Scale2n(VF p, VF n)
+{
+    VF n1 = Floor(Mul(n, Set(0.5F)));
+    VF n2 = Sub(n, n1);
+    return Mul(Mul(p, Pow2n(n1)), Pow2n(n2));
+}
+
+/* e^r for r in [-ln2/2, ln2/2] (Cephes) */
+inline VF ExpPoly(VF r)
+{
+    VF p = Set(1.9875691500E-4F);
+    p = MulAdd(p, r, Set(1.3981999507E-3F));
+    p = MulAdd(p, r, Set(8.3334519073E-3F));
+    p = MulAdd(p, r, Set(4.1665795894E-2F));
+    p = MulAdd(p, r, Set(1.6666665459E-1F));
+    p = MulAdd(p, r, Set(5.0000001201E-1F));
+    return MulAdd(p, Mul(r, r), Add(r, Set(1.0F)));
+}
+
+/*
+e^x. We have e^x = 2^n * e^r where n = round(x/ln2), and r = x - n * ln2 is
+in [-ln2/2, ln2/2] (ln2 is split into two parts so that n * ln2 is exact)
+*/
+inline VF Exp(VF x)
+{
+    VF c = Min(Max(x, Set(-104.0F)), Set(89.0F));
+    VF n = RoundNearest(Mul(c, Set(1.44269504088896341F)));
+    VF r = MulAdd(n, Set(-0.693359375F), c);
+    r = MulAdd(n, Set(2.12194440e-4F), r);
+    VF y = Scale2n(ExpPoly(r), n);
+    return Select(IsNaN(x), x, y);
+}
+
+/*
+split x (> 0) into x = 2^e * (1 + t) where t is in [sqrt(0.5) - 1, sqrt(2) - 1),
+and compute ln(1 + t) (Cephes)
+*/
+inline VF LogCore(VF x, VF &e)
+{
+    /* the subnormal numbers are scaled by 2^23 */
+    VM sub = CmpLT(x, Set(1.17549435e-38F));
+    x = Select(sub, Mul(x, Set(8388608.0F)), x);
+
+    VI i = AsInt(x);
+    e = Add(ToFloat(SubI(Srl23(i), SetI(126))), Select(sub, Set(-23.0F), Set(0.0F)));
+    VF m = AsFloat(OrI(AndI(i, SetI(0x007FFFFF)), SetI(0x3F000000)));
+
+    /* m is in [0.5, 1). It is moved to [sqrt(0.5), sqrt(2)) */
+    VM small = CmpLT(m, Set(0.707106781186547524F));
+    e = Select(small, Sub(e, Set(1.0F)), e);
+    VF t = Sub(Select(small, Add(m, m), m), Set(1.0F));
+
+    VF z = Mul(t, t);
+    VF y = Set(7.0376836292E-2F);
+    y = MulAdd(y, t, Set(-1.1514610310E-1F));
+    y = MulAdd(y, t, Set(1.1676998740E-1F));
+    y = MulAdd(y, t, Set(-1.2420140846E-1F));
+    y = MulAdd(y, t, Set(1.4249322787E-1F));
+    y = MulAdd(y, t, Set(-1.6668057665E-1F));
+    y = MulAdd(y, t, Set(2.0000714765E-1F));
+    y = MulAdd(y, t, Set(-2.4999993993E-1F));
+    y = MulAdd(y, t, Set(3.3333331174E-1F));
+    y = Mul(Mul(y, t), z);
+
+    /* the caller adds e * ln2 */
+    return Add(t, MulAdd(z, Set(-0.5F), y));
+}
+
+/* ln(x) */
+inline VF Log(VF x)
+{
+    VF e;
+    VF y = LogCore(x, e);
+
+    /* ln2 is split into two parts */
+    y = MulAdd(e, Set(-2.12194440e-4F), y);
+    y = MulAdd(e, Set(0.693359375F), y);
+
+    y = Select(CmpEQ(x, Set(0.0F)), Set(-INFINITY), y);
+    y = Select(CmpLT(x, Set(0.0F)), Set(NAN), y);
+    y = Select(CmpEQ(x, Set(INFINITY)), x, y);
+    return Select(IsNaN(x), x, y);
+}
+
+/* tanh(x) = x + x^3 P(x^2) if |x| < 0.625, and 1 - 2 / (e^{2|x|} + 1) (with the sign of x) otherwise */
+inline VF Tanh(VF x)
+{
+    VF ax = Abs(x);
+
+    VF z = Mul(x, x);
+    VF p = Set(-5.70498872745E-3F);
+    p = MulAdd(p, z, Set(2.06390887954E-2F));
+    p = MulAdd(p, z, Set(-5.37397155531E-2F));
+    p = MulAdd(p, z, Set(1.33314422036E-1F));
+    p = MulAdd(p, z, Set(-3.33332819422E-1F));
+    VF small = MulAdd(Mul(p, z), x, x);
+
+    VF e = Exp(Min(Add(ax, ax), Set(40.0F)));
+    VF large = CopySign(Sub(Set(1.0F), Div(Set(2.0F), Add(e, Set(1.0F)))), x);
+
+    VF y = Select(CmpLT(ax, Set(0.625F)), small, large);
+    return Select(IsNaN(x), x, y);
+}
+
+/* 1 / (1 + e^{-x}). With t = e^{-|x|}, it is 1 / (1 + t) for x >= 0 and t / (1 + t) for x < 0 */
+inline VF Sigmoid(VF x)
+{
+    VF t = Exp(Neg(Abs(x)));
+    VF d = Add(Set(1.0F), t);
+    VF y = Div(Select(CmpLT(x, Set(0.0F)), t, Set(1.0F)), d);
+    return Select(IsNaN(x), x, y);
+}
+
+/* round half away from zero (as round() of libm) */
+inline VF RoundAway(VF x)
+{
+    VF t = Trunc(x);
+    VM up = CmpLE(Set(0.5F), Abs(Sub(x, t)));
+    return Select(up, Add(t, CopySign(Set(1.0F), x)), t);
+}
+
+/*
+|x|^p for a p that is not a small integer. We have |x|^p = 2^{p * log2|x|}
+where log2|x| = e + log2(1 + t). p * e is kept with its rounding error (by
+FMA), and the error of the rest is a few 2^-24 of |p| * |log2(1 + t)| < |p| / 2,
+so the result is within (2 + |p|) ulp whatever x is.
+*/
+inline VF PowAbs(VF x, float p)
+{
+    VF e;
+    VF l2 = Mul(LogCore(Abs(x), e), Set(1.44269504088896341F));
+
+    VF vp = Set(p);
+    VF hi = Min(Max(Mul(vp, e), Set(-200.0F)), Set(200.0F));
+    VF lo = MulAdd(vp, e, Neg(hi));
+    VF n = RoundNearest(hi);
+    VF s = Add(Sub(hi, n), MulAdd(vp, l2, lo));
+    s = Min(Max(s, Set(-200.0F)), Set(200.0F));
+
+    VF n2 = RoundNearest(s);
+    n = Min(Max(Add(n, n2), Set(-160.0F)), Set(140.0F));
+    s = Sub(s, n2);
+
+    return Scale2n(ExpPoly(Mul(s, Set(0.693147180559945309F))), n);
+}
+
+/* x^k for an integer k (by squaring) */
+inline VF PowInt(VF x, int k)
+{
+    VF r = Set(1.0F);
+    VF b = x;
+    for(int m = k < 0 ? -k : k; m > 0; m >>= 1){
+        if(m & 1)
+            r = Mul(r, b);
+        if(m > 1)
+            b = Mul(b, b);
+    }
+    return k < 0 ? Div(Set(1.0F), r) : r;
+}
+
+/* apply f to each item */
+template<class F>
+inline void Map(const float * a, float * b, int n, F f)
+{
+    int i = 0;
+    for(; i + N <= n; i += N)
+        Store(b + i, f(Load(a + i)));
+
+    /* the tail goes through a full vector */
+    if(i < n){
+        float ta[N] = {0};
+        float tb[N];
+        memcpy(ta, a + i, sizeof(float) * (n - i));
+        Store(tb, f(Load(ta)));
+        memcpy(b + i, tb, sizeof(float) * (n - i));
+    }
+}
+
+/* apply f to each pair of items */
+template<class F>
+inline void Map2(const float * a, const float * b, float * c, int n, F f)
+{
+    int i = 0;
+    for(; i + N <= n; i += N)
+        Store(c + i, f(Load(a + i), Load(b + i)));
+
+    if(i < n){
+        float ta[N] = {0};
+        float tb[N] = {0};
+        float tc[N];
+        memcpy(ta, a + i, sizeof(float) * (n - i));
+        memcpy(tb, b + i, sizeof(float) * (n - i));
+        Store(tc, f(Load(ta), Load(tb)));
+        memcpy(c + i, tc, sizeof(float) * (n - i));
+    }
+}
+
+/* apply f to each triple of items (c is read and written) */
+template<class F>
+inline void Map3(const float * a, const float * b, float * c, int n, F f)
+{
+    int i = 0;
+    for(; i + N <= n; i += N)
+        Store(c + i, f(Load(a + i), Load(b + i), Load(c + i)));
+
+    if(i < n){
+        float ta[N] = {0};
+        float tb[N] = {0};
+        float tc[N] = {0};
+        memcpy(ta, a + i, sizeof(float) * (n - i));
+        memcpy(tb, b + i, sizeof(float) * (n - i));
+        memcpy(tc, c + i, sizeof(float) * (n - i));
+        Store(tc, f(Load(ta), Load(tb), Load(tc)));
+        memcpy(c + i, tc, sizeof(float) * (n - i));
+    }
+}
+
+/* apply a function of libm to each item */
+inline void MapScalar(const float * a, float * b, int n, float (*f)(float))
+{
+    for(int i = 0; i < n; i++)
+        b[i] = f(a[i]);
+}
+
+/* b = a^p */
+inline void RunPower(const float * a, float * b, int n, float p)
+{
+    if(p == 0){
+        Map(a, b, n, [](VF x) { return Set(1.0F); });
+    }
+    else if(p == 0.5F){
+        Map(a, b, n, [](VF x) { return Sqrt(x); });
+    }
+    else if(p == (float)(int)p && p >= -64.0F && p <= 64.0F){
+        int k = (int)p;
+        Map(a, b, n, [k](VF x) {
+            VF y = PowInt(x, k);
+
+            /* 0^p = 1e20 for p < 0 (the same as the GPU code) */
+            return k < 0 ? Select(CmpEQ(x, Set(0.0F)), Set(1e20F), y) : y;
+        });
+    }
+    else{
+        bool isInt = p == floorf(p);
+        bool isOdd = isInt && fmodf(p, 2.0F) != 0;
+        Map(a, b, n, [p, isInt, isOdd](VF x) {
+            VF ax = Abs(x);
+            VF y = PowAbs(x, p);
+
+            /* 0 and inf */
+            VM inf = CmpEQ(ax, Set(INFINITY));
+            y = Select(CmpEQ(x, Set(0.0F)), Set(p > 0 ? 0.0F : 1e20F), y);
+            y = Select(inf, Set(p > 0 ? INFINITY : 0.0F), y);
+
+            /* x < 0 (a negative number to a fraction is nan, but (-inf)^p is not) */
+            VM neg = CmpLT(x, Set(0.0F));
+            if(isOdd)
+                y = Select(neg, Neg(y), y);
+            else if(!isInt)
+                y = Select(MAndNot(neg, inf), Set(NAN), y);
+
+            return Select(IsNaN(x), x, y);
+        });
+    }
+}
+
+/* b = f(a) over n items */
+void RunUnary(int op, const float * a, float * b, int n, float p0, float p1)
+{
+    switch(op){
+    case EW_ABSOLUTE:
+        Map(a, b, n, [](VF x) { return Abs(x); });
+        break;
+    case EW_CEIL:
+        Map(a, b, n, [](VF x) { return Ceil(x); });
+        break;
+    case EW_EXP:
+        Map(a, b, n, [](VF x) { return Exp(x); });
+        break;
+    case EW_FLOOR:
+        Map(a, b, n, [](VF x) { return Floor(x); });
+        break;
+    case EW_ISNONZERO:
+        Map(a, b, n, [](VF x) { return Select(CmpNEQ(x, Set(0.0F)), Set(1.0F), Set(0.0F)); });
+        break;
+    case EW_ISZERO:
+        Map(a, b, n, [](VF x) { return Select(CmpEQ(x, Set(0.0F)), Set(1.0F), Set(0.0F)); });
+        break;
+    case EW_LOG:
+        Map(a, b, n, [](VF x) { return Log(x); });
+        break;
+    case EW_NEGATE:
+        Map(a, b, n, [](VF x) { return Neg(x); });
+        break;
+    case EW_ROUND:
+        Map(a, b, n, [](VF x) { return RoundAway(x); });
+        break;
+    case EW_SIGN:
+        Map(a, b, n, [](VF x) {
+            return Select(CmpGT(x, Set(0.0F)), Set(1.0F), Select(CmpEQ(x, Set(0.0F)), Set(0.0F), Set(-1.0F)));
+        });
+        break;
+    case EW_SQRT:
+        Map(a, b, n, [](VF x) { return Sqrt(x); });
+        break;
+    case EW_SQUARE:
+        Map(a, b, n, [](VF x) { return Mul(x, x); });
+        break;
+    case EW_SIN:
+        MapScalar(a, b, n, sinf);
+        break;
+    case EW_COS:
+        MapScalar(a, b, n, cosf);
+        break;
+    case EW_TAN:
+        MapScalar(a, b, n, tanf);
+        break;
+    case EW_TANH:
+        Map(a, b, n, [](VF x) { return Tanh(x); });
+        break;
+    case EW_SIGMOID:
+        Map(a, b, n, [](VF x) { return Sigmoid(x); });
+        break;
+    case EW_RECTIFY:
+        Map(a, b, n, [](VF x) { return Select(CmpLT(x, Set(0.0F)), Set(0.0F), x); });
+        break;
+    case EW_HARDTANH:
+        Map(a, b, n, [](VF x) {
+            return Select(CmpGT(x, Set(1.0F)), Set(1.0F), Select(CmpLT(x, Set(-1.0F)), Set(-1.0F), x));
+        });
+        break;
+    case EW_SCALE:
+        Map(a, b, n, [p0](VF x) { return Mul(x, Set(p0)); });
+        break;
+    case EW_DESCALE:
+        Map(a, b, n, [p0](VF x) { return Div(x, Set(p0)); });
+        break;
+    case EW_SHIFT:
+        Map(a, b, n, [p0](VF x) { return Add(x, Set(p0)); });
+        break;
+    case EW_SCALE_AND_SHIFT:
+        Map(a, b, n, [p0, p1](VF x) { return MulAdd(x, Set(p0), Set(p1)); });
+        break;
+    case EW_POWER:
+        RunPower(a, b, n, p0);
+        break;
+    default:
+        ShowNTErrors("Unknown element-wise function!");
+    }
+}
+
+/* c = f(a, b) over n items */
+void RunBinary(int op, const float * a, const float * b, float * c, int n, float alpha)
+{
+    switch(op){
+    case EW_MULTIPLY:
+        if(alpha == 0)
+            Map2(a, b, c, n, [](VF x, VF y) { return Mul(x, y); });
+        else
+            Map3(a, b, c, n, [alpha](VF x, VF y, VF z) { return MulAdd(x, y, Mul(Set(alpha), z)); });
+        break;
+    case EW_DIV:
+        if(alpha == 0)
+            Map2(a, b, c, n, [](VF x, VF y) { return Div(x, y); });
+        else
+            Map3(a, b, c, n, [alpha](VF x, VF y, VF z) { return MulAdd(Set(alpha), z, Div(x, y)); });
+        break;
+    case EW_SIGMOID_BACKWARD:
+        Map2(a, b, c, n, [](VF y, VF dedy) { return Mul(Mul(dedy, y), Sub(Set(1.0F), y)); });
+        break;
+    case EW_RECTIFY_BACKWARD:
+        Map2(a, b, c, n, [](VF x, VF dedy) { return Select(CmpLT(x, Set(0.0F)), Set(0.0F), dedy); });
+        break;
+    case EW_HARDTANH_BACKWARD:
+        Map2(a, b, c, n, [](VF x, VF dedy) {
+            return Select(MOr(CmpGT(x, Set(1.0F)), CmpLT(x, Set(-1.0F))), Set(0.0F), dedy);
+        });
+        break;
+    case EW_SUM:
+        Map2(a, b, c, n, [](VF x, VF y) { return Add(x, y); });
+        break;
+    case EW_SUB:
+        Map2(a, b, c, n, [](VF x, VF y) { return Sub(x, y); });
+        break;
+    case EW_SUM_SCALED:
+        Map2(a, b, c, n, [alpha](VF x, VF y) { return MulAdd(y, Set(alpha), x); });
+        break;
+    default:
+        ShowNTErrors("Unknown element-wise function!");
+    }
+}
+
+/*
+max of x and sum_i e^{x_i - max} in one pass (and sum_i x_i if total != NULL).
+The array is processed tile by tile. For each tile we get its max first (the
+tile is still in L1 cache when we read it again), rescale the sum we have if
+the max changes, and then accumulate e^{x_i - max}
+*/
+void RunMaxSumExp(const float * x, int n, float * max, float * sum, float * total)
+{
+    const int tileSize = N * EW_TILE_VECTOR_NUM;
+    float m = -FLT_MAX;
+    VF sumV = Set(0.0F);
+    VF totalV = Set(0.0F);
+
+    int i = 0;
+    for(; i + tileSize <= n; i += tileSize){
+        VF maxV = Load(x + i);
+        for(int k = 1; k < EW_TILE_VECTOR_NUM; k++)
+            maxV = Max(maxV, Load(x + i + k * N));
+
+        float tileMax = ReduceMax(maxV);
+        if(tileMax > m){
+            sumV = Mul(sumV, Set(ew_scalar::Exp(m - tileMax)));
+            m = tileMax;
+        }
+
+        VF mV = Set(m);
+        for(int k = 0; k < EW_TILE_VECTOR_NUM; k++){
+            VF v = Load(x + i + k * N);
+            sumV = Add(sumV, Exp(Sub(v, mV)));
+            if(total != NULL)
+                totalV = Add(totalV, v);
+        }
+    }
+
+    float s = ReduceSum(sumV);
+    float t = ReduceSum(totalV);
+
+    /* the tail (less than a tile) */
+    if(i < n){
+        float tileMax = x[i];
+        for(int k = i + 1; k < n; k++)
+            tileMax = tileMax > x[k] ? tileMax : x[k];
+        if(tileMax > m){
+            s *= ew_scalar::Exp(m - tileMax);
+            m = tileMax;
+        }
+        for(; i < n; i++){
+            s += ew_scalar::Exp(x[i] - m);
+            t += x[i];
+        }
+    }
+
+    *max = m;
+    *sum = s;
+    if(total != NULL)
+        *total = t;
+}
+
+/*
+max and sum_i e^{x_i - max} for the columns of a matrix in one pass. The
+columns are put in the lanes, i.e., each lane keeps the running max and sum of
+a column, and the rows are visited tile by tile
+*/
+void RunMaxSumExpCol(const float * x, int n, int stride, int colNum, float * max, float * sum)
+{
+    int j = 0;
+    for(; j + N <= colNum; j += N){
+        VF mV = Set(-FLT_MAX);
+        VF sumV = Set(0.0F);
+
+        for(int i = 0; i < n; i += EW_TILE_VECTOR_NUM){
+            int iEnd = i + EW_TILE_VECTOR_NUM < n ? i + EW_TILE_VECTOR_NUM : n;
+
+            VF newMax = mV;
+            for(int k = i; k < iEnd; k++)
+                newMax = Max(newMax, Load(x + (long)k * stride + j));
+
+            sumV = Mul(sumV, Exp(Sub(mV, newMax)));
+            mV = newMax;
+
+            for(int k = i; k < iEnd; k++)
+                sumV = Add(sumV, Exp(Sub(Load(x + (long)k * stride + j), mV)));
+        }
+
+        Store(max + j, mV);
+        Store(sum + j, sumV);
+    }
+
+    /* the remaining columns */
+    if(j < colNum)
+        ew_scalar::RunMaxSumExpCol(x + j, n, stride, colNum - j, max + j, sum + j);
+}
+
+/* y = e^{x - shift} * alpha + beta */
+void RunExpAffine(const float * x, float * y, int n, float shift, float alpha, float beta)
+{
+    Map(x, y, n, [shift, alpha, beta](VF v) {
+        return MulAdd(Exp(Sub(v, Set(shift))), Set(alpha), Set(beta));
+    });
+}
+
+/* y_i = e^{x_i - shift_i} * alpha_i */
+void RunExpAffineV(const float * x, float * y, int n, const float * shift, const float * alpha)
+{
+    int i = 0;
+    for(; i + N <= n; i += N)
+        Store(y + i, Mul(Exp(Sub(Load(x + i), Load(shift + i))), Load(alpha + i)));
+    if(i < n)
+        ew_scalar::RunExpAffineV(x + i, y + i, n - i, shift + i, alpha + i);
+}
+
+/* y = max(x - shift, lower) */
+void RunShiftMax(const float * x, float * y, int n, float shift, float lower)
+{
+    Map(x, y, n, [shift, lower](VF v) { return Max(Sub(v, Set(shift)), Set(lower)); });
+}
+
+/* y_i = max(x_i - shift_i, lower) */
+void RunShiftMaxV(const float * x, float * y, int n, const float * shift, float lower)
+{
+    int i = 0;
+    for(; i + N <= n; i += N)
+        Store(y + i, Max(Sub(Load(x + i), Load(shift + i)), Set(lower)));
+    if(i < n)
+        ew_scalar::RunShiftMaxV(x + i, y + i, n - i, shift + i, lower);
+}
+
+/* the Adam update (see XEWAdam) */
+void RunAdam(float * para, float * grad, float * m, float * v, int n,
+             float beta1, float beta2, float e, float delta, float decay)
+{
+    int i = 0;
+    for(; i + N <= n; i += N){
+        VF g = Load(grad + i);
+        VF mV = MulAdd(Load(m + i), Set(beta1), Mul(g, Set(1.0F - beta1)));
+        VF vV = MulAdd(Load(v + i), Set(beta2), Mul(Mul(g, g), Set(1.0F - beta2)));
+        VF update = Div(mV, Add(Sqrt(vV), Set(delta)));
+        Store(para + i, MulAdd(update, Set(-e), Mul(Load(para + i), Set(decay))));
+        Store(m + i, mV);
+        Store(v + i, vV);
+        Store(grad + i, Set(0.0F));
+    }
+    if(i < n)
+        ew_scalar::RunAdam(para + i, grad + i, m + i, v + i, n - i, beta1, beta2, e, delta, decay);
+}
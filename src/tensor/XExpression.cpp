@@ -0,0 +1,109 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * Lazy element-wise expressions (see XExpression.h). Here are the things
+ * that need the tensor functions: the check of the fused path and the
+ * usual operators for the fallback.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#include "XExpression.h"
+#include "core/CHeader.h"
+#include "function/FHeader.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/*
+check whether a tensor can be read by the fused loop, i.e., it is a dense
+float tensor on CPUs that has the shape of ref and needs no gradient
+>> tensor - the tensor
+>> ref - the first tensor of the expression
+*/
+bool XExprIsFusible(const XTensor * tensor, const XTensor * ref)
+{
+    if(tensor->devID >= 0 || tensor->dataType != X_FLOAT || tensor->isSparse)
+        return false;
+    if(tensor->data == NULL || tensor->enableGrad)
+        return false;
+    return tensor == ref || _IsSameShaped(tensor, ref);
+}
+
+/*
+a unary function by the usual operators
+>> op - the function
+>> a - the argument
+>> p0 - the first parameter
+>> p1 - the second parameter
+*/
+XTensor XExprEagerUnary(EW_UNARY op, const XTensor & a, float p0, float p1)
+{
+    switch(op){
+    case EW_ABSOLUTE:
+        return Absolute(a);
+    case EW_EXP:
+        return Exp(a);
+    case EW_LOG:
+        return Log(a);
+    case EW_SQRT:
+        return Sqrt(a);
+    case EW_SQUARE:
+        return Square(a);
+    case EW_NEGATE:
+        return Negate(a);
+    case EW_SIGMOID:
+        return Sigmoid(a);
+    case EW_HARDTANH:
+        return HardTanH(a);
+    case EW_RECTIFY:
+        return Rectify(a);
+    case EW_SCALE_AND_SHIFT:
+        return ScaleAndShift(a, p0, p1);
+    default:
+        ShowNTErrors("The function is not supported in lazy expressions!");
+    }
+    return XTensor();
+}
+
+/*
+a binary function by the usual operators (with broadcasting)
+>> op - the function
+>> a - the first argument
+>> b - the second argument
+*/
+XTensor XExprEagerBinary(EW_BINARY op, const XTensor & a, const XTensor & b)
+{
+    switch(op){
+    case EW_SUM:
+        return a + b;
+    case EW_SUB:
+        return a - b;
+    case EW_MULTIPLY:
+        return a * b;
+    case EW_DIV:
+        return a / b;
+    default:
+        ShowNTErrors("The function is not supported in lazy expressions!");
+    }
+    return XTensor();
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
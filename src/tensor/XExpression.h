@@ -0,0 +1,351 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * Lazy element-wise expressions. Lazy(t) wraps a tensor, and the operators
+ * and functions on it build an expression tree at compile time instead of
+ * computing anything, e.g.,
+ *
+ *     c = Sigmoid(Lazy(f)) * c + Sigmoid(Lazy(i)) * HardTanH(Lazy(g));
+ *
+ * The expression is computed when it is assigned to a tensor (or by Eval).
+ * The items are processed tile by tile: each node computes a tile of its
+ * result in a small buffer that stays in L1 cache (by the element-wise
+ * engine), so there is one pass over the memory and one output tensor for the
+ * whole formula, rather than a temporary tensor for each operator. The tiles
+ * run on the threads of globalPRunner. The results are the same as those of
+ * the usual operators.
+ *
+ * The fused path needs dense float tensors on CPUs of the same shape, and no
+ * gradient. Otherwise (e.g., broadcasting, GPUs or training) the expression
+ * falls back to the usual operators, so it is always safe to use. Note that
+ * an expression keeps pointers to its tensors, so it should be evaluated in
+ * the statement where it is built.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XEXPRESSION_H__
+#define __XEXPRESSION_H__
+
+#include <string.h>
+#include "XTensor.h"
+#include "XElementWise.h"
+#include "XPRunner.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* number of items of a tile */
+#define XEXPR_TILE 1024
+
+/* number of tiles a thread processes at least */
+#define XEXPR_GRAIN 16
+
+/* check whether a tensor can be read by the fused loop (it has the shape of ref) */
+bool XExprIsFusible(const XTensor * tensor, const XTensor * ref);
+
+/* a unary function by the usual operators */
+XTensor XExprEagerUnary(EW_UNARY op, const XTensor & a, float p0, float p1);
+
+/* a binary function by the usual operators */
+XTensor XExprEagerBinary(EW_BINARY op, const XTensor & a, const XTensor & b);
+
+/*
+the base of the expressions (E is the type of the expression). An expression
+has
+    bufNum - number of the tile buffers it needs
+    Ref() - the first tensor of the expression (the result has its shape)
+    IsFusible(ref) - whether the expression can run in the fused loop
+    Tile(begin, n, buf) - the items [begin, begin + n) of the result. They are
+                          put in buf (or it returns the data of a tensor)
+    Eager(holder) - the result by the usual operators (kept in holder
+                    unless it is a tensor of the expression)
+*/
+template<class E>
+struct XExpr
+{
+    /* the expression itself */
+    const E & Self() const
+    {
+        return *static_cast<const E*>(this);
+    }
+
+    /* compute the expression (for assignment) */
+    operator XTensor() const;
+};
+
+/* a tensor in an expression */
+struct XExprTensor : public XExpr<XExprTensor>
+{
+    static const int bufNum = 0;
+
+    /* the tensor */
+    const XTensor * tensor;
+
+    /* constructor */
+    explicit XExprTensor(const XTensor & t) : tensor(&t) {}
+
+    const XTensor * Ref() const
+    {
+        return tensor;
+    }
+
+    bool IsFusible(const XTensor * ref) const
+    {
+        return XExprIsFusible(tensor, ref);
+    }
+
+    const float * Tile(int begin, int n, float * buf) const
+    {
+        return (const float*)tensor->data + begin;
+    }
+
+    const XTensor & Eager(XTensor & holder) const
+    {
+        return *tensor;
+    }
+};
+
+/* a unary function of an expression (see EW_UNARY) */
+template<class A>
+struct XExprUnary : public XExpr<XExprUnary<A> >
+{
+    static const int bufNum = A::bufNum > 1 ? A::bufNum : 1;
+
+    /* the argument */
+    A a;
+
+    /* the function and its parameters */
+    EW_UNARY op;
+    float p0;
+    float p1;
+
+    /* constructor */
+    XExprUnary(const A & myA, EW_UNARY myOp, float myP0 = 0, float myP1 = 0)
+        : a(myA), op(myOp), p0(myP0), p1(myP1) {}
+
+    const XTensor * Ref() const
+    {
+        return a.Ref();
+    }
+
+    bool IsFusible(const XTensor * ref) const
+    {
+        return a.IsFusible(ref);
+    }
+
+    const float * Tile(int begin, int n, float * buf) const
+    {
+        const float * x = a.Tile(begin, n, buf);
+        XEWUnary(op, x, buf, n, p0, p1);
+        return buf;
+    }
+
+    const XTensor & Eager(XTensor & holder) const
+    {
+        XTensor ha;
+        holder = XExprEagerUnary(op, a.Eager(ha), p0, p1);
+        return holder;
+    }
+};
+
+/* a binary function of two expressions (see EW_BINARY) */
+template<class A, class B>
+struct XExprBinary : public XExpr<XExprBinary<A, B> >
+{
+    /* a is computed in the first buffer, and b in the buffers after it */
+    static const int bufNum = A::bufNum > B::bufNum + 1 ? A::bufNum : B::bufNum + 1;
+
+    /* the arguments */
+    A a;
+    B b;
+
+    /* the function */
+    EW_BINARY op;
+
+    /* constructor */
+    XExprBinary(const A & myA, const B & myB, EW_BINARY myOp)
+        : a(myA), b(myB), op(myOp) {}
+
+    const XTensor * Ref() const
+    {
+        return a.Ref();
+    }
+
+    bool IsFusible(const XTensor * ref) const
+    {
+        return a.IsFusible(ref) && b.IsFusible(ref);
+    }
+
+    const float * Tile(int begin, int n, float * buf) const
+    {
+        const float * x = a.Tile(begin, n, buf);
+        const float * y = b.Tile(begin, n, buf + XEXPR_TILE);
+        XEWBinary(op, x, y, buf, n);
+        return buf;
+    }
+
+    const XTensor & Eager(XTensor & holder) const
+    {
+        XTensor ha;
+        XTensor hb;
+        holder = XExprEagerBinary(op, a.Eager(ha), b.Eager(hb));
+        return holder;
+    }
+};
+
+/* run the fused loop of an expression and put the result in out (n items) */
+template<class E>
+void XExprRun(const E & e, float * out, int n)
+{
+    int tileNum = (n + XEXPR_TILE - 1) / XEXPR_TILE;
+
+    XParallelFor(0, tileNum, XEXPR_GRAIN, [&](int tileBegin, int tileEnd) {
+        float buf[(E::bufNum > 0 ? E::bufNum : 1) * XEXPR_TILE];
+        for(int t = tileBegin; t < tileEnd; t++){
+            int begin = t * XEXPR_TILE;
+            int len = MIN(XEXPR_TILE, n - begin);
+            const float * r = e.Tile(begin, len, buf);
+            memcpy(out + begin, r, sizeof(float) * len);
+        }
+    });
+}
+
+/*
+compute an expression
+>> expr - the expression
+<< return - the result
+*/
+template<class E>
+XTensor Eval(const XExpr<E> & expr)
+{
+    const E & e = expr.Self();
+    const XTensor * ref = e.Ref();
+
+    /* the usual operators */
+    if(!e.IsFusible(ref)){
+        XTensor holder;
+        const XTensor & r = e.Eager(holder);
+        if(&r == &holder)
+            return holder;
+        return XTensor(r);
+    }
+
+    XTensor out(ref);
+    out.SetTMPFlag();
+    XExprRun(e, (float*)out.data, ref->unitNum);
+
+    return out;
+}
+
+/*
+compute an expression in an existing tensor. The tensor can be used in the
+expression, e.g., Eval(Lazy(c) * 0.5F + Lazy(x), c)
+>> expr - the expression
+>> out - the result
+*/
+template<class E>
+void Eval(const XExpr<E> & expr, XTensor & out)
+{
+    const E & e = expr.Self();
+    const XTensor * ref = e.Ref();
+
+    if(e.IsFusible(ref) && XExprIsFusible(&out, ref))
+        XExprRun(e, (float*)out.data, ref->unitNum);
+    else
+        out = Eval(expr);
+}
+
+template<class E>
+XExpr<E>::operator XTensor() const
+{
+    return Eval(*this);
+}
+
+/* a tensor as an expression */
+inline XExprTensor Lazy(const XTensor & t)
+{
+    return XExprTensor(t);
+}
+
+/* the binary operators on expressions and tensors */
+#define XEXPR_BINARY_OPERATOR(opName, ewOp)                                          \
+template<class A, class B>                                                           \
+XExprBinary<A, B> opName(const XExpr<A> & a, const XExpr<B> & b)                     \
+{                                                                                    \
+    return XExprBinary<A, B>(a.Self(), b.Self(), ewOp);                              \
+}                                                                                    \
+template<class A>                                                                    \
+XExprBinary<A, XExprTensor> opName(const XExpr<A> & a, const XTensor & b)            \
+{                                                                                    \
+    return XExprBinary<A, XExprTensor>(a.Self(), XExprTensor(b), ewOp);              \
+}                                                                                    \
+template<class B>                                                                    \
+XExprBinary<XExprTensor, B> opName(const XTensor & a, const XExpr<B> & b)            \
+{                                                                                    \
+    return XExprBinary<XExprTensor, B>(XExprTensor(a), b.Self(), ewOp);              \
+}
+
+XEXPR_BINARY_OPERATOR(operator+, EW_SUM)
+XEXPR_BINARY_OPERATOR(operator-, EW_SUB)
+XEXPR_BINARY_OPERATOR(operator*, EW_MULTIPLY)
+XEXPR_BINARY_OPERATOR(operator/, EW_DIV)
+
+/*
+the operators with a number. They are a * scale + shift, the same as the
+operators of XTensor
+*/
+template<class A>
+XExprUnary<A> operator+ (const XExpr<A> & a, float s) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, 1.0F, s); }
+template<class A>
+XExprUnary<A> operator+ (float s, const XExpr<A> & a) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, 1.0F, s); }
+template<class A>
+XExprUnary<A> operator- (const XExpr<A> & a, float s) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, 1.0F, -s); }
+template<class A>
+XExprUnary<A> operator- (float s, const XExpr<A> & a) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, -1.0F, s); }
+template<class A>
+XExprUnary<A> operator* (const XExpr<A> & a, float s) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, s, 0.0F); }
+template<class A>
+XExprUnary<A> operator* (float s, const XExpr<A> & a) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, s, 0.0F); }
+template<class A>
+XExprUnary<A> operator/ (const XExpr<A> & a, float s) { return XExprUnary<A>(a.Self(), EW_SCALE_AND_SHIFT, 1.0F / s, 0.0F); }
+template<class A>
+XExprUnary<A> operator- (const XExpr<A> & a) { return XExprUnary<A>(a.Self(), EW_NEGATE); }
+
+/* the functions on expressions */
+#define XEXPR_UNARY_FUNCTION(funcName, ewOp)                                         \
+template<class A>                                                                    \
+XExprUnary<A> funcName(const XExpr<A> & a)                                           \
+{                                                                                    \
+    return XExprUnary<A>(a.Self(), ewOp);                                            \
+}
+
+XEXPR_UNARY_FUNCTION(Absolute, EW_ABSOLUTE)
+XEXPR_UNARY_FUNCTION(Exp, EW_EXP)
+XEXPR_UNARY_FUNCTION(Log, EW_LOG)
+XEXPR_UNARY_FUNCTION(Sqrt, EW_SQRT)
+XEXPR_UNARY_FUNCTION(Square, EW_SQUARE)
+XEXPR_UNARY_FUNCTION(Sigmoid, EW_SIGMOID)
+XEXPR_UNARY_FUNCTION(HardTanH, EW_HARDTANH)
+XEXPR_UNARY_FUNCTION(Rectify, EW_RECTIFY)
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
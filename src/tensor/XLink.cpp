@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include "XLink.h"
 #include "XName.h"
+#include "XMemStat.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -348,6 +349,9 @@ void XLink::MakeLink(const TensorList * list, XTensor * h, int id)
     income.SetHead(h);
     income.SetType(id);
 
+    /* the memory of the head is attributed to the op */
+    GMemStat.SetOp(h->data, id);
+
     for(int i = 0; i < list->count; i++){
         XTensor * t = (XTensor*)list->GetItem(i);
         if(t == NULL)
@@ -389,6 +393,7 @@ void XLink::MakeLink(XTensor * t, TensorList * list, int id)
         income.SetHead(h);
         income.SetType(id);
         income.AddTail(t);
+        GMemStat.SetOp(h->data, id);
     }
 
     /* backward */
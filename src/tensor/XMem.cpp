@@ -27,6 +27,7 @@
 #include "XGlobal.h"
 #include "XUtility.h"
 #include "XMem.h"
+#include "XMemStat.h"
 
 /* the nts (NiuTrans.Tensor) namespace */
 namespace nts{
@@ -48,7 +49,6 @@ XMem::XMem()
     devID = -1;
     mode = UNI_FREE;
     curBlockPin = -1;
-    indexOffset = -1;
     name = new char[64];
     strcpy(name, "xmem");
     signature = 0;
@@ -72,7 +72,6 @@ XMem::XMem(int myDevID, MEMPOOL_MODE myMode, MTYPE myBlockSize, int myBlockNum,
 {
     memset(this, 0, sizeof(XMem));
     curBlockPin = -1;
-    indexOffset = -1;
     name = new char[64];
     strcpy(name, "xmem");
     signature = 0;
@@ -97,8 +96,7 @@ XMem::~XMem()
     Free();
     delete[] name;
     delete[] memIndex;
-    delete[] memIndex2;
-    delete[] minSizeIndex;
+    delete[] allocTable;
 }
 
 /* 
@@ -176,6 +174,9 @@ void XMem::Initialize(int myDevID, MEMPOOL_MODE myMode, MTYPE myBlockSize, int m
 /* free memory */
 void XMem::Free()
 {
+    GMemStat.OnClearPool(this);
+    GMemStat.OnClearBuf(this);
+
     for(int i = 0; i < blockNum; i++){
         Free(devID, blocks[i].mem);
     }
@@ -315,34 +316,45 @@ void XMem::SetComputationMode(bool myIsForComputation)
 
 /*
 initialize the index
->> indexSize - size of the index
->> minSizeFirst - minimal size allocation for the first entry
->> minSizeNum - number of minimal-size index nodes
+>> indexSize - size of the index (maximum number of index nodes)
+>> minSize - minimal size of a memory piece
 */
-void XMem::SetIndex(INT_64 indexSize, MTYPE minSizeFirst, int minSizeNum)
+void XMem::SetIndex(INT_64 indexSize, MTYPE minSize)
 {
     delete[] memIndex;
-    delete[] memIndex2;
-    delete[] minSizeIndex;
+    delete[] allocTable;
+
+    CheckNTErrors(indexSize > MEM_LIST_NUM, "The index of the memory pool is too small!");
 
     nodeNum = indexSize;
-    nodeNumUsed = minSizeNum * 2;
-    indexEntryNum = minSizeNum;
-    
     memIndex = new MPieceNode[nodeNum];
-    memset(memIndex, 0, sizeof(MPieceNode) * nodeNum);
-    
-    memIndex2 = new MPieceNode[nodeNum];
-    memset(memIndex2, 0, sizeof(MPieceNode) * nodeNum);
 
-    minSizeIndex = new MTYPE[indexEntryNum];
-    memset(minSizeIndex, 0, sizeof(MTYPE) * indexEntryNum);
+    /* the hash table is at most half full */
+    allocTableSize = 1;
+    while(allocTableSize < nodeNum * 2)
+        allocTableSize <<= 1;
+    allocTable = new MPieceNode*[allocTableSize];
 
-    minSizeIndex[0] = minSizeFirst;
-    for(int i = 1; i < indexEntryNum; i++)
-        minSizeIndex[i] = minSizeIndex[i - 1] * 2;
+    minPieceSize = minSize;
+    peakUsed = 0;
+    allocNum = 0;
+    releaseNum = 0;
+    blockAllocNum = 0;
 
-    indexOffset = GetMSB(minSizeFirst);
+    ClearIndex();
+}
+
+/* clear the index (all the memory pieces are regarded as unused) */
+void XMem::ClearIndex()
+{
+    memset(memIndex, 0, sizeof(MPieceNode) * MEM_LIST_NUM);
+    memset(allocTable, 0, sizeof(MPieceNode*) * allocTableSize);
+    memset(slBitmap, 0, sizeof(slBitmap));
+    flBitmap = 0;
+    nodeNumUsed = MEM_LIST_NUM;
+    freeNodes = NULL;
+    freeNodeNum = 0;
+    totalUsed = 0;
 }
 
 /* get device id */
@@ -378,12 +390,18 @@ require a piece of memory
 */
 void * XMem::Alloc(int myDevID, MTYPE mySize)
 {
+    void * p = NULL;
+
     if(mode == FREE_ON_THE_FLY)
-        return AllocStandard(myDevID, mySize);
+        p = AllocStandard(myDevID, mySize);
     else if(isStatic)
-        return AllocStatic(myDevID, mySize);
+        p = AllocStatic(myDevID, mySize);
     else
-        return AllocDynamic(myDevID, mySize);
+        p = AllocDynamic(myDevID, mySize);
+
+    GMemStat.OnAlloc(myDevID, this, name, p, mySize);
+
+    return p;
 }
 
 /* 
@@ -536,6 +554,8 @@ void * XMem::AllocBuf(int myDevID, MTYPE mySize, int pitch)
 
     CheckNTErrors((bufSize >= bufUsed), "Something is wrong with the memory block.");
 
+    GMemStat.OnAllocBuf(myDevID, this, name, mySize);
+
     return required;
 }
 
@@ -559,8 +579,11 @@ release a piece of memory
 */
 void XMem::Release(int myDevID, void * p, MTYPE size)
 {
-    if(mode == FREE_ON_THE_FLY)
+    /* in other modes, the memory is kept until the pool is cleared */
+    if(mode == FREE_ON_THE_FLY){
         ReleaseStandard(myDevID, p, size);
+        GMemStat.OnRelease(p);
+    }
 }
 
 /* 
@@ -582,6 +605,8 @@ void XMem::ReleaseBuf(int myDevID, MTYPE mySize, int pitch)
     }
 
     bufUsed -= (mySize + backOffset);
+
+    GMemStat.OnReleaseBuf(myDevID, this, mySize);
 }
 
 /* 
@@ -594,238 +619,130 @@ void XMem::ReleaseGlobal(int myDevID, void * p)
     XMemFreeOnDev(myDevID, p);
 }
 
-/* 
-allocate a piece of memory as "malloc" 
+/*
+allocate a piece of memory as "malloc". The free memory pieces are kept in
+segregated lists (in the TLSF way), and a piece that is large enough is found
+with the bitmaps of the lists in constant time. The remaining part of the piece
+goes back to the lists.
 >> myDevID - device id(-1: CPU memory, >=0: GPU device ID)
 >> mySize - size of the require memory
->> myIsRebuiltIndex - indicates whether the index has been just rebuilt
-<< return - index
+>> myIsRebuiltIndex - indicates whether the blocks with no use have been just freed
+<< return - the head pointer of the required memory
 */
 void * XMem::AllocStandard(int myDevID, MTYPE mySize, bool myIsRebuiltIndex)
 {
     CheckNTErrors(memIndex != NULL, "The index of the memory pool is not initialized!");
 
-    if(mySize <= minSizeIndex[0])
-        mySize = minSizeIndex[0];
+    if(mySize <= minPieceSize)
+        mySize = minPieceSize;
 
-    int index = FindIndexEntry(mySize);
-    MPieceNode * entry = NULL;
-    MPieceNode * node = NULL;
-    MPieceNode * hit = NULL;
-    void * result = NULL;
-
-    /* search for the memory piece avialable for the allocation */
-    for(int i = index; i <= indexEntryNum; i++){
-        if(i == indexEntryNum){
-            entry = memIndex + index;
-            CheckNTErrors(mySize >= minSizeIndex[index], "Wrong index!");
-        }
-        else
-            entry = memIndex + i;
-        
-        node = entry->next;
-        while(node != NULL){
-            if(node->size == 0){
-                MPieceNode * next = node->next;
-                RemoveIndexNode(node, entry);
-                node = next;
-            }
-            else{
-                if(node->size >= mySize){
-                    hit = node;
-                    break;
-                }
-                node = node->next;
-            }
-        }
+    /* the pieces start at pitched addresses */
+    mySize = (mySize + MY_PITCH - 1) / MY_PITCH * MY_PITCH;
 
-        if(hit != NULL)
-            break;
-    }
-    
-    /* if a free memory piece is found, we allocate the memory on it. */
-    if(hit != NULL){
-        MHeader * head = &hit->head;
-        char * beg = (char*)GetPitchedAddress((char*)hit->p, MY_PITCH);
-        char * end = (char*)beg + mySize;
-        MTYPE needed = end - (char*)hit->p;
-        MTYPE remaining = head->size - needed;
-        
-        if(remaining >= minSizeIndex[0]){
-
-            /* make a new index node */
-            MPieceNode * newNode = memIndex + nodeNumUsed++;
-            newNode->head.indexNode = newNode;
-            newNode->p = end;
-            newNode->pReal = NULL;
-            newNode->size = (char*)end + remaining -
-                            (char*)GetPitchedAddress((char*)end, MY_PITCH);
-            
-            AddFreeIndexNode(newNode);
-            
-            /* connections for headers */
-            MHeader &cur = hit->head;
-            MHeader &next = newNode->head;
-            next.pre = &cur;
-            next.next = cur.next;
-            cur.next = &next;
-            cur.size = needed;
-            
-            if(next.next != NULL)
-                next.next->pre = &next;
-            
-            next.state = 1;
-            next.size = remaining;
-            next.blockID = cur.blockID;
-        }
-        
-        hit->size = mySize;
-        hit->head.state = 2;
-        hit->pReal = beg;
-        blocks[hit->head.blockID].used += head->size;
-        
-        RemoveIndexNode(hit);
-        AddAllocIndexNode(hit);
-        
-        result = beg;
-    }
-    else{
-        /* if no free memory piece is available, we rebuild the index and merge small fragments
-           to make bigger free memory pieces. */
-        if(!myIsRebuiltIndex){
+    MPieceNode * hit = FindFreeIndexNode(mySize);
+
+    /* if no free memory piece is available, we free the blocks with no use
+       and then obtain a new block of memory. */
+    if(hit == NULL){
+        if(!myIsRebuiltIndex)
             RebuildIndex();
-            result = AllocStandard(myDevID, mySize, true);
-        }
-        /* if there is still no available memory piece, we have to obtain a new block of memory. */
-        else{
-            int bi;
-            for(bi = 0; bi < blockNum; bi++){
-                XMemBlock * block = blocks + bi;
-                if (block->mem != NULL && (block->head != NULL || block->size < mySize + 2 * MY_PITCH))
-                    continue;
-                
-                if (block->mem == NULL) {
-                    block->size = MAX(block->sizeDesired, mySize + 2 * MY_PITCH);
-                    if (myDevID < 0) {
-                        block->mem = new char[block->size];
-                        memset(block->mem, 0, block->size);
-                    }
-                    else {
+
+        int bi;
+        for(bi = 0; bi < blockNum; bi++){
+            XMemBlock * block = blocks + bi;
+            if (block->mem != NULL && (block->head != NULL || block->size < mySize + 2 * MY_PITCH))
+                continue;
+
+            if (block->mem == NULL) {
+                block->size = MAX(block->sizeDesired, mySize + 2 * MY_PITCH);
+                if (myDevID < 0) {
+                    block->mem = new char[block->size];
+                    memset(block->mem, 0, block->size);
+                }
+                else {
 #ifdef USE_CUDA
-                        int devIDBackup = -1;
-                        cudaGetDevice(&devIDBackup);
-                        SetDevice(myDevID);
-                        cudaError_t e = cudaMalloc((void **)&block->mem, block->size);
-                        if (e != cudaSuccess) {
-                            ShowNTErrors("Cannot allocate the memory.");
-                        }
-                        CheckNTErrors(cudaMemset(block->mem, 0, block->size) == cudaSuccess, "Cannot update the memory.");
-                        SetDevice(devIDBackup);
+                    int devIDBackup = -1;
+                    cudaGetDevice(&devIDBackup);
+                    SetDevice(myDevID);
+                    cudaError_t e = cudaMalloc((void **)&block->mem, block->size);
+                    if (e != cudaSuccess) {
+                        ShowNTErrors("Cannot allocate the memory.");
+                    }
+                    CheckNTErrors(cudaMemset(block->mem, 0, block->size) == cudaSuccess, "Cannot update the memory.");
+                    SetDevice(devIDBackup);
 #else
-                        ShowNTErrors("Please specify USE_CUDA for compiling this program.");
+                    ShowNTErrors("Please specify USE_CUDA for compiling this program.");
 #endif
-                    }
                 }
-
-                curBlockID = MAX(curBlockID, bi);
-                    
-                /* make a new index node */
-                MPieceNode * newNode = memIndex + nodeNumUsed++;
-                newNode->head.indexNode = newNode;
-                newNode->p = block->mem;
-                newNode->pReal = NULL;
-                //newNode->size = (char*)block->mem + block->size -
-                //                (char*)GetPitchedAddress(block->mem, MY_PITCH);
-                newNode->size = mySize;
-                    
-                AddFreeIndexNode(newNode);
-                    
-                MHeader &header = newNode->head;
-                header.state = 1;
-                header.size = block->size;
-                header.pre = NULL;
-                header.next = NULL;
-                header.blockID = bi;
-                    
-                block->head = &header;
-                block->used = 0;
-                    
-                result = AllocStandard(myDevID, mySize, myIsRebuiltIndex);
-                break;
+                blockAllocNum++;
             }
-            CheckNTErrors(bi < blockNum, "No enough memory is available!");
-        }
-    }
 
-    /* if all index nodes are used, we rebuild the index to release the nodes that are free */
-    if(nodeNumUsed == nodeNum){
-        RebuildIndex();
-        CheckNTErrors(nodeNumUsed < nodeNum, "No enough index nodes for the memory pool!");
-    }
+            curBlockID = MAX(curBlockID, bi);
 
-    /*if(testxmemid == 30){
-        recordp = result;
-    }
+            /* the whole block is a free memory piece */
+            char * beg = (char*)GetPitchedAddress(block->mem, MY_PITCH);
+            MTYPE size = ((char*)block->mem + block->size - beg) / MY_PITCH * MY_PITCH;
+
+            hit = NewIndexNode();
+            hit->p = beg;
+            hit->size = size;
+
+            MHeader &header = hit->head;
+            header.state = 1;
+            header.size = size;
+            header.pre = NULL;
+            header.next = NULL;
+            header.blockID = bi;
+
+            block->head = &header;
+            block->used = 0;
 
-    if(curBlockID >= 25){
-        MHeader * head = blocks[25].head;
-        while(head != NULL){
-            fprintf(stderr, "head: %ld %ld\n", head->indexNode->pReal, head->indexNode->size);
-            head = head->next;
+            AddFreeIndexNode(hit);
+            break;
         }
+        CheckNTErrors(bi < blockNum, "No enough memory is available!");
     }
 
-    if(testxmemid == 32){
-        int nnn = 0;
+    RemoveIndexNode(hit);
+
+    /* split the piece */
+    MHeader * head = &hit->head;
+    MTYPE remaining = head->size - mySize;
+    if(remaining >= minPieceSize){
+        MPieceNode * newNode = NewIndexNode();
+        newNode->p = (char*)hit->p + mySize;
+        newNode->size = remaining;
+
+        /* connections for headers */
+        MHeader &next = newNode->head;
+        next.state = 1;
+        next.size = remaining;
+        next.blockID = head->blockID;
+        next.pre = head;
+        next.next = head->next;
+        if(next.next != NULL)
+            next.next->pre = &next;
+        head->next = &next;
+        head->size = mySize;
+
+        AddFreeIndexNode(newNode);
     }
 
-    if(recordp != NULL){
-        MTYPE size = mySize;
-        if(size <= minSizeIndex[0])
-            size = minSizeIndex[0];
-    
-        MPieceNode * entry = NULL;
-        MPieceNode * node = NULL;
-        MPieceNode * hit = NULL;
-        MPieceNode * last = NULL;
-    
-        entry = memIndex + indexEntryNum + FindIndexEntry(size);
-    
-        last = entry;
-        node = entry->next;
-    
-        while(node != NULL){
-            CheckNTErrors(node->pre == last, "Something is wrong!");
-            CheckNTErrors(last->next == node, "Something is wrong!");
-            CheckNTErrors(node->head.state == 2, "Something is wrong!");
-            last = node;
-        
-            if(node->size == 0){
-                MPieceNode * next = node->next;
-                RemoveFreeIndexNode(node, entry);
-                node = next;
-                ShowNTErrors("Something is wrong!");
-            }
-            else{
-                CheckNTErrors(node->pReal != NULL, "Illegal pointer!");
-                if(node->pReal == recordp){
-                    hit = node;
-                    break;
-                }
-                node = node->next;
-            }
-        }
+    hit->size = mySize;
+    hit->pReal = hit->p;
+    head->state = 2;
+    blocks[head->blockID].used += head->size;
+    AddAllocIndexNode(hit);
 
-        if(hit == NULL){
-            int nnn = 0;
-        }
-    }*/
+    totalUsed += head->size;
+    peakUsed = MAX(peakUsed, totalUsed);
+    allocNum++;
 
-    return result;
+    return hit->pReal;
 }
 
-/* 
-find the highest set bit (or most significant set bit) in an integer-64 
+/*
+find the highest set bit (or most significant set bit) in an integer-64
 >> mySize - required size
 << return - the position of MSB
 */
@@ -848,49 +765,140 @@ int XMem::GetMSB(MTYPE mySize)
     return result;
 }
 
-/* 
-find the index entry for allocation query 
->> mySize - required size
-<< return - index
+/*
+find the lowest set bit in an integer-64
+>> mySize - the integer
+<< return - the position of the lowest set bit (-1 if it is 0)
+*/
+int XMem::GetLSB(MTYPE mySize)
+{
+    return GetMSB(mySize & (~mySize + 1));
+}
+
+/*
+find the index entry (the free list) of a memory piece. The first-level class is
+given by the highest set bit of the size, and the second-level class is given by
+the following MEM_SL_BITS bits. The sizes below MEM_SL_NUM have a list for each.
+>> mySize - size of the memory piece
+<< return - index of the list
 */
 int XMem::FindIndexEntry(MTYPE mySize)
 {
-    CheckNTErrors(minSizeIndex != NULL && indexOffset >= 0, 
-                 "The index of the memory pool is not initialized!");
+    if(mySize < MEM_SL_NUM)
+        return (int)mySize;
 
-    if(mySize <= minSizeIndex[0])
-        mySize = minSizeIndex[0];
+    int msb = GetMSB(mySize);
+    int fl = msb - MEM_SL_BITS + 1;
+    int sl = (int)(mySize >> (msb - MEM_SL_BITS)) - MEM_SL_NUM;
 
-    int index = GetMSB(mySize) - indexOffset;
+    return fl * MEM_SL_NUM + sl;
+}
 
-    if(index >= indexEntryNum)
-        index = indexEntryNum - 1;
+/*
+find a free memory piece for allocation query. The size is rounded up to the
+next class so that the first piece of any class we find is large enough.
+>> mySize - required size
+<< return - the index node of the piece (NULL if there is no such piece)
+*/
+MPieceNode * XMem::FindFreeIndexNode(MTYPE mySize)
+{
+    MTYPE rounded = mySize;
+    if(mySize >= MEM_SL_NUM)
+        rounded += ((MTYPE)1 << (GetMSB(mySize) - MEM_SL_BITS)) - 1;
+
+    int index = FindIndexEntry(rounded);
+    int fl = index / MEM_SL_NUM;
+    int sl = index % MEM_SL_NUM;
+
+    unsigned int slMap = slBitmap[fl] & (~0U << sl);
+    if(slMap == 0){
+        MTYPE flMap = fl + 1 < MEM_FL_NUM ? flBitmap & (~(MTYPE)0 << (fl + 1)) : 0;
+
+        /* the pieces in the class of the size may still be large enough */
+        if(flMap == 0){
+            MPieceNode * entry = memIndex + FindIndexEntry(mySize);
+            for(MPieceNode * node = entry->next; node != NULL; node = node->next){
+                if(node->size >= mySize)
+                    return node;
+            }
+            return NULL;
+        }
+
+        fl = GetLSB(flMap);
+        slMap = slBitmap[fl];
+    }
+    sl = GetLSB(slMap);
 
-    return index;
+    return memIndex[fl * MEM_SL_NUM + sl].next;
 }
 
-/* 
-remove an index node
+/*
+get an index node. The recycled nodes are used first.
+<< return - the node
+*/
+MPieceNode * XMem::NewIndexNode()
+{
+    MPieceNode * node = NULL;
+    if(freeNodes != NULL){
+        node = freeNodes;
+        freeNodes = node->next;
+        freeNodeNum--;
+    }
+    else{
+        CheckNTErrors(nodeNumUsed < nodeNum, "No enough index nodes for the memory pool!");
+        node = memIndex + nodeNumUsed++;
+    }
+
+    memset(node, 0, sizeof(MPieceNode));
+    node->head.indexNode = node;
+
+    return node;
+}
+
+/*
+recycle an index node
+>> node - the node
+*/
+void XMem::DelIndexNode(MPieceNode * node)
+{
+    node->pre = NULL;
+    node->next = freeNodes;
+    freeNodes = node;
+    freeNodeNum++;
+}
+
+/*
+remove an index node for available memory pieces
 >> node - node to remove
->> - the entry of the list that keeps the node
+>> entry - the entry of the list that keeps the node
 */
 void XMem::RemoveIndexNode(MPieceNode * node, MPieceNode * entry)
 {
     MPieceNode * pre = node->pre;
     MPieceNode * next = node->next;
-    
 
     CheckNTErrors(pre != NULL, "cannot free the entry node!");
 
     pre->next = next;
     if(next != NULL)
         next->pre = pre;
-    
+
     node->pre = NULL;
     node->next = NULL;
+
+    /* the list is empty now */
+    MPieceNode * entryForMe = entry != NULL ? entry :
+                              memIndex + FindIndexEntry(node->size);
+    if(entryForMe->next == NULL){
+        int index = (int)(entryForMe - memIndex);
+        int fl = index / MEM_SL_NUM;
+        slBitmap[fl] &= ~(1U << (index % MEM_SL_NUM));
+        if(slBitmap[fl] == 0)
+            flBitmap &= ~((MTYPE)1 << fl);
+    }
 }
 
-/* 
+/*
 add an index node for available memory pieces
 >> node - node to add
 >> entry - the entry of the list to append the node
@@ -900,19 +908,6 @@ void XMem::AddFreeIndexNode(MPieceNode * node, MPieceNode * entry)
     MPieceNode * entryForMe = entry != NULL ? entry :
                               memIndex + FindIndexEntry(node->size);
 
-    /*MPieceNode * backup = entryForMe->next;
-
-    while(backup != NULL && backup->head.size < node->head.size){
-        backup = backup->next;
-        entryForMe = entryForMe->next;
-    }
-
-    entryForMe->next = node;
-    node->pre = entryForMe;
-    node->next = backup;
-    if(backup != NULL)
-        backup->pre = node;*/
-    
     MPieceNode * backup = entryForMe->next;
     entryForMe->next = node;
     node->pre = entryForMe;
@@ -920,254 +915,178 @@ void XMem::AddFreeIndexNode(MPieceNode * node, MPieceNode * entry)
     if(backup != NULL)
         backup->pre = node;
 
+    int index = (int)(entryForMe - memIndex);
+    int fl = index / MEM_SL_NUM;
+    slBitmap[fl] |= 1U << (index % MEM_SL_NUM);
+    flBitmap |= (MTYPE)1 << fl;
+
     CheckNTErrors(node != node->next, "Something wrong with the index node!");
     CheckNTErrors(node != node->pre,  "Something wrong with the index node!");
 }
-    
+
+/* the slot of an address in the hash table */
+inline INT_64 GetAllocSlot(void * p, INT_64 tableSize)
+{
+    MTYPE h = ((MTYPE)p >> 4) * 0x9E3779B97F4A7C15ULL;
+    return (INT_64)(h ^ (h >> 32)) & (tableSize - 1);
+}
+
 /*
-remove an index node for memory pieces in use
+remove an index node for memory pieces in use. The following nodes in the
+probe sequence are moved backward so that no tombstone is needed.
 >> node - node to remove
->> - the entry of the list that keeps the node
 */
-void XMem::RemoveAllocIndexNode(MPieceNode * node, MPieceNode * entry)
+void XMem::RemoveAllocIndexNode(MPieceNode * node)
 {
-    RemoveIndexNode(node, entry);
+    INT_64 mask = allocTableSize - 1;
+    INT_64 i = GetAllocSlot(node->pReal, allocTableSize);
+    while(allocTable[i] != node){
+        CheckNTErrors(allocTable[i] != NULL, "No header is found!");
+        i = (i + 1) & mask;
+    }
+
+    for(INT_64 j = (i + 1) & mask; allocTable[j] != NULL; j = (j + 1) & mask){
+        INT_64 k = GetAllocSlot(allocTable[j]->pReal, allocTableSize);
+
+        /* move the node to the hole if its home slot is not in (i, j] */
+        bool isBetween = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if(!isBetween){
+            allocTable[i] = allocTable[j];
+            i = j;
+        }
+    }
+    allocTable[i] = NULL;
 }
 
 /*
 add an index node for memory pieces in use
 >> node - node to add
->> entry - the entry of the list to append the node
 */
-void XMem::AddAllocIndexNode(MPieceNode * node, MPieceNode * entry)
+void XMem::AddAllocIndexNode(MPieceNode * node)
 {
-    MPieceNode * entryForMe = entry != NULL ? entry :
-                              memIndex + indexEntryNum + FindIndexEntry(node->size);
-    
-    MPieceNode * backup = entryForMe->next;
-    entryForMe->next = node;
-    node->pre = entryForMe;
-    node->next = backup;
-    if(backup != NULL)
-        backup->pre = node;
-    
-    CheckNTErrors(node != node->next, "Something wrong with the index node!");
-    CheckNTErrors(node != node->pre,  "Something wrong with the index node!");
+    INT_64 mask = allocTableSize - 1;
+    INT_64 i = GetAllocSlot(node->pReal, allocTableSize);
+    while(allocTable[i] != NULL)
+        i = (i + 1) & mask;
+    allocTable[i] = node;
 }
 
-/* 
-release a piece of memory as "free" 
+/*
+find the index node of a memory piece in use
+>> p - the pointer to the memory piece
+<< return - the node (NULL if it is not found)
+*/
+MPieceNode * XMem::FindAllocIndexNode(void * p)
+{
+    INT_64 mask = allocTableSize - 1;
+    for(INT_64 i = GetAllocSlot(p, allocTableSize); allocTable[i] != NULL; i = (i + 1) & mask){
+        if(allocTable[i]->pReal == p)
+            return allocTable[i];
+    }
+    return NULL;
+}
+
+/*
+release a piece of memory as "free". The piece is found by its address, and
+it is merged with the free neighbors right away.
 >> myDevID - device id(-1: CPU memory, >=0: GPU device ID)
 >> p - the pointer to the address of the memory we intend to free
->> size - size of the memory piece to release
+>> size - size of the memory piece to release (not required since the
+          piece is found by the address)
 */
 void XMem::ReleaseStandard(int myDevID, void * p, MTYPE size)
 {
     if(p == NULL)
         return;
-    
-    if(size <= minSizeIndex[0])
-        size = minSizeIndex[0];
-    
-    MPieceNode * entry = NULL;
-    MPieceNode * node = NULL;
-    MPieceNode * hit = NULL;
-    MPieceNode * last = NULL;
-    
-    entry = memIndex + indexEntryNum + FindIndexEntry(size);
-    
-    last = entry;
-    node = entry->next;
-    
-    while(node != NULL){
-        CheckNTErrors(node->pre == last, "Something is wrong!");
-        CheckNTErrors(last->next == node, "Something is wrong!");
-        CheckNTErrors(node->head.state == 2, "Something is wrong!");
-        last = node;
-        
-        if(node->size == 0){
-            MPieceNode * next = node->next;
-            RemoveIndexNode(node, entry);
-            node = next;
-            ShowNTErrors("Something is wrong!");
-        }
-        else{
-            CheckNTErrors(node->pReal != NULL, "Illegal pointer!");
-            if(node->pReal == p){
-                hit = node;
-                break;
-            }
-            node = node->next;
-        }
-    }
-    
+
+    MPieceNode * hit = FindAllocIndexNode(p);
     CheckNTErrors(hit != NULL, "No header is found!");
-    
-    hit->head.state = 1;
-    
+    CheckNTErrors(hit->head.state == 2, "Something is wrong!");
+
     RemoveAllocIndexNode(hit);
 
-    MTYPE usedSize = (char*)hit->p + hit->head.size - (char*)GetPitchedAddress((char*)hit->p, MY_PITCH);
-    blocks[hit->head.blockID].used -= usedSize;
+    MHeader * head = &hit->head;
+    head->state = 1;
+    blocks[head->blockID].used -= head->size;
+    totalUsed -= head->size;
+    releaseNum++;
 
     if(mergeFreeOTF){
-        MHeader * head = &hit->head;
         MHeader * pre = head->pre;
         MHeader * next = head->next;
-        bool mergeLeft = false;
-        bool mergeRight = false;
 
         CheckNTErrors(head != pre, "wrong list of memory headers");
         CheckNTErrors(head != next, "wrong list of memory headers");
 
-        if(pre != NULL && pre->state == 1 && pre->blockID == head->blockID){
-            mergeLeft = true;
+        if(pre != NULL && pre->state == 1){
+            MPieceNode * preNode = pre->indexNode;
+            RemoveIndexNode(preNode);
+
+            hit->p = preNode->p;
+            head->size += pre->size;
             head->pre = pre->pre;
             if(head->pre != NULL)
                 head->pre->next = head;
-            hit->p = pre->indexNode->p;
-            hit->head.size += pre->size;
-            RemoveAllocIndexNode(pre->indexNode);
 
             if(pre == blocks[head->blockID].head)
                 blocks[head->blockID].head = head;
+
+            DelIndexNode(preNode);
         }
 
-        if(next != NULL && next->state == 1 && next->blockID == head->blockID){
-            mergeRight = true;
+        if(next != NULL && next->state == 1){
+            MPieceNode * nextNode = next->indexNode;
+            RemoveIndexNode(nextNode);
+
+            head->size += next->size;
             head->next = next->next;
             if(head->next != NULL)
                 head->next->pre = head;
-            hit->head.size += next->size;
-            RemoveAllocIndexNode(next->indexNode);
-        }
 
-        if(!mergeLeft && !mergeRight){
-            hit->size = usedSize;
-        }
-        else{
-            hit->size = (char*)hit->p + hit->head.size - (char*)GetPitchedAddress((char*)hit->p, MY_PITCH);
+            DelIndexNode(nextNode);
         }
     }
-    else{
-        hit->size = usedSize;
-    }
 
+    hit->size = head->size;
+    hit->pReal = NULL;
     AddFreeIndexNode(hit);
 }
 
-/* rebuild index to merge small fragments of memory and free the block with no use */
+/* free the blocks with no use (the free pieces are merged on the fly so the index needs no rebuilding) */
 void XMem::RebuildIndex()
 {
-    int nodeNumUsed2 = indexEntryNum * 2;
-    memset(memIndex2, 0, sizeof(MPieceNode) * indexEntryNum * 2);
-
     for(int bi = 0; bi <= curBlockID; bi++){
         XMemBlock * block = blocks + bi;
         if(block->mem == NULL || block->head == NULL)
             continue;
 
         MHeader * head = block->head;
-        CheckNTErrors(head->size <= block->size, "Illegal memory block!");
-        
-        block->head = NULL;
-        block->used = 0;
+        if(head->state != 1 || head->pre != NULL || head->next != NULL)
+            continue;
 
-        /* if the block is not used, we delete it */
-        if(head->state == 1 && head->size == block->size){
-            if(devID < 0){
-                delete[] (char*)block->mem;
-            }
-            else{
-#ifdef USE_CUDA
-                int devIDBackup = -1;
-                cudaGetDevice(&devIDBackup);
-                SetDevice(devID);
-                CheckNTErrors(cudaFree((char*)block->mem) == cudaSuccess, "Cannot free the memory.");
-                SetDevice(devIDBackup);
-#else
-                ShowNTErrors("Please specify USE_CUDA for compiling this program.");
-#endif 
-            }
+        RemoveIndexNode(head->indexNode);
+        DelIndexNode(head->indexNode);
 
-            block->size = 0;
-            block->mem = NULL;
+        if(devID < 0){
+            delete[] (char*)block->mem;
         }
         else{
-            /* if the block is in use, we build the index */
-            int pieceCount = 0;
-            MTYPE size = 0;
-            MHeader * newLast = NULL;
-            while(head != NULL){
-                MHeader * next = head->next;
-                if(head->state == 1){
-                    while(next != NULL && next->state == 1){
-                        head->size += next->size;
-                        next = next->next;
-                    }
-                    head->next = next;
-                }
-                
-                MPieceNode * node = head->indexNode;
-                void * p = node->p;
-                
-                /* make a new index node */
-                MPieceNode * newNode = memIndex2 + nodeNumUsed2++;
-                newNode->p = p;
-                
-                if(head->state == 1){
-                    newNode->size = (char*)p + head->size -
-                                    (head->state == 1 ? (char*)GetPitchedAddress((char*)p, MY_PITCH) : (char*)head->indexNode->pReal);
-                }
-                else
-                    newNode->size = node->size;
-                
-                newNode->pre = NULL;
-                newNode->next = NULL;
-                
-                CheckNTErrors(newNode->size > 0, "Illegal index node!");
-                
-                MHeader * newHeader = &newNode->head;
-                
-                newHeader->indexNode = newNode;
-                newHeader->pre = newLast;
-                newHeader->next = NULL;
-                newHeader->blockID = bi;
-                newHeader->size = head->size;
-                newHeader->state = head->state;
-                
-                if(newLast != NULL)
-                    newLast->next = newHeader;
-                
-                if(head->state == 1){
-                    newNode->pReal = NULL;
-                    MPieceNode * entry = memIndex2 + FindIndexEntry(newNode->size);
-                    AddFreeIndexNode(newNode, entry);
-                }
-                else{
-                    newNode->pReal = head->indexNode->pReal;
-                    MPieceNode * entry = memIndex2 + indexEntryNum + FindIndexEntry(newNode->size);
-                    AddAllocIndexNode(newNode, entry);
-                    block->used += head->size;
-                }
-                
-                if(newLast == NULL)
-                    block->head = newHeader;
-                
-                pieceCount++;
-                size += head->size;
-                CheckNTErrors(size <= block->size, "Illegal block size!");
-                
-                newLast = newHeader;
-                head = next;
-            }
+#ifdef USE_CUDA
+            int devIDBackup = -1;
+            cudaGetDevice(&devIDBackup);
+            SetDevice(devID);
+            CheckNTErrors(cudaFree((char*)block->mem) == cudaSuccess, "Cannot free the memory.");
+            SetDevice(devIDBackup);
+#else
+            ShowNTErrors("Please specify USE_CUDA for compiling this program.");
+#endif
         }
+
+        block->head = NULL;
+        block->used = 0;
+        block->size = 0;
+        block->mem = NULL;
     }
-    
-    MPieceNode * backup = memIndex2;
-    memIndex2 = memIndex;
-    memIndex = backup;    
-    nodeNumUsed = nodeNumUsed2;
 }
 
 /* 
@@ -1176,6 +1095,9 @@ reset the memory pool
 */
 void XMem::Reset(int myDevID)
 {
+    GMemStat.OnClearPool(this);
+    GMemStat.OnClearBuf(this);
+
     for(int i = 0; i <= curBlockID; i++){
         if(devID >= 0){
 #ifdef USE_CUDA
@@ -1239,6 +1161,8 @@ void * XMem::GetAddress()
 /* clear it */
 void XMem::Clear()
 {
+    GMemStat.OnClearPool(this);
+
     if (mode == UNI_FREE) {
         for (int i = 0; i < blockNum; i++)
             blocks[i].used = 0;
@@ -1246,8 +1170,7 @@ void XMem::Clear()
         curBlockID = 0;
     }
     else if (mode == FREE_ON_THE_FLY) {
-        nodeNumUsed = indexEntryNum * 2;
-        memset(memIndex, 0, sizeof(MPieceNode) * indexEntryNum * 2);
+        ClearIndex();
         for (int i = 0; i <= curBlockID; i++) {
             blocks[i].head = NULL;
             blocks[i].used = 0;
@@ -1271,6 +1194,7 @@ void XMem::Clear()
 void XMem::ClearBuf()
 {
     bufUsed = 0;
+    GMemStat.OnClearBuf(this);
 }
 
 /* clear the memory pool and the buffer */
@@ -1483,6 +1407,34 @@ void XMem::ShowMemUsage(FILE * file)
 
     fprintf(file, "mem:%.1fMB used:%.1fMB usage:%.3f\n", 
            (DTYPE)total/MILLION, (DTYPE)used/MILLION, (DTYPE)used/total);
+
+    if(mode != FREE_ON_THE_FLY || memIndex == NULL)
+        return;
+
+    /* fragmentation is the share of the free memory that is not in the largest free piece */
+    INT_64 pieceNum = 0;
+    INT_64 freePieceNum = 0;
+    MTYPE freeSize = 0;
+    MTYPE maxFreeSize = 0;
+    for(int i = 0; i < blockNum; i++){
+        if(blocks[i].mem == NULL)
+            continue;
+        for(MHeader * head = blocks[i].head; head != NULL; head = head->next){
+            pieceNum++;
+            if(head->state == 1){
+                freePieceNum++;
+                freeSize += head->size;
+                maxFreeSize = MAX(maxFreeSize, head->size);
+            }
+        }
+    }
+
+    fprintf(file, "peak:%.1fMB pieces:%lld free pieces:%lld free:%.1fMB largest free:%.1fMB fragmentation:%.3f "
+           "allocs:%lld releases:%lld new blocks:%lld index nodes:%lld/%lld\n",
+           (DTYPE)peakUsed/MILLION, pieceNum, freePieceNum, (DTYPE)freeSize/MILLION, (DTYPE)maxFreeSize/MILLION,
+           freeSize > 0 ? 1.0F - (DTYPE)maxFreeSize/freeSize : 0.0F,
+           allocNum, releaseNum, blockAllocNum,
+           nodeNumUsed - MEM_LIST_NUM - freeNodeNum, nodeNum - MEM_LIST_NUM);
 }
 
 #ifdef USE_CUDA
@@ -1615,6 +1567,7 @@ XMem * XMemManager::GetMem(const int devID)
                                   MIN_BLOCK_SIZE_FOR_MEMPOOL, 
                                   MIN_BLOCK_NUM_FOR_MEMPOOL, 
                                   myBufSize);
+            CPUMems[0].SetName("cpu");
         }
         mem = CPUMems;
     }
@@ -1628,6 +1581,7 @@ XMem * XMemManager::GetMem(const int devID)
                                           MIN_BLOCK_SIZE_FOR_MEMPOOL, 
                                           MIN_BLOCK_NUM_FOR_MEMPOOL, 
                                           myBufSize);
+                GPUMems[devID].SetName("gpu");
             }
             mem = GPUMems + devID;
         }
@@ -65,6 +65,14 @@ typedef long long          INT_64;
 #define MAX_CPU_MEM_NUM 16
 #define MAX_GPU_MEM_NUM 16
 
+/* the free memory pieces (FREE_ON_THE_FLY) are kept in segregated lists. A size
+   falls in the first-level class of its highest set bit, which is split into
+   2^MEM_SL_BITS second-level classes by the following bits */
+#define MEM_SL_BITS 4
+#define MEM_SL_NUM (1 << MEM_SL_BITS)
+#define MEM_FL_NUM 64
+#define MEM_LIST_NUM (MEM_FL_NUM * MEM_SL_NUM)
+
 /* 
 mode of runnig a memory pool 
 - UNI_FREE: free all memory space when the memory allocation is no use
@@ -86,10 +94,10 @@ struct MHeader
     /* size of the allocated memory */
     MTYPE size;
 
-    /* pointer to the header of the previous memory piece */
+    /* pointer to the header of the previous memory piece (in the same block) */
     MHeader * pre;
 
-    /* pointer to the header of the next memory piece */
+    /* pointer to the header of the next memory piece (in the same block) */
     MHeader * next;
 
     /* id of the memory block */
@@ -102,13 +110,13 @@ struct MHeader
 /* index of memory piece */
 struct MPieceNode
 {
-    /* size of the memory piece */
+    /* size of the memory piece (the size that is required if it is in use) */
     MTYPE size;
 
-    /* previous node */
+    /* previous node (in the free list) */
     MPieceNode * pre;
 
-    /* next node */
+    /* next node (in the free list, or in the stack of the nodes that are not used) */
     MPieceNode * next;
 
     /* pointer to the head of a memory piece */
@@ -225,30 +233,52 @@ public:
 #endif
 
 public:
-    /* index of the free memory pieces */
+    /* index nodes of the memory pieces. The first MEM_LIST_NUM nodes are
+       the heads of the free lists */
     MPieceNode * memIndex;
-    
-    /* for double buffering */
-    MPieceNode * memIndex2;
 
     /* maximum number of index nodes */
     INT_64 nodeNum;
 
-    /* count of the used nodes */
+    /* count of the nodes that have ever been used (the nodes that are
+       released are recycled through the stack of free nodes) */
     INT_64 nodeNumUsed;
 
-    /* minimal size allocation for each index entry */
-    MTYPE * minSizeIndex;
+    /* the stack of the index nodes that are released */
+    MPieceNode * freeNodes;
+
+    /* number of the nodes in the stack */
+    INT_64 freeNodeNum;
+
+    /* bitmap of the first-level classes that have free pieces */
+    MTYPE flBitmap;
 
-    /* number of the index entries */
-    int indexEntryNum;
+    /* bitmaps of the second-level classes that have free pieces */
+    unsigned int slBitmap[MEM_FL_NUM];
 
-    /* index offset */
-    int indexOffset;
+    /* hash table (with linear probing) from the address to the node of
+       the pieces in use */
+    MPieceNode ** allocTable;
+
+    /* size of the hash table (a power of 2) */
+    INT_64 allocTableSize;
+
+    /* minimal size of a memory piece */
+    MTYPE minPieceSize;
 
     /* indicates whether we merge free memory pieces on the fly */
     bool mergeFreeOTF;
 
+    /* peak size of the used memory */
+    MTYPE peakUsed;
+
+    /* number of allocations and releases */
+    INT_64 allocNum;
+    INT_64 releaseNum;
+
+    /* number of times that a new block is required */
+    INT_64 blockAllocNum;
+
 public:
 
     /* constructor */
@@ -293,7 +323,10 @@ public:
     void SetComputationMode(bool myIsForComputation);
 
     /* initialize the index */
-    void SetIndex(INT_64 size, MTYPE minSizeFirst = 256, int minSizeNum = 20);
+    void SetIndex(INT_64 size, MTYPE minSize = 256);
+
+    /* clear the index (all the memory pieces are regarded as unused) */
+    void ClearIndex();
 
     /* get device id */
     int GetDevID();
@@ -340,9 +373,21 @@ public:
     /* find the highest set bit (or most significant set bit) in an integer-64 */
     int GetMSB(MTYPE mySize);
 
-    /* find the index entry for allocation query */
+    /* find the lowest set bit in an integer-64 */
+    int GetLSB(MTYPE mySize);
+
+    /* find the index entry (the free list) of a memory piece */
     int FindIndexEntry(MTYPE mySize);
 
+    /* find a free memory piece for allocation query */
+    MPieceNode * FindFreeIndexNode(MTYPE mySize);
+
+    /* get an index node (a recycled one if there is) */
+    MPieceNode * NewIndexNode();
+
+    /* recycle an index node */
+    void DelIndexNode(MPieceNode * node);
+
     /* remove an index node for available memory pieces */
     void RemoveIndexNode(MPieceNode * node, MPieceNode * entry = NULL);
 
@@ -350,15 +395,18 @@ public:
     void AddFreeIndexNode(MPieceNode * node, MPieceNode * entry = NULL);
     
     /* remove an index node for memory pieces in use */
-    void RemoveAllocIndexNode(MPieceNode * node, MPieceNode * entry = NULL);
+    void RemoveAllocIndexNode(MPieceNode * node);
     
-    /* add an index node for available memory pieces */
-    void AddAllocIndexNode(MPieceNode * node, MPieceNode * entry = NULL);
+    /* add an index node for memory pieces in use */
+    void AddAllocIndexNode(MPieceNode * node);
+
+    /* find the index node of a memory piece in use */
+    MPieceNode * FindAllocIndexNode(void * p);
 
     /* release a piece of memory as "free" */
     void ReleaseStandard(int myDevID, void * p, MTYPE size);
 
-    /* rebuild index to merge small fragments of memory and free the block with no use */
+    /* free the blocks with no use */
     void RebuildIndex();
 
     /* reset buffer */
@@ -0,0 +1,761 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "XMemStat.h"
+#include "XName.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+XMemStat GMemStat;
+
+/* category of the allocations of the current thread */
+static thread_local int memCategory = MEM_ACTIVATION;
+
+/* name of a category */
+const char * GetMemCategoryName(int category)
+{
+    if (category == MEM_ACTIVATION)
+        return "activation";
+    else if (category == MEM_PARAMETER)
+        return "parameter";
+    else if (category == MEM_EMBEDDING)
+        return "embedding";
+    else if (category == MEM_GRADIENT)
+        return "gradient";
+    else if (category == MEM_OPTIMIZER)
+        return "optimizer";
+    else if (category == MEM_BUFFER)
+        return "buffer";
+
+    return "NULL";
+}
+
+/* name of an op (in the summary) */
+static const char * GetMemOPName(int op)
+{
+    return op == 0 ? "-" : GetOPName(op);
+}
+
+/* index of a device in the counters */
+static int GetMemDevIndex(int devID)
+{
+    int d = devID + 1;
+    if (d < 0)
+        return 0;
+    if (d >= MEM_STAT_DEV_NUM)
+        return MEM_STAT_DEV_NUM - 1;
+    return d;
+}
+
+/* hash of an address */
+static unsigned int HashMemAddress(const void * p)
+{
+    unsigned long long h = (unsigned long long)p >> 4;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return (unsigned int)(h >> 32);
+}
+
+/* hash of a (device, pool, op, category) tuple */
+static unsigned int HashMemItem(int devID, int pool, int op, int category)
+{
+    unsigned long long h = (unsigned long long)(devID + 1);
+    h = h * 0x9E3779B97F4A7C15ULL + (unsigned long long)pool;
+    h = h * 0x9E3779B97F4A7C15ULL + (unsigned long long)op;
+    h = h * 0x9E3779B97F4A7C15ULL + (unsigned long long)category;
+    return (unsigned int)(h >> 32);
+}
+
+/* show the summary at exit */
+static void ShowMemStatAtExit()
+{
+    if (GMemStat.enabled && GMemStat.showAtExit)
+        GMemStat.ShowPeak(stderr);
+}
+
+/* constructor */
+XMemStat::XMemStat()
+{
+    enabled = false;
+    showAtExit = false;
+    items = NULL;
+    itemNum = 0;
+    itemSize = 0;
+    itemIndex = NULL;
+    itemIndexSize = 0;
+    records = NULL;
+    recordNum = 0;
+    recordSize = 0;
+    poolKeys = NULL;
+    poolNames = NULL;
+    poolNum = 0;
+    poolSize = 0;
+    memset(current, 0, sizeof(current));
+    memset(peak, 0, sizeof(peak));
+    memset(categoryCurrent, 0, sizeof(categoryCurrent));
+    memset(categoryAtPeak, 0, sizeof(categoryAtPeak));
+    MUTEX_INIT(mutex);
+}
+
+/* de-constructor */
+XMemStat::~XMemStat()
+{
+    /* the memory pools might be freed after us */
+    enabled = false;
+    Clear();
+
+    delete[] poolNames;
+    delete[] poolKeys;
+    delete[] items;
+    delete[] itemIndex;
+    delete[] records;
+
+    MUTEX_DELE(mutex);
+}
+
+/*
+turn on the accounting. The allocations before it are not counted.
+>> myShowAtExit - show the peak usage at exit or not
+*/
+void XMemStat::Enable(bool myShowAtExit)
+{
+    static bool isRegistered = false;
+
+    MUTEX_LOCK(mutex);
+    if (records == NULL)
+        InitTables();
+    showAtExit = myShowAtExit;
+    enabled = true;
+    MUTEX_UNLOCK(mutex);
+
+    if (!isRegistered) {
+        isRegistered = true;
+        atexit(ShowMemStatAtExit);
+    }
+}
+
+/* turn off the accounting */
+void XMemStat::Disable()
+{
+    enabled = false;
+}
+
+/* forget everything (the tables are kept) */
+void XMemStat::Clear()
+{
+    MUTEX_LOCK(mutex);
+
+    for (int i = 0; i < poolNum; i++)
+        delete[] poolNames[i];
+    poolNum = 0;
+    itemNum = 0;
+    recordNum = 0;
+
+    if (itemIndex != NULL)
+        memset(itemIndex, -1, sizeof(int) * itemIndexSize);
+    if (records != NULL)
+        memset(records, 0, sizeof(XMemStatRecord) * recordSize);
+
+    memset(current, 0, sizeof(current));
+    memset(peak, 0, sizeof(peak));
+    memset(categoryCurrent, 0, sizeof(categoryCurrent));
+    memset(categoryAtPeak, 0, sizeof(categoryAtPeak));
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+a piece of memory is allocated
+>> devID - device id
+>> pool - the memory pool (NULL for the global XMemAlloc path)
+>> poolName - name of the pool
+>> p - the memory
+>> size - size of the memory
+*/
+void XMemStat::OnAlloc(int devID, const void * pool, const char * poolName, void * p, MTYPE size)
+{
+    if (!enabled || p == NULL)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    if ((recordNum + 1) * 2 > recordSize)
+        RebuildRecords(recordSize * 2, -1);
+
+    int slot = FindRecord(p);
+    XMemStatRecord &r = records[slot];
+
+    /* the memory was freed without us knowing it */
+    if (r.p == p)
+        Uncount(r.item, r.size);
+    else
+        recordNum++;
+
+    r.p = p;
+    r.size = size;
+    r.item = GetItem(devID, GetPool(pool, poolName), 0, memCategory);
+    Count(r.item, size);
+    items[r.item].allocNum++;
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+a piece of memory is released
+>> p - the memory
+*/
+void XMemStat::OnRelease(void * p)
+{
+    if (!enabled || p == NULL)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int slot = FindRecord(p);
+    if (records[slot].p == p) {
+        Uncount(records[slot].item, records[slot].size);
+        items[records[slot].item].releaseNum++;
+        RemoveRecord(slot);
+    }
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+all pieces of a pool are released (at once), e.g., when the pool is cleared.
+The buffer is not included.
+>> pool - the memory pool
+*/
+void XMemStat::OnClearPool(const void * pool)
+{
+    if (!enabled)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int poolIndex = GetPool(pool, NULL);
+    if (poolIndex >= 0)
+        RebuildRecords(recordSize, poolIndex);
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+a piece of memory is allocated in the buffer of a pool. The buffer is a stack,
+and a piece is released by its size only. So we count the bytes but do not keep
+the pieces.
+>> devID - device id
+>> pool - the memory pool
+>> poolName - name of the pool
+>> size - size of the memory
+*/
+void XMemStat::OnAllocBuf(int devID, const void * pool, const char * poolName, MTYPE size)
+{
+    if (!enabled)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int item = GetItem(devID, GetPool(pool, poolName), 0, MEM_BUFFER);
+    Count(item, size);
+    items[item].allocNum++;
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+a piece of memory is released in the buffer of a pool
+>> devID - device id
+>> pool - the memory pool
+>> size - size of the memory
+*/
+void XMemStat::OnReleaseBuf(int devID, const void * pool, MTYPE size)
+{
+    if (!enabled)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int poolIndex = GetPool(pool, NULL);
+    if (poolIndex >= 0) {
+        int item = GetItem(devID, poolIndex, 0, MEM_BUFFER);
+        Uncount(item, size);
+        items[item].releaseNum++;
+    }
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+the buffer of a pool is cleared
+>> pool - the memory pool
+*/
+void XMemStat::OnClearBuf(const void * pool)
+{
+    if (!enabled)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int poolIndex = GetPool(pool, NULL);
+    for (int i = 0; i < itemNum && poolIndex >= 0; i++) {
+        XMemStatItem &it = items[i];
+        if (it.pool == poolIndex && it.category == MEM_BUFFER)
+            Uncount(i, it.current);
+    }
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+set the op of a piece of memory. It is called when an op links its output (so
+the ops are known when the gradient is enabled, and they are "-" otherwise), and
+the first op wins, i.e., a tensor that shares the memory of another one does
+not change it.
+>> p - the memory
+>> op - op id (in XName)
+*/
+void XMemStat::SetOp(const void * p, int op)
+{
+    if (!enabled || p == NULL)
+        return;
+
+    MUTEX_LOCK(mutex);
+
+    int slot = FindRecord(p);
+    XMemStatRecord &r = records[slot];
+    if (r.p == p && items[r.item].op == 0) {
+        XMemStatItem &from = items[r.item];
+        int item = GetItem(from.devID, from.pool, op, from.category);
+
+        /* GetItem might move the array */
+        XMemStatItem &oldItem = items[r.item];
+        XMemStatItem &newItem = items[item];
+        oldItem.current -= r.size < oldItem.current ? r.size : oldItem.current;
+        oldItem.allocNum--;
+        newItem.current += r.size;
+        newItem.allocNum++;
+        if (newItem.peak < newItem.current)
+            newItem.peak = newItem.current;
+        r.item = item;
+    }
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/*
+bytes in use
+>> devID - device id
+>> category - the category (-1 for all)
+*/
+MTYPE XMemStat::GetCurrent(int devID, int category)
+{
+    int d = GetMemDevIndex(devID);
+    return category < 0 ? current[d] : categoryCurrent[d][category];
+}
+
+/*
+peak bytes
+>> devID - device id
+>> category - the category (-1 for all). For a category, it is the bytes of
+              the category when the device reaches its peak
+*/
+MTYPE XMemStat::GetPeak(int devID, int category)
+{
+    int d = GetMemDevIndex(devID);
+    return category < 0 ? peak[d] : categoryAtPeak[d][category];
+}
+
+/* write a string in JSON */
+static void DumpJSONString(FILE * file, const char * str)
+{
+    fputc('"', file);
+    for (const char * c = str; *c != 0; c++) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        if ((unsigned char)*c >= 0x20)
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+/*
+dump a snapshot to a JSON file, i.e.,
+{"devices": [{"dev": -1, "current": ..., "peak": ..., "categories": {...}}, ...],
+ "items": [{"dev": -1, "pool": "cpu", "op": "M_SUM", "category": "activation",
+            "current": ..., "peak": ..., "allocs": ..., "releases": ...}, ...]}
+>> file - where we dump it ("-" for stdout)
+<< return - succeeded or not
+*/
+bool XMemStat::Dump(const char * file)
+{
+    FILE * f = strcmp(file, "-") == 0 ? stdout : fopen(file, "w");
+    if (f == NULL)
+        return false;
+
+    MUTEX_LOCK(mutex);
+
+    fprintf(f, "{\n  \"devices\": [");
+    bool first = true;
+    for (int d = 0; d < MEM_STAT_DEV_NUM; d++) {
+        if (peak[d] == 0)
+            continue;
+        fprintf(f, "%s\n    {\"dev\": %d, \"current\": %llu, \"peak\": %llu, \"categories\": {",
+                first ? "" : ",", d - 1, current[d], peak[d]);
+        for (int c = 0; c < MEM_CATEGORY_NUM; c++) {
+            fprintf(f, "%s\"%s\": {\"current\": %llu, \"at_peak\": %llu}", c > 0 ? ", " : "",
+                    GetMemCategoryName(c), categoryCurrent[d][c], categoryAtPeak[d][c]);
+        }
+        fprintf(f, "}}");
+        first = false;
+    }
+    fprintf(f, "\n  ],\n  \"items\": [");
+
+    for (int i = 0; i < itemNum; i++) {
+        XMemStatItem &it = items[i];
+        fprintf(f, "%s\n    {\"dev\": %d, \"pool\": ", i > 0 ? "," : "", it.devID);
+        DumpJSONString(f, poolNames[it.pool]);
+        fprintf(f, ", \"op\": \"%s\", \"category\": \"%s\", \"current\": %llu, \"peak\": %llu, "
+                   "\"allocs\": %llu, \"releases\": %llu}",
+                GetMemOPName(it.op), GetMemCategoryName(it.category),
+                it.current, it.peak, it.allocNum, it.releaseNum);
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    MUTEX_UNLOCK(mutex);
+
+    if (f != stdout)
+        fclose(f);
+    else
+        fflush(f);
+
+    return true;
+}
+
+/*
+show the peak usage of each device: the categories when it reaches the peak
+and the (pool, op, category) tuples of the largest peaks
+>> file - where we show it
+*/
+void XMemStat::ShowPeak(FILE * file)
+{
+    const int topNum = 5;
+    const double mb = 1024.0 * 1024.0;
+
+    MUTEX_LOCK(mutex);
+
+    for (int d = 0; d < MEM_STAT_DEV_NUM; d++) {
+        if (peak[d] == 0)
+            continue;
+
+        if (d == 0)
+            fprintf(file, "[memory] cpu: peak %.1fMB, current %.1fMB\n", peak[d] / mb, current[d] / mb);
+        else
+            fprintf(file, "[memory] gpu%d: peak %.1fMB, current %.1fMB\n", d - 1, peak[d] / mb, current[d] / mb);
+
+        fprintf(file, "[memory]   at peak:");
+        for (int c = 0; c < MEM_CATEGORY_NUM; c++) {
+            if (categoryAtPeak[d][c] > 0)
+                fprintf(file, " %s %.1fMB", GetMemCategoryName(c), categoryAtPeak[d][c] / mb);
+        }
+        fprintf(file, "\n");
+
+        /* the largest peaks (a selection of topNum) */
+        int top[topNum];
+        int n = 0;
+        for (int i = 0; i < itemNum; i++) {
+            if (GetMemDevIndex(items[i].devID) != d || items[i].peak == 0)
+                continue;
+            int j = n < topNum ? n++ : topNum;
+            while (j > 0 && items[top[j - 1]].peak < items[i].peak) {
+                if (j < topNum)
+                    top[j] = top[j - 1];
+                j--;
+            }
+            if (j < topNum)
+                top[j] = i;
+        }
+
+        for (int k = 0; k < n; k++) {
+            XMemStatItem &it = items[top[k]];
+            fprintf(file, "[memory]   %-12s %-20s %-10s peak %.1fMB, %llu allocs\n",
+                    poolNames[it.pool], GetMemOPName(it.op), GetMemCategoryName(it.category),
+                    it.peak / mb, it.allocNum);
+        }
+    }
+
+    MUTEX_UNLOCK(mutex);
+}
+
+/* category of the allocations of the current thread */
+int XMemStat::GetCategory()
+{
+    return memCategory;
+}
+
+/*
+set the category of the allocations of the current thread
+>> category - the category
+*/
+void XMemStat::SetCategory(int category)
+{
+    memCategory = category;
+}
+
+/* make the (empty) tables */
+void XMemStat::InitTables()
+{
+    recordSize = 1024;
+    records = new XMemStatRecord[recordSize];
+    memset(records, 0, sizeof(XMemStatRecord) * recordSize);
+
+    itemIndexSize = 256;
+    itemIndex = new int[itemIndexSize];
+    memset(itemIndex, -1, sizeof(int) * itemIndexSize);
+}
+
+/*
+get the index of a pool
+>> pool - the pool (NULL for the global XMemAlloc path)
+>> poolName - name of the pool. If it is NULL, we do not create the pool
+<< return - index of the pool (-1 if we do not find it)
+*/
+int XMemStat::GetPool(const void * pool, const char * poolName)
+{
+    for (int i = 0; i < poolNum; i++) {
+        if (poolKeys[i] == pool)
+            return i;
+    }
+
+    if (poolName == NULL)
+        return -1;
+
+    if (poolNum == poolSize) {
+        int newSize = poolSize > 0 ? poolSize * 2 : 8;
+        const void ** newKeys = new const void*[newSize];
+        char ** newNames = new char*[newSize];
+        if (poolNum > 0) {
+            memcpy(newKeys, poolKeys, sizeof(void*) * poolNum);
+            memcpy(newNames, poolNames, sizeof(char*) * poolNum);
+        }
+        delete[] poolKeys;
+        delete[] poolNames;
+        poolKeys = newKeys;
+        poolNames = newNames;
+        poolSize = newSize;
+    }
+
+    /* pools of the same name are told apart by a suffix */
+    int sameNum = 0;
+    for (int i = 0; i < poolNum; i++) {
+        if (strncmp(poolNames[i], poolName, strlen(poolName)) == 0 &&
+            (poolNames[i][strlen(poolName)] == 0 || poolNames[i][strlen(poolName)] == '#'))
+            sameNum++;
+    }
+
+    char * name = new char[strlen(poolName) + 16];
+    if (sameNum == 0)
+        strcpy(name, poolName);
+    else
+        sprintf(name, "%s#%d", poolName, sameNum + 1);
+
+    poolKeys[poolNum] = pool;
+    poolNames[poolNum] = name;
+
+    return poolNum++;
+}
+
+/*
+get (or create) the counters of a tuple
+>> devID - device id
+>> pool - index of the pool
+>> op - op id
+>> category - the category
+<< return - index of the counters
+*/
+int XMemStat::GetItem(int devID, int pool, int op, int category)
+{
+    int mask = itemIndexSize - 1;
+    int slot = HashMemItem(devID, pool, op, category) & mask;
+
+    while (itemIndex[slot] >= 0) {
+        XMemStatItem &it = items[itemIndex[slot]];
+        if (it.devID == devID && it.pool == pool && it.op == op && it.category == category)
+            return itemIndex[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    if (itemNum == itemSize) {
+        int newSize = itemSize > 0 ? itemSize * 2 : 64;
+        XMemStatItem * newItems = new XMemStatItem[newSize];
+        if (itemNum > 0)
+            memcpy(newItems, items, sizeof(XMemStatItem) * itemNum);
+        delete[] items;
+        items = newItems;
+        itemSize = newSize;
+    }
+
+    XMemStatItem &it = items[itemNum];
+    memset(&it, 0, sizeof(XMemStatItem));
+    it.devID = devID;
+    it.pool = pool;
+    it.op = op;
+    it.category = category;
+    itemIndex[slot] = itemNum++;
+
+    if (itemNum * 2 > itemIndexSize)
+        ResizeItems();
+
+    return itemNum - 1;
+}
+
+/*
+find the slot of a piece of memory
+>> p - the memory
+<< return - the slot of it, or the empty slot where it should go
+*/
+int XMemStat::FindRecord(const void * p)
+{
+    int mask = recordSize - 1;
+    int slot = HashMemAddress(p) & mask;
+
+    while (records[slot].p != NULL && records[slot].p != p)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+/*
+remove the record in a slot. The records after it (in the same run) are moved
+back, so a probe never stops at a hole.
+>> slot - the slot
+*/
+void XMemStat::RemoveRecord(int slot)
+{
+    int mask = recordSize - 1;
+    int hole = slot;
+    int next = (slot + 1) & mask;
+
+    while (records[next].p != NULL) {
+        int home = HashMemAddress(records[next].p) & mask;
+
+        /* move it if its home is not in (hole, next] */
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            records[hole] = records[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    records[hole].p = NULL;
+    recordNum--;
+}
+
+/*
+add bytes to the counters
+>> item - index of the counters
+>> size - number of bytes
+*/
+void XMemStat::Count(int item, MTYPE size)
+{
+    XMemStatItem &it = items[item];
+    int d = GetMemDevIndex(it.devID);
+
+    it.current += size;
+    if (it.peak < it.current)
+        it.peak = it.current;
+
+    current[d] += size;
+    categoryCurrent[d][it.category] += size;
+    if (peak[d] < current[d]) {
+        peak[d] = current[d];
+        memcpy(categoryAtPeak[d], categoryCurrent[d], sizeof(MTYPE) * MEM_CATEGORY_NUM);
+    }
+}
+
+/*
+take bytes from the counters
+>> item - index of the counters
+>> size - number of bytes
+*/
+void XMemStat::Uncount(int item, MTYPE size)
+{
+    XMemStatItem &it = items[item];
+    int d = GetMemDevIndex(it.devID);
+
+    it.current -= size < it.current ? size : it.current;
+    current[d] -= size < current[d] ? size : current[d];
+    categoryCurrent[d][it.category] -= size < categoryCurrent[d][it.category] ?
+                                       size : categoryCurrent[d][it.category];
+}
+
+/* enlarge the hash index of the counters */
+void XMemStat::ResizeItems()
+{
+    delete[] itemIndex;
+    itemIndexSize *= 2;
+    itemIndex = new int[itemIndexSize];
+    memset(itemIndex, -1, sizeof(int) * itemIndexSize);
+
+    int mask = itemIndexSize - 1;
+    for (int i = 0; i < itemNum; i++) {
+        XMemStatItem &it = items[i];
+        int slot = HashMemItem(it.devID, it.pool, it.op, it.category) & mask;
+        while (itemIndex[slot] >= 0)
+            slot = (slot + 1) & mask;
+        itemIndex[slot] = i;
+    }
+}
+
+/*
+rebuild the table of the pieces
+>> size - the new size of the table (a power of 2)
+>> dropPool - the pieces of this pool are released (-1 for none)
+*/
+void XMemStat::RebuildRecords(int size, int dropPool)
+{
+    XMemStatRecord * oldRecords = records;
+    int oldSize = recordSize;
+
+    records = new XMemStatRecord[size];
+    memset(records, 0, sizeof(XMemStatRecord) * size);
+    recordSize = size;
+    recordNum = 0;
+
+    for (int i = 0; i < oldSize; i++) {
+        XMemStatRecord &r = oldRecords[i];
+        if (r.p == NULL)
+            continue;
+        if (items[r.item].pool == dropPool) {
+            Uncount(r.item, r.size);
+            items[r.item].releaseNum++;
+            continue;
+        }
+        records[FindRecord(r.p)] = r;
+        recordNum++;
+    }
+
+    delete[] oldRecords;
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
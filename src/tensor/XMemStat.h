@@ -0,0 +1,250 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * Memory accounting. Every allocation (of a memory pool, of its buffer or of the
+ * global XMemAlloc path) is attributed to a device, a pool, an operation (the
+ * op id of XName that produces the tensor) and a category (parameter, embedding,
+ * activation, gradient, optimizer state or temp buffer). We keep the current and
+ * peak bytes and the allocation counts of each of them, and the numbers can be
+ * dumped to a JSON file at any time. It is off by default, and all the hooks
+ * return at once in this case.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XMEMSTAT_H__
+#define __XMEMSTAT_H__
+
+#include <stdio.h>
+#include "XMem.h"
+#include "XThread.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* devices we account for (the CPU and MAX_GPU_MEM_NUM GPUs) */
+#define MEM_STAT_DEV_NUM (MAX_GPU_MEM_NUM + 1)
+
+/* what a piece of memory is used for */
+enum MEM_CATEGORY {MEM_ACTIVATION, MEM_PARAMETER, MEM_EMBEDDING, MEM_GRADIENT,
+                   MEM_OPTIMIZER, MEM_BUFFER, MEM_CATEGORY_NUM};
+
+/* name of a category */
+const char * GetMemCategoryName(int category);
+
+/* the counters of a (device, pool, op, category) tuple */
+struct XMemStatItem
+{
+    /* device id */
+    int devID;
+
+    /* index of the pool */
+    int pool;
+
+    /* op id (0 if we do not know it) */
+    int op;
+
+    /* category */
+    int category;
+
+    /* bytes in use */
+    MTYPE current;
+
+    /* the max of "current" */
+    MTYPE peak;
+
+    /* number of allocations and releases */
+    MTYPE allocNum;
+    MTYPE releaseNum;
+};
+
+/* a piece of memory in use */
+struct XMemStatRecord
+{
+    /* where the piece starts (NULL for an empty slot) */
+    void * p;
+
+    /* size of the piece */
+    MTYPE size;
+
+    /* index of the item it is counted in */
+    int item;
+};
+
+/* memory accounting */
+class XMemStat
+{
+public:
+    /* indicates whether the accounting is on */
+    bool enabled;
+
+    /* indicates whether we show the summary at exit */
+    bool showAtExit;
+
+    /* the counters */
+    XMemStatItem * items;
+    int itemNum;
+    int itemSize;
+
+    /* hash index of the counters */
+    int * itemIndex;
+    int itemIndexSize;
+
+    /* the pieces in use (open addressing with linear probing) */
+    XMemStatRecord * records;
+    int recordNum;
+    int recordSize;
+
+    /* the pools (a pool is identified by its address) */
+    const void ** poolKeys;
+    char ** poolNames;
+    int poolNum;
+    int poolSize;
+
+    /* bytes in use on each device */
+    MTYPE current[MEM_STAT_DEV_NUM];
+
+    /* the max of "current" */
+    MTYPE peak[MEM_STAT_DEV_NUM];
+
+    /* bytes of each category in use */
+    MTYPE categoryCurrent[MEM_STAT_DEV_NUM][MEM_CATEGORY_NUM];
+
+    /* bytes of each category when a device reaches its peak */
+    MTYPE categoryAtPeak[MEM_STAT_DEV_NUM][MEM_CATEGORY_NUM];
+
+    /* mutex of the tables */
+    MUTEX_HANDLE mutex;
+
+public:
+    /* constructor */
+    XMemStat();
+
+    /* de-constructor */
+    ~XMemStat();
+
+    /* turn on the accounting */
+    void Enable(bool myShowAtExit = true);
+
+    /* turn off the accounting */
+    void Disable();
+
+    /* forget everything */
+    void Clear();
+
+    /* a piece of memory is allocated */
+    void OnAlloc(int devID, const void * pool, const char * poolName, void * p, MTYPE size);
+
+    /* a piece of memory is released */
+    void OnRelease(void * p);
+
+    /* all pieces of a pool are released (at once) */
+    void OnClearPool(const void * pool);
+
+    /* a piece of memory is allocated in the buffer of a pool */
+    void OnAllocBuf(int devID, const void * pool, const char * poolName, MTYPE size);
+
+    /* a piece of memory is released in the buffer of a pool */
+    void OnReleaseBuf(int devID, const void * pool, MTYPE size);
+
+    /* the buffer of a pool is cleared */
+    void OnClearBuf(const void * pool);
+
+    /* set the op of a piece of memory (if it is not set yet) */
+    void SetOp(const void * p, int op);
+
+    /* bytes in use (of a category if category >= 0) */
+    MTYPE GetCurrent(int devID, int category = -1);
+
+    /* peak bytes (of a category at the peak if category >= 0) */
+    MTYPE GetPeak(int devID, int category = -1);
+
+    /* dump a snapshot to a JSON file */
+    bool Dump(const char * file);
+
+    /* show the peak usage */
+    void ShowPeak(FILE * file);
+
+    /* category of the allocations of the current thread */
+    static int GetCategory();
+
+    /* set the category of the allocations of the current thread */
+    static void SetCategory(int category);
+
+protected:
+    /* make the (empty) tables */
+    void InitTables();
+
+    /* get (or create) the index of a pool */
+    int GetPool(const void * pool, const char * poolName);
+
+    /* get (or create) the counters of a tuple */
+    int GetItem(int devID, int pool, int op, int category);
+
+    /* find the slot of a piece of memory */
+    int FindRecord(const void * p);
+
+    /* remove the record in a slot */
+    void RemoveRecord(int slot);
+
+    /* add bytes to the counters */
+    void Count(int item, MTYPE size);
+
+    /* take bytes from the counters */
+    void Uncount(int item, MTYPE size);
+
+    /* enlarge the hash index of the counters */
+    void ResizeItems();
+
+    /* rebuild the table of the pieces (and drop the pieces of a pool if dropPool >= 0) */
+    void RebuildRecords(int size, int dropPool);
+};
+
+/*
+set the category of the allocations of the current thread in a scope, e.g.,
+    XMemCategoryScope scope(MEM_PARAMETER);
+    InitTensor2D(&w, n, m);
+*/
+class XMemCategoryScope
+{
+public:
+    /* the category before the scope */
+    int backup;
+
+    /* constructor */
+    XMemCategoryScope(int category)
+    {
+        backup = XMemStat::GetCategory();
+        XMemStat::SetCategory(category);
+    }
+
+    /* de-constructor */
+    ~XMemCategoryScope()
+    {
+        XMemStat::SetCategory(backup);
+    }
+};
+
+/* the memory accounting of the process */
+extern XMemStat GMemStat;
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
@@ -167,6 +167,8 @@ const char * GetOPName(int type)
     else if ((type & LOSS_BASE) != 0) {
         if (type == LOSS_CROSSENTROPY)
             return "L_CROSSENTROPY";
+        else if (type == LOSS_CROSSENTROPY_LOGITS)
+            return "L_CROSSENTROPY_LOGITS";
     }
     
     return "NULL";
@@ -0,0 +1,617 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "XNuma.h"
+#include "XTensor.h"
+#include "XGlobal.h"
+#include "XUtility.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+/* flags of get_mempolicy (see numaif.h, which is not always installed) */
+#define NUMA_MPOL_F_NODE (1 << 0)
+#define NUMA_MPOL_F_ADDR (1 << 1)
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* max number of the cpus of a line of /sys */
+#define MAX_NUMA_CPU_NUM 4096
+
+/* the node of the current thread (-1 if it is not pinned to a node) */
+static thread_local int threadNode = -1;
+
+/* constructor */
+XNumaTopology::XNumaTopology()
+{
+    nodeNum = 0;
+    cpuNum = 0;
+    nodeOfCPU = NULL;
+    nodeCPUs = NULL;
+    nodeCPUNum = NULL;
+    activeNodeNum = 0;
+    firstNode = 0;
+}
+
+/* de-constructor */
+XNumaTopology::~XNumaTopology()
+{
+    Clear();
+}
+
+/* release the tables */
+void XNumaTopology::Clear()
+{
+    for(int i = 0; i < nodeNum; i++)
+        delete[] nodeCPUs[i];
+    delete[] nodeCPUs;
+    delete[] nodeCPUNum;
+    delete[] nodeOfCPU;
+
+    nodeNum = 0;
+    cpuNum = 0;
+    nodeOfCPU = NULL;
+    nodeCPUs = NULL;
+    nodeCPUNum = NULL;
+    activeNodeNum = 0;
+    firstNode = 0;
+}
+
+/*
+read the first line of a file
+>> fn - the file
+>> line - the buffer
+>> size - size of the buffer
+<< return - whether the line is read
+*/
+bool ReadFirstLine(const char * fn, char * line, int size)
+{
+    FILE * file = fopen(fn, "rb");
+    if(file == NULL)
+        return false;
+
+    bool ok = fgets(line, size, file) != NULL;
+    fclose(file);
+
+    return ok;
+}
+
+/*
+read the topology from /sys/devices/system/node. Only the cpus that the
+process can run on (e.g., in a cpuset) are used. If the nodes are not
+available, all the cpus are put in node 0.
+*/
+void XNumaTopology::Load()
+{
+    Clear();
+
+    /* the cpus we can run on */
+    bool * usable = NULL;
+
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if(sched_getaffinity(0, sizeof(mask), &mask) == 0){
+        for(int i = 0; i < CPU_SETSIZE; i++){
+            if(CPU_ISSET(i, &mask))
+                cpuNum = i + 1;
+        }
+        usable = new bool[cpuNum];
+        for(int i = 0; i < cpuNum; i++)
+            usable[i] = CPU_ISSET(i, &mask) != 0;
+    }
+    else
+        cpuNum = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    cpuNum = MAX(cpuNum, 1);
+
+    if(usable == NULL){
+        usable = new bool[cpuNum];
+        for(int i = 0; i < cpuNum; i++)
+            usable[i] = true;
+    }
+
+    nodeOfCPU = new int[cpuNum];
+    for(int i = 0; i < cpuNum; i++)
+        nodeOfCPU[i] = -1;
+
+    char * line = new char[MAX_NUMA_CPU_NUM * 8];
+    int * items = new int[MAX_NUMA_CPU_NUM];
+    int nodes[MAX_NUMA_NODE_NUM];
+    int num = 0;
+
+    if(ReadFirstLine("/sys/devices/system/node/online", line, MAX_NUMA_CPU_NUM * 8))
+        num = XParseIntList(line, nodes, MAX_NUMA_NODE_NUM);
+
+    for(int i = 0; i < num; i++)
+        nodeNum = MAX(nodeNum, nodes[i] + 1);
+
+    /* the cpus of each node */
+    for(int i = 0; i < num; i++){
+        char fn[256];
+        sprintf(fn, "/sys/devices/system/node/node%d/cpulist", nodes[i]);
+        if(!ReadFirstLine(fn, line, MAX_NUMA_CPU_NUM * 8))
+            continue;
+
+        int cpuCount = XParseIntList(line, items, MAX_NUMA_CPU_NUM);
+        for(int j = 0; j < cpuCount; j++){
+            if(items[j] < cpuNum && usable[items[j]])
+                nodeOfCPU[items[j]] = nodes[i];
+        }
+    }
+
+    /* no node information. We put all the cpus in node 0 */
+    bool found = false;
+    for(int i = 0; i < cpuNum; i++)
+        found = found || nodeOfCPU[i] >= 0;
+
+    if(!found){
+        nodeNum = 1;
+        for(int i = 0; i < cpuNum; i++)
+            nodeOfCPU[i] = usable[i] ? 0 : -1;
+    }
+
+    nodeCPUNum = new int[nodeNum];
+    nodeCPUs = new int*[nodeNum];
+    memset(nodeCPUNum, 0, sizeof(int) * nodeNum);
+
+    for(int i = 0; i < cpuNum; i++){
+        if(nodeOfCPU[i] >= 0)
+            nodeCPUNum[nodeOfCPU[i]]++;
+    }
+
+    activeNodeNum = 0;
+    firstNode = -1;
+    for(int k = 0; k < nodeNum; k++){
+        nodeCPUs[k] = new int[MAX(nodeCPUNum[k], 1)];
+        nodeCPUNum[k] = 0;
+    }
+
+    for(int i = 0; i < cpuNum; i++){
+        int k = nodeOfCPU[i];
+        if(k >= 0)
+            nodeCPUs[k][nodeCPUNum[k]++] = i;
+    }
+
+    for(int k = 0; k < nodeNum; k++){
+        if(nodeCPUNum[k] > 0){
+            if(firstNode < 0)
+                firstNode = k;
+            activeNodeNum++;
+        }
+    }
+
+    firstNode = MAX(firstNode, 0);
+
+    delete[] line;
+    delete[] items;
+    delete[] usable;
+}
+
+/*
+get the node of a cpu
+>> cpu - id of the cpu
+<< return - id of the node (-1 if the cpu is not used)
+*/
+int XNumaTopology::GetNode(int cpu)
+{
+    if(cpu < 0 || cpu >= cpuNum)
+        return -1;
+    return nodeOfCPU[cpu];
+}
+
+/* show the topology */
+void XNumaTopology::Show()
+{
+    XPRINT1(0, stderr, "[NUMA] %d node(s) with cpus\n", activeNodeNum);
+    for(int k = 0; k < nodeNum; k++){
+        if(nodeCPUNum[k] == 0)
+            continue;
+        XPRINT2(0, stderr, "  node %d: %d cpu(s):", k, nodeCPUNum[k]);
+        for(int i = 0; i < nodeCPUNum[k]; i++)
+            XPRINT1(0, stderr, " %d", nodeCPUs[k][i]);
+        XPRINT(0, stderr, "\n");
+    }
+}
+
+/* load the topology */
+XNumaTopology * LoadNumaTopology()
+{
+    XNumaTopology * topology = new XNumaTopology();
+    topology->Load();
+    return topology;
+}
+
+/* the topology of the machine (it is loaded on the first call) */
+XNumaTopology * GetNumaTopology()
+{
+    static XNumaTopology * topology = LoadNumaTopology();
+    return topology;
+}
+
+/*
+parse a list of numbers, e.g., "0,2-3" (the format of /sys)
+>> str - the string
+>> items - the numbers
+>> maxNum - max number of the items
+<< return - number of the items
+*/
+int XParseIntList(const char * str, int * items, int maxNum)
+{
+    int num = 0;
+    const char * p = str;
+
+    while(*p != '\0' && num < maxNum){
+        if(*p < '0' || *p > '9'){
+            p++;
+            continue;
+        }
+
+        char * q = NULL;
+        int first = (int)strtol(p, &q, 10);
+        int last = first;
+        p = q;
+
+        if(*p == '-'){
+            last = (int)strtol(p + 1, &q, 10);
+            p = q;
+        }
+
+        for(int i = first; i <= last && num < maxNum; i++)
+            items[num++] = i;
+    }
+
+    return num;
+}
+
+/*
+parse a list of nodes. A node must have cpus.
+>> spec - the list, e.g., "0,1", "0-1" or "all" (or "") for all the nodes that have cpus
+>> nodes - the nodes
+>> maxNum - max number of the nodes
+<< return - number of the nodes
+*/
+int XParseNumaNodes(const char * spec, int * nodes, int maxNum)
+{
+    XNumaTopology * topology = GetNumaTopology();
+    int num = 0;
+
+    if(spec == NULL || !strcmp(spec, "") || !strcmp(spec, "all")){
+        for(int k = 0; k < topology->nodeNum && num < maxNum; k++){
+            if(topology->nodeCPUNum[k] > 0)
+                nodes[num++] = k;
+        }
+        return num;
+    }
+
+    num = XParseIntList(spec, nodes, maxNum);
+    for(int i = 0; i < num; i++){
+        if(nodes[i] >= topology->nodeNum || topology->nodeCPUNum[nodes[i]] == 0){
+            XPRINT1(0, stderr, "[XParseNumaNodes] Error! No cpu of node %d can be used!\n", nodes[i]);
+            exit(1);
+        }
+    }
+
+    return num;
+}
+
+/*
+pin a thread to a set of cpus
+>> hnd - the thread
+>> cpus - the cpus
+>> cpuNum - number of the cpus
+<< return - succeeded or not
+*/
+bool XPinThread(THREAD_HANDLE hnd, const int * cpus, int cpuNum)
+{
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for(int i = 0; i < cpuNum; i++){
+        if(cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &mask);
+    }
+    return pthread_setaffinity_np(hnd, sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+}
+
+/*
+pin the current thread to a set of cpus
+>> cpus - the cpus
+>> cpuNum - number of the cpus
+<< return - succeeded or not
+*/
+bool XPinCurrentThread(const int * cpus, int cpuNum)
+{
+#if defined(__linux__)
+    return XPinThread(pthread_self(), cpus, cpuNum);
+#else
+    return false;
+#endif
+}
+
+/*
+pin the current thread to the cpus of a node
+>> node - the node
+<< return - succeeded or not
+*/
+bool XPinCurrentThreadToNode(int node)
+{
+    XNumaTopology * topology = GetNumaTopology();
+    CheckNTErrors(node >= 0 && node < topology->nodeNum, "Illegal node!");
+
+    if(!XPinCurrentThread(topology->nodeCPUs[node], topology->nodeCPUNum[node]))
+        return false;
+
+    XSetThreadNode(node);
+    return true;
+}
+
+/*
+set the node of the current thread
+>> node - the node (-1 means unknown)
+*/
+void XSetThreadNode(int node)
+{
+    threadNode = node;
+}
+
+/*
+get the node of the current thread. It is the node that the thread is
+pinned to, or the node of the cpu that the thread runs on.
+*/
+int XGetThreadNode()
+{
+    if(threadNode >= 0)
+        return threadNode;
+
+    XNumaTopology * topology = GetNumaTopology();
+    if(topology->activeNodeNum <= 1)
+        return topology->firstNode;
+
+#if defined(__linux__)
+    int node = topology->GetNode(sched_getcpu());
+    if(node >= 0)
+        return node;
+#endif
+
+    return topology->firstNode;
+}
+
+/*
+get the node that a memory page is on. The page is touched if it is
+not there yet.
+>> p - an address in the page
+<< return - the node (-1 if it is unknown)
+*/
+int XGetPageNode(const void * p)
+{
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    int node = -1;
+    if(syscall(SYS_get_mempolicy, &node, NULL, 0, p, NUMA_MPOL_F_NODE | NUMA_MPOL_F_ADDR) == 0)
+        return node;
+#endif
+    return -1;
+}
+
+/* constructor */
+XNumaReplica::XNumaReplica()
+{
+    source = NULL;
+    sourceTensor = NULL;
+    size = 0;
+    isReady = false;
+    copyNum = 0;
+    firstNode = -1;
+    sourceNode = -1;
+    memset(copies, 0, sizeof(void*) * MAX_NUMA_NODE_NUM);
+    memset(views, 0, sizeof(XTensor*) * MAX_NUMA_NODE_NUM);
+}
+
+/* de-constructor */
+XNumaReplica::~XNumaReplica()
+{
+    Clear();
+}
+
+/* release the copies */
+void XNumaReplica::Clear()
+{
+    for(int k = 0; k < MAX_NUMA_NODE_NUM; k++){
+        if(views[k] != NULL){
+            /* the data is not released by the tensor */
+            views[k]->data = NULL;
+            delete views[k];
+        }
+        /* the source is not ours */
+        if(copies[k] != NULL && k != sourceNode)
+            XMemFree(-1, copies[k]);
+    }
+
+    memset(copies, 0, sizeof(void*) * MAX_NUMA_NODE_NUM);
+    memset(views, 0, sizeof(XTensor*) * MAX_NUMA_NODE_NUM);
+    source = NULL;
+    sourceTensor = NULL;
+    size = 0;
+    isReady = false;
+    copyNum = 0;
+    firstNode = -1;
+    sourceNode = -1;
+}
+
+/*
+make a copy of an array on each node. The source itself is the copy of
+the node it is on (or of the first node if we do not know where it is), so
+N nodes need N - 1 new copies. A new copy is written (first touched) by the
+current thread when it is pinned to the node, and the thread is moved back
+after that. The source is not copied if there is only one node.
+>> data - the data
+>> mySize - size of the data (in bytes)
+>> nodes - the nodes (NULL for all the nodes that have cpus)
+>> nodeNum - number of the nodes
+*/
+void XNumaReplica::Init(void * data, MTYPE mySize, const int * nodes, int nodeNum)
+{
+    Clear();
+
+    source = data;
+    size = mySize;
+    isReady = true;
+
+    int nodeList[MAX_NUMA_NODE_NUM];
+    if(nodes == NULL)
+        nodeNum = XParseNumaNodes("all", nodeList, MAX_NUMA_NODE_NUM);
+    else{
+        nodeNum = MIN(nodeNum, MAX_NUMA_NODE_NUM);
+        memcpy(nodeList, nodes, sizeof(int) * nodeNum);
+    }
+
+    firstNode = nodeNum > 0 ? nodeList[0] : -1;
+
+    if(nodeNum <= 1 || size == 0)
+        return;
+
+#if defined(__linux__)
+    cpu_set_t backup;
+    if(pthread_getaffinity_np(pthread_self(), sizeof(backup), &backup) != 0)
+        return;
+
+    int nodeBackup = threadNode;
+
+    /* the source is used as the copy of its node if the node is in the list */
+    int pageNode = XGetPageNode(source);
+    for(int i = 0; i < nodeNum; i++){
+        if(nodeList[i] == pageNode || (pageNode < 0 && i == 0))
+            sourceNode = nodeList[i];
+    }
+    if(sourceNode >= 0 && sourceNode < MAX_NUMA_NODE_NUM){
+        copies[sourceNode] = source;
+        copyNum++;
+    }
+    else
+        sourceNode = -1;
+
+    for(int i = 0; i < nodeNum; i++){
+        int k = nodeList[i];
+        if(k < 0 || k >= MAX_NUMA_NODE_NUM || copies[k] != NULL)
+            continue;
+
+        if(!XPinCurrentThreadToNode(k))
+            continue;
+
+        copies[k] = XMemAlloc(-1, size);
+        memcpy(copies[k], source, size);
+        copyNum++;
+    }
+
+    pthread_setaffinity_np(pthread_self(), sizeof(backup), &backup);
+    threadNode = nodeBackup;
+
+    if(copyNum > 0 && copies[firstNode] == NULL){
+        for(int k = 0; k < MAX_NUMA_NODE_NUM; k++){
+            if(copies[k] != NULL){
+                firstNode = k;
+                break;
+            }
+        }
+    }
+#endif
+}
+
+/*
+make a copy of a tensor on each node. The copies are viewed as tensors
+of the same shape.
+>> tensor - the tensor (on CPUs)
+>> nodes - the nodes (NULL for all the nodes that have cpus)
+>> nodeNum - number of the nodes
+*/
+void XNumaReplica::Init(XTensor * tensor, const int * nodes, int nodeNum)
+{
+    CheckNTErrors(tensor != NULL && tensor->devID < 0, "The replicas are made for the tensors on CPUs!");
+
+    Init(tensor->data, (MTYPE)tensor->GetDataSizeInChar(), nodes, nodeNum);
+    sourceTensor = tensor;
+
+    for(int k = 0; k < MAX_NUMA_NODE_NUM; k++){
+        if(copies[k] == NULL)
+            continue;
+
+        XTensor * view = new XTensor();
+        view->ShallowCopy(*tensor);
+        view->devID = -1;
+        view->mem = NULL;
+        view->data = copies[k];
+        view->isShared = true;
+        view->isInGlobalMem = false;
+        view->enableGrad = false;
+        views[k] = view;
+    }
+}
+
+/*
+the data of a node
+>> node - the node (-1 for the node of the current thread)
+<< return - the copy of the node, or another copy if the node has none
+*/
+void * XNumaReplica::Get(int node) const
+{
+    if(copyNum == 0)
+        return source;
+
+    if(node < 0)
+        node = XGetThreadNode();
+
+    if(node >= 0 && node < MAX_NUMA_NODE_NUM && copies[node] != NULL)
+        return copies[node];
+
+    return copies[firstNode];
+}
+
+/*
+the tensor of a node
+>> node - the node (-1 for the node of the current thread)
+<< return - the tensor of the node, or another one if the node has none
+*/
+XTensor * XNumaReplica::GetTensor(int node) const
+{
+    if(copyNum == 0)
+        return sourceTensor;
+
+    if(node < 0)
+        node = XGetThreadNode();
+
+    if(node >= 0 && node < MAX_NUMA_NODE_NUM && views[node] != NULL)
+        return views[node];
+
+    return views[firstNode];
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
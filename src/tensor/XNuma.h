@@ -0,0 +1,176 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * NUMA support. The topology (the cores of each node) is read from
+ * /sys/devices/system/node, and the threads can be pinned to the cores of
+ * some nodes. The read-only data (e.g., model weights and embedding tables)
+ * can be replicated on the nodes. A copy is written by a thread that runs on
+ * its node, so its pages are placed there by the first-touch policy of the
+ * kernel, and a thread reads the copy of the node it runs on.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XNUMA_H__
+#define __XNUMA_H__
+
+#include "XThread.h"
+#include "XMem.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+#define MAX_NUMA_NODE_NUM 64
+
+struct XTensor;
+
+/* the NUMA topology of the machine */
+class XNumaTopology
+{
+public:
+    /* number of node ids (the max node id + 1) */
+    int nodeNum;
+
+    /* number of cpu ids (the max cpu id + 1) */
+    int cpuNum;
+
+    /* the node of each cpu (-1 if we cannot run on the cpu) */
+    int * nodeOfCPU;
+
+    /* the cpus of each node (that we can run on) */
+    int ** nodeCPUs;
+
+    /* number of the cpus of each node */
+    int * nodeCPUNum;
+
+    /* number of the nodes that have cpus */
+    int activeNodeNum;
+
+    /* the first node that has cpus */
+    int firstNode;
+
+public:
+    /* constructor */
+    XNumaTopology();
+
+    /* de-constructor */
+    ~XNumaTopology();
+
+    /* release the tables */
+    void Clear();
+
+    /* read the topology from /sys (or make a single node of all the cpus) */
+    void Load();
+
+    /* get the node of a cpu */
+    int GetNode(int cpu);
+
+    /* show the topology */
+    void Show();
+};
+
+/* the topology of the machine (it is loaded on the first call) */
+XNumaTopology * GetNumaTopology();
+
+/* parse a list of numbers, e.g., "0,2-3" (it returns the count) */
+int XParseIntList(const char * str, int * items, int maxNum);
+
+/* parse a list of nodes, e.g., "0,1", "0-1" or "all" (all the nodes that have cpus) */
+int XParseNumaNodes(const char * spec, int * nodes, int maxNum);
+
+/* pin a thread to a set of cpus */
+bool XPinThread(THREAD_HANDLE hnd, const int * cpus, int cpuNum);
+
+/* pin the current thread to a set of cpus */
+bool XPinCurrentThread(const int * cpus, int cpuNum);
+
+/* pin the current thread to the cpus of a node */
+bool XPinCurrentThreadToNode(int node);
+
+/* set the node of the current thread (-1 means unknown) */
+void XSetThreadNode(int node);
+
+/* get the node of the current thread */
+int XGetThreadNode();
+
+/* get the node that a memory page is on (-1 if it is unknown) */
+int XGetPageNode(const void * p);
+
+/*
+a copy of read-only data on each NUMA node. With one node (or none of the
+nodes has cpus), there is no copy and the source is used. Otherwise the
+source is the copy of the node it is on, and the other nodes have new ones.
+*/
+class XNumaReplica
+{
+public:
+    /* the source data */
+    void * source;
+
+    /* the source tensor (NULL if the source is an array) */
+    XTensor * sourceTensor;
+
+    /* size of the data (in bytes) */
+    MTYPE size;
+
+    /* indicates whether the replica is initialized */
+    bool isReady;
+
+    /* the copy of each node (NULL if the node has no copy) */
+    void * copies[MAX_NUMA_NODE_NUM];
+
+    /* the tensor of each copy (if the source is a tensor) */
+    XTensor * views[MAX_NUMA_NODE_NUM];
+
+    /* number of the copies */
+    int copyNum;
+
+    /* the node of the first copy */
+    int firstNode;
+
+    /* the node whose copy is the source (-1 if the source is not a copy) */
+    int sourceNode;
+
+public:
+    /* constructor */
+    XNumaReplica();
+
+    /* de-constructor */
+    ~XNumaReplica();
+
+    /* release the copies */
+    void Clear();
+
+    /* make a copy of an array on each node (all the nodes if nodes == NULL) */
+    void Init(void * data, MTYPE mySize, const int * nodes = NULL, int nodeNum = 0);
+
+    /* make a copy of a tensor (on CPUs) on each node (all the nodes if nodes == NULL) */
+    void Init(XTensor * tensor, const int * nodes = NULL, int nodeNum = 0);
+
+    /* the data of a node (-1 for the node of the current thread) */
+    void * Get(int node = -1) const;
+
+    /* the tensor of a node (-1 for the node of the current thread) */
+    XTensor * GetTensor(int node = -1) const;
+};
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
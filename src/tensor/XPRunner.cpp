@@ -24,8 +24,17 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
+#include <atomic>
 #include "XPRunner.h"
+#include "XNuma.h"
 #include "XGlobal.h"
+#include "XUtility.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 /* the nts (NiuTrans.Tensor) namespace */
 namespace nts{
@@ -63,11 +72,17 @@ XPRunner::XPRunner()
     memset(runningStates, 0 ,sizeof(int) * MAX_THREAD_NUM);
     availableThreads = new int[MAX_THREAD_NUM];
     memset(availableThreads, 0 ,sizeof(int) * MAX_THREAD_NUM);
+
+    /* fork-join */
+    workers = NULL;
+    workerNum = 0;
+    forkJoin = NULL;
 }
 
 /* deconstructor */
 XPRunner::~XPRunner()
 {
+    KillWorkers();
     KillThreads();
     MUTEX_DELE(mutex);
     delete[] runningThreads;
@@ -82,6 +97,7 @@ initialization
 void XPRunner::Init(int myThreadNum)
 {
     CreateThreads(myThreadNum);
+    CreateWorkers(myThreadNum - 1);
 
     if(myThreadNum > 0)
         method = PRUNNER_MULTIPLE;
@@ -258,4 +274,382 @@ int XPRunner::GetJobNum(int size)
     return MIN(jobNum, threadNum);
 }
 
+/****************************
+methods for fork-join
+
+ParallelFor splits a range into chunks, and the workers and the caller take
+the chunks one by one (by an atomic counter) until all of them are done. A job
+is published by increasing "epoch", and the caller waits on "unfinished", the
+number of workers that are still on the job. Both waits spin for a while and
+then sleep on a futex, and a thread is woken only when it is sleeping. There is
+no allocation or lock on the way.
+*/
+
+#define FORK_JOIN_CACHE_LINE_SIZE 64
+
+/* number of chunks of each thread (for load balance) */
+#define FORK_JOIN_CHUNK_NUM 4
+
+/* the descriptor of a worker */
+struct XForkJoinWorker
+{
+    /* the shared state */
+    XForkJoin * shared;
+
+    /* the last job that the worker has seen */
+    int epoch;
+
+    /* the NUMA node that the worker is pinned to (-1 if it is not pinned) */
+    int node;
+
+    /* argument list of the thread */
+    TensorList * argv;
+
+    char pad[FORK_JOIN_CACHE_LINE_SIZE];
+};
+
+/* the state shared by the workers */
+struct XForkJoin
+{
+    /* the job */
+    XRangeFunction func;
+    void * context;
+    int begin;
+    int end;
+    int chunk;
+    int chunkNum;
+
+    char pad0[FORK_JOIN_CACHE_LINE_SIZE];
+
+    /* index of the next chunk to run */
+    std::atomic<int> nextChunk;
+
+    char pad1[FORK_JOIN_CACHE_LINE_SIZE];
+
+    /* id of the current job (the workers sleep on it) */
+    std::atomic<int> epoch;
+
+    /* number of the sleeping workers */
+    std::atomic<int> sleeperNum;
+
+    char pad2[FORK_JOIN_CACHE_LINE_SIZE];
+
+    /* number of the workers that are on the job (the caller sleeps on it) */
+    std::atomic<int> unfinished;
+
+    /* indicates whether the caller is sleeping */
+    std::atomic<int> callerSleeping;
+
+    char pad3[FORK_JOIN_CACHE_LINE_SIZE];
+
+    /* indicates whether a job is running (nested or concurrent calls run in place) */
+    std::atomic<int> busy;
+
+    /* indicates whether the workers stop */
+    std::atomic<int> stop;
+
+    /* number of tries before a thread sleeps (0 if the threads are more than the cores) */
+    int spinNum;
+
+    /* the descriptors of the workers */
+    XForkJoinWorker * descs;
+};
+
+/* spin for a short while */
+inline void ForkJoinPause()
+{
+#if defined(_WIN32)
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* sleep if *word == value */
+inline void ForkJoinSleep(std::atomic<int> * word, int value)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, (int*)word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+    if(word->load() == value)
+        XSleep(1);
+#endif
+}
+
+/* wake the threads that sleep on a word */
+inline void ForkJoinWake(std::atomic<int> * word, int threadNum)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, (int*)word, FUTEX_WAKE_PRIVATE, threadNum, NULL, NULL, 0);
+#endif
+}
+
+/* run the chunks of the current job */
+void RunForkJoinChunks(XForkJoin * fj)
+{
+    while(1){
+        int c = fj->nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if(c >= fj->chunkNum)
+            break;
+
+        long long b = (long long)fj->begin + (long long)c * fj->chunk;
+        long long e = MIN(b + fj->chunk, (long long)fj->end);
+        fj->func(fj->context, (int)b, (int)e);
+    }
+}
+
+/* 
+the loop of a worker 
+>> argv - the descriptor of the worker
+*/
+void RunForkJoinWorker(volatile TensorList * argv)
+{
+    XForkJoinWorker * w = (XForkJoinWorker*)((TensorList*)argv)->GetItem(0);
+    XForkJoin * fj = w->shared;
+
+    while(1){
+        /* wait for a new job */
+        int epoch = fj->epoch.load(std::memory_order_acquire);
+        for(int i = 0; i < fj->spinNum && epoch == w->epoch; i++){
+            ForkJoinPause();
+            epoch = fj->epoch.load(std::memory_order_acquire);
+        }
+
+        if(epoch == w->epoch){
+            fj->sleeperNum++;
+            while((epoch = fj->epoch.load()) == w->epoch)
+                ForkJoinSleep(&fj->epoch, epoch);
+            fj->sleeperNum--;
+        }
+
+        w->epoch = epoch;
+
+        if(fj->stop.load())
+            break;
+
+        XSetThreadNode(w->node);
+
+        RunForkJoinChunks(fj);
+
+        /* the job is done (we do not touch it after that) */
+        if(fj->unfinished.fetch_sub(1) == 1 && fj->callerSleeping.load() > 0)
+            ForkJoinWake(&fj->unfinished, 1);
+    }
+}
+
+/* 
+create the workers of ParallelFor 
+>> wNum - number of the workers
+*/
+void XPRunner::CreateWorkers(int wNum)
+{
+    CheckNTErrors(workers == NULL, "The workers have been created!");
+
+    forkJoin = new XForkJoin();
+    forkJoin->func = NULL;
+    forkJoin->context = NULL;
+    forkJoin->nextChunk.store(0);
+    forkJoin->epoch.store(0);
+    forkJoin->sleeperNum.store(0);
+    forkJoin->unfinished.store(0);
+    forkJoin->callerSleeping.store(0);
+    forkJoin->busy.store(0);
+    forkJoin->stop.store(0);
+    forkJoin->descs = NULL;
+    forkJoin->spinNum = PRUNNER_SPIN_NUM;
+
+    if(wNum <= 0)
+        return;
+
+    /* spinning does not help if a waiting thread holds the core of the one it waits for */
+#if defined(__linux__)
+    if(sysconf(_SC_NPROCESSORS_ONLN) < wNum + 1)
+        forkJoin->spinNum = 0;
+#endif
+
+    workerNum = wNum;
+    workers = new XThread[wNum];
+    forkJoin->descs = new XForkJoinWorker[wNum];
+
+    for(int i = 0; i < wNum; i++){
+        XForkJoinWorker * w = forkJoin->descs + i;
+        w->shared = forkJoin;
+        w->epoch = 0;
+        w->node = -1;
+        w->argv = new TensorList(1);
+        w->argv->Add((XTensor*)w);
+
+        workers[i].function = (TFunction)RunForkJoinWorker;
+        workers[i].argv = w->argv;
+        workers[i].Start();
+        workers[i].LetItGo();
+    }
+}
+
+/* stop the workers of ParallelFor */
+void XPRunner::KillWorkers()
+{
+    if(forkJoin == NULL)
+        return;
+
+    if(workerNum > 0){
+        forkJoin->stop.store(1);
+        forkJoin->epoch++;
+        ForkJoinWake(&forkJoin->epoch, INT_MAX);
+
+        for(int i = 0; i < workerNum; i++){
+            while(workers[i].jobCount > 0)
+                XSleep(1);
+            workers[i].End();
+            delete forkJoin->descs[i].argv;
+        }
+
+        delete[] workers;
+        delete[] forkJoin->descs;
+    }
+
+    delete forkJoin;
+    workers = NULL;
+    workerNum = 0;
+    forkJoin = NULL;
+}
+
+/*
+run func(context, b, e) on the sub-ranges of [begin, end) in parallel. The
+caller is one of the threads, and it returns when all the sub-ranges are done.
+The call runs in place if the range is small (<= grain), or another job is
+running (e.g., ParallelFor is called in a job).
+>> begin - the first item
+>> end - the last item + 1
+>> grain - the min number of items of a sub-range
+>> func - the job
+>> context - the argument of the job
+*/
+void XPRunner::ParallelFor(int begin, int end, int grain, XRangeFunction func, void * context)
+{
+    if(begin >= end)
+        return;
+
+    int n = end - begin;
+    int expected = 0;
+    grain = MAX(grain, 1);
+
+    if(workerNum == 0 || n <= grain || 
+       !forkJoin->busy.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+    {
+        func(context, begin, end);
+        return;
+    }
+
+    XForkJoin * fj = forkJoin;
+    int chunkNum = (workerNum + 1) * FORK_JOIN_CHUNK_NUM;
+
+    fj->func = func;
+    fj->context = context;
+    fj->begin = begin;
+    fj->end = end;
+    fj->chunk = MAX(grain, (int)(((long long)n + chunkNum - 1) / chunkNum));
+    fj->chunkNum = (int)(((long long)n + fj->chunk - 1) / fj->chunk);
+    fj->nextChunk.store(0, std::memory_order_relaxed);
+    fj->unfinished.store(workerNum, std::memory_order_relaxed);
+
+    /* fork */
+    fj->epoch++;
+    if(fj->sleeperNum.load() > 0)
+        ForkJoinWake(&fj->epoch, INT_MAX);
+
+    RunForkJoinChunks(fj);
+
+    /* join */
+    int unfinished = fj->unfinished.load(std::memory_order_acquire);
+    for(int i = 0; i < fj->spinNum && unfinished > 0; i++){
+        ForkJoinPause();
+        unfinished = fj->unfinished.load(std::memory_order_acquire);
+    }
+
+    if(unfinished > 0){
+        fj->callerSleeping.store(1);
+        while((unfinished = fj->unfinished.load()) > 0)
+            ForkJoinSleep(&fj->unfinished, unfinished);
+        fj->callerSleeping.store(0);
+    }
+
+    fj->busy.store(0, std::memory_order_release);
+}
+
+/****************************
+methods for NUMA
+*/
+
+/*
+pin the threads to the cores of some NUMA nodes. The cores are taken from
+the nodes in turn (core 0 of node 0, core 0 of node 1, core 1 of node 0, ...),
+so that a small number of threads are spread over the nodes. The caller (the
+thread 0 of ParallelFor) is pinned to the node of the first core rather than
+to the core, so the threads it creates later are not put on a single core.
+Worker i of ParallelFor takes core i + 1 and the node of the core is the one
+whose data (see XNumaReplica) it reads.
+>> nodes - the nodes
+>> nodeNum - number of the nodes
+<< return - succeeded or not
+*/
+bool XPRunner::Pin(const int * nodes, int nodeNum)
+{
+    XNumaTopology * topology = GetNumaTopology();
+
+    int cpuNum = 0;
+    int maxCPUNum = 0;
+    for(int i = 0; i < nodeNum; i++){
+        CheckNTErrors(nodes[i] >= 0 && nodes[i] < topology->nodeNum, "Illegal node!");
+        cpuNum += topology->nodeCPUNum[nodes[i]];
+        maxCPUNum = MAX(maxCPUNum, topology->nodeCPUNum[nodes[i]]);
+    }
+
+    if(cpuNum == 0)
+        return false;
+
+    int * cpus = new int[cpuNum];
+    int * cpuNodes = new int[cpuNum];
+    int c = 0;
+    for(int j = 0; j < maxCPUNum; j++){
+        for(int i = 0; i < nodeNum; i++){
+            int k = nodes[i];
+            if(j < topology->nodeCPUNum[k]){
+                cpus[c] = topology->nodeCPUs[k][j];
+                cpuNodes[c] = k;
+                c++;
+            }
+        }
+    }
+
+    bool ok = XPinCurrentThreadToNode(cpuNodes[0]);
+
+    for(int i = 0; i < workerNum; i++){
+        int p = (i + 1) % cpuNum;
+        ok = XPinThread(workers[i].hnd, cpus + p, 1) && ok;
+        forkJoin->descs[i].node = cpuNodes[p];
+    }
+
+    for(int i = 0; i < threadNum; i++)
+        ok = XPinThread(threads[i].hnd, cpus + i % cpuNum, 1) && ok;
+
+    delete[] cpus;
+    delete[] cpuNodes;
+
+    return ok;
+}
+
+/*
+pin the threads to the cores of some NUMA nodes
+>> nodeSpec - the nodes, e.g., "0,1", "0-1" or "all"
+<< return - succeeded or not
+*/
+bool XPRunner::Pin(const char * nodeSpec)
+{
+    int nodes[MAX_NUMA_NODE_NUM];
+    int nodeNum = XParseNumaNodes(nodeSpec, nodes, MAX_NUMA_NODE_NUM);
+
+    return Pin(nodes, nodeNum);
+}
+
 } /* end of the nts (NiuTrans.Tensor) namespace */
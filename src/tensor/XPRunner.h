@@ -38,6 +38,22 @@ namespace nts{
 #define PRUNNER_MULTIPLE 1
 #define PRUNNER_GPU 2
 
+/* number of tries before a thread of ParallelFor sleeps */
+#define PRUNNER_SPIN_NUM 2048
+
+/* a job of ParallelFor. It processes items [begin, end) */
+typedef void (*XRangeFunction)(void * context, int begin, int end);
+
+/* call a function object (e.g., a lambda) on [begin, end) */
+template<class F>
+void XCallRange(void * context, int begin, int end)
+{
+    (*(const F*)context)(begin, end);
+}
+
+/* the state shared by the fork-join workers (see XPRunner.cpp) */
+struct XForkJoin;
+
 /*
 The XPRunner maintains a the parallel processing resources, e.g., a pool
 of threads. It can provide the parallel computation interface for someone
@@ -86,6 +102,15 @@ public:
     /* number of available threads */
     int availableThreadNum;
 
+    /* the workers of ParallelFor (threadNum - 1 of them, and the caller is the last one) */
+    XThread * workers;
+
+    /* number of the workers */
+    int workerNum;
+
+    /* the fork-join state and the descriptors of the workers */
+    XForkJoin * forkJoin;
+
 /* general methods */
 public:
     /* constructor */
@@ -110,10 +135,52 @@ public:
 
     /* get the number of parallel jobs to run */
     int GetJobNum(int size);
+
+/* methods for fork-join */
+public:
+    /* create the workers of ParallelFor */
+    void CreateWorkers(int wNum);
+
+    /* stop the workers of ParallelFor */
+    void KillWorkers();
+
+    /* run func(context, b, e) on the sub-ranges of [begin, end) in parallel */
+    void ParallelFor(int begin, int end, int grain, XRangeFunction func, void * context);
+
+    /* 
+    run f(b, e) on the sub-ranges of [begin, end) in parallel, e.g.,
+        runner->ParallelFor(0, n, 1024, [&](int b, int e){
+            for(int i = b; i < e; i++)
+                c[i] = a[i] + b[i];
+        });
+    */
+    template<class F>
+    void ParallelFor(int begin, int end, int grain, const F &f)
+    {
+        ParallelFor(begin, end, grain, &XCallRange<F>, (void*)&f);
+    }
+
+/* methods for NUMA */
+public:
+    /* pin the threads to the cores of some NUMA nodes */
+    bool Pin(const int * nodes, int nodeNum);
+
+    /* pin the threads to the cores of some NUMA nodes, e.g., "0,1", "0-1" or "all" */
+    bool Pin(const char * nodeSpec);
 };
 
 extern XPRunner * globalPRunner;
 
+/* run f(b, e) on the sub-ranges of [begin, end) with globalPRunner (or in this thread) */
+template<class F>
+void XParallelFor(int begin, int end, int grain, const F &f)
+{
+    if(globalPRunner != NULL)
+        globalPRunner->ParallelFor(begin, end, grain, f);
+    else if(begin < end)
+        f(begin, end);
+}
+
 } /* end of the nts (NiuTrans.Tensor) namespace */
 
 #endif
\ No newline at end of file
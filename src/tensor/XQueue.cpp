@@ -55,103 +55,237 @@ JobQueueNode::~JobQueueNode()
 This class provides standard utilities of Queue.
 */
 
-/* constuctor */
+/* spin for a short while */
+inline void QueuePause()
+{
+#if defined(_WIN32)
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* 
+constuctor 
+>> mySize - max number of items in the queue (rounded up to a power of 2)
+*/
 XQueue::XQueue(int mySize)
 {
-    queue = new void*[mySize];
+    CheckNTErrors(mySize > 0 && mySize <= (1 << 30), "Illegal queue size!");
+
+    size = 1;
+    while(size < mySize)
+        size <<= 1;
+    mask = (unsigned int)size - 1;
 
-    memset(queue, 0, sizeof(void*) * mySize);
+    cells = new XQueueCell[size];
+    for(int i = 0; i < size; i++){
+        cells[i].seq.store((unsigned int)i, std::memory_order_relaxed);
+        cells[i].item = NULL;
+    }
 
-    size = mySize;
-    itemCount = 0;
-    head = 0;
-    tail = 0;
+    enqueuePos.store(0);
+    dequeuePos.store(0);
+    parkedProducerNum.store(0);
+    parkedConsumerNum.store(0);
     isJobQueue = false;
+    jobDequeuers = NULL;
+    jobDequeuerNum = 0;
     jobDequeuerArgs = new TensorList(1);
     jobDequeuerBreak = false;
-    runningJobCount = 0;
-    jobStream = NULL;
-    jobStream1 = NULL;
-    jobStream2 = NULL;
+    runningJobCount.store(0);
+    memset(jobStreams, 0, sizeof(XStream*) * MAX_JOB_STREAM_NUM);
     
-    MUTEX_INIT(enqueueMutex);
-    MUTEX_INIT(dequeueMutex);
-    COND_INIT(queueCond);
-    MUTEX_INIT(jobQueueMutex);
+    MUTEX_INIT(parkMutex);
+    COND_INIT(notEmptyCond);
+    COND_INIT(notFullCond);
 }
 
 /* deconstructor */
 XQueue::~XQueue()
 {
-    delete[] queue;
+    delete[] cells;
     delete jobDequeuerArgs;
-    delete jobStream;
-    delete jobStream1;
-    delete jobStream2;
+    for(int i = 0; i < MAX_JOB_STREAM_NUM; i++)
+        delete jobStreams[i];
 
     //if(isJobQueue)
     //    StopJobConsumer();
 
-    MUTEX_DELE(enqueueMutex);
-    MUTEX_DELE(dequeueMutex);
-    COND_DELE(queueCond);
-    MUTEX_DELE(jobQueueMutex);
+    MUTEX_DELE(parkMutex);
+    COND_DELE(notEmptyCond);
+    COND_DELE(notFullCond);
+}
+
+/*
+put an item in the tail of the queue if it is not full. A producer takes
+a position by CAS, and the cell of the position is ready when its sequence
+number equals the position.
+>> item - the item we intend to add into the queue
+<< return - false if the queue is full
+*/
+bool XQueue::TryEnqueue(void * item)
+{
+    unsigned int pos = enqueuePos.load(std::memory_order_relaxed);
+
+    while(1){
+        XQueueCell * cell = cells + (pos & mask);
+        unsigned int seq = cell->seq.load(std::memory_order_acquire);
+        int diff = (int)(seq - pos);
+
+        if(diff == 0){
+            if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                cell->item = item;
+                cell->seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        /* the cell still keeps the item of the last round */
+        else if(diff < 0)
+            return false;
+        else
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+}
+
+/*
+fetch an item from head of the queue if it is not empty. The cell of position
+"pos" keeps an item when its sequence number is pos + 1, and we set the number
+to pos + size after the item is taken, i.e., the cell is free for the next round.
+>> item - the head item of the queue
+<< return - false if the queue is empty
+*/
+bool XQueue::TryDequeue(void ** item)
+{
+    unsigned int pos = dequeuePos.load(std::memory_order_relaxed);
+
+    while(1){
+        XQueueCell * cell = cells + (pos & mask);
+        unsigned int seq = cell->seq.load(std::memory_order_acquire);
+        int diff = (int)(seq - (pos + 1));
+
+        if(diff == 0){
+            if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                *item = cell->item;
+                cell->seq.store(pos + mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        /* no item is put into the cell yet */
+        else if(diff < 0)
+            return false;
+        else
+            pos = dequeuePos.load(std::memory_order_relaxed);
+    }
 }
 
 /* 
-put an item in the tail of the queue 
+put an item in the tail of the queue. We spin for a while if the queue
+is full, and then park until a consumer takes an item.
 >> item - the item we intend to add into the queue
 */
 void XQueue::Enqueue(void * item)
 {
+    bool done = false;
+    for(int i = 0; i < QUEUE_SPIN_NUM && !done; i++){
+        done = TryEnqueue(item);
+        if(!done)
+            QueuePause();
+    }
 
-    MUTEX_LOCK(enqueueMutex);
-    MUTEX_LOCK(dequeueMutex);
+    if(!done){
+        MUTEX_LOCK(parkMutex);
+        parkedProducerNum++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
 
-    CheckNTErrors((itemCount < size), "Put too many items into the queue!");
+        while(!TryEnqueue(item)){
+#ifdef  WIN32
+            MUTEX_UNLOCK(parkMutex);
+#endif
+            COND_WAIT(notFullCond, parkMutex);
+#ifdef  WIN32
+            MUTEX_LOCK(parkMutex);
+#endif
+        }
 
-    queue[tail] = item;
-    tail = (tail + 1) % size;
-    itemCount++;
-    
-    COND_SIGNAL(queueCond);
+        parkedProducerNum--;
+        MUTEX_UNLOCK(parkMutex);
+    }
 
-    MUTEX_UNLOCK(dequeueMutex);
-    MUTEX_UNLOCK(enqueueMutex);
+    WakeConsumer();
 }
 
 /* 
-fetch an item from head of the queue 
+fetch an item from head of the queue. We spin for a while if the queue
+is empty, and then park until a producer puts an item.
 << return - the head item of the queue
 */
 void * XQueue::Dequeue()
 {
-    MUTEX_LOCK(dequeueMutex);
+    void * r = NULL;
+    bool done = false;
+    for(int i = 0; i < QUEUE_SPIN_NUM && !done; i++){
+        done = TryDequeue(&r);
+        if(!done)
+            QueuePause();
+    }
 
-    while(itemCount == 0)
-    {
+    if(!done){
+        MUTEX_LOCK(parkMutex);
+        parkedConsumerNum++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        while(!TryDequeue(&r)){
 #ifdef  WIN32
-        MUTEX_UNLOCK(dequeueMutex);
+            MUTEX_UNLOCK(parkMutex);
 #endif
-        COND_WAIT(queueCond, dequeueMutex);
+            COND_WAIT(notEmptyCond, parkMutex);
 #ifdef  WIN32
-        MUTEX_LOCK(dequeueMutex);
+            MUTEX_LOCK(parkMutex);
 #endif
-    }
+        }
 
-    void * r = queue[head];
-    head = (head + 1) % size;
-    itemCount--;
+        parkedConsumerNum--;
+        MUTEX_UNLOCK(parkMutex);
+    }
 
-    MUTEX_UNLOCK(dequeueMutex);
+    WakeProducer();
 
     return r;
 }
 
+/* 
+wake a parked consumer (if any). A consumer parks after it increases
+parkedConsumerNum and then fails to fetch an item (both under parkMutex), and
+the fences make sure that either it sees our item or we see it parked.
+*/
+void XQueue::WakeConsumer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(parkedConsumerNum.load(std::memory_order_relaxed) > 0){
+        MUTEX_LOCK(parkMutex);
+        COND_SIGNAL(notEmptyCond);
+        MUTEX_UNLOCK(parkMutex);
+    }
+}
+
+/* wake a parked producer (if any) */
+void XQueue::WakeProducer()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(parkedProducerNum.load(std::memory_order_relaxed) > 0){
+        MUTEX_LOCK(parkMutex);
+        COND_SIGNAL(notFullCond);
+        MUTEX_UNLOCK(parkMutex);
+    }
+}
+
 /* return if the queue is empty */
 bool XQueue::IsEmpty()
 {
-    return itemCount == 0;
+    return (int)(enqueuePos.load() - dequeuePos.load()) <= 0;
 }
 
 /* wait until the queue is empty */
@@ -161,17 +295,11 @@ void XQueue::WaitForEmptyJobQueue()
         XSleep(10);
     }
 
-    if(jobStream != NULL){
-        CheckNTErrors((jobStream->IsFinished()), "None fineished jobs remain");
-        jobStream->Clear();
-    }
-    if(jobStream1 != NULL){
-        CheckNTErrors((jobStream1->IsFinished()), "None fineished jobs remain");
-        jobStream1->Clear();
-    }
-    if(jobStream2 != NULL){
-        CheckNTErrors((jobStream2->IsFinished()), "None fineished jobs remain");
-        jobStream2->Clear();
+    for(int i = 0; i < MAX_JOB_STREAM_NUM; i++){
+        if(jobStreams[i] != NULL){
+            CheckNTErrors((jobStreams[i]->IsFinished()), "None fineished jobs remain");
+            jobStreams[i]->Clear();
+        }
     }
 }
 
@@ -179,45 +307,58 @@ int devids[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
 int cpuid = -1;
 
 /* 
-run job consumer (in another thread) 
+run job consumers (in other threads) 
 >> jobDevID - id of the device for running the jobs
+>> consumerNum - number of the consumers
 */
-void XQueue::RunJobConsumer(int jobDevID)
+void XQueue::RunJobConsumer(int jobDevID, int consumerNum)
 {
     CheckNTErrors((jobDevID < 16), "device id is out of scope!");
+    CheckNTErrors((consumerNum > 0 && consumerNum <= MAX_JOB_CONSUMER_NUM), "Illegal consumer number!");
+    CheckNTErrors((jobDequeuers == NULL), "The consumers are running!");
 
     isJobQueue = true;
+    jobDequeuerBreak = false;
     jobDequeuerArgs->Clear();
 
     // warning: this may cause unknown error
     jobDequeuerArgs->Add((XTensor*)this);
     jobDequeuerArgs->Add(jobDevID >= 0 ? (XTensor*)(devids + jobDevID) : (XTensor*)&cpuid);
 
-    jobDequeuer.function = (TFunction)DequeueJobs;
-    jobDequeuer.argv = jobDequeuerArgs;
+    jobDequeuers = new XThread[consumerNum];
+    jobDequeuerNum = consumerNum;
+
+    for(int i = 0; i < consumerNum; i++){
+        jobDequeuers[i].function = (TFunction)DequeueJobs;
+        jobDequeuers[i].argv = jobDequeuerArgs;
 
-    jobDequeuer.Start();
-    jobDequeuer.LetItGo();
+        jobDequeuers[i].Start();
+        jobDequeuers[i].LetItGo();
+    }
 }
 
-/* stop the job consumer */
+/* stop the job consumers (after the jobs in the queue are done) */
 void XQueue::StopJobConsumer()
 {
     jobDequeuerBreak = true;
-    XSleep(10);
 
-    EnqueueJob(NULL, NULL);
+    /* a NULL item stops a consumer */
+    for(int i = 0; i < jobDequeuerNum; i++)
+        Enqueue(NULL);
+
+    for(int i = 0; i < jobDequeuerNum; i++)
+        jobDequeuers[i].End();
 
-    jobDequeuer.End();
+    delete[] jobDequeuers;
+    jobDequeuers = NULL;
+    jobDequeuerNum = 0;
     isJobQueue = false;
 }
 
 /* add a job item to process */
 void XQueue::EnqueueJob(void * job, TensorList * jobArgs)
 {
-    MUTEX_LOCK(jobQueueMutex);
     runningJobCount++;
-    MUTEX_UNLOCK(jobQueueMutex);
 
     JobQueueNode * node = new JobQueueNode();
     node->job = job;
@@ -234,28 +375,25 @@ void XQueue::DequeueJobs(TensorList * args)
     XQueue * q = (XQueue*)args->GetItem(0);
     int devID = *(int*)args->GetItem(1);
 
-    int devIDBackup = XDevice::GetGPUDevice();
+    int devIDBackup = -1;
 
-    if(devID >= 0)
+    if(devID >= 0){
+        devIDBackup = XDevice::GetGPUDevice();
         XDevice::SetGPUDevice(devID);
+    }
 
     while(1){
         JobQueueNode * node = (JobQueueNode*)q->Dequeue();
 
-        if(q->GetJobBreak())
+        if(node == NULL)
             break;
 
-        CheckNTErrors((node != NULL), "Illegal job!");
-
         /* process a job */
         ((TFunction)node->job)(node->args);
 
         delete node;
 
-        MUTEX_LOCK(q->jobQueueMutex);
         q->runningJobCount--;
-        MUTEX_UNLOCK(q->jobQueueMutex);
-
     }
 
     if(devID >= 0)
@@ -271,28 +409,32 @@ bool XQueue::GetJobBreak()
 /* get job stream */
 XStream * XQueue::GetJobStream(int n)
 {
-    if(n == 0)
-        return jobStream;
-    else if(n == 1)
-        return jobStream1;
-    else if(n == 2)
-        return jobStream2;
-    else{
-        ShowNTErrors("invalid stream id!");
-    }
+    CheckNTErrors((n >= 0 && n < MAX_JOB_STREAM_NUM), "invalid stream id!");
 
-    return NULL;
+    return jobStreams[n];
 }
 
 /* make job streams */
 void XQueue::MakeJobStreams(int devID, int devID1, int devID2)
 {
-    if(devID != INVALID_DEVICE_ID)
-        jobStream = new XStream(0, devID);
-    if(devID1 != INVALID_DEVICE_ID)
-        jobStream1 = new XStream(0, devID1);
-    if(devID2 != INVALID_DEVICE_ID)
-        jobStream2 = new XStream(0, devID2);
+    MakeJobStream(0, devID);
+    MakeJobStream(1, devID1);
+    MakeJobStream(2, devID2);
+}
+
+/* 
+make a job stream 
+>> n - index of the stream
+>> devID - the device of the stream
+*/
+void XQueue::MakeJobStream(int n, int devID)
+{
+    CheckNTErrors((n >= 0 && n < MAX_JOB_STREAM_NUM), "invalid stream id!");
+
+    if(devID != INVALID_DEVICE_ID){
+        delete jobStreams[n];
+        jobStreams[n] = new XStream(0, devID);
+    }
 }
 
 } /* end of the nts (NiuTrans.Tensor) namespace */
@@ -20,6 +20,12 @@
  * This is an implementation of queue. Actually we intend to use it to maintain
  * a priority job list
  *
+ * The queue is a bounded lock-free ring that any number of threads can put items
+ * into and fetch items from (see "Bounded MPMC queue", Dmitry Vyukov). Each cell
+ * has a sequence number that tells whether it is ready for the next producer or the
+ * next consumer, so threads only compete for a counter (by CAS) rather than a lock.
+ * A thread that finds the queue empty (or full) spins for a while and then parks
+ * on a condition variable.
  *
  * $Created by: XIAO Tong (xiaotong@mail.neu.edu.cn) 2017-04-05
  * I came back from the holiday - while Tongran and Dingdang are still in Beijing
@@ -31,6 +37,7 @@
 #ifndef __XQUEUE_H__
 #define __XQUEUE_H__
 
+#include <atomic>
 #include "XGlobal.h"
 #include "XThread.h"
 #include "XStream.h"
@@ -41,6 +48,14 @@
 namespace nts{
 
 #define MAX_QUEUE_SIZE 1024 * 8
+#define MAX_JOB_STREAM_NUM 16
+#define MAX_JOB_CONSUMER_NUM 64
+
+/* number of tries before a thread parks */
+#define QUEUE_SPIN_NUM 1024
+
+/* size of a cache line (to keep the counters apart) */
+#define QUEUE_CACHE_LINE_SIZE 64
 
 /*
 job item used in queues
@@ -62,44 +77,65 @@ public:
     ~JobQueueNode();
 };
 
+/* a cell of the queue */
+struct XQueueCell
+{
+    /* sequence number. It is pos if the cell is free for the producer at "pos",
+       and pos + 1 if it keeps an item for the consumer at "pos" */
+    std::atomic<unsigned int> seq;
+
+    /* the item */
+    void * item;
+};
+
 /*
 This class provides standard utilities of Queue.
 */
 class XQueue
 {
 private:
-    /* mutex for the enqueue process */
-    MUTEX_HANDLE enqueueMutex;
+    /* the cells of the queue */
+    XQueueCell * cells;
 
-    /* mutex for the dequeue process */
-    MUTEX_HANDLE dequeueMutex;
+    /* size - 1 (the size is a power of 2) */
+    unsigned int mask;
 
-    /* conditional mutex for the dequeue process */
-    COND_HANDLE  queueCond;
+    /* max size of the queue */
+    int size;
 
-    /* mutex for the job queue */
-    MUTEX_HANDLE jobQueueMutex;
+    char pad0[QUEUE_CACHE_LINE_SIZE];
 
-    /* the array for the queue */
-    void ** queue;
+    /* position of the next producer */
+    std::atomic<unsigned int> enqueuePos;
 
-    /* max size of the queue */
-    int size;
+    char pad1[QUEUE_CACHE_LINE_SIZE];
 
-    /* number of item in queue */
-    int itemCount;
+    /* position of the next consumer */
+    std::atomic<unsigned int> dequeuePos;
 
-    /* head of the queue */
-    int head;
+    char pad2[QUEUE_CACHE_LINE_SIZE];
 
-    /* tail of the queue */
-    int tail;
+    /* number of parked producers and consumers */
+    std::atomic<int> parkedProducerNum;
+    std::atomic<int> parkedConsumerNum;
+
+    /* mutex for the parked threads */
+    MUTEX_HANDLE parkMutex;
+
+    /* conditional mutex for the dequeue process */
+    COND_HANDLE  notEmptyCond;
+
+    /* conditional mutex for the enqueue process */
+    COND_HANDLE  notFullCond;
 
     /* indicates whether we are using a job queue */
     bool isJobQueue;
 
     /* consume the job items in the queue */
-    XThread jobDequeuer;
+    XThread * jobDequeuers;
+
+    /* number of the job consumers */
+    int jobDequeuerNum;
 
     /* argument list of jobDequeuer */
     TensorList * jobDequeuerArgs;
@@ -108,12 +144,10 @@ private:
     bool jobDequeuerBreak;
 
     /* running job count */
-    int runningJobCount;
+    std::atomic<int> runningJobCount;
 
-    /* job streams (we think that three streams is enough :)) */
-    XStream * jobStream;
-    XStream * jobStream1;
-    XStream * jobStream2;
+    /* job streams */
+    XStream * jobStreams[MAX_JOB_STREAM_NUM];
 
 public:
     /* constuctor */
@@ -122,12 +156,18 @@ public:
     /* deconstructor */
     ~XQueue();
 
-    /* put an item in the tail of the queue */
+    /* put an item in the tail of the queue (wait if the queue is full) */
     void Enqueue(void * item);
 
-    /* fetch an item from head of the queue */
+    /* fetch an item from head of the queue (wait if the queue is empty) */
     void * Dequeue();
 
+    /* put an item in the tail of the queue if it is not full */
+    bool TryEnqueue(void * item);
+
+    /* fetch an item from head of the queue if it is not empty */
+    bool TryDequeue(void ** item);
+
     /* return if the queue is empty */
     bool IsEmpty();
 
@@ -135,7 +175,7 @@ public:
     void WaitForEmptyJobQueue();
 
     /* run the job consumer */
-    void RunJobConsumer(int jobDevID = 0);
+    void RunJobConsumer(int jobDevID = 0, int consumerNum = 1);
 
     /* stop the job consumer */
     void StopJobConsumer();
@@ -155,8 +195,18 @@ public:
 
     /* make job streams */
     void MakeJobStreams(int devID = INVALID_DEVICE_ID, int devID1 = INVALID_DEVICE_ID, int devID2 = INVALID_DEVICE_ID);
+
+    /* make a job stream */
+    void MakeJobStream(int n, int devID);
+
+private:
+    /* wake a parked consumer (if any) */
+    void WakeConsumer();
+
+    /* wake a parked producer (if any) */
+    void WakeProducer();
 };
 
 } /* end of the nts (NiuTrans.Tensor) namespace */
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,337 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <math.h>
+#include <atomic>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "XRand.h"
+#include "XGlobal.h"
+#include "XPRunner.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* constants of Philox-4x32 */
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUND_NUM 10
+
+/* number of items that are processed by a job (a multiple of 4) */
+#define RAND_BLOCK_SIZE 4096
+
+/*
+the blocks run in the integer vectors that the compiler is allowed to use. All
+instruction sets give the same numbers, so (unlike XElementWise) there is no
+need to choose one when the program runs
+*/
+#if defined(__AVX512F__)
+#define RAND_AVX512
+#define RAND_SIMD_NUM 16
+#elif defined(__AVX2__)
+#define RAND_AVX2
+#define RAND_SIMD_NUM 8
+#else
+#define RAND_SIMD_NUM 1
+#endif
+
+/* the seed of the default generator */
+static unsigned long long randSeed = 1;
+
+/* number of streams made by the default generator */
+static std::atomic<unsigned int> randDrawNum(0);
+
+/*
+set the seed of the default generator. The streams made after it
+are the same for the same seed.
+>> seed - the seed
+*/
+void XRandSeed(unsigned long long seed)
+{
+    randSeed = seed;
+    randDrawNum = 0;
+}
+
+/*
+a new stream of the default generator for a tensor. The numbers depend
+on the seed, the tensor id and the number of streams made before, so a
+tensor gets new numbers each time it is filled.
+>> id - the tensor id
+<< return - the stream
+*/
+XRandStream XRandNewStream(int id)
+{
+    XRandStream s = XRandSeededStream(randSeed, id);
+    s.stream[1] = randDrawNum++;
+    return s;
+}
+
+/*
+the stream of a given seed
+>> seed - the seed
+>> id - the tensor id (or any number to tell the streams of a seed apart)
+<< return - the stream
+*/
+XRandStream XRandSeededStream(unsigned long long seed, int id)
+{
+    XRandStream s;
+    s.key[0] = (unsigned int)seed;
+    s.key[1] = (unsigned int)(seed >> 32);
+    s.stream[0] = (unsigned int)id;
+    s.stream[1] = 0;
+    return s;
+}
+
+/*
+four random numbers of a block. The counter is (block, stream) and the key is
+the seed. There are 10 rounds, and in each round
+(c0, c1, c2, c3) <- (hi(M1 * c2) ^ c1 ^ k0, lo(M1 * c2), hi(M0 * c0) ^ c3 ^ k1, lo(M0 * c0))
+>> s - the stream
+>> block - index of the block (item i of an array is in block i / 4)
+>> r - the random numbers
+*/
+void Philox4x32(const XRandStream &s, unsigned long long block, unsigned int r[4])
+{
+    unsigned int c0 = (unsigned int)block;
+    unsigned int c1 = (unsigned int)(block >> 32);
+    unsigned int c2 = s.stream[0];
+    unsigned int c3 = s.stream[1];
+    unsigned int k0 = s.key[0];
+    unsigned int k1 = s.key[1];
+
+    for (int i = 0; i < PHILOX_ROUND_NUM; i++) {
+        unsigned long long p0 = (unsigned long long)PHILOX_M0 * c0;
+        unsigned long long p1 = (unsigned long long)PHILOX_M1 * c2;
+        c0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (unsigned int)p1;
+        c3 = (unsigned int)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    r[0] = c0;
+    r[1] = c1;
+    r[2] = c2;
+    r[3] = c3;
+}
+
+#if defined(RAND_AVX512)
+
+typedef __m512i VInt;
+
+inline VInt VIntSet(unsigned int a) { return _mm512_set1_epi32((int)a); }
+inline VInt VIntXor(VInt a, VInt b) { return _mm512_xor_si512(a, b); }
+inline VInt VIntLanes() { return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); }
+inline VInt VIntAdd(VInt a, VInt b) { return _mm512_add_epi32(a, b); }
+inline void VIntStore(unsigned int * p, VInt a) { _mm512_storeu_si512((void*)p, a); }
+
+/* the high and low words of a * m for each lane */
+inline void VMulHiLo(VInt a, VInt m, VInt &hi, VInt &lo)
+{
+    VInt even = _mm512_mul_epu32(a, m);
+    VInt odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+    lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+    hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+}
+
+#elif defined(RAND_AVX2)
+
+typedef __m256i VInt;
+
+inline VInt VIntSet(unsigned int a) { return _mm256_set1_epi32((int)a); }
+inline VInt VIntXor(VInt a, VInt b) { return _mm256_xor_si256(a, b); }
+inline VInt VIntLanes() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+inline VInt VIntAdd(VInt a, VInt b) { return _mm256_add_epi32(a, b); }
+inline void VIntStore(unsigned int * p, VInt a) { _mm256_storeu_si256((VInt*)p, a); }
+
+/* the high and low words of a * m for each lane */
+inline void VMulHiLo(VInt a, VInt m, VInt &hi, VInt &lo)
+{
+    VInt even = _mm256_mul_epu32(a, m);
+    VInt odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+#endif
+
+/*
+the random numbers of RAND_SIMD_NUM successive blocks. A lane of the vectors runs
+the rounds of a block, and the results are in the same order as Philox4x32(...)
+gives them block by block.
+>> s - the stream
+>> block - index of the first block (the blocks are below 2^32)
+>> r - the random numbers (4 * RAND_SIMD_NUM)
+*/
+static void PhiloxBlocks(const XRandStream &s, unsigned long long block, unsigned int * r)
+{
+#if defined(RAND_AVX512) || defined(RAND_AVX2)
+    VInt c0 = VIntAdd(VIntSet((unsigned int)block), VIntLanes());
+    VInt c1 = VIntSet((unsigned int)(block >> 32));
+    VInt c2 = VIntSet(s.stream[0]);
+    VInt c3 = VIntSet(s.stream[1]);
+    VInt m0 = VIntSet(PHILOX_M0);
+    VInt m1 = VIntSet(PHILOX_M1);
+    unsigned int k0 = s.key[0];
+    unsigned int k1 = s.key[1];
+
+    for (int i = 0; i < PHILOX_ROUND_NUM; i++) {
+        VInt hi0, lo0, hi1, lo1;
+        VMulHiLo(c0, m0, hi0, lo0);
+        VMulHiLo(c2, m1, hi1, lo1);
+        c0 = VIntXor(VIntXor(hi1, c1), VIntSet(k0));
+        c2 = VIntXor(VIntXor(hi0, c3), VIntSet(k1));
+        c1 = lo1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    unsigned int words[4][RAND_SIMD_NUM];
+    VIntStore(words[0], c0);
+    VIntStore(words[1], c1);
+    VIntStore(words[2], c2);
+    VIntStore(words[3], c3);
+
+    for (int l = 0; l < RAND_SIMD_NUM; l++) {
+        r[4 * l] = words[0][l];
+        r[4 * l + 1] = words[1][l];
+        r[4 * l + 2] = words[2][l];
+        r[4 * l + 3] = words[3][l];
+    }
+#else
+    Philox4x32(s, block, r);
+#endif
+}
+
+/* a random number in [0, 1) */
+inline float RandToUniform(unsigned int x, float *) { return (x >> 8) * (1.0F / 16777216.0F); }
+inline double RandToUniform(unsigned int x, double *) { return x * (1.0 / 4294967296.0); }
+
+/*
+turn random numbers into items of a distribution
+>> dist - the distribution
+>> r - the random numbers (4 for each block)
+>> d - the items
+>> n - number of the items
+>> a - the lower bound (uniform), the mean (normal) or the probability of 0 (bernoulli)
+>> b - the upper bound (uniform), the standard deviation (normal) or the non-zero value (bernoulli)
+*/
+template<class T>
+void RandTransform(RAND_DIST dist, const unsigned int * r, T * d, int n, T a, T b)
+{
+    if (dist == RAND_UNIFORM) {
+        T range = b - a;
+        for (int i = 0; i < n; i++)
+            d[i] = a + range * RandToUniform(r[i], d);
+    }
+    else if (dist == RAND_BERNOULLI) {
+        for (int i = 0; i < n; i++)
+            d[i] = RandToUniform(r[i], d) >= a ? b : 0;
+    }
+    else if (dist == RAND_NORMAL) {
+        /* Box-Muller on the pairs of a block */
+        const T pi2 = (T)6.283185307179586;
+        for (int i = 0; i < n; i += 2) {
+            T u1 = (T)1.0 - RandToUniform(r[i], d);
+            T u2 = RandToUniform(r[i + 1], d);
+            T radius = sqrt((T)-2.0 * log(u1)) * b;
+            d[i] = a + radius * cos(pi2 * u2);
+            if (i + 1 < n)
+                d[i + 1] = a + radius * sin(pi2 * u2);
+        }
+    }
+}
+
+/*
+fill items [begin, end) of an array. begin is a multiple of 4, so an item
+is always made from the same block (and the same pair of numbers for
+the normal distribution) whoever fills it.
+*/
+template<class T>
+void RandFillRange(const XRandStream &s, RAND_DIST dist, T * d, int begin, int end, T a, T b)
+{
+    unsigned int r[4 * RAND_SIMD_NUM];
+
+    for (int i = begin; i < end; i += 4 * RAND_SIMD_NUM) {
+        unsigned long long block = (unsigned long long)(i / 4);
+        int m = MIN(4 * RAND_SIMD_NUM, end - i);
+
+        if (m == 4 * RAND_SIMD_NUM)
+            PhiloxBlocks(s, block, r);
+        else {
+            for (int k = 0; 4 * k < m; k++)
+                Philox4x32(s, block + k, r + 4 * k);
+        }
+
+        RandTransform(dist, r, d + i, m, a, b);
+    }
+}
+
+/* fill an array in parallel (a job takes RAND_BLOCK_SIZE items at least) */
+template<class T>
+void RandFill(const XRandStream &s, RAND_DIST dist, T * d, int n, T a, T b)
+{
+    if (n <= 0)
+        return;
+
+    int blockNum = (n + RAND_BLOCK_SIZE - 1) / RAND_BLOCK_SIZE;
+
+    XParallelFor(0, blockNum, 1, [&](int begin, int end) {
+        RandFillRange(s, dist, d, begin * RAND_BLOCK_SIZE, (int)MIN((long long)end * RAND_BLOCK_SIZE, (long long)n), a, b);
+    });
+}
+
+/*
+fill an array with random numbers (in parallel). Item i of the array is made
+from block i / 4 of the stream, so the results do not depend on the number of
+threads.
+>> s - the stream
+>> dist - the distribution
+>> d - the array
+>> n - number of items
+>> a - the lower bound (uniform), the mean (normal) or the probability of 0 (bernoulli)
+>> b - the upper bound (uniform), the standard deviation (normal) or the non-zero value (bernoulli)
+*/
+void XRandFill(const XRandStream &s, RAND_DIST dist, float * d, int n, float a, float b)
+{
+    RandFill(s, dist, d, n, a, b);
+}
+
+/*
+fill an array with random numbers (in parallel)
+>> s - the stream
+>> dist - the distribution
+>> d - the array
+>> n - number of items
+>> a - the lower bound (uniform), the mean (normal) or the probability of 0 (bernoulli)
+>> b - the upper bound (uniform), the standard deviation (normal) or the non-zero value (bernoulli)
+*/
+void XRandFill(const XRandStream &s, RAND_DIST dist, double * d, int n, double a, double b)
+{
+    RandFill(s, dist, d, n, a, b);
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
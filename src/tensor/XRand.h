@@ -0,0 +1,70 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * A counter-based random number generator (Philox-4x32-10, see "Parallel random
+ * numbers: as easy as 1, 2, 3", Salmon et al., SC 2011). A random number is a
+ * function of a key and a counter rather than of a hidden state, so item i of an
+ * array is computed from (seed, tensor id, i) alone. The arrays are filled in
+ * parallel (and with SIMD), and the results are the same for any number of
+ * threads.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XRAND_H__
+#define __XRAND_H__
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* distributions */
+enum RAND_DIST {RAND_UNIFORM, RAND_NORMAL, RAND_BERNOULLI};
+
+/* a stream of random numbers, i.e., the key and the high words of the counter */
+struct XRandStream
+{
+    /* the key (the seed) */
+    unsigned int key[2];
+
+    /* the high words of the counter (the tensor id and the draw number) */
+    unsigned int stream[2];
+};
+
+/* set the seed of the default generator */
+void XRandSeed(unsigned long long seed);
+
+/* a new stream of the default generator for a tensor (each call gives another one) */
+XRandStream XRandNewStream(int id);
+
+/* the stream of a given seed. The same seed always gives the same numbers */
+XRandStream XRandSeededStream(unsigned long long seed, int id = 0);
+
+/* four random numbers of block "block" of a stream */
+void Philox4x32(const XRandStream &s, unsigned long long block, unsigned int r[4]);
+
+/* fill an array with random numbers (in parallel) */
+void XRandFill(const XRandStream &s, RAND_DIST dist, float * d, int n, float a, float b);
+
+/* fill an array with random numbers (in parallel) */
+void XRandFill(const XRandStream &s, RAND_DIST dist, double * d, int n, double a, double b);
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
@@ -0,0 +1,258 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * The sort engine on CPUs (see XSort.h). A row is copied into a buffer of
+ * (key, position) pairs, the pairs are sorted by key, and the values and
+ * indices are put back by the positions.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include "XSort.h"
+#include "XGlobal.h"
+#include "XPRunner.h"
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/* the largest row that is sorted by ranks */
+#define XSORT_SMALL_NUM 64
+
+/* number of items a thread processes at least */
+#define XSORT_GRAIN 16384
+
+/* number of items of a chunk of a long row (the chunks run on different threads) */
+#define XSORT_CHUNK 65536
+
+/* the max number of chunks of a row */
+#define XSORT_MAX_CHUNK_NUM 64
+
+/* number of bits of a digit of radix sort */
+#define XSORT_RADIX_BITS 8
+#define XSORT_RADIX (1 << XSORT_RADIX_BITS)
+
+/* the unsigned key of a float. A larger float has a larger key, and -0 is 0 */
+inline uint32_t XSortKey(float x)
+{
+    uint32_t u;
+    x = x == 0 ? 0.0F : x;
+    memcpy(&u, &x, sizeof(float));
+    return u ^ ((uint32_t)((int32_t)u >> 31) | 0x80000000U);
+}
+
+/* the unsigned key of an int */
+inline uint32_t XSortKey(int x)
+{
+    return (uint32_t)x ^ 0x80000000U;
+}
+
+/*
+sort a short row by ranks. The rank of an item is the number of items before
+it, and it is counted by comparing the item with all of the others. The key and
+the position are packed into 64 bits, so there are no ties
+>> key - the keys
+>> pos - the positions of the items (the result is put here)
+>> num - number of items
+*/
+void XSortByRank(const uint32_t * key, int * pos, int num)
+{
+    uint64_t packed[XSORT_SMALL_NUM];
+    int posCopy[XSORT_SMALL_NUM];
+
+    for(int i = 0; i < num; i++){
+        packed[i] = ((uint64_t)key[i] << 32) | (uint32_t)i;
+        posCopy[i] = pos[i];
+    }
+
+    for(int i = 0; i < num; i++){
+        uint64_t p = packed[i];
+        int rank = 0;
+        for(int j = 0; j < num; j++)
+            rank += packed[j] < p;
+        pos[rank] = posCopy[i];
+    }
+}
+
+/*
+sort a row by LSD radix sort (stable)
+>> key - the keys
+>> pos - the positions of the items (the result is put here)
+>> num - number of items
+>> key2 - a buffer of num keys
+>> pos2 - a buffer of num positions
+*/
+void XSortByRadix(uint32_t * key, int * pos, int num, uint32_t * key2, int * pos2)
+{
+    int chunkNum = MAX(1, MIN(XSORT_MAX_CHUNK_NUM, num / XSORT_CHUNK));
+    int chunkSize = (num + chunkNum - 1) / chunkNum;
+    int * count = new int[chunkNum * XSORT_RADIX];
+
+    uint32_t * keyIn = key;
+    uint32_t * keyOut = key2;
+    int * posIn = pos;
+    int * posOut = pos2;
+
+    for(int shift = 0; shift < 32; shift += XSORT_RADIX_BITS){
+
+        /* count the digits of each chunk */
+        XParallelFor(0, chunkNum, 1, [&](int begin, int end) {
+            for(int c = begin; c < end; c++){
+                int * myCount = count + c * XSORT_RADIX;
+                memset(myCount, 0, sizeof(int) * XSORT_RADIX);
+                int last = MIN(num, (c + 1) * chunkSize);
+                for(int i = c * chunkSize; i < last; i++)
+                    myCount[(keyIn[i] >> shift) & (XSORT_RADIX - 1)]++;
+            }
+        });
+
+        /* where each chunk puts each digit */
+        bool isSame = false;
+        int offset = 0;
+        for(int d = 0; d < XSORT_RADIX; d++){
+            int start = offset;
+            for(int c = 0; c < chunkNum; c++){
+                int n = count[c * XSORT_RADIX + d];
+                count[c * XSORT_RADIX + d] = offset;
+                offset += n;
+            }
+            if(offset - start == num)
+                isSame = true;
+        }
+
+        /* all keys have the same digit, so the order does not change */
+        if(isSame)
+            continue;
+
+        XParallelFor(0, chunkNum, 1, [&](int begin, int end) {
+            for(int c = begin; c < end; c++){
+                int * myOffset = count + c * XSORT_RADIX;
+                int last = MIN(num, (c + 1) * chunkSize);
+                for(int i = c * chunkSize; i < last; i++){
+                    int p = myOffset[(keyIn[i] >> shift) & (XSORT_RADIX - 1)]++;
+                    keyOut[p] = keyIn[i];
+                    posOut[p] = posIn[i];
+                }
+            }
+        });
+
+        uint32_t * keyTmp = keyIn;
+        keyIn = keyOut;
+        keyOut = keyTmp;
+        int * posTmp = posIn;
+        posIn = posOut;
+        posOut = posTmp;
+    }
+
+    if(posIn != pos)
+        memcpy(pos, posIn, sizeof(int) * num);
+
+    delete[] count;
+}
+
+/*
+sort the rows of an array in place
+>> data - the array of (blockNum, num, stride)
+>> index - the indices that move along with the items (NULL if there is none)
+>> blockNum - number of blocks
+>> num - number of items of a row
+>> stride - the distance between two items of a row
+>> descending - indicates whether larger items come first
+*/
+template<class T>
+void XSortRows(T * data, int * index, int blockNum, int num, int stride, bool descending)
+{
+    if(num < 2 || blockNum <= 0 || stride <= 0)
+        return;
+
+    int rowNum = blockNum * stride;
+    uint32_t flip = descending ? 0xFFFFFFFFU : 0;
+
+    XParallelFor(0, rowNum, MAX(1, XSORT_GRAIN / num), [&](int begin, int end) {
+        uint32_t * key = new uint32_t[num * 2];
+        int * pos = new int[num * 2];
+        T * value = new T[num];
+        int * valueIndex = index != NULL ? new int[num] : NULL;
+
+        for(int r = begin; r < end; r++){
+            int start = (r / stride) * num * stride + r % stride;
+            T * row = data + start;
+            int * rowIndex = index != NULL ? index + start : NULL;
+
+            for(int j = 0; j < num; j++){
+                value[j] = row[j * stride];
+                key[j] = XSortKey(value[j]) ^ flip;
+                pos[j] = j;
+            }
+            if(rowIndex != NULL){
+                for(int j = 0; j < num; j++)
+                    valueIndex[j] = rowIndex[j * stride];
+            }
+
+            if(num <= XSORT_SMALL_NUM)
+                XSortByRank(key, pos, num);
+            else
+                XSortByRadix(key, pos, num, key + num, pos + num);
+
+            for(int j = 0; j < num; j++)
+                row[j * stride] = value[pos[j]];
+            if(rowIndex != NULL){
+                for(int j = 0; j < num; j++)
+                    rowIndex[j * stride] = valueIndex[pos[j]];
+            }
+        }
+
+        delete[] key;
+        delete[] pos;
+        delete[] value;
+        delete[] valueIndex;
+    });
+}
+
+/*
+sort the rows of a float array in place
+>> data - the array of (blockNum, num, stride)
+>> index - the indices that move along with the items (NULL if there is none)
+>> blockNum - number of blocks
+>> num - number of items of a row
+>> stride - the distance between two items of a row
+>> descending - indicates whether larger items come first
+*/
+void XSortFloat(float * data, int * index, int blockNum, int num, int stride, bool descending)
+{
+    XSortRows(data, index, blockNum, num, stride, descending);
+}
+
+/*
+sort the rows of an int array in place
+>> data - the array of (blockNum, num, stride)
+>> index - the indices that move along with the items (NULL if there is none)
+>> blockNum - number of blocks
+>> num - number of items of a row
+>> stride - the distance between two items of a row
+>> descending - indicates whether larger items come first
+*/
+void XSortInt(int * data, int * index, int blockNum, int num, int stride, bool descending)
+{
+    XSortRows(data, index, blockNum, num, stride, descending);
+}
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
@@ -0,0 +1,52 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *
+ * The sort engine on CPUs. It sorts float or int keys, and an index array
+ * (if there is one) moves along with them. The keys are mapped to unsigned
+ * integers of the same order and then
+ *   - short rows are sorted by ranks (each key is compared with all others,
+ *     which has no branches and runs in SIMD code)
+ *   - long rows are sorted by LSD radix sort (8 bits a pass, and a pass is
+ *     skipped if all keys have the same digit). A very long row is cut into
+ *     chunks that are counted and scattered on different threads.
+ * Rows run on the threads of globalPRunner. The sort is stable, so items of
+ * the same value keep their order (e.g., smaller indices first).
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ *
+ */
+
+#ifndef __XSORT_H__
+#define __XSORT_H__
+
+/* the nts (NiuTrans.Tensor) namespace */
+namespace nts{
+
+/*
+sort the rows of a float array in place. The array is of (blockNum, num, stride)
+and each row is along the middle dimension, i.e., its items are stride apart
+*/
+void XSortFloat(float * data, int * index, int blockNum, int num, int stride, bool descending);
+
+/* sort the rows of an int array in place (see XSortFloat) */
+void XSortInt(int * data, int * index, int blockNum, int num, int stride, bool descending);
+
+} /* end of the nts (NiuTrans.Tensor) namespace */
+
+#endif
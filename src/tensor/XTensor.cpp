@@ -40,6 +40,7 @@
 #include "XHeap.h"
 #include "XBLAS.h"
 #include "XName.h"
+#include "XRand.h"
 #include "core/shape/MergeBlockLists.h"
 #include "core/movement/CopyValues.h"
 #include "core/arithmetic/Sum.h"
@@ -840,21 +841,14 @@ void XTensor::SetDataRand(DTYPE lower, DTYPE upper)
     if (data == NULL)
         return;
 
-    // srand((unsigned)time(0));
-    DTYPE variance = upper - lower;
     void * d = NULL;
     if (dataType == X_FLOAT) {
         d = new float[unitNum];
-        for (int i = 0; i < unitNum; i++) {
-            DTYPE value = lower + variance * (float)rand() / RAND_MAX;
-            *((float*)d + i) = value;
-        }
+        XRandFill(XRandNewStream(id), RAND_UNIFORM, (float*)d, unitNum, (float)lower, (float)upper);
     }
     else if (dataType == X_DOUBLE) {
         d = new double[unitNum];
-        for (int i = 0; i < unitNum; i++) {
-            *((double*)d + i) = lower + variance * rand() / RAND_MAX;
-        }
+        XRandFill(XRandNewStream(id), RAND_UNIFORM, (double*)d, unitNum, (double)lower, (double)upper);
     }
     else {
         ShowNTErrors("Data type must be X_FLOAT or X_Double!");
@@ -870,29 +864,6 @@ void XTensor::SetDataRand(DTYPE lower, DTYPE upper)
     }
 }
 
-/* a gauss distribution (Box-Muller method) */
-double GaussRand(DTYPE mean, DTYPE standardDeviation)
-{
-    // TODO: GPU code!!!!!!!
-
-    static double u, v;
-    static int phase = 0;
-    double z;
-    double pi = 3.141592654;
-
-    if (phase == 0){
-        u = (rand() + 1.0) / (RAND_MAX + 1.0);
-        v = (rand() + 1.0) / (RAND_MAX + 1.0);
-        z = sqrt(-2.0 * log(u))* sin(2.0 * pi * v);
-    }
-    else{
-        z = sqrt(-2.0 * log(u)) * cos(2.0 * pi * v);
-    }
-
-    phase = 1 - phase;
-    return mean + (z * standardDeviation);
-}
-
 /* 
 set the tensor items by a normal distribution
 >> mean - mean or expectation of the distribution
@@ -905,19 +876,14 @@ void XTensor::SetDataRandn(DTYPE mean, DTYPE standardDeviation)
     if (data == NULL)
         return;
 
-    // srand((unsigned)time(0));
     void * d = NULL;
     if (dataType == X_FLOAT) {
         d = new float[unitNum];
-        for (int i = 0; i < unitNum; i++) {
-            *((float*)d + i) = (float)GaussRand(mean, standardDeviation);
-        }
+        XRandFill(XRandNewStream(id), RAND_NORMAL, (float*)d, unitNum, (float)mean, (float)standardDeviation);
     }
     else if (dataType == X_DOUBLE) {
         d = new double[unitNum];
-        for (int i = 0; i < unitNum; i++) {
-            *((double*)d + i) = GaussRand(mean, standardDeviation);
-        }
+        XRandFill(XRandNewStream(id), RAND_NORMAL, (double*)d, unitNum, (double)mean, (double)standardDeviation);
     }
     else {
         ShowNTErrors("Data type must be X_FLOAT or X_Double!");
@@ -2021,10 +1987,10 @@ XTensor operator+ (const DTYPE shift, const XTensor &tensor)
     return ScaleAndShift(tensor, 1, shift);
 }
 
-/* overloading of the minus-sign */
+/* overloading of the minus-sign (shift - tensor) */
 XTensor  operator- (const DTYPE shift, const XTensor &tensor)
 {
-    return ScaleAndShift(tensor, 1, -shift);
+    return ScaleAndShift(tensor, -1, shift);
 }
 
 /* overloading of the multiply-sign */
@@ -2033,10 +1999,10 @@ XTensor  operator* (const DTYPE scale, const XTensor &tensor)
     return ScaleAndShift(tensor, scale, 0);
 }
 
-/* overloading of the division-sign */
+/* overloading of the division-sign (scale / tensor) */
 XTensor  operator/ (const DTYPE scale, const XTensor &tensor)
 {
-    return ScaleAndShift(tensor, (DTYPE)1/scale, 0);
+    return ScaleAndShift(Power(tensor, (DTYPE)-1), scale, 0);
 }
 
 } /* end of the nts (NiuTrans.Tensor) namespace */
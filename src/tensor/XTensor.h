@@ -452,13 +452,13 @@ extern int MakeTensorID();
 /* overloading of the plus-sign */
 XTensor  operator+ (const DTYPE shift, const XTensor &tensor);
 
-/* overloading of the minus-sign */
+/* overloading of the minus-sign (shift - tensor) */
 XTensor  operator- (const DTYPE shift, const XTensor &tensor);
 
 /* overloading of the multiply-sign */
 XTensor  operator* (const DTYPE scale, const XTensor &tensor);
 
-/* overloading of the division-sign */
+/* overloading of the division-sign (scale / tensor) */
 XTensor  operator/ (const DTYPE scale, const XTensor &tensor);
 
 } /* end of the nts (NiuTrans.Tensor) namespace */
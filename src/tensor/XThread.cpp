@@ -194,6 +194,7 @@ void XThread::LetItGo()
 #ifdef USE_PTHREAD
     MUTEX_LOCK(mutex);
     jobCount++;
+    COND_SIGNAL(cond);
     MUTEX_UNLOCK(mutex);
 #else
 #ifdef _WIN32
@@ -22,6 +22,7 @@
  */
 
 #include "XUtility.h"
+#include "XMemStat.h"
 
 #if !defined( WIN32 ) && !defined( _WIN32 )
     #include "sys/time.h"
@@ -355,6 +356,7 @@ void * XMemAlloc(int devID, size_t size)
 
     if(devID < 0){
         p = new char[size];
+        GMemStat.OnAlloc(devID, NULL, "global", p, size);
         return p;
     }
     else{
@@ -371,6 +373,8 @@ void * XMemAlloc(int devID, size_t size)
 
         cudaSetDevice(devIDBackup);
 
+        GMemStat.OnAlloc(devID, NULL, "global", p, size);
+
         return p;
 #else
         ShowNTErrors("Please specify USE_CUDA and recompile the code!");
@@ -385,6 +389,7 @@ void * XMemAllocOnDev(int devID, size_t size)
 
     if(devID < 0){
         p = new char[size];
+        GMemStat.OnAlloc(devID, NULL, "global", p, size);
         return p;
     }
     else{
@@ -395,6 +400,8 @@ void * XMemAllocOnDev(int devID, size_t size)
             ShowNTErrors("Cannot allocate the memory in XMemAlloc.");
         }
 
+        GMemStat.OnAlloc(devID, NULL, "global", p, size);
+
         return p;
 #else
         ShowNTErrors("Please specify USE_CUDA and recompile the code!");
@@ -408,6 +415,8 @@ void XMemFree(int devID, void * p)
     if(p == NULL)
         return;
 
+    GMemStat.OnRelease(p);
+
     if(devID < 0){
         delete[] (char*)p;
         return;
@@ -432,6 +441,8 @@ void XMemFree(int devID, void * p)
 
 void XMemFreeOnDev(int devID, void * p)
 {
+    GMemStat.OnRelease(p);
+
     if(devID < 0){
         delete[] (char*)p;
         return;
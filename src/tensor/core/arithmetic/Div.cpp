@@ -25,6 +25,7 @@
 #include "../shape/IsSameShaped.h"
 #include "Div.h"
 #include "Div.cuh"
+#include "../../XElementWise.h"
 #include "DivDim.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
@@ -80,7 +81,29 @@ void _Div(const XTensor * a, const XTensor * b, XTensor * c, DTYPE alpha, int le
     blockNum = a->unitNum / blockSizeA;
 
     if (!a->isSparse && !b->isSparse) {
-        if (a->dataType == DEFAULT_DTYPE && b->dataType == DEFAULT_DTYPE) {
+        /* with broadcasting, the engine runs on each row of stride items. Rows
+           shorter than a vector are left to the plain loop below */
+        if (a->dataType == X_FLOAT && b->dataType == X_FLOAT && c->dataType == X_FLOAT &&
+            ((a->unitNum == c->unitNum && b->unitNum == c->unitNum) || stride >= XEWGetWidth())) {
+            if (a->unitNum == c->unitNum && b->unitNum == c->unitNum) {
+                XEWBinary(EW_DIV, (float*)a->data, (float*)b->data, (float*)c->data, a->unitNum, alpha);
+            }
+            else {
+                for (int k = 0; k < blockNum; k++) {
+                    for (int ci = 0, ai = 0, bi = 0; ci < dimensionSizeC; ci++, ai++, bi++) {
+                        if (ai >= dimensionSizeA)
+                            ai = 0;
+                        if (bi >= dimensionSizeB)
+                            bi = 0;
+                        float * ap = (float*)a->data + k * blockSizeA + ai * stride;
+                        float * bp = (float*)b->data + k * blockSizeB + bi * stride;
+                        float * cp = (float*)c->data + k * blockSizeC + ci * stride;
+                        XEWBinary(EW_DIV, ap, bp, cp, stride, alpha);
+                    }
+                }
+            }
+        }
+        else if (a->dataType == DEFAULT_DTYPE && b->dataType == DEFAULT_DTYPE) {
             if (a->unitNum == c->unitNum && b->unitNum == c->unitNum) {
                 int size = a->unitNum;
                 DTYPE * ap = (DTYPE*)a->data;
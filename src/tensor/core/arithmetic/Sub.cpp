@@ -22,6 +22,7 @@
 #include "../../XTensor.h"
 #include "../../XName.h"
 #include "../../XUtility.h"
+#include "../../XElementWise.h"
 #include "../shape/IsSameShaped.h"
 #include "Sub.h"
 #include "Sub.cuh"
@@ -81,27 +82,11 @@ void _Sub(const XTensor * a, const XTensor * b, XTensor * c, DTYPE beta)
                 DTYPE * bp = (DTYPE*)b->data;
                 DTYPE * cp = (DTYPE*)c->data;
     
-                /* unrolling */
-                int num = a->unitNum;
-                if (num % 4 == 0) {
-                    for (int i = 0; i < num; i += 4) {
-                        cp[i] = ap[i] - bp[i] * beta;
-                        cp[i + 1] = ap[i + 1] - bp[i + 1] * beta;
-                        cp[i + 2] = ap[i + 2] - bp[i + 2] * beta;
-                        cp[i + 3] = ap[i + 3] - bp[i + 3] * beta;
-                    }
-                }
-                else if (num % 2 == 0) {
-                    for (int i = 0; i < num; i += 2) {
-                        cp[i] = ap[i] - bp[i] * beta;
-                        cp[i + 1] = ap[i + 1] - bp[i + 1] * beta;
-                    }
-                }
-                else {
-                    for (int i = 0; i < num; i++) {
-                        cp[i] = ap[i] - bp[i] * beta;
-                    }
-                }
+                /* c = a + b * (-beta) is the same thing */
+                if (beta == 1)
+                    XEWBinary(EW_SUB, ap, bp, cp, a->unitNum);
+                else
+                    XEWBinary(EW_SUM_SCALED, ap, bp, cp, a->unitNum, -beta);
             }
             else {
                 // TODO!!
@@ -23,6 +23,7 @@
 #include "../../XName.h"
 #include "../../XUtility.h"
 #include "../../XBLAS.h"
+#include "../../XElementWise.h"
 #include "../movement/CopyValues.h"
 #include "../shape/IsSameShaped.h"
 #include "Sum.h"
@@ -89,53 +90,15 @@ void _Sum(const XTensor * a, const XTensor * b, XTensor * c, DTYPE beta)
                 /* when c != a, OpenBLAS needs to copy a to c first. This operation
                  slow down the speed, so just use OpenBLAS when c == a */
 #if defined(USE_BLAS)
-                if( c == a){
-                    AXPY(a->unitNum,beta,bp,1,cp,1);
-                } else{
-                     int num = a->unitNum;
-                        if (num % 4 == 0) {
-                            for (int i = 0; i < num; i += 4) {
-                                cp[i] = ap[i] + bp[i] * beta;
-                                cp[i + 1] = ap[i + 1] + bp[i + 1] * beta;
-                                cp[i + 2] = ap[i + 2] + bp[i + 2] * beta;
-                                cp[i + 3] = ap[i + 3] + bp[i + 3] * beta;
-                            }
-                        }
-                        else if (num % 2 == 0) {
-                            for (int i = 0; i < num; i += 2) {
-                                cp[i] = ap[i] + bp[i] * beta;
-                                cp[i + 1] = ap[i + 1] + bp[i + 1] * beta;
-                            }
-                        }
-                        else {
-                            for (int i = 0; i < num; i++) {
-                                cp[i] = ap[i] + bp[i] * beta;
-                            }
-                        }
+                if (c == a) {
+                    AXPY(a->unitNum, beta, bp, 1, cp, 1);
+                    return;
                 }
-#else
-                    /* unrolling */
-                    int num = a->unitNum;
-                    if (num % 4 == 0) {
-                        for (int i = 0; i < num; i += 4) {
-                            cp[i] = ap[i] + bp[i] * beta;
-                            cp[i + 1] = ap[i + 1] + bp[i + 1] * beta;
-                            cp[i + 2] = ap[i + 2] + bp[i + 2] * beta;
-                            cp[i + 3] = ap[i + 3] + bp[i + 3] * beta;
-                        }
-                    }
-                    else if (num % 2 == 0) {
-                        for (int i = 0; i < num; i += 2) {
-                            cp[i] = ap[i] + bp[i] * beta;
-                            cp[i + 1] = ap[i + 1] + bp[i + 1] * beta;
-                        }
-                    }
-                    else {
-                        for (int i = 0; i < num; i++) {
-                            cp[i] = ap[i] + bp[i] * beta;
-                        }
-                    }
 #endif
+                if (beta == 1)
+                    XEWBinary(EW_SUM, ap, bp, cp, a->unitNum);
+                else
+                    XEWBinary(EW_SUM_SCALED, ap, bp, cp, a->unitNum, beta);
                 }
             else {
                 // TODO!!
@@ -24,6 +24,7 @@
 #include "SetData.h"
 #include "SetData.cuh"
 #include "../../XUtility.h"
+#include "../../XRand.h"
 #include "../movement/CopyValues.h"
 
 #if !defined( WIN32 ) && !defined( _WIN32 )
@@ -489,21 +490,15 @@ void _SetDataRand(XTensor * tensor, DTYPE lower, DTYPE upper)
     if(tensor == NULL)
         return;
     
-    /* CPU code */
+    /* CPU code (the counter-based generator, see XRand.h) */
     if(tensor->devID < 0){
-        DTYPE variance = upper - lower;
-        
         if(tensor->dataType == X_FLOAT){
-            float * d = (float*)tensor->data;
-            for(int i = 0; i < tensor->unitNum; i++){
-                d[i] = variance * ((float)rand()/RAND_MAX) + lower;
-            }
+            XRandFill(XRandNewStream(tensor->id), RAND_UNIFORM,
+                      (float*)tensor->data, tensor->unitNum, (float)lower, (float)upper);
         }
         else if(tensor->dataType == X_DOUBLE){
-            double * d = (double*)tensor->data;
-            for(int i = 0; i < tensor->unitNum; i++){
-                d[i] = variance * ((double)rand()/RAND_MAX) + lower;
-            }
+            XRandFill(XRandNewStream(tensor->id), RAND_UNIFORM,
+                      (double*)tensor->data, tensor->unitNum, (double)lower, (double)upper);
         }
         else{
             ShowNTErrors("TODO");
@@ -577,15 +572,12 @@ void _SetDataRandP(XTensor * tensor, DTYPE lower, DTYPE upper, DTYPE p, DTYPE va
     CheckNTErrors(tensor->dataType == DEFAULT_DTYPE, "TODO");
 
     if (tensor->devID < 0) {
-        _SetDataRand(tensor, lower, upper);
-
-        DTYPE * data = (DTYPE*)tensor->data;
-        for (int i = 0; i < tensor->unitNum; i++) {
-            if (data[i] >= p)
-                data[i] = value;
-            else
-                data[i] = 0;
-        }
+        CheckNTErrors(upper > lower, "the high value must be greater than low value!");
+
+        /* item >= p <=> a number of [0, 1) >= (p - lower) / (upper - lower) */
+        DTYPE q = (p - lower) / (upper - lower);
+        XRandFill(XRandNewStream(tensor->id), RAND_BERNOULLI,
+                  (DTYPE*)tensor->data, tensor->unitNum, q, value);
     }
     else {
 #ifdef USE_CUDA
@@ -604,8 +596,18 @@ generate data items with a normal distribution with specified mean and standard
 */
 void _SetDataRandN(XTensor * tensor, DTYPE mean, DTYPE standardDeviation)
 {
-    // TODO: rewrite it and add cuda code!!!!!!!
-    tensor->SetDataRandn(mean, standardDeviation);
+    if (tensor->devID < 0 && tensor->dataType == X_FLOAT) {
+        XRandFill(XRandNewStream(tensor->id), RAND_NORMAL,
+                  (float*)tensor->data, tensor->unitNum, (float)mean, (float)standardDeviation);
+    }
+    else if (tensor->devID < 0 && tensor->dataType == X_DOUBLE) {
+        XRandFill(XRandNewStream(tensor->id), RAND_NORMAL,
+                  (double*)tensor->data, tensor->unitNum, (double)mean, (double)standardDeviation);
+    }
+    else {
+        // TODO: add cuda code!!!!!!!
+        tensor->SetDataRandn(mean, standardDeviation);
+    }
 }
 
 /* 
@@ -24,6 +24,7 @@
 #include "../shape/IsSameShaped.h"
 #include "Binary.h"
 #include "Binary.cuh"
+#include "../../XElementWise.h"
 
 namespace nts {
 
@@ -67,9 +68,12 @@ int BinaryMod(int x, int num)
     return x % num;
 }
 
-/* define three marco separately, specify the respective function names */
+/*
+define three marco separately, specify the respective function names. The float
+case runs in the element-wise engine (ewOp < 0 means the engine has no such function)
+*/
 #ifdef USE_CUDA                                                                      
-#define _SIMPLE_BINARY_FUNCTION(_funcName, _cudaFuncName, origFunc)                  \
+#define _SIMPLE_BINARY_FUNCTION(_funcName, _cudaFuncName, origFunc, ewOp)            \
 template<class T>                                                                    \
 void _funcName(const XTensor * a, XTensor * b, T num)                                \
 {                                                                                    \
@@ -86,6 +90,10 @@ void _funcName(const XTensor * a, XTensor * b, T num)
         for (int i = 0; i < a->unitNum; i++)                                         \
             db[i] = (int)origFunc((int)d[i], (T)num);                                \
     }                                                                                \
+    else if (a->dataType == X_FLOAT && ewOp >= 0 && (double)(float)num == (double)num) { \
+        XEWUnary((EW_UNARY)ewOp, (float*)a->data, (float*)b->data,                  \
+                 a->unitNum, (float)num);                                            \
+    }                                                                                \
     else if (a->dataType == X_FLOAT) {                                               \
         float * d = (float*)a->data;                                                 \
         float * db = (float*)b->data;                                                \
@@ -105,7 +113,7 @@ template void _funcName<int>(const XTensor*, XTensor*, int);
 template void _funcName<float>(const XTensor*, XTensor*, float);                     \
 template void _funcName<double>(const XTensor*, XTensor*, double);                   
 #else
-#define _SIMPLE_BINARY_FUNCTION(_funcName, origFunc)                                 \
+#define _SIMPLE_BINARY_FUNCTION(_funcName, origFunc, ewOp)                           \
 template<class T>                                                                    \
 void _funcName(const XTensor * a, XTensor * b, T num)                                \
 {                                                                                    \
@@ -121,6 +129,10 @@ void _funcName(const XTensor * a, XTensor * b, T num)
         for (int i = 0; i < a->unitNum; i++)                                         \
             db[i] = (int)origFunc((int)d[i], (T)num);                                \
     }                                                                                \
+    else if (a->dataType == X_FLOAT && ewOp >= 0 && (double)(float)num == (double)num) { \
+        XEWUnary((EW_UNARY)ewOp, (float*)a->data, (float*)b->data,                  \
+                 a->unitNum, (float)num);                                            \
+    }                                                                                \
     else if (a->dataType == X_FLOAT) {                                               \
         float * d = (float*)a->data;                                                 \
         float * db = (float*)b->data;                                                \
@@ -196,17 +208,17 @@ template void funcName<float>(const XTensor&, XTensor&, float);
 template void funcName<double>(const XTensor&, XTensor&, double);                                                                           
 
 #ifdef USE_CUDA
-_SIMPLE_BINARY_FUNCTION(_Descale, _CudaDescale, BinaryDescale)
-_SIMPLE_BINARY_FUNCTION(_Mod, _CudaMod, BinaryMod)
-_SIMPLE_BINARY_FUNCTION(_Power, _CudaPower, BinaryPower)
-_SIMPLE_BINARY_FUNCTION(_Scale, _CudaScale, BinaryScale)
-_SIMPLE_BINARY_FUNCTION(_Shift, _CudaShift, BinaryShift)
+_SIMPLE_BINARY_FUNCTION(_Descale, _CudaDescale, BinaryDescale, EW_DESCALE)
+_SIMPLE_BINARY_FUNCTION(_Mod, _CudaMod, BinaryMod, -1)
+_SIMPLE_BINARY_FUNCTION(_Power, _CudaPower, BinaryPower, EW_POWER)
+_SIMPLE_BINARY_FUNCTION(_Scale, _CudaScale, BinaryScale, EW_SCALE)
+_SIMPLE_BINARY_FUNCTION(_Shift, _CudaShift, BinaryShift, EW_SHIFT)
 #else
-_SIMPLE_BINARY_FUNCTION(_Descale, BinaryDescale)
-_SIMPLE_BINARY_FUNCTION(_Mod, BinaryMod)
-_SIMPLE_BINARY_FUNCTION(_Power, BinaryPower)
-_SIMPLE_BINARY_FUNCTION(_Scale, BinaryScale)
-_SIMPLE_BINARY_FUNCTION(_Shift, BinaryShift)
+_SIMPLE_BINARY_FUNCTION(_Descale, BinaryDescale, EW_DESCALE)
+_SIMPLE_BINARY_FUNCTION(_Mod, BinaryMod, -1)
+_SIMPLE_BINARY_FUNCTION(_Power, BinaryPower, EW_POWER)
+_SIMPLE_BINARY_FUNCTION(_Scale, BinaryScale, EW_SCALE)
+_SIMPLE_BINARY_FUNCTION(_Shift, BinaryShift, EW_SHIFT)
 #endif
 
 _SIMPLE_BINARY_FUNCTION_ME(_DescaleMe, _Descale)
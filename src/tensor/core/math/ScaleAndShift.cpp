@@ -25,6 +25,7 @@
 #include "../shape/IsSameShaped.h"
 #include "ScaleAndShift.h"
 #include "ScaleAndShift.cuh"
+#include "../../XElementWise.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -66,6 +67,9 @@ void _ScaleAndShift(const XTensor * a, XTensor * b, DTYPE scale, DTYPE shift)
         }
     }
     /* dense tensor */
+    else if(a->dataType == X_FLOAT){
+        XEWUnary(EW_SCALE_AND_SHIFT, (float*)a->data, (float*)b->data, b->unitNum, scale, shift);
+    }
     else{
         DTYPE * va = (DTYPE*)a->data;
         DTYPE * vb = (DTYPE*)b->data;
@@ -25,6 +25,7 @@
 #include "../shape/IsSameShaped.h"
 #include "Unary.h"
 #include "Unary.cuh"
+#include "../../XElementWise.h"
 
 namespace nts{
   
@@ -70,7 +71,7 @@ T UnaryIsZero(T r)
 
 /* define three marco separately, specify the respective function names */
 #ifdef USE_CUDA
-#define _SIMPLE_UNARY_FUNCTION(_funcName, _cudaFuncName, origFunc)                   \
+#define _SIMPLE_UNARY_FUNCTION(_funcName, _cudaFuncName, origFunc, ewOp)             \
 void _funcName(const XTensor * a, XTensor * b)                                       \
 {                                                                                    \
     /* run it on GPUs */                                                             \
@@ -87,10 +88,7 @@ void _funcName(const XTensor * a, XTensor * b)
             db[i] = (int)origFunc(d[i]);                                             \
     }                                                                                \
     else if (a->dataType == X_FLOAT) {                                               \
-        float * d = (float*)a->data;                                                 \
-        float * db = (float*)b->data;                                                \
-        for (int i = 0; i < a->unitNum; i++)                                         \
-            db[i] = (float)origFunc(d[i]);                                           \
+        XEWUnary(ewOp, (float*)a->data, (float*)b->data, a->unitNum);                \
     }                                                                                \
     else if (a->dataType == X_DOUBLE) {                                              \
         double * d = (double*)a->data;                                               \
@@ -102,7 +100,7 @@ void _funcName(const XTensor * a, XTensor * b)
         ShowNTErrors("TO DO!");                                                      \
 }                                       
 #else
-#define _SIMPLE_UNARY_FUNCTION(_funcName, origFunc)                                  \
+#define _SIMPLE_UNARY_FUNCTION(_funcName, origFunc, ewOp)                            \
 void _funcName(const XTensor * a, XTensor * b)                                       \
 {                                                                                    \
     /* run it on GPUs */                                                             \
@@ -118,10 +116,7 @@ void _funcName(const XTensor * a, XTensor * b)
             db[i] = (int)origFunc(d[i]);                                             \
     }                                                                                \
     else if (a->dataType == X_FLOAT) {                                               \
-        float * d = (float*)a->data;                                                 \
-        float * db = (float*)b->data;                                                \
-        for (int i = 0; i < a->unitNum; i++)                                         \
-            db[i] = (float)origFunc(d[i]);                                           \
+        XEWUnary(ewOp, (float*)a->data, (float*)b->data, a->unitNum);                \
     }                                                                                \
     else if (a->dataType == X_DOUBLE) {                                              \
         double * d = (double*)a->data;                                               \
@@ -171,37 +166,37 @@ void funcName(const XTensor & a, XTensor & b)
 }
 
 #ifdef USE_CUDA
-_SIMPLE_UNARY_FUNCTION(_Absolute, _CudaAbsolute, fabs)
-_SIMPLE_UNARY_FUNCTION(_Ceil, _CudaCeil, ceil)
-_SIMPLE_UNARY_FUNCTION(_Exp, _CudaExp, exp)
-_SIMPLE_UNARY_FUNCTION(_Floor, _CudaFloor, floor)
-_SIMPLE_UNARY_FUNCTION(_IsNonZero, _CudaIsNonZero, UnaryIsNonZero)
-_SIMPLE_UNARY_FUNCTION(_IsZero, _CudaIsZero, UnaryIsZero)
-_SIMPLE_UNARY_FUNCTION(_Log, _CudaLog, log)
-_SIMPLE_UNARY_FUNCTION(_Negate, _CudaNegate, UnaryNegate)
-_SIMPLE_UNARY_FUNCTION(_Round, _CudaRound, round)
-_SIMPLE_UNARY_FUNCTION(_Sign, _CudaSign, UnarySign)
-_SIMPLE_UNARY_FUNCTION(_Sqrt, _CudaSqrt, sqrt)
-_SIMPLE_UNARY_FUNCTION(_Square, _CudaSquare, UnarySquare)
-_SIMPLE_UNARY_FUNCTION(_Sin, _CudaSin, sin)
-_SIMPLE_UNARY_FUNCTION(_Cos, _CudaCos, cos)
-_SIMPLE_UNARY_FUNCTION(_Tan, _CudaTan, tan)
+_SIMPLE_UNARY_FUNCTION(_Absolute, _CudaAbsolute, fabs, EW_ABSOLUTE)
+_SIMPLE_UNARY_FUNCTION(_Ceil, _CudaCeil, ceil, EW_CEIL)
+_SIMPLE_UNARY_FUNCTION(_Exp, _CudaExp, exp, EW_EXP)
+_SIMPLE_UNARY_FUNCTION(_Floor, _CudaFloor, floor, EW_FLOOR)
+_SIMPLE_UNARY_FUNCTION(_IsNonZero, _CudaIsNonZero, UnaryIsNonZero, EW_ISNONZERO)
+_SIMPLE_UNARY_FUNCTION(_IsZero, _CudaIsZero, UnaryIsZero, EW_ISZERO)
+_SIMPLE_UNARY_FUNCTION(_Log, _CudaLog, log, EW_LOG)
+_SIMPLE_UNARY_FUNCTION(_Negate, _CudaNegate, UnaryNegate, EW_NEGATE)
+_SIMPLE_UNARY_FUNCTION(_Round, _CudaRound, round, EW_ROUND)
+_SIMPLE_UNARY_FUNCTION(_Sign, _CudaSign, UnarySign, EW_SIGN)
+_SIMPLE_UNARY_FUNCTION(_Sqrt, _CudaSqrt, sqrt, EW_SQRT)
+_SIMPLE_UNARY_FUNCTION(_Square, _CudaSquare, UnarySquare, EW_SQUARE)
+_SIMPLE_UNARY_FUNCTION(_Sin, _CudaSin, sin, EW_SIN)
+_SIMPLE_UNARY_FUNCTION(_Cos, _CudaCos, cos, EW_COS)
+_SIMPLE_UNARY_FUNCTION(_Tan, _CudaTan, tan, EW_TAN)
 #else
-_SIMPLE_UNARY_FUNCTION(_Absolute, fabs)
-_SIMPLE_UNARY_FUNCTION(_Ceil, ceil)
-_SIMPLE_UNARY_FUNCTION(_Exp, exp)
-_SIMPLE_UNARY_FUNCTION(_Floor, floor)
-_SIMPLE_UNARY_FUNCTION(_IsNonZero, UnaryIsNonZero)
-_SIMPLE_UNARY_FUNCTION(_IsZero, UnaryIsZero)
-_SIMPLE_UNARY_FUNCTION(_Log, log)
-_SIMPLE_UNARY_FUNCTION(_Negate, UnaryNegate)
-_SIMPLE_UNARY_FUNCTION(_Round, round)
-_SIMPLE_UNARY_FUNCTION(_Sign, UnarySign)
-_SIMPLE_UNARY_FUNCTION(_Sqrt, sqrt)
-_SIMPLE_UNARY_FUNCTION(_Square, UnarySquare)
-_SIMPLE_UNARY_FUNCTION(_Sin, sin)
-_SIMPLE_UNARY_FUNCTION(_Cos, cos)
-_SIMPLE_UNARY_FUNCTION(_Tan, tan)
+_SIMPLE_UNARY_FUNCTION(_Absolute, fabs, EW_ABSOLUTE)
+_SIMPLE_UNARY_FUNCTION(_Ceil, ceil, EW_CEIL)
+_SIMPLE_UNARY_FUNCTION(_Exp, exp, EW_EXP)
+_SIMPLE_UNARY_FUNCTION(_Floor, floor, EW_FLOOR)
+_SIMPLE_UNARY_FUNCTION(_IsNonZero, UnaryIsNonZero, EW_ISNONZERO)
+_SIMPLE_UNARY_FUNCTION(_IsZero, UnaryIsZero, EW_ISZERO)
+_SIMPLE_UNARY_FUNCTION(_Log, log, EW_LOG)
+_SIMPLE_UNARY_FUNCTION(_Negate, UnaryNegate, EW_NEGATE)
+_SIMPLE_UNARY_FUNCTION(_Round, round, EW_ROUND)
+_SIMPLE_UNARY_FUNCTION(_Sign, UnarySign, EW_SIGN)
+_SIMPLE_UNARY_FUNCTION(_Sqrt, sqrt, EW_SQRT)
+_SIMPLE_UNARY_FUNCTION(_Square, UnarySquare, EW_SQUARE)
+_SIMPLE_UNARY_FUNCTION(_Sin, sin, EW_SIN)
+_SIMPLE_UNARY_FUNCTION(_Cos, cos, EW_COS)
+_SIMPLE_UNARY_FUNCTION(_Tan, tan, EW_TAN)
 #endif
 
 _SIMPLE_UNARY_FUNCTION_ME(_AbsoluteMe, _Absolute)
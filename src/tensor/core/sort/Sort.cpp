@@ -24,7 +24,7 @@
 #include "../movement/CopyValues.h"
 #include "../shape/IsSameShaped.h"
 #include "../utilities/SetAscendingOrder.h"
-#include "../../XUtility.h"
+#include "../../XSort.h"
 #include "../../XName.h"
 #include "Sort.h"
 #include "Sort.cuh"
@@ -66,21 +66,16 @@ void _Sort(const XTensor * a, XTensor * b, XTensor * index, int dim)
 
         for (int i = dim + 1; i < a->order; i++)
             stride *= a->dimSize[i];
-        int blockSize = stride * strideNum;
 
         _CopyValues(a, b);
-        for (int k = 0; k < blockNum; k++) {
-        for (int i = 0; i < stride; i++) {
-                void * dataB = (char*)b->data + (k * blockSize + i) * b->unitSize;
-                void * indexData = (char*)index->data + (k * blockSize + i) * sizeof(int);
-
-                /* we sort the data array along "dim" */
-                if (a->dataType == X_FLOAT)
-                    XQSort(dataB, indexData, strideNum, a->unitSize, stride, CompXFloat);
-                else {
-                    ShowNTErrors("TODO!");
-                }
-            }
+
+        /* we sort the data array along "dim" (in descending order) */
+        if (a->dataType == X_FLOAT)
+            XSortFloat((float*)b->data, (int*)index->data, blockNum, strideNum, stride, true);
+        else if (a->dataType == X_INT)
+            XSortInt((int*)b->data, (int*)index->data, blockNum, strideNum, stride, true);
+        else {
+            ShowNTErrors("TODO!");
         }
     }
 }
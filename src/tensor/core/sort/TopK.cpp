@@ -20,14 +20,246 @@
 */
 
 #include <math.h>
+#include <algorithm>
 #include "../../XTensor.h"
 #include "../../XName.h"
+#include "../../XPRunner.h"
 #include "TopK.h"
 #include "TopK.cuh"
 #include "Sort.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
 
+/* number of items a thread processes at least */
+#define TOPK_GRAIN 16384
+
+/* the largest k that is kept in a small sorted list */
+#define TOPK_SMALL_K 16
+
+/* number of items that are checked against the threshold at a time */
+#define TOPK_CHUNK 16
+
+/* number of columns processed at a time when the items are not contiguous */
+#define TOPK_TILE 16
+
+/* an item of the top-k list */
+struct TopKNode
+{
+    DTYPE value;
+    int index;
+};
+
+/* 
+whether node a comes before node b in the result, i.e., larger values first,
+and smaller indices first for the same value (as the heap-based version)
+*/
+inline bool TopKBefore(const TopKNode &a, const TopKNode &b)
+{
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+}
+
+/*
+the argmax of a row. The max is found in TOPK_CHUNK lanes, which the
+compiler turns into SIMD code, and the index is the first item with that
+value
+>> x - the row
+>> n - number of items
+>> value - the max value
+>> index - its index
+*/
+void TopKArgMax(const DTYPE * x, int n, DTYPE * value, int * index)
+{
+    DTYPE lane[TOPK_CHUNK];
+    for (int l = 0; l < TOPK_CHUNK; l++)
+        lane[l] = x[0];
+
+    int j = 0;
+    for (; j + TOPK_CHUNK <= n; j += TOPK_CHUNK) {
+        for (int l = 0; l < TOPK_CHUNK; l++)
+            lane[l] = x[j + l] > lane[l] ? x[j + l] : lane[l];
+    }
+
+    DTYPE best = lane[0];
+    for (int l = 1; l < TOPK_CHUNK; l++)
+        best = lane[l] > best ? lane[l] : best;
+    for (; j < n; j++)
+        best = x[j] > best ? x[j] : best;
+
+    int bestIndex = 0;
+    for (j = 0; j < n; j++) {
+        if (x[j] == best) {
+            bestIndex = j;
+            break;
+        }
+    }
+
+    *value = x[bestIndex];
+    *index = bestIndex;
+}
+
+/*
+the argmax of the columns of a tile (each line of the tile is contiguous)
+>> a - the first item of the tile
+>> n - number of lines
+>> stride - the distance between two lines
+>> width - number of columns
+>> value - the max values
+>> index - their indices
+*/
+void TopKArgMaxColumns(const DTYPE * a, int n, int stride, int width, DTYPE * value, int * index)
+{
+    DTYPE best[TOPK_TILE];
+    int bestIndex[TOPK_TILE];
+    for (int c = 0; c < width; c++) {
+        best[c] = a[c];
+        bestIndex[c] = 0;
+    }
+
+    for (int j = 1; j < n; j++) {
+        const DTYPE * line = a + j * stride;
+        for (int c = 0; c < width; c++) {
+            bool greater = line[c] > best[c];
+            best[c] = greater ? line[c] : best[c];
+            bestIndex[c] = greater ? j : bestIndex[c];
+        }
+    }
+
+    for (int c = 0; c < width; c++) {
+        value[c] = best[c];
+        index[c] = bestIndex[c];
+    }
+}
+
+/* put an item into a sorted list of at most k items (the last one drops out if it is full) */
+inline void TopKPush(TopKNode * top, int &count, int k, DTYPE value, int index)
+{
+    int pos = count < k ? count++ : k - 1;
+    while (pos > 0 && top[pos - 1].value < value) {
+        top[pos] = top[pos - 1];
+        pos--;
+    }
+    top[pos].value = value;
+    top[pos].index = index;
+}
+
+/*
+the top-k items of a row for a small k (<= TOPK_SMALL_K). The list is kept
+sorted, and a chunk of items is skipped at once if none of them is above the
+last item of the list, which is the case for most chunks
+>> x - the row
+>> n - number of items
+>> k - how many items are kept
+>> top - the list
+<< return - number of items in the list
+*/
+int TopKSmall(const DTYPE * x, int n, int k, TopKNode * top)
+{
+    int count = 0;
+    int j = 0;
+    for (; j < n && count < k; j++)
+        TopKPush(top, count, k, x[j], j);
+
+    DTYPE threshold = top[count - 1].value;
+    for (; j + TOPK_CHUNK <= n; j += TOPK_CHUNK) {
+        int hit = 0;
+        for (int l = 0; l < TOPK_CHUNK; l++)
+            hit |= x[j + l] > threshold;
+        if (!hit)
+            continue;
+
+        for (int l = 0; l < TOPK_CHUNK; l++) {
+            if (x[j + l] > threshold) {
+                TopKPush(top, count, k, x[j + l], j + l);
+                threshold = top[k - 1].value;
+            }
+        }
+    }
+
+    for (; j < n; j++) {
+        if (x[j] > threshold) {
+            TopKPush(top, count, k, x[j], j);
+            threshold = top[k - 1].value;
+        }
+    }
+
+    return count;
+}
+
+/*
+the top-k items of a row for a large k. The items above a threshold are put
+into a buffer of 2k items. When it is full, we select the best k of them and
+the k-th value is the new threshold
+>> x - the row
+>> n - number of items
+>> k - how many items are kept
+>> buf - the buffer (2k items). The result is sorted in its first items
+<< return - number of items in the result
+*/
+int TopKLarge(const DTYPE * x, int n, int k, TopKNode * buf)
+{
+    int size = 2 * k;
+    int count = 0;
+    int j = 0;
+    for (; j < n && count < size; j++) {
+        buf[count].value = x[j];
+        buf[count].index = j;
+        count++;
+    }
+
+    if (j < n) {
+        std::nth_element(buf, buf + k - 1, buf + count, TopKBefore);
+        count = k;
+        DTYPE threshold = buf[k - 1].value;
+
+        for (; j < n; j++) {
+            if (x[j] <= threshold)
+                continue;
+            buf[count].value = x[j];
+            buf[count].index = j;
+            if (++count == size) {
+                std::nth_element(buf, buf + k - 1, buf + count, TopKBefore);
+                count = k;
+                threshold = buf[k - 1].value;
+            }
+        }
+    }
+
+    if (count > k) {
+        std::nth_element(buf, buf + k - 1, buf + count, TopKBefore);
+        count = k;
+    }
+    std::sort(buf, buf + count, TopKBefore);
+
+    return count;
+}
+
+/*
+the top-k items of a contiguous row
+>> x - the row
+>> n - number of items
+>> k - how many items are kept
+>> value - the values of the top-k items
+>> index - the indices of the top-k items
+>> outStride - the distance between two items of the result
+>> buf - the buffer of 2k items (for k > TOPK_SMALL_K)
+*/
+void TopKRow(const DTYPE * x, int n, int k, DTYPE * value, int * index, int outStride, TopKNode * buf)
+{
+    if (k == 1) {
+        TopKArgMax(x, n, value, index);
+        return;
+    }
+
+    TopKNode top[TOPK_SMALL_K];
+    TopKNode * result = k > TOPK_SMALL_K ? buf : top;
+    int count = k > TOPK_SMALL_K ? TopKLarge(x, n, k, buf) : TopKSmall(x, n, k, top);
+
+    for (int i = 0; i < count; i++) {
+        value[i * outStride] = result[i].value;
+        index[i * outStride] = result[i].index;
+    }
+}
+
 /*
 get the top-k items along a given dimension
 >> a - input tensor
@@ -78,33 +310,58 @@ void _TopK(const XTensor * a, XTensor * b, XTensor * index, int dim, int k)
         int blockSizeA = stride * strideNumA;
         int blockSizeB = stride * strideNumB;
 
-        XHeap<MIN_HEAP, DTYPE> heap(k);
+        if (strideNumA == 0 || k == 0)
+            return;
+
+        DTYPE * dataA = (DTYPE*)a->data;
+        DTYPE * dataB = (DTYPE*)b->data;
+        int * indexData = (int*)index->data;
 
-        for (int h = 0; h < blockNum; h++) {
-            for (int i = 0; i < stride; i++) {
-                DTYPE * dataA = (DTYPE*)a->data + (h * blockSizeA + i);
-                DTYPE * dataB = (DTYPE*)b->data + (h * blockSizeB + i);
-                int * indexData = (int*)index->data + (h * blockSizeB + i);
+        if (stride == 1) {
+            /* each row is contiguous */
+            XParallelFor(0, blockNum, MAX(1, TOPK_GRAIN / strideNumA), [&](int begin, int end) {
+                TopKNode * buf = k > TOPK_SMALL_K ? new TopKNode[2 * k] : NULL;
+                for (int h = begin; h < end; h++)
+                    TopKRow(dataA + h * blockSizeA, strideNumA, k,
+                            dataB + h * blockSizeB, indexData + h * blockSizeB, 1, buf);
+                delete[] buf;
+            });
+        }
+        else {
+            /* the rows are the columns of a block. We process TOPK_TILE of them at a time */
+            int tileNum = (stride + TOPK_TILE - 1) / TOPK_TILE;
+            int grain = MAX(1, TOPK_GRAIN / (strideNumA * TOPK_TILE));
 
-                /* initialize the heep */
-                heap.Clear(DTYPE_MIN);
+            XParallelFor(0, blockNum * tileNum, grain, [&](int begin, int end) {
+                DTYPE * column = k > 1 ? new DTYPE[TOPK_TILE * strideNumA] : NULL;
+                TopKNode * buf = k > TOPK_SMALL_K ? new TopKNode[2 * k] : NULL;
+                for (int t = begin; t < end; t++) {
+                    int h = t / tileNum;
+                    int i = (t % tileNum) * TOPK_TILE;
+                    int width = MIN(TOPK_TILE, stride - i);
+                    const DTYPE * tileA = dataA + h * blockSizeA + i;
+                    DTYPE * tileB = dataB + h * blockSizeB + i;
+                    int * tileIndex = indexData + h * blockSizeB + i;
 
-                for (int j = 0; j < blockSizeA; j += stride) {
-                    if (heap.count < heap.size) {
-                        heap.Push(HeapNode<DTYPE>(j / stride, dataA[j]));
+                    if (k == 1) {
+                        TopKArgMaxColumns(tileA, strideNumA, stride, width, tileB, tileIndex);
+                        continue;
                     }
-                    else {
-                        if (dataA[j] > heap.Top().value)
-                            heap.ReplaceTop(HeapNode<DTYPE>(j / stride, dataA[j]));
+
+                    /* transpose the tile (reading whole lines of it) so that each column is contiguous */
+                    for (int j = 0; j < strideNumA; j++) {
+                        const DTYPE * line = tileA + j * stride;
+                        for (int c = 0; c < width; c++)
+                            column[c * strideNumA + j] = line[c];
                     }
-                }
 
-                for (int j = strideNumA >= k ? k - 1 : strideNumA - 1; j >= 0; j--) {
-                    HeapNode<DTYPE> node = heap.Pop();
-                    dataB[j * stride] = node.value;
-                    indexData[j * stride] = (int)node.index;
+                    for (int c = 0; c < width; c++)
+                        TopKRow(column + c * strideNumA, strideNumA, k,
+                                tileB + c, tileIndex + c, stride, buf);
                 }
-            }
+                delete[] column;
+                delete[] buf;
+            });
         }
     }
 }
@@ -44,76 +44,63 @@ void RunParallel2D(XPRunner * parallelRunner, void * job,
     int jobNum = 1;
 
     if (parallelRunner != NULL && (parallelRunner->method == PRUNNER_SINGLE || parallelRunner->method == PRUNNER_MULTIPLE)) {
-        if (opNum >= parallelRunner->minimumOPNum * parallelRunner->threadNum)
+        if (opNum >= parallelRunner->minimumOPNum * parallelRunner->threadNum) {
             jobNum = parallelRunner->GetJobNum(rowNum * colNum);
+
+            /* the rows are blocks of items rather than items */
+            if (jobNum == 0)
+                jobNum = MIN(parallelRunner->threadNum, rowNum * colNum);
+        }
     }
 
     CheckNTErrors(jobNum != 0, "TODO!");
+    CheckNTErrors(jobNum <= MAX_THREAD_NUM, "Too many jobs!");
 
     /* argument list of the jobs */
-    TensorList * jobArgList = new TensorList(argNum);
+    TensorList jobArgList(argNum);
 
     va_list ap;
     va_start(ap, argNum);
     for (int i = 0; i < argNum; i++) {
         XTensor* p = va_arg(ap, XTensor*);
-        jobArgList->Add(p);
+        jobArgList.Add(p);
     }
     va_end(ap);
 
-    /* prepare the neccesary argument list for parallel processing */
-    TensorList * jobs = new TensorList(jobNum);
-    TensorList * args = new TensorList(jobNum);
-
-    int * indexList = new int[jobNum * 4 * 4];
-
     /* segment the matrix into blocks */
+    int indexList[MAX_THREAD_NUM * 4 * 4];
     int nblock = SegmentTensor2D(rowNum, colNum, jobNum, indexList);
 
     /*
-    assign jobs
+    run the jobs (by ParallelFor of the runner)
     argument rules:
     1. block information
     2. other arguments
     */
-    for (int i = 0; i < jobNum; i++) {
-        IntList* indexArgs = new IntList(4);
-        TensorList * blockArgs = new TensorList(argNum);
-        int * blockIndex = indexList + i * 4;
-
-        indexArgs->Add(blockIndex[0]);
-        indexArgs->Add(blockIndex[1]);
-        indexArgs->Add(blockIndex[2]);
-        indexArgs->Add(blockIndex[3]);
+    auto runBlocks = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int * blockIndex = indexList + i * 4;
+            IntList indexArgs(4);
+            TensorList args(2);
 
-        for (int j = 0; j < argNum; j++)
-            blockArgs->Add(jobArgList->GetItem(j));
+            indexArgs.Add(blockIndex[0]);
+            indexArgs.Add(blockIndex[1]);
+            indexArgs.Add(blockIndex[2]);
+            indexArgs.Add(blockIndex[3]);
 
-        args->Add((XTensor*)indexArgs);
-        args->Add((XTensor*)blockArgs);
+            args.Add((XTensor*)&indexArgs);
+            args.Add((XTensor*)&jobArgList);
 
-        jobs->Add((XTensor*)job);
-    }
-
-    args->count = jobNum * 2;
-    jobs->count = nblock;
+            ((TFunction)job)(&args);
+        }
+    };
 
     /* single job */
-    if (jobNum == 1)
-        ((TFunction)job)(args);
+    if (nblock == 1)
+        runBlocks(0, 1);
     /* multiple jobs */
     else
-        parallelRunner->Run(jobs, args);
-
-    /* free the memory */
-    delete[] indexList;
-    for (int i = 0; i < args->count; i++) {
-        TensorList * blockArgs = (TensorList*)args->GetItem(i);
-        delete blockArgs;
-    }
-    delete args;
-    delete jobs;
-    delete jobArgList;
+        parallelRunner->ParallelFor(0, nblock, 1, runBlocks);
 }
 
 /*
@@ -20,6 +20,7 @@
  */
 
 #include "../XName.h"
+#include "../XRand.h"
 #include <time.h>
 #include <math.h>
 #include "Dropout.h"
@@ -64,9 +65,8 @@ void _Dropout(const XTensor * x, XTensor * y, unsigned int seed, DTYPE dropProb,
     int unitNum = x->dimSize[n];
     DTYPE * maskArray = new DTYPE[unitNum];
 
-    srand(seed);
-    for (int i = 0; i < unitNum; i++)
-        maskArray[i] = RandomBernoulli(dropProb, scaleFactor);
+    /* the mask is a function of the seed, so the backward pass can make it again */
+    XRandFill(XRandSeededStream(seed), RAND_BERNOULLI, maskArray, unitNum, dropProb, scaleFactor);
 
     XTensor * mask = NewTensor1DV2(unitNum, x->dataType, x->devID, x->mem);
     mask->SetData(maskArray, unitNum);
@@ -109,9 +109,7 @@ void _DropoutBackward(const XTensor * y, const XTensor * x,
         int unitNum = x->dimSize[n];
         DTYPE * maskArray = new DTYPE[unitNum];
         
-        srand(seed);
-        for (int i = 0; i < unitNum; i++)
-            maskArray[i] = RandomBernoulli(dropProb, scaleFactor);
+        XRandFill(XRandSeededStream(seed), RAND_BERNOULLI, maskArray, unitNum, dropProb, scaleFactor);
 
         XTensor * mask = NewTensor1DV2(unitNum, x->dataType, x->devID, x->mem);
         mask->SetData(maskArray, unitNum);
@@ -186,9 +184,7 @@ XTensor Dropout(const XTensor &x, DTYPE dropProb, int leadingDim, int leadingDim
         int unitNum = x.dimSize[n];
         maskArray = new DTYPE[unitNum];
 
-        //srand((unsigned int)time(NULL));
-        for (int i = 0; i < unitNum; i++)
-            maskArray[i] = RandomBernoulli(dropProb, scaleFactor);
+        XRandFill(XRandNewStream(x.id), RAND_BERNOULLI, maskArray, unitNum, dropProb, scaleFactor);
     
         XTensor mask;
         InitTensor1DV2(&mask, unitNum, x.dataType, x.devID, x.mem);
@@ -209,9 +205,7 @@ XTensor Dropout(const XTensor &x, DTYPE dropProb, int leadingDim, int leadingDim
         int unitNum = x.dimSize[n] * x.dimSize[m];
         maskArray = new DTYPE[unitNum];
 
-        //srand((unsigned int)time(NULL));
-        for (int i = 0; i < unitNum; i++)
-            maskArray[i] = RandomBernoulli(dropProb, scaleFactor);
+        XRandFill(XRandNewStream(x.id), RAND_BERNOULLI, maskArray, unitNum, dropProb, scaleFactor);
 
         int dims[MAX_TENSOR_DIM_NUM];
 
@@ -246,8 +240,7 @@ XTensor DropoutWithoutBroadcast(const XTensor &x, DTYPE dropProb)
     int unitNum = x.unitNum;
     DTYPE * maskArray = new DTYPE[unitNum];
 
-    for (int i = 0; i < unitNum; i++)
-        maskArray[i] = RandomBernoulli(dropProb, scaleFactor);
+    XRandFill(XRandNewStream(x.id), RAND_BERNOULLI, maskArray, unitNum, dropProb, scaleFactor);
     
     XTensor mask;
     InitTensorV2(&mask, x.order, x.dimSize, x.dataType, x.denseRatio, x.devID, x.mem);
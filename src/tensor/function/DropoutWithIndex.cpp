@@ -45,8 +45,16 @@ void _DropoutWithIndex(const XTensor * x, XTensor * maskIndex, XTensor * c)
     }
 #endif
 
-    // TODO!!
-    ShowNTErrors("TODO!");
+    CheckNTErrors(maskIndex->dataType == X_INT, "The mask index must be of integers!");
+    CheckNTErrors(c->dataType == DEFAULT_DTYPE, "TODO!");
+
+    /* set the dropped items to 0 */
+    int * index = (int*)maskIndex->data;
+    DTYPE * cData = (DTYPE*)c->data;
+    for (int i = 0; i < maskIndex->unitNum; i++) {
+        CheckNTErrors(index[i] >= 0 && index[i] < c->unitNum, "Illegal mask index!");
+        cData[index[i]] = 0;
+    }
 }
 
 /*
@@ -24,6 +24,7 @@
 #include "../../tensor/core/shape/IsSameShaped.h"
 #include "HardTanH.h"
 #include "HardTanH.cuh"
+#include "../XElementWise.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -47,6 +48,11 @@ void _HardTanH(const XTensor * x, XTensor * y)
     }
 #endif
 
+    if(x->dataType == X_FLOAT && y->dataType == X_FLOAT){
+        XEWUnary(EW_HARDTANH, (float*)x->data, (float*)y->data, x->GetSize());
+        return;
+    }
+
     int n = x->GetSize();
     DTYPE * ip = (DTYPE*)x->data;
     DTYPE * op = (DTYPE*)y->data;
@@ -130,6 +136,12 @@ void _HardTanHBackward(XTensor * y, XTensor * x,
     }
 #endif
 
+    if(x->dataType == X_FLOAT){
+        XEWBinary(EW_HARDTANH_BACKWARD, (float*)x->data, (float*)dedy->data,
+                  (float*)dedx->data, x->unitNum);
+        return;
+    }
+
     DTYPE * dedyp = (DTYPE*)dedy->data;
     DTYPE * dedxp = (DTYPE*)dedx->data;
     DTYPE * ip = (DTYPE*)x->data;
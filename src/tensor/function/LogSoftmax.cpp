@@ -22,6 +22,7 @@
 #include <math.h>
 #include "LogSoftmax.h"
 #include "LogSoftmax.cuh"
+#include "Softmax.h"
 #include "../XName.h"
 #include "../XUtility.h"
 #include "../core/reduce/ReduceSum.h"
@@ -53,6 +54,11 @@ void _LogSoftmax(const XTensor * x, XTensor * y, int leadDim)
     if (!x->isSparse && !y->isSparse &&
         x->dataType == DEFAULT_DTYPE && y->dataType == DEFAULT_DTYPE)
     {
+        if (x->devID < 0) {
+            _SoftmaxOnePass(x, y, leadDim, true);
+            return;
+        }
+
         int * dimSize = new int[x->order - 1];
         for (int i = 0; i < x->order; i++) {
             if (i < leadDim)
@@ -85,81 +91,52 @@ void _LogSoftmax(const XTensor * x, XTensor * y, int leadDim)
         _ReduceMax(x, max, leadDim);
         _ReduceSum(x, sum, leadDim, max, 1.0F, true);
 
-        if (x->devID >= 0) {
-            if(leadDim == x->order - 1){
-                blockSize = y->unitNum;
-                blockNum  = 1;
-                blockx = NewTensor2DV2(blockSize/dimensionSize, -dimensionSize, x->dataType, x->devID, mem);
-                blocky = NewTensor2DV2(blockSize/dimensionSize, -dimensionSize, x->dataType, x->devID, mem);
-                blockMax = NewTensor2DV2(blockSize/dimensionSize, -1, x->dataType, x->devID, mem);
-                blockSum = NewTensor2DV2(blockSize/dimensionSize, -1, x->dataType, x->devID, mem);
-            }
-            else{
-                blockx = NewTensor2DV2(-stride, dimensionSize, x->dataType, x->devID, mem);
-                blocky = NewTensor2DV2(-stride, dimensionSize, x->dataType, x->devID, mem);
-                blockMax = NewTensor2DV2(-stride, 1, x->dataType, x->devID, mem);
-                blockSum = NewTensor2DV2(-stride, 1, x->dataType, x->devID, mem);
-            }
+        if(leadDim == x->order - 1){
+            blockSize = y->unitNum;
+            blockNum  = 1;
+            blockx = NewTensor2DV2(blockSize/dimensionSize, -dimensionSize, x->dataType, x->devID, mem);
+            blocky = NewTensor2DV2(blockSize/dimensionSize, -dimensionSize, x->dataType, x->devID, mem);
+            blockMax = NewTensor2DV2(blockSize/dimensionSize, -1, x->dataType, x->devID, mem);
+            blockSum = NewTensor2DV2(blockSize/dimensionSize, -1, x->dataType, x->devID, mem);
+        }
+        else{
+            blockx = NewTensor2DV2(-stride, dimensionSize, x->dataType, x->devID, mem);
+            blocky = NewTensor2DV2(-stride, dimensionSize, x->dataType, x->devID, mem);
+            blockMax = NewTensor2DV2(-stride, 1, x->dataType, x->devID, mem);
+            blockSum = NewTensor2DV2(-stride, 1, x->dataType, x->devID, mem);
         }
 
         for (int k = 0; k < blockNum; k++) {
-            int m = stride;
-            int n = dimensionSize;
-
             DTYPE * ip = (DTYPE*)x->data + k * blockSize;
             DTYPE * op = (DTYPE*)y->data + k * blockSize;
             DTYPE * mp = (DTYPE*)max->data + k * blockSize / dimensionSize;
             DTYPE * sp = (DTYPE*)sum->data + k * blockSize / dimensionSize;
 
-            if (x->devID < 0) {
-                for (int j = 0; j < m; j++) {
-                    DTYPE sumValue = sp[j];
-                    if (sumValue == 0) {
-                        for (int i = 0; i < n; i++)
-                            op[i * m + j] = 0;
-                    }
-                    else {
-                        for (int i = 0; i < n; i++) {
-                            DTYPE r = (DTYPE)log(exp(ip[i * m + j] - mp[j]) / sp[j]);
-                            if (IsNAN(r))
-                                r = LOGPROB_MIN;
-                            if (IsINF(r))
-                                r = LOGPROB_MIN;
-
-                            op[i * m + j] = MAX(r, LOGPROB_MIN);
-                        }
-                    }
-                }
-            }
-            else {
-                blockx->data = ip;
-                blocky->data = op;
-                blockMax->data = mp;
-                blockSum->data = sp;
+            blockx->data = ip;
+            blocky->data = op;
+            blockMax->data = mp;
+            blockSum->data = sp;
 #ifdef USE_CUDA
-                if(leadDim == x->order - 1)
-                    _CudaLogSoftmaxSumMax(blockx, blocky, 1, blockSum, blockMax);
-                else
-                    _CudaLogSoftmaxSumMax(blockx, blocky, leadDim, blockSum, blockMax);
+            if(leadDim == x->order - 1)
+                _CudaLogSoftmaxSumMax(blockx, blocky, 1, blockSum, blockMax);
+            else
+                _CudaLogSoftmaxSumMax(blockx, blocky, leadDim, blockSum, blockMax);
 #else
-                ShowNTErrors("Please specify USE_CUDA and recompile the code!");
+            ShowNTErrors("Please specify USE_CUDA and recompile the code!");
 #endif
-                blockx->data = NULL;
-                blocky->data = NULL;
-                blockMax->data = NULL;
-                blockSum->data = NULL;
-            }
+            blockx->data = NULL;
+            blocky->data = NULL;
+            blockMax->data = NULL;
+            blockSum->data = NULL;
         }
 
         DelTensorBuf(max);
         DelTensorBuf(sum);
 
-        if (x->devID >= 0) {
-            delete blockx;
-            delete blocky;
-            delete blockMax;
-            delete blockSum;
-        }
+        delete blockx;
+        delete blocky;
+        delete blockMax;
+        delete blockSum;
 
         delete[] dimSize;
     }
@@ -23,6 +23,7 @@
 #include "../core/shape/IsSameShaped.h"
 #include "Rectify.h"
 #include "Rectify.cuh"
+#include "../XElementWise.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -43,6 +44,11 @@ void _Rectify(const XTensor * x, XTensor * y)
     }
 #endif
 
+    if(x->dataType == X_FLOAT && y->dataType == X_FLOAT){
+        XEWUnary(EW_RECTIFY, (float*)x->data, (float*)y->data, x->GetSize());
+        return;
+    }
+
     DTYPE * ip = (DTYPE*)x->data;
     DTYPE * op = (DTYPE*)y->data;
     int n = x->GetSize();
@@ -125,6 +131,12 @@ void _RectifyBackward(XTensor * y, XTensor * x,
     }
 #endif
 
+    if(x->dataType == X_FLOAT){
+        XEWBinary(EW_RECTIFY_BACKWARD, (float*)x->data, (float*)dedy->data,
+                  (float*)dedx->data, x->unitNum);
+        return;
+    }
+
     DTYPE * dedyp = (DTYPE*)dedy->data;
     DTYPE * dedxp = (DTYPE*)dedx->data;
     DTYPE * ip = (DTYPE*)x->data;
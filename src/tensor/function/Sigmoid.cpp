@@ -25,6 +25,7 @@
 #include "Sigmoid.h"
 #include "Sigmoid.cuh"
 #include "../loss/LHeader.h"
+#include "../XElementWise.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -45,7 +46,10 @@ void _Sigmoid(const XTensor * x, XTensor * y)
     }
 #endif
 
-    if(x->dataType == DEFAULT_DTYPE && y->dataType == DEFAULT_DTYPE){
+    if(x->dataType == X_FLOAT && y->dataType == X_FLOAT){
+        XEWUnary(EW_SIGMOID, (float*)x->data, (float*)y->data, x->GetSize());
+    }
+    else if(x->dataType == DEFAULT_DTYPE && y->dataType == DEFAULT_DTYPE){
         DTYPE * ip = (DTYPE*)x->data;
         DTYPE * op = (DTYPE*)y->data;
         int n = x->GetSize();
@@ -119,6 +123,12 @@ void _SigmoidBackward(XTensor * y, XTensor * x,
         return;
     }
 #endif
+    if(y->dataType == X_FLOAT){
+        XEWBinary(EW_SIGMOID_BACKWARD, (float*)y->data, (float*)dedy->data,
+                  (float*)dedx->data, y->unitNum);
+        return;
+    }
+
     DTYPE * dedyp = (DTYPE*)dedy->data;
     DTYPE * dedxp = (DTYPE*)dedx->data;
     DTYPE * op = (DTYPE*)y->data;
@@ -24,9 +24,11 @@
 #include "Softmax.cuh"
 #include "../XName.h"
 #include "../XUtility.h"
+#include "../XElementWise.h"
 #include "../core/reduce/ReduceSum.h"
 #include "../core/reduce/ReduceMax.h"
 #include "../core/shape/IsSameShaped.h"
+#include "../core/utilities/XMatrixSegment.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
 
@@ -42,6 +44,12 @@ void _Softmax(const XTensor * x, XTensor * y, int leadDim)
         leadDim = x->order - 1;
 
     if(!x->isSparse && !y->isSparse && x->dataType == y->dataType){
+        if(x->devID < 0){
+            CheckNTErrors((x->dataType == DEFAULT_DTYPE), "TODO!");
+            _SoftmaxOnePass(x, y, leadDim, false);
+            return;
+        }
+
         int * dimSize = new int[x->order - 1];
         for(int i = 0; i < x->order; i++){
             if(i < leadDim)
@@ -60,56 +68,11 @@ void _Softmax(const XTensor * x, XTensor * y, int leadDim)
         _ReduceMax(x, max, leadDim);
         _ReduceSum(x, sum, leadDim, max, 1.0F, true);
 
-        if(x->devID >= 0){
 #ifdef USE_CUDA
-            _CudaSoftmaxSumMax(x, y, leadDim, sum, max);
+        _CudaSoftmaxSumMax(x, y, leadDim, sum, max);
 #else
-            ShowNTErrors("Please specify USE_CUDA and recompile the code!");
+        ShowNTErrors("Please specify USE_CUDA and recompile the code!");
 #endif
-        }
-        else{
-            CheckNTErrors((x->dataType == DEFAULT_DTYPE), "TODO!");
-
-            int dimensionSize = y->dimSize[leadDim];
-            int stride = 1;
-            int blockSize = 1;
-            int blockNum = 1;
-
-            for(int i = leadDim + 1; i < y->order; i++)
-                stride *= y->dimSize[i];
-            blockSize = stride * dimensionSize;
-            blockNum = y->unitNum / blockSize;
-
-            for(int k = 0; k < blockNum; k++){
-                int m = stride;
-                int n = dimensionSize;
-                int blockOffset = k * blockSize;
-                int blockOffsetMax = k * blockSize / dimensionSize;
-
-                DTYPE * ip = (DTYPE*)x->data + blockOffset;
-                DTYPE * op = (DTYPE*)y->data + blockOffset;
-                DTYPE * mp = (DTYPE*)max->data + blockOffsetMax;
-                DTYPE * sp = (DTYPE*)sum->data + blockOffsetMax;
-
-                for(int j = 0; j < m; j++){
-                    DTYPE sumValue = sp[j];
-                    if(sumValue == 0){
-                        for(int i = 0; i < n; i++)
-                            op[i * m + j] = 0;
-                    }
-                    else{
-                        for(int i = 0; i < n; i++){
-                            DTYPE r = (DTYPE)exp(ip[i * m + j] - mp[j])/sp[j];
-                            if (r > (DTYPE)1.0F)
-                                r = (DTYPE)1.0F;
-                            else if (r < 0)
-                                r = 0;
-                            op[i * m + j] = r;
-                        }
-                    }
-                }
-            }
-        }
 
         DelTensorBuf(sum);
         DelTensorBuf(max);
@@ -121,6 +84,126 @@ void _Softmax(const XTensor * x, XTensor * y, int leadDim)
     
 }
 
+/*
+softmax (or log-softmax) for a block (x1,y1) - (x2,y2) where a row is a block of
+the input (i.e., all the items in front of the leading dimension) and a column is
+an item behind the leading dimension.
+NOTE: this is a instance of the TFunction type and would be used in XThread
+(see more information in XThread.h/cpp)
+>> args - arguments
+argument0: x1 - block index (upper-left corner)
+argument1: y1 - column index (upper-left corner)
+argument2: x2 - block index (bottom-right corner)
+argument3: y2 - column index (bottom-right corner)
+argument4: x - input tensor
+argument5: y - output tensor
+argument6: leading dimension
+argument7: indicates whether we compute log-softmax
+*/
+void _SoftmaxOnePassJob(TensorList * args)
+{
+    CheckNTErrors(args->count == 2, "invalid argument number!");
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(indexArgs->count == 4, "invalid argument number!");
+    CheckNTErrors(tensorArgs->count == 4, "invalid argument number!");
+
+    XTensor * x = tensorArgs->GetItem(0);
+    XTensor * y = tensorArgs->GetItem(1);
+    int leadDim = *(int*)(tensorArgs->GetItem(2));
+    bool isLog = *(bool*)(tensorArgs->GetItem(3));
+    int x1 = indexArgs->GetItem(0);
+    int y1 = indexArgs->GetItem(1);
+    int x2 = indexArgs->GetItem(2);
+    int y2 = indexArgs->GetItem(3);
+
+    int n = y->dimSize[leadDim];
+    int stride = 1;
+    for(int i = leadDim + 1; i < y->order; i++)
+        stride *= y->dimSize[i];
+    int blockSize = stride * n;
+    int colNum = y2 - y1 + 1;
+
+    DTYPE * maxBuf = new DTYPE[colNum];
+    DTYPE * sumBuf = new DTYPE[colNum];
+
+    for(int k = x1; k <= x2; k++){
+        DTYPE * ip = (DTYPE*)x->data + (MTYPE)k * blockSize + y1;
+        DTYPE * op = (DTYPE*)y->data + (MTYPE)k * blockSize + y1;
+
+        /* one pass to read the input for max and sum */
+        if(stride == 1)
+            XEWMaxSumExp(ip, n, maxBuf, sumBuf);
+        else
+            XEWMaxSumExpCol(ip, n, stride, colNum, maxBuf, sumBuf);
+
+        /* for log-softmax we keep max + log(sum) in maxBuf,
+           and for softmax we keep 1/sum in sumBuf. A row of -inf (e.g.,
+           it is fully masked) has sum = 0, and its outputs are 0 for
+           softmax and LOGPROB_MIN for log-softmax */
+        for(int j = 0; j < colNum; j++){
+            if(sumBuf[j] == 0){
+                if(isLog)
+                    maxBuf[j] = FLT_MAX;
+                else
+                    sumBuf[j] = 0;
+            }
+            else if(isLog)
+                maxBuf[j] += (DTYPE)log(sumBuf[j]);
+            else
+                sumBuf[j] = 1.0F / sumBuf[j];
+        }
+
+        /* one pass to write the output */
+        if(stride == 1){
+            if(isLog)
+                XEWShiftMax(ip, op, n, maxBuf[0], LOGPROB_MIN);
+            else
+                XEWExpAffine(ip, op, n, maxBuf[0], sumBuf[0], 0);
+            continue;
+        }
+
+        for(int i = 0; i < n; i++){
+            DTYPE * ipi = ip + (MTYPE)i * stride;
+            DTYPE * opi = op + (MTYPE)i * stride;
+            if(isLog)
+                XEWShiftMaxV(ipi, opi, colNum, maxBuf, LOGPROB_MIN);
+            else
+                XEWExpAffineV(ipi, opi, colNum, maxBuf, sumBuf);
+        }
+    }
+
+    delete[] maxBuf;
+    delete[] sumBuf;
+}
+
+/*
+softmax or log-softmax on CPUs. Unlike the GPU code, it does not need the buffers
+of max and sum. For each row (or column) we read the input once to get the max and
+the sum of e^{x - max} (see XEWMaxSumExp), and write the output in another pass.
+The rows are processed in parallel.
+>> x - input vector
+>> y - result
+>> leadDim - leading dimension (along which we perform reduction)
+>> isLog - indicates whether we compute log-softmax
+*/
+void _SoftmaxOnePass(const XTensor * x, XTensor * y, int leadDim, bool isLog)
+{
+    CheckNTErrors(x->devID < 0 && y->devID < 0, "The tensors must be on CPUs!");
+    CheckNTErrors(x->dataType == DEFAULT_DTYPE && y->dataType == DEFAULT_DTYPE, "TODO!");
+    CheckNTErrors(_IsSameShaped(x, y), "The tensors must be of the same size!");
+
+    int n = y->dimSize[leadDim];
+    int stride = 1;
+    for(int i = leadDim + 1; i < y->order; i++)
+        stride *= y->dimSize[i];
+    int blockNum = y->unitNum / (stride * n);
+
+    RunParallel2D(globalPRunner, (void*)_SoftmaxOnePassJob, y->unitNum,
+                  blockNum, stride, 4,
+                  x, y, &leadDim, &isLog);
+}
+
 /*
 softmax y = e^x / \sum_{i} e^{x_i} (return an XTensor structure) 
 make a new tensor to keep the result and return it
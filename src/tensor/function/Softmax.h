@@ -35,6 +35,9 @@ XTensor Softmax(const XTensor &x, int leadDim);
 
 void Softmax(const XTensor &x, XTensor &y, int leadDim);
 
+/* softmax or log-softmax in one pass over the input (CPU only) */
+void _SoftmaxOnePass(const XTensor * x, XTensor * y, int leadDim, bool isLog);
+
 /* de/dx */
 void _SoftmaxBackward(XTensor * gold, XTensor * y, XTensor * x, 
                       XTensor * dedy, XTensor * dedx, 
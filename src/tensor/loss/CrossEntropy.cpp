@@ -20,10 +20,12 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "CrossEntropy.h"
 #include "CrossEntropy.cuh"
 #include "../XTensor.h"
 #include "../XName.h"
+#include "../XElementWise.h"
 #include "../core/arithmetic/MultiplyDim.h"
 #include "../core/arithmetic/Multiply.h"
 #include "../core/math/Unary.h"
@@ -31,6 +33,7 @@
 #include "../core/reduce/ReduceSum.h"
 #include "../core/reduce/ReduceSumAll.h"
 #include "../core/shape/IsSameShaped.h"
+#include "../core/utilities/XMatrixSegment.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
 
@@ -684,4 +687,301 @@ void _CrossEntropyBackward(XTensor * dedy, const XTensor * output,
     }
 }
 
+/*
+check the arguments of the cross entropy loss with logits
+>> input - the logits
+>> gold - indices of the gold standard
+>> result - the loss (of size gold) or the gradient (of size input)
+>> padding - specify a target value that is ignored and does not contribute to the loss computation
+*/
+void CheckCrossEntropyWithLogits(const XTensor * input, const XTensor * gold,
+                                 const XTensor * result, const XTensor * padding)
+{
+    CheckNTErrors(input->devID < 0, "TODO!");
+    CheckNTErrors(input->dataType == DEFAULT_DTYPE && gold->dataType == X_INT,
+                 "The input must be of the default type and the gold standard must be of integers!");
+    CheckNTErrors(gold->order == input->order - 1, "Wrong gold standard tensor!");
+    for(int i = 0; i < gold->order; i++)
+        CheckNTErrors(gold->dimSize[i] == input->dimSize[i], "Unmatched tensors!");
+    CheckNTErrors(result->dataType == DEFAULT_DTYPE && result->devID < 0, "Wrong result tensor!");
+    CheckNTErrors(result->unitNum == input->unitNum || result->unitNum == gold->unitNum,
+                 "Wrong result tensor!");
+    CheckNTErrors(padding == NULL || (padding->dataType == DEFAULT_DTYPE && padding->unitNum == gold->unitNum),
+                 "The gold standard tensor and padding tensor must be same shape!");
+}
+
+/*
+cross entropy loss with logits for a number of rows (x1 - x2) where a row is
+a vector of the logits
+NOTE: this is a instance of the TFunction type and would be used in XThread
+(see more information in XThread.h/cpp)
+>> args - arguments
+argument0: x1 - row index (upper-left corner)
+argument1: y1 - column index (upper-left corner)
+argument2: x2 - row index (bottom-right corner)
+argument3: y2 - column index (bottom-right corner)
+argument4: input - the logits
+argument5: gold - indices of the gold standard
+argument6: loss - the loss of each row
+argument7: padding - the padding (NULL means no padding)
+argument8: label smoothing factor
+*/
+void _CrossEntropyWithLogitsJob(TensorList * args)
+{
+    CheckNTErrors(args->count == 2, "invalid argument number!");
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(indexArgs->count == 4, "invalid argument number!");
+    CheckNTErrors(tensorArgs->count == 5, "invalid argument number!");
+
+    XTensor * input = tensorArgs->GetItem(0);
+    XTensor * gold = tensorArgs->GetItem(1);
+    XTensor * loss = tensorArgs->GetItem(2);
+    XTensor * padding = tensorArgs->GetItem(3);
+    DTYPE p = *(DTYPE*)(tensorArgs->GetItem(4));
+    int x1 = indexArgs->GetItem(0);
+    int x2 = indexArgs->GetItem(2);
+
+    int n = input->GetDim(-1);
+    DTYPE smoothing = p / n;
+    DTYPE confidence = 1.0F - p;
+    DTYPE targetSum = confidence + smoothing * (n - 1);
+
+    int * goldData = (int*)gold->data;
+    DTYPE * lossData = (DTYPE*)loss->data;
+    DTYPE * paddingData = padding != NULL ? (DTYPE*)padding->data : NULL;
+
+    for(int k = x1; k <= x2; k++){
+        if(paddingData != NULL && paddingData[k] == 0){
+            lossData[k] = 0;
+            continue;
+        }
+
+        DTYPE * ip = (DTYPE*)input->data + (MTYPE)k * n;
+        int g = goldData[k];
+        CheckNTErrors(g >= 0 && g < n, "Illegal index of the gold standard!");
+
+        /* log Z and sum_i x_i in one pass */
+        DTYPE max;
+        DTYPE sum;
+        DTYPE total = 0;
+        XEWMaxSumExp(ip, n, &max, &sum, smoothing > 0 ? &total : NULL);
+        DTYPE logZ = max + (DTYPE)log(sum);
+
+        /* loss = -sum_i t_i * (x_i - log Z) where t_i is the (smoothed) gold standard */
+        DTYPE l = targetSum * logZ - confidence * ip[g];
+        if(smoothing > 0)
+            l -= smoothing * (total - ip[g]);
+
+        lossData[k] = paddingData != NULL ? l * paddingData[k] : l;
+    }
+}
+
+/*
+compute the cross entropy loss from the logits (i.e., the input of the softmax
+function) and the indices of the gold standard
+
+loss = sum_{i} (-t_i * log(softmax(x)_i))
+
+where t is the gold standard in the form of one-hot vectors (with label
+smoothing, i.e., t_i = 1 - p for the gold index and p/n for the others, the same
+as IndexToOnehot(...)). We never generate the softmax output and the one-hot
+tensor. Instead, every row is read once to get log Z = log \sum_{i} e^{x_i}
+(and \sum_{i} x_i for label smoothing) and the loss is computed from them.
+
+>> input - the logits (the last dimension is the one we perform softmax along)
+>> gold - indices of the gold standard (of X_INT), its size is that of input without the last dimension
+>> loss - the loss of each position (of the same size as gold)
+>> labelSmoothingP - label smoothing factor
+>> padding - specify a target value that is ignored and does not contribute to the loss computation
+*/
+void _CrossEntropyWithLogits(const XTensor * input, const XTensor * gold,
+                             XTensor * loss, DTYPE labelSmoothingP,
+                             const XTensor * padding)
+{
+    CheckCrossEntropyWithLogits(input, gold, loss, padding);
+    CheckNTErrors(loss->unitNum == gold->unitNum, "The loss tensor and gold tensor must be same shape!");
+
+    int rowNum = gold->unitNum;
+
+    RunParallel2D(globalPRunner, (void*)_CrossEntropyWithLogitsJob, input->unitNum,
+                  rowNum, 1, 5,
+                  input, gold, loss, padding, &labelSmoothingP);
+}
+
+/*
+compute the cross entropy loss from the logits and the indices of the gold standard
+(return an XTensor structure)
+make a new tensor to keep the result and return it
+
+>> input - the logits
+>> gold - indices of the gold standard
+>> labelSmoothingP - label smoothing factor
+<< return - the cross entropy loss of each position
+*/
+XTensor CrossEntropyWithLogits(const XTensor & input, const XTensor & gold,
+                               DTYPE labelSmoothingP)
+{
+    XTensor loss;
+    loss = GetReduceTensor(input, input.order - 1);
+
+    /* call _CrossEntropyWithLogits function */
+    _CrossEntropyWithLogits(&input, &gold, &loss, labelSmoothingP);
+
+    /* tensor connection */
+    TensorList tails(2);
+    tails.Add((XTensor*)&input);
+    tails.Add((XTensor*)&gold);
+
+    if (input.enableGrad) {
+        XLink::MakeLink(&tails, &loss, LOSS_CROSSENTROPY_LOGITS);
+        XLink::AddParamToHead(&loss, labelSmoothingP);
+    }
+
+    return loss;
+}
+
+/*
+compute the cross entropy loss from the logits and the indices of the gold standard
+with padding (return an XTensor structure)
+make a new tensor to keep the result and return it
+
+>> input - the logits
+>> gold - indices of the gold standard
+>> padding - specify a target value that is ignored and does not contribute to the loss computation
+>> labelSmoothingP - label smoothing factor
+<< return - the cross entropy loss of each position
+*/
+XTensor CrossEntropyWithLogits(const XTensor & input, const XTensor & gold,
+                               const XTensor & padding, DTYPE labelSmoothingP)
+{
+    XTensor loss;
+    loss = GetReduceTensor(input, input.order - 1);
+
+    /* call _CrossEntropyWithLogits function */
+    _CrossEntropyWithLogits(&input, &gold, &loss, labelSmoothingP, &padding);
+
+    /* tensor connection */
+    TensorList tails(3);
+    tails.Add((XTensor*)&input);
+    tails.Add((XTensor*)&gold);
+    tails.Add((XTensor*)&padding);
+
+    if (input.enableGrad) {
+        XLink::MakeLink(&tails, &loss, LOSS_CROSSENTROPY_LOGITS);
+        XLink::AddParamToHead(&loss, labelSmoothingP);
+    }
+
+    return loss;
+}
+
+/*
+backward computation of the cross entropy loss with logits for a number of rows
+NOTE: this is a instance of the TFunction type and would be used in XThread
+(see more information in XThread.h/cpp)
+>> args - arguments
+argument0: x1 - row index (upper-left corner)
+argument1: y1 - column index (upper-left corner)
+argument2: x2 - row index (bottom-right corner)
+argument3: y2 - column index (bottom-right corner)
+argument4: dedx - the gradient
+argument5: input - the logits
+argument6: gold - indices of the gold standard
+argument7: padding - the padding (NULL means no padding)
+argument8: label smoothing factor
+argument9: the scaling factor of the gradient
+*/
+void _CrossEntropyWithLogitsBackwardJob(TensorList * args)
+{
+    CheckNTErrors(args->count == 2, "invalid argument number!");
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * tensorArgs = (TensorList*)args->GetItem(1);
+    CheckNTErrors(indexArgs->count == 4, "invalid argument number!");
+    CheckNTErrors(tensorArgs->count == 6, "invalid argument number!");
+
+    XTensor * dedx = tensorArgs->GetItem(0);
+    XTensor * input = tensorArgs->GetItem(1);
+    XTensor * gold = tensorArgs->GetItem(2);
+    XTensor * padding = tensorArgs->GetItem(3);
+    DTYPE p = *(DTYPE*)(tensorArgs->GetItem(4));
+    DTYPE scale = *(DTYPE*)(tensorArgs->GetItem(5));
+    int x1 = indexArgs->GetItem(0);
+    int x2 = indexArgs->GetItem(2);
+
+    int n = input->GetDim(-1);
+    DTYPE smoothing = p / n;
+    DTYPE confidence = 1.0F - p;
+    DTYPE targetSum = confidence + smoothing * (n - 1);
+
+    int * goldData = (int*)gold->data;
+    DTYPE * paddingData = padding != NULL ? (DTYPE*)padding->data : NULL;
+
+    for(int k = x1; k <= x2; k++){
+        DTYPE * ip = (DTYPE*)input->data + (MTYPE)k * n;
+        DTYPE * gp = (DTYPE*)dedx->data + (MTYPE)k * n;
+
+        if(paddingData != NULL && paddingData[k] == 0){
+            memset(gp, 0, sizeof(DTYPE) * n);
+            continue;
+        }
+
+        int g = goldData[k];
+        CheckNTErrors(g >= 0 && g < n, "Illegal index of the gold standard!");
+
+        DTYPE max;
+        DTYPE sum;
+        XEWMaxSumExp(ip, n, &max, &sum);
+        DTYPE logZ = max + (DTYPE)log(sum);
+
+        /* dE/dx_i = (sum_j t_j) * softmax(x)_i - t_i */
+        XEWExpAffine(ip, gp, n, logZ, targetSum * scale, -smoothing * scale);
+
+        gp[g] -= (confidence - smoothing) * scale;
+    }
+}
+
+/*
+backward computation of the cross entropy loss with logits
+
+loss = sum_{i} (-t_i * log(softmax(x)_i))
+dE/dx_i = (sum_{j} t_j) * softmax(x)_i - t_i
+
+The gradient is averaged over the positions that are not padded, as in
+_CrossEntropyBackward(...). It goes to dE/dx directly and we do not need to
+compute the backward of the softmax function. log Z is computed again here
+(rather than kept in the forward pass) so that no extra memory is occupied
+between the forward and backward passes.
+
+>> dedx - dE/dx (for return)
+>> input - the logits
+>> gold - indices of the gold standard
+>> labelSmoothingP - label smoothing factor
+>> padding - specify a target value that is ignored and does not contribute to the loss computation
+*/
+void _CrossEntropyWithLogitsBackward(XTensor * dedx, const XTensor * input,
+                                     const XTensor * gold, DTYPE labelSmoothingP,
+                                     const XTensor * padding)
+{
+    CheckCrossEntropyWithLogits(input, gold, dedx, padding);
+    CheckNTErrors(_IsSameShaped(dedx, input), "The gradient tensor and input tensor must be same shape!");
+
+    int rowNum = gold->unitNum;
+    int nonZeroNum = rowNum;
+
+    if(padding != NULL) {
+        DTYPE * paddingData = (DTYPE*)padding->data;
+        nonZeroNum = 0;
+        for(int i = 0; i < rowNum; i++){
+            if(paddingData[i] != 0)
+                nonZeroNum++;
+        }
+    }
+
+    DTYPE scale = nonZeroNum > 0 ? (DTYPE)1.0/(DTYPE)nonZeroNum : 0;
+
+    RunParallel2D(globalPRunner, (void*)_CrossEntropyWithLogitsBackwardJob, input->unitNum,
+                  rowNum, 1, 6,
+                  dedx, input, gold, padding, &labelSmoothingP, &scale);
+}
+
 } // namespace nts(NiuTrans.Tensor)
@@ -75,6 +75,25 @@ void _CrossEntropyBackward(XTensor * dedy, const XTensor * output,
                            const XTensor * gold, const XTensor * weight = NULL, 
                            XTensor * padding = NULL, int leadingDim = -1);
 
+/* compute the cross entropy loss from the logits and the indices of the gold standard
+   (softmax and cross entropy in one pass) */
+void _CrossEntropyWithLogits(const XTensor * input, const XTensor * gold,
+                             XTensor * loss, DTYPE labelSmoothingP = 0,
+                             const XTensor * padding = NULL);
+
+/* compute the cross entropy loss from the logits and the indices of the gold standard */
+XTensor CrossEntropyWithLogits(const XTensor & input, const XTensor & gold,
+                               DTYPE labelSmoothingP = 0);
+
+/* compute the cross entropy loss from the logits and the indices of the gold standard with padding */
+XTensor CrossEntropyWithLogits(const XTensor & input, const XTensor & gold,
+                               const XTensor & padding, DTYPE labelSmoothingP = 0);
+
+/* backward computation of the cross entropy loss with logits (dE/dx) */
+void _CrossEntropyWithLogitsBackward(XTensor * dedx, const XTensor * input,
+                                     const XTensor * gold, DTYPE labelSmoothingP = 0,
+                                     const XTensor * padding = NULL);
+
 } // namespace nts(NiuTrans.Tensor)
 
 #endif // __CROSSENTROPY_H__
\ No newline at end of file
@@ -0,0 +1,47 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include "Bench.h"
+
+namespace nts { // namespace nts(NiuTrans.Tensor)
+
+/* benchmarks (they report the speed of the utilities, and Test() does not run them) */
+bool Bench()
+{
+    bool wrong = false;
+    XPRINT(0, stdout, "Benchmarking the XTensor utilities ... \n\n");
+
+    wrong = !BenchXQueue() || wrong;
+    wrong = !BenchXPRunner() || wrong;
+    wrong = !BenchXElementWise() || wrong;
+    wrong = !BenchXExpression() || wrong;
+
+    if (wrong) {
+        XPRINT(0, stdout, "Something goes wrong! Please check the code!\n");
+        return false;
+    }
+    else {
+        XPRINT(0, stdout, "OK! Everything is done!\n");
+        return true;
+    }
+}
+
+} // namespace nts(NiuTrans.Tensor)
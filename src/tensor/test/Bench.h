@@ -0,0 +1,37 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "TXQueue.h"
+#include "TXPRunner.h"
+#include "TXElementWise.h"
+#include "TXExpression.h"
+
+namespace nts { // namespace nts(NiuTrans.Tensor)
+
+/* benchmarks (they report the speed of the utilities, and Test() does not run them) */
+bool Bench();
+
+} // namespace nts(NiuTrans.Tensor)
+
+#endif // __BENCH_H__
@@ -407,6 +407,108 @@ bool TestCrossEntropy4()
 #endif // USE_CUDA
 }
 
+/*
+case 5: test CrossEntropyWithLogits function.
+loss = sum_{i} (-t_i * log(softmax(x)_i))
+dE/dx_i = (sum_{j} t_j) * softmax(x)_i - t_i
+where x is the logits and t is the gold standard given by indices (with
+label smoothing). The results are compared with those computed in double
+precision.
+*/
+bool TestCrossEntropy5()
+{
+    /* logits of size (2, 3, 37) and indices of size (2, 3) */
+    int rowNum = 6;
+    int n = 37;
+    int inputDimSize[3] = {2, 3, 37};
+    int goldDimSize[2] = {2, 3};
+    DTYPE p = 0.1F;
+
+    DTYPE * inputData = new DTYPE[rowNum * n];
+    int goldData[6] = {0, 36, 5, 17, 2, 30};
+    DTYPE paddingData[6] = {1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 0.0F};
+
+    for (int i = 0; i < rowNum * n; i++)
+        inputData[i] = (DTYPE)(4.0 * sin(0.37 * i + 0.5));
+
+    /* the answer */
+    double * lossAnswer = new double[rowNum];
+    double * gradAnswer = new double[rowNum * n];
+    double smoothing = p / n;
+    double confidence = 1.0 - p;
+    int nonZeroNum = 0;
+    for (int k = 0; k < rowNum; k++) {
+        if (paddingData[k] != 0)
+            nonZeroNum++;
+    }
+
+    for (int k = 0; k < rowNum; k++) {
+        DTYPE * x = inputData + k * n;
+        double max = x[0];
+        for (int i = 1; i < n; i++)
+            max = x[i] > max ? x[i] : max;
+        double sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += exp(x[i] - max);
+        double logZ = max + log(sum);
+
+        double loss = 0;
+        for (int i = 0; i < n; i++) {
+            double t = i == goldData[k] ? confidence : smoothing;
+            loss -= t * (x[i] - logZ);
+        }
+        lossAnswer[k] = loss * paddingData[k];
+
+        for (int i = 0; i < n; i++) {
+            double t = i == goldData[k] ? confidence : smoothing;
+            double tSum = confidence + smoothing * (n - 1);
+            double g = tSum * exp(x[i] - logZ) - t;
+            gradAnswer[k * n + i] = paddingData[k] != 0 ? g / nonZeroNum : 0;
+        }
+    }
+
+    /* CPU test */
+    bool cpuTest = true;
+
+    /* create tensors */
+    XTensor * input = NewTensorV2(3, inputDimSize);
+    XTensor * gold = NewTensorV2(2, goldDimSize, X_INT);
+    XTensor * padding = NewTensorV2(2, goldDimSize);
+    XTensor * loss = NewTensorV2(2, goldDimSize);
+    XTensor * dedx = NewTensorV2(3, inputDimSize);
+
+    /* initialize variables */
+    input->SetData(inputData, rowNum * n);
+    gold->SetData(goldData, rowNum);
+    padding->SetData(paddingData, rowNum);
+
+    /* call CrossEntropyWithLogits function */
+    _CrossEntropyWithLogits(input, gold, loss, p, padding);
+    _CrossEntropyWithLogitsBackward(dedx, input, gold, p, padding);
+
+    /* check results */
+    for (int k = 0; k < rowNum; k++) {
+        if (fabs(((DTYPE*)loss->data)[k] - lossAnswer[k]) > 1e-5)
+            cpuTest = false;
+    }
+    for (int i = 0; i < rowNum * n; i++) {
+        if (fabs(((DTYPE*)dedx->data)[i] - gradAnswer[i]) > 1e-6)
+            cpuTest = false;
+    }
+
+    /* destroy variables */
+    delete input;
+    delete gold;
+    delete padding;
+    delete loss;
+    delete dedx;
+    delete[] inputData;
+    delete[] lossAnswer;
+    delete[] gradAnswer;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
 TODO!!
@@ -454,6 +556,15 @@ bool TestCrossEntropy()
     else
         XPRINT(0, stdout, ">> case 4 passed!\n");
 
+    /* case 5 test */
+    caseFlag = TestCrossEntropy5();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 5 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 5 passed!\n");
+
     ///* other cases test */
     ///*
     //TODO!!
@@ -19,6 +19,7 @@
 * $Created by: Xu Chen (email: hello_master1954@163.com) 2018-07-02
 */
 
+#include <math.h>
 #include "../XUtility.h"
 #include "../core/utilities/CheckData.h"
 #include "TLogSoftmax.h"
@@ -312,6 +313,87 @@ bool TestLogSoftmax3()
 #endif // USE_CUDA
 }
 
+/* 
+case 4: test LogSoftmax function on long rows and along a non-last dimension.
+The answer is computed in double precision.
+*/
+bool TestLogSoftmax4()
+{
+    /* a tensor of size (3, 1000) */
+    int order = 2;
+    int * dimSize = new int[order];
+    dimSize[0] = 3;
+    dimSize[1] = 1000;
+
+    int unitNum = 1;
+    for (int i = 0; i < order; i++)
+        unitNum *= dimSize[i];
+
+    DTYPE * xData = new DTYPE[unitNum];
+    DTYPE * answer = new DTYPE[unitNum];
+    DTYPE * answerCol = new DTYPE[unitNum];
+
+    srand(1);
+    for (int i = 0; i < unitNum; i++)
+        xData[i] = (DTYPE)(rand() % 2000) / 100.0F - 10.0F;
+
+    /* log-softmax along dimension 1 (rows) */
+    for (int i = 0; i < dimSize[0]; i++) {
+        DTYPE * row = xData + i * dimSize[1];
+        double max = row[0];
+        double sum = 0;
+        for (int j = 0; j < dimSize[1]; j++)
+            max = MAX(max, (double)row[j]);
+        for (int j = 0; j < dimSize[1]; j++)
+            sum += exp(row[j] - max);
+        for (int j = 0; j < dimSize[1]; j++)
+            answer[i * dimSize[1] + j] = (DTYPE)MAX(row[j] - max - log(sum), (double)LOGPROB_MIN);
+    }
+
+    /* log-softmax along dimension 0 (columns) */
+    for (int j = 0; j < dimSize[1]; j++) {
+        double max = xData[j];
+        double sum = 0;
+        for (int i = 0; i < dimSize[0]; i++)
+            max = MAX(max, (double)xData[i * dimSize[1] + j]);
+        for (int i = 0; i < dimSize[0]; i++)
+            sum += exp(xData[i * dimSize[1] + j] - max);
+        for (int i = 0; i < dimSize[0]; i++)
+            answerCol[i * dimSize[1] + j] = (DTYPE)MAX(xData[i * dimSize[1] + j] - max - log(sum), (double)LOGPROB_MIN);
+    }
+
+    /* CPU test */
+    bool cpuTest = true;
+
+    /* create tensors */
+    XTensor * x = NewTensorV2(order, dimSize);
+    XTensor * y = NewTensorV2(order, dimSize);
+    XTensor * yCol = NewTensorV2(order, dimSize);
+
+    /* initialize variables */
+    x->SetData(xData, unitNum);
+    y->SetZeroAll();
+    yCol->SetZeroAll();
+
+    /* call LogSoftmax function */
+    _LogSoftmax(x, y, 1);
+    _LogSoftmax(x, yCol, 0);
+
+    /* check result */
+    cpuTest = _CheckData(y, answer, unitNum, 1e-4F) && _CheckData(yCol, answerCol, unitNum, 1e-4F);
+
+    /* destroy variables */
+    delete x;
+    delete y;
+    delete yCol;
+    delete[] xData;
+    delete[] answer;
+    delete[] answerCol;
+    delete[] dimSize;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
     TODO!!
@@ -353,6 +435,16 @@ bool TestLogSoftmax()
     else
         XPRINT(0, stdout, ">> case 3 passed!\n");
 
+    /* case 4 test */
+    caseFlag = TestLogSoftmax4();
+
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 4 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 4 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
@@ -114,6 +114,93 @@ bool TestScaleAndShift1()
 #endif // USE_CUDA
 }
 
+/*
+case 2: the operators of a tensor and a number (the number on either side).
+s + p, s - p, s * p, s / p, p - s and p / s
+*/
+bool TestScaleAndShift2()
+{
+    /* a input tensor of size (2, 4) */
+    int sOrder = 2;
+    int * sDimSize = new int[sOrder];
+    sDimSize[0] = 2;
+    sDimSize[1] = 4;
+
+    int sUnitNum = 1;
+    for (int i = 0; i < sOrder; i++)
+        sUnitNum *= sDimSize[i];
+
+    DTYPE sData[2][4] = { {1.0F, 2.0F, 4.0F, 8.0F},
+                          {-0.5F, -1.0F, -2.0F, -4.0F} };
+    DTYPE answerAdd[2][4] = { {3.0F, 4.0F, 6.0F, 10.0F},
+                              {1.5F, 1.0F, 0.0F, -2.0F} };
+    DTYPE answerSub[2][4] = { {1.0F, 0.0F, -2.0F, -6.0F},
+                              {2.5F, 3.0F, 4.0F, 6.0F} };
+    DTYPE answerMul[2][4] = { {2.0F, 4.0F, 8.0F, 16.0F},
+                              {-1.0F, -2.0F, -4.0F, -8.0F} };
+    DTYPE answerDiv[2][4] = { {2.0F, 1.0F, 0.5F, 0.25F},
+                              {-4.0F, -2.0F, -1.0F, -0.5F} };
+    DTYPE answerSubBy[2][4] = { {-1.0F, 0.0F, 2.0F, 6.0F},
+                                {-2.5F, -3.0F, -4.0F, -6.0F} };
+    DTYPE answerDivBy[2][4] = { {0.5F, 1.0F, 2.0F, 4.0F},
+                                {-0.25F, -0.5F, -1.0F, -2.0F} };
+
+    DTYPE number = 2.0F;
+
+    /* CPU test */
+    bool cpuTest = true;
+
+    /* create tensors */
+    XTensor * s = NewTensorV2(sOrder, sDimSize);
+
+    /* initialize variables */
+    s->SetData(sData, sUnitNum);
+
+    /* call the operators */
+    XTensor tAdd = number + *s;
+    XTensor tSub = number - *s;
+    XTensor tMul = number * *s;
+    XTensor tDiv = number / *s;
+    XTensor tSubBy = *s - number;
+    XTensor tDivBy = *s / number;
+
+    /* check results */
+    cpuTest = _CheckData(&tAdd, answerAdd, sUnitNum) && _CheckData(&tSub, answerSub, sUnitNum) &&
+              _CheckData(&tMul, answerMul, sUnitNum) && _CheckData(&tDiv, answerDiv, sUnitNum) &&
+              _CheckData(&tSubBy, answerSubBy, sUnitNum) && _CheckData(&tDivBy, answerDivBy, sUnitNum);
+
+#ifdef USE_CUDA
+    /* GPU test */
+    bool gpuTest = true;
+
+    /* create tensors */
+    XTensor * sGPU = NewTensorV2(sOrder, sDimSize, X_FLOAT, 1.0F, 0);
+
+    /* initialize variables */
+    sGPU->SetData(sData, sUnitNum);
+
+    /* call the operators */
+    XTensor tSubGPU = number - *sGPU;
+    XTensor tDivGPU = number / *sGPU;
+
+    /* check results */
+    gpuTest = _CheckData(&tSubGPU, answerSub, sUnitNum) && _CheckData(&tDivGPU, answerDiv, sUnitNum);
+
+    /* destroy variables */
+    delete s;
+    delete sGPU;
+    delete[] sDimSize;
+
+    return cpuTest && gpuTest;
+#else
+    /* destroy variables */
+    delete s;
+    delete[] sDimSize;
+
+    return cpuTest;
+#endif // USE_CUDA
+}
+
 /* other cases */
 /*
 TODO!!
@@ -134,6 +221,15 @@ bool TestScaleAndShift()
     else
         XPRINT(0, stdout, ">> case 1 passed!\n");
 
+    /* case 2 test */
+    caseFlag = TestScaleAndShift2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
@@ -19,8 +19,11 @@
  * $Created by: Xu Chen (email: hello_master1954@163.com) 2018-07-06
  */
 
+#include <math.h>
 #include "../core/utilities/CheckData.h"
 #include "../core/getandset/SetData.h"
+#include "../XRand.h"
+#include "TUtility.h"
 #include "TSetData.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
@@ -469,6 +472,88 @@ bool TestSetData6()
 #endif // USE_CUDA
 }
 
+/*
+case 7: test the counter-based random number generator.
+The generator should give the numbers of Philox-4x32-10, and an array
+should be the same however many threads fill it.
+*/
+bool TestSetData7()
+{
+    bool cpuTest = true;
+
+    /* known answers of Philox-4x32-10 */
+    unsigned int r[4];
+    unsigned int answer1[4] = {0x6627e8d5U, 0xe169c58dU, 0xbc57ac4cU, 0x9b00dbd8U};
+    unsigned int answer2[4] = {0x408f276dU, 0x41c83b0eU, 0xa20bc7c6U, 0x6d5451fdU};
+    XRandStream s1 = XRandSeededStream(0, 0);
+    XRandStream s2 = XRandSeededStream(0xFFFFFFFFFFFFFFFFULL, -1);
+    s2.stream[1] = 0xFFFFFFFFU;
+
+    Philox4x32(s1, 0, r);
+    for (int i = 0; i < 4; i++)
+        cpuTest = cpuTest && r[i] == answer1[i];
+
+    Philox4x32(s2, 0xFFFFFFFFFFFFFFFFULL, r);
+    for (int i = 0; i < 4; i++)
+        cpuTest = cpuTest && r[i] == answer2[i];
+
+    /* a uniform array (an odd size to have a tail) against the generator itself */
+    int unitNum = 100003;
+    float * d1 = new float[unitNum];
+    float * d2 = new float[unitNum];
+    XRandStream s = XRandSeededStream(20, 7);
+
+    XRandFill(s, RAND_UNIFORM, d1, unitNum, -1.0F, 1.0F);
+    double sum = 0;
+    for (int i = 0; i < unitNum; i++) {
+        Philox4x32(s, i / 4, r);
+        float u = (r[i % 4] >> 8) * (1.0F / 16777216.0F);
+        if (fabs(d1[i] - (-1.0F + 2.0F * u)) > 1e-6F || d1[i] < -1.0F || d1[i] >= 1.0F)
+            cpuTest = false;
+        sum += d1[i];
+    }
+    cpuTest = cpuTest && fabs(sum / unitNum) < 0.01;
+
+    /* the normal distribution with one thread and four threads */
+    {
+        TestRunnerScope runnerScope(0);
+        XRandFill(s, RAND_NORMAL, d1, unitNum, 0.0F, 1.0F);
+    }
+    {
+        TestRunnerScope runnerScope(4);
+        XRandFill(s, RAND_NORMAL, d2, unitNum, 0.0F, 1.0F);
+    }
+
+    double mean = 0;
+    double var = 0;
+    for (int i = 0; i < unitNum; i++) {
+        if (d1[i] != d2[i])
+            cpuTest = false;
+        mean += d1[i];
+        var += d1[i] * d1[i];
+    }
+    mean /= unitNum;
+    var = var / unitNum - mean * mean;
+    cpuTest = cpuTest && fabs(mean) < 0.02 && fabs(var - 1.0) < 0.02;
+
+    /* a dropout mask */
+    XRandFill(s, RAND_BERNOULLI, d1, unitNum, 0.2F, 1.25F);
+    int zeroNum = 0;
+    for (int i = 0; i < unitNum; i++) {
+        if (d1[i] == 0)
+            zeroNum++;
+        else if (d1[i] != 1.25F)
+            cpuTest = false;
+    }
+    cpuTest = cpuTest && fabs((double)zeroNum / unitNum - 0.2) < 0.01;
+
+    /* destroy variables */
+    delete[] d1;
+    delete[] d2;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
 TODO!!
@@ -534,6 +619,15 @@ bool TestSetData()
     else
         XPRINT(0, stdout, ">> case 6 passed!\n");
 
+    /* case 7 test */
+    caseFlag = TestSetData7();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 7 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 7 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
@@ -19,9 +19,11 @@
 * $Created by: Xu Chen (email: hello_master1954@163.com) 2018-06-19
 */
 
+#include <math.h>
 #include "../XTensor.h"
 #include "../XUtility.h"
 #include "../core/utilities/CheckData.h"
+#include "../function/LogSoftmax.h"
 #include "TSoftmax.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
@@ -208,6 +210,167 @@ bool TestSoftmax2()
 #endif // USE_CUDA
 }
 
+/* 
+case 3: test Softmax function on long rows and along a non-last dimension.
+The answer is computed in double precision.
+*/
+bool TestSoftmax3()
+{
+    /* a tensor of size (3, 1000) */
+    int order = 2;
+    int * dimSize = new int[order];
+    dimSize[0] = 3;
+    dimSize[1] = 1000;
+
+    int unitNum = 1;
+    for (int i = 0; i < order; i++)
+        unitNum *= dimSize[i];
+
+    DTYPE * xData = new DTYPE[unitNum];
+    DTYPE * answer = new DTYPE[unitNum];
+    DTYPE * answerCol = new DTYPE[unitNum];
+
+    srand(1);
+    for (int i = 0; i < unitNum; i++)
+        xData[i] = (DTYPE)(rand() % 2000) / 100.0F - 10.0F;
+
+    /* softmax along dimension 1 (rows) */
+    for (int i = 0; i < dimSize[0]; i++) {
+        DTYPE * row = xData + i * dimSize[1];
+        double max = row[0];
+        double sum = 0;
+        for (int j = 0; j < dimSize[1]; j++)
+            max = MAX(max, (double)row[j]);
+        for (int j = 0; j < dimSize[1]; j++)
+            sum += exp(row[j] - max);
+        for (int j = 0; j < dimSize[1]; j++)
+            answer[i * dimSize[1] + j] = (DTYPE)(exp(row[j] - max) / sum);
+    }
+
+    /* softmax along dimension 0 (columns) */
+    for (int j = 0; j < dimSize[1]; j++) {
+        double max = xData[j];
+        double sum = 0;
+        for (int i = 0; i < dimSize[0]; i++)
+            max = MAX(max, (double)xData[i * dimSize[1] + j]);
+        for (int i = 0; i < dimSize[0]; i++)
+            sum += exp(xData[i * dimSize[1] + j] - max);
+        for (int i = 0; i < dimSize[0]; i++)
+            answerCol[i * dimSize[1] + j] = (DTYPE)(exp(xData[i * dimSize[1] + j] - max) / sum);
+    }
+
+    /* CPU test */
+    bool cpuTest = true;
+
+    /* create tensors */
+    XTensor * x = NewTensorV2(order, dimSize);
+    XTensor * y = NewTensorV2(order, dimSize);
+    XTensor * yCol = NewTensorV2(order, dimSize);
+
+    /* initialize variables */
+    x->SetData(xData, unitNum);
+    y->SetZeroAll();
+    yCol->SetZeroAll();
+
+    /* call Softmax function */
+    _Softmax(x, y, 1);
+    _Softmax(x, yCol, 0);
+
+    /* check result */
+    cpuTest = _CheckData(y, answer, unitNum, 1e-6F) && _CheckData(yCol, answerCol, unitNum, 1e-6F);
+
+    /* destroy variables */
+    delete x;
+    delete y;
+    delete yCol;
+    delete[] xData;
+    delete[] answer;
+    delete[] answerCol;
+    delete[] dimSize;
+
+    return cpuTest;
+}
+
+/* 
+case 4: test Softmax and LogSoftmax functions on masked rows and columns,
+i.e., all the inputs are -inf. Softmax gives 0 and LogSoftmax gives
+LOGPROB_MIN there, and the other rows (columns) are not affected.
+*/
+bool TestSoftmax4()
+{
+    /* a tensor of size (3, 40) */
+    int order = 2;
+    int * dimSize = new int[order];
+    dimSize[0] = 3;
+    dimSize[1] = 40;
+
+    int unitNum = 1;
+    for (int i = 0; i < order; i++)
+        unitNum *= dimSize[i];
+
+    /* row 1 and column 5 are masked */
+    DTYPE * xData = new DTYPE[unitNum];
+    for (int i = 0; i < dimSize[0]; i++) {
+        for (int j = 0; j < dimSize[1]; j++) {
+            bool masked = i == 1 || j == 5;
+            xData[i * dimSize[1] + j] = masked ? -INFINITY : (DTYPE)(j % 7) / 2.0F;
+        }
+    }
+
+    /* CPU test */
+    bool cpuTest = true;
+
+    /* create tensors */
+    XTensor * x = NewTensorV2(order, dimSize);
+    XTensor * y = NewTensorV2(order, dimSize);
+    XTensor * yCol = NewTensorV2(order, dimSize);
+    XTensor * yLog = NewTensorV2(order, dimSize);
+    XTensor * yLogCol = NewTensorV2(order, dimSize);
+
+    /* initialize variables */
+    x->SetData(xData, unitNum);
+
+    /* call Softmax and LogSoftmax functions */
+    _Softmax(x, y, 1);
+    _Softmax(x, yCol, 0);
+    _LogSoftmax(x, yLog, 1);
+    _LogSoftmax(x, yLogCol, 0);
+
+    /* check results */
+    DTYPE * yp = (DTYPE*)y->data;
+    DTYPE * ycp = (DTYPE*)yCol->data;
+    DTYPE * ylp = (DTYPE*)yLog->data;
+    DTYPE * ylcp = (DTYPE*)yLogCol->data;
+    for (int i = 0; i < dimSize[0]; i++) {
+        double sum = 0;
+        for (int j = 0; j < dimSize[1]; j++) {
+            int k = i * dimSize[1] + j;
+            if (i == 1) {
+                cpuTest = cpuTest && yp[k] == 0 && ylp[k] == LOGPROB_MIN;
+            }
+            if (j == 5) {
+                cpuTest = cpuTest && ycp[k] == 0 && ylcp[k] == LOGPROB_MIN;
+            }
+            cpuTest = cpuTest && yp[k] == yp[k] && ycp[k] == ycp[k];
+            cpuTest = cpuTest && ylp[k] == ylp[k] && ylcp[k] == ylcp[k];
+            sum += yp[k];
+        }
+        if (i != 1)
+            cpuTest = cpuTest && fabs(sum - 1.0) < 1e-5;
+    }
+
+    /* destroy variables */
+    delete x;
+    delete y;
+    delete yCol;
+    delete yLog;
+    delete yLogCol;
+    delete[] xData;
+    delete[] dimSize;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
     TODO!!
@@ -239,6 +402,25 @@ bool TestSoftmax()
     else
         XPRINT(0, stdout, ">> case 2 passed!\n");
 
+    /* case 3 test */
+    caseFlag = TestSoftmax3();
+
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
+    /* case 4 test */
+    caseFlag = TestSoftmax4();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 4 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 4 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
@@ -19,6 +19,8 @@
 * $Created by: LI Yinqiao (li.yin.qiao.2012@hotmail.com) 2018-04-30
 */
 
+#include <stdlib.h>
+#include "TUtility.h"
 #include "../core/utilities/CheckData.h"
 #include "TSort.h"
 
@@ -208,6 +210,105 @@ bool TestSort2()
 #endif // USE_CUDA
 }
 
+/*
+check the result of sorting a tensor along a given dimension, i.e., each row
+is in descending order, it is the input row under the index, and items of the
+same value keep their order
+*/
+template<class T>
+bool CheckSort(XTensor * a, int dim)
+{
+    XTensor * b = NewTensorV2(a->order, a->dimSize, a->dataType);
+    XTensor * index = NewTensorV2(a->order, a->dimSize, X_INT);
+    _Sort(a, b, index, dim);
+
+    int n = a->dimSize[dim];
+    int stride = 1;
+    int blockNum = 1;
+    for (int i = 0; i < dim; i++)
+        blockNum *= a->dimSize[i];
+    for (int i = dim + 1; i < a->order; i++)
+        stride *= a->dimSize[i];
+
+    bool * used = new bool[n];
+    bool ok = true;
+
+    for (int h = 0; h < blockNum && ok; h++) {
+        for (int i = 0; i < stride && ok; i++) {
+            T * rowA = (T*)a->data + h * n * stride + i;
+            T * rowB = (T*)b->data + h * n * stride + i;
+            int * rowIndex = (int*)index->data + h * n * stride + i;
+
+            for (int j = 0; j < n; j++)
+                used[j] = false;
+
+            for (int j = 0; j < n && ok; j++) {
+                int id = rowIndex[j * stride];
+                if (id < 0 || id >= n || used[id] || rowB[j * stride] != rowA[id * stride])
+                    ok = false;
+                else if (j > 0) {
+                    T pre = rowB[(j - 1) * stride];
+                    T cur = rowB[j * stride];
+                    if (pre < cur || (pre == cur && rowIndex[(j - 1) * stride] > id))
+                        ok = false;
+                }
+                if (ok)
+                    used[id] = true;
+            }
+        }
+    }
+
+    delete[] used;
+    delete b;
+    delete index;
+
+    return ok;
+}
+
+/*
+case 3: sort larger tensors (short rows, long rows and a very long row that
+is sorted by several threads) with many equal values.
+In this case, float (5, 300, 7) along each dimension, float (1, 300000) and
+int (4, 1000) along dim = 1.
+*/
+bool TestSort3()
+{
+    int sDimSize[3] = {5, 300, 7};
+    int lDimSize[2] = {1, 300000};
+    int iDimSize[2] = {4, 1000};
+
+    XTensor * s = NewTensorV2(3, sDimSize);
+    XTensor * l = NewTensorV2(2, lDimSize);
+    XTensor * t = NewTensorV2(2, iDimSize, X_INT);
+
+    srand(1);
+    for (int i = 0; i < s->unitNum; i++)
+        ((float*)s->data)[i] = (float)(rand() % 41 - 20) / 4.0F;
+    for (int i = 0; i < l->unitNum; i++)
+        ((float*)l->data)[i] = ((float)rand() / RAND_MAX - 0.5F) * 1000.0F;
+    for (int i = 0; i < t->unitNum; i++)
+        ((int*)t->data)[i] = rand() % 2001 - 1000;
+
+    /* -0 and 0 are the same value */
+    ((float*)s->data)[0] = -0.0F;
+    ((float*)s->data)[7] = 0.0F;
+
+    bool cpuTest = true;
+    {
+        TestRunnerScope runnerScope(4);
+        for (int dim = 0; dim < 3; dim++)
+            cpuTest = cpuTest && CheckSort<float>(s, dim);
+        cpuTest = cpuTest && CheckSort<float>(l, 1);
+        cpuTest = cpuTest && CheckSort<int>(t, 1);
+    }
+
+    delete s;
+    delete l;
+    delete t;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
 TODO!!
@@ -237,6 +338,15 @@ bool TestSort()
     else
         XPRINT(0, stdout, ">> case 2 passed!\n");
 
+    /* case 3 test */
+    caseFlag = TestSort3();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
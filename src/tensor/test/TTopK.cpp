@@ -19,6 +19,8 @@
 * $Created by: Xu Chen (email: hello_master1954@163.com) 2018-06-27
 */
 
+#include <stdlib.h>
+#include "TUtility.h"
 #include "TTopK.h"
 
 namespace nts { // namespace nts(NiuTrans.Tensor)
@@ -488,6 +490,101 @@ bool TestTopK2()
 #endif // USE_CUDA
 }
 
+/*
+check the top-k items of a tensor against a simple selection (larger values
+first, and smaller indices first for the same value)
+*/
+bool CheckTopK(XTensor * s, int dim, int k)
+{
+    int dimSize[MAX_TENSOR_DIM_NUM];
+    for (int i = 0; i < s->order; i++)
+        dimSize[i] = s->dimSize[i];
+    dimSize[dim] = k;
+
+    XTensor * t = NewTensorV2(s->order, dimSize);
+    XTensor * index = NewTensorV2(s->order, dimSize, X_INT);
+    _TopK(s, t, index, dim, k);
+
+    int n = s->dimSize[dim];
+    int stride = 1;
+    int blockNum = 1;
+    for (int i = 0; i < dim; i++)
+        blockNum *= s->dimSize[i];
+    for (int i = dim + 1; i < s->order; i++)
+        stride *= s->dimSize[i];
+
+    bool * used = new bool[n];
+    bool ok = true;
+
+    for (int h = 0; h < blockNum && ok; h++) {
+        for (int i = 0; i < stride && ok; i++) {
+            float * row = (float*)s->data + h * n * stride + i;
+            float * rowT = (float*)t->data + h * k * stride + i;
+            int * rowIndex = (int*)index->data + h * k * stride + i;
+
+            for (int j = 0; j < n; j++)
+                used[j] = false;
+
+            for (int r = 0; r < k; r++) {
+                int best = -1;
+                for (int j = 0; j < n; j++) {
+                    if (!used[j] && (best < 0 || row[j * stride] > row[best * stride]))
+                        best = j;
+                }
+                used[best] = true;
+                if (rowIndex[r * stride] != best || rowT[r * stride] != row[best * stride])
+                    ok = false;
+            }
+        }
+    }
+
+    delete[] used;
+    delete t;
+    delete index;
+
+    return ok;
+}
+
+/*
+case 3: get the top-k items of larger tensors along each dimension (k = 1,
+small k and large k) with many equal values, on several threads.
+In this case, (6, 300, 20) -> (6, k, 20) and (6, 300, k), and (3, 5000) -> (3, k).
+*/
+bool TestTopK3()
+{
+    int sDimSize[3] = {6, 300, 20};
+    int lDimSize[2] = {3, 5000};
+
+    XTensor * s = NewTensorV2(3, sDimSize);
+    XTensor * l = NewTensorV2(2, lDimSize);
+
+    /* the values are integers in [-25, 25), so that there are many ties */
+    srand(1);
+    for (int i = 0; i < s->unitNum; i++)
+        ((float*)s->data)[i] = (float)(rand() % 50 - 25);
+    for (int i = 0; i < l->unitNum; i++)
+        ((float*)l->data)[i] = (float)(rand() % 1000) / 8.0F;
+
+    bool cpuTest = true;
+    {
+        TestRunnerScope runnerScope(4);
+        int kList[5] = {1, 2, 5, 16, 17};
+        for (int i = 0; i < 5; i++) {
+            cpuTest = cpuTest && CheckTopK(s, 0, MIN(kList[i], 6));
+            cpuTest = cpuTest && CheckTopK(s, 1, kList[i]);
+            cpuTest = cpuTest && CheckTopK(s, 2, kList[i]);
+            cpuTest = cpuTest && CheckTopK(l, 1, kList[i]);
+        }
+        cpuTest = cpuTest && CheckTopK(s, 1, 100);
+        cpuTest = cpuTest && CheckTopK(l, 1, 300);
+    }
+
+    delete s;
+    delete l;
+
+    return cpuTest;
+}
+
 /* other cases */
 /*
 TODO!!
@@ -517,6 +614,15 @@ bool TestTopK()
     else
         XPRINT(0, stdout, ">> case 2 passed!\n");
 
+    /* case 3 test */
+    caseFlag = TestTopK3();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
     /* other cases test */
     /*
     TODO!!
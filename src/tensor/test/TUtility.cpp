@@ -0,0 +1,48 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include "TUtility.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/*
+constructor
+>> threadNum - number of the threads (0 for no runner)
+*/
+TestRunnerScope::TestRunnerScope(int threadNum)
+{
+    runner = NULL;
+    if (threadNum > 0) {
+        runner = new XPRunner();
+        runner->Init(threadNum);
+    }
+    backup = globalPRunner;
+    globalPRunner = runner;
+}
+
+/* de-constructor */
+TestRunnerScope::~TestRunnerScope()
+{
+    globalPRunner = backup;
+    delete runner;
+}
+
+} // namespace nts(NiuTrans.Tensor)
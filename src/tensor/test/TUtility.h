@@ -0,0 +1,52 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Helpers shared by the tests.
+ *
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#ifndef __TUTILITY_H__
+#define __TUTILITY_H__
+
+#include "../XPRunner.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/*
+globalPRunner is replaced by a runner of threadNum threads (or by NULL if
+threadNum is 0, i.e., everything runs on the calling thread) in a scope,
+and the old one is put back when the scope ends
+*/
+struct TestRunnerScope
+{
+    /* the runner of the scope */
+    XPRunner * runner;
+
+    /* the runner before the scope */
+    XPRunner * backup;
+
+    /* constructor */
+    explicit TestRunnerScope(int threadNum = 4);
+
+    /* de-constructor */
+    ~TestRunnerScope();
+};
+
+} // namespace nts(NiuTrans.Tensor)
+#endif // __TUTILITY_H__
@@ -0,0 +1,442 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <math.h>
+#include <string.h>
+#include "../XGlobal.h"
+#include "../XUtility.h"
+#include "TUtility.h"
+#include "TXElementWise.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/* distance of two floats in ulp (two nans are the same, and so are 0 and -0) */
+long long ULPDistance(float a, float b)
+{
+    if(a != a || b != b)
+        return (a != a && b != b) ? 0 : (1LL << 40);
+
+    int ia;
+    int ib;
+    memcpy(&ia, &a, sizeof(int));
+    memcpy(&ib, &b, sizeof(int));
+    long long la = ia < 0 ? -(long long)(ia & 0x7FFFFFFF) : ia;
+    long long lb = ib < 0 ? -(long long)(ib & 0x7FFFFFFF) : ib;
+    return la > lb ? la - lb : lb - la;
+}
+
+/* x^p as _Power computes it (in double precision) */
+float RefPower(float x, float p)
+{
+    if(p == 0)
+        return 1.0F;
+    if(p == 0.5F)
+        return sqrtf(x);
+    if(x == 0 && p < 0)
+        return 1e20F;
+    return (float)pow((double)x, (double)p);
+}
+
+/* a unary function of the engine computed by libm */
+float RefUnary(int op, float x, float p0, float p1)
+{
+    switch(op){
+    case EW_ABSOLUTE:        return fabsf(x);
+    case EW_CEIL:            return ceilf(x);
+    case EW_EXP:             return (float)exp((double)x);
+    case EW_FLOOR:           return floorf(x);
+    case EW_ISNONZERO:       return x != 0 ? 1.0F : 0.0F;
+    case EW_ISZERO:          return x == 0 ? 1.0F : 0.0F;
+    case EW_LOG:             return (float)log((double)x);
+    case EW_NEGATE:          return -x;
+    case EW_ROUND:           return roundf(x);
+    case EW_SIGN:            return x > 0 ? 1.0F : (x == 0 ? 0.0F : -1.0F);
+    case EW_SQRT:            return sqrtf(x);
+    case EW_SQUARE:          return x * x;
+    case EW_SIN:             return sinf(x);
+    case EW_COS:             return cosf(x);
+    case EW_TAN:             return tanf(x);
+    case EW_TANH:            return (float)tanh((double)x);
+    case EW_SIGMOID:         return (float)(1.0 / (1.0 + exp(-(double)x)));
+    case EW_RECTIFY:         return x < 0 ? 0.0F : x;
+    case EW_HARDTANH:        return x > 1.0F ? 1.0F : (x < -1.0F ? -1.0F : x);
+    case EW_SCALE:           return x * p0;
+    case EW_DESCALE:         return x / p0;
+    case EW_SHIFT:           return x + p0;
+    case EW_SCALE_AND_SHIFT: return fmaf(x, p0, p1);
+    case EW_POWER:           return RefPower(x, p0);
+    }
+    return 0;
+}
+
+/* a binary function of the engine */
+float RefBinary(int op, float x, float y, float c, float alpha)
+{
+    switch(op){
+    case EW_MULTIPLY:          return alpha == 0 ? x * y : fmaf(x, y, alpha * c);
+    case EW_DIV:               return alpha == 0 ? x / y : fmaf(alpha, c, x / y);
+    case EW_SIGMOID_BACKWARD:  return (y * x) * (1.0F - x);
+    case EW_RECTIFY_BACKWARD:  return x < 0 ? 0.0F : y;
+    case EW_HARDTANH_BACKWARD: return (x > 1.0F || x < -1.0F) ? 0.0F : y;
+    case EW_SUM:               return x + y;
+    case EW_SUB:               return x - y;
+    case EW_SUM_SCALED:        return fmaf(y, alpha, x);
+    }
+    return 0;
+}
+
+/* the max error (in ulp) of a unary function */
+long long MaxULP(int op, float p0)
+{
+    switch(op){
+    case EW_EXP:     return 2;
+    case EW_LOG:     return 2;
+    case EW_TANH:    return 3;
+    case EW_SIGMOID: return 3;
+    case EW_POWER:   return 2 + (long long)fabsf(p0);
+    }
+    return 0;
+}
+
+/* random numbers and the special values */
+void FillElementWiseInput(float * a, int n)
+{
+    const float specials[] = {0.0F, -0.0F, 1.0F, -1.0F, INFINITY, -INFINITY, NAN,
+                              1e-40F, -1e-40F, 1.17549435e-38F, 0.5F, -0.5F, 2.5F, -2.5F,
+                              1.5F, 88.5F, 89.0F, -100.0F, 1e30F, -1e30F};
+    const int specialNum = sizeof(specials) / sizeof(float);
+
+    for(int i = 0; i < n; i++)
+        a[i] = (float)rand() / RAND_MAX * 40.0F - 20.0F;
+    for(int i = 0; i < specialNum; i++)
+        a[(i * 37) % n] = specials[i];
+}
+
+/*
+case 1: the results of all the functions on each instruction set of the CPU.
+The arrays are unaligned, of odd sizes, and have the special values (0, inf,
+nan and subnormal numbers).
+*/
+bool TestXElementWiseCase1()
+{
+    bool ok = true;
+
+    const int maxN = 1024;
+    const int guardNum = 4;
+    const float guard = 12345.0F;
+    const int lens[] = {1, 7, 16, 33, 1000};
+    const int offsets[] = {0, 1, 3};
+    const float powers[] = {3.0F, -2.0F, -5.0F, 2.5F, -1.5F, 0.3F, 0.5F, 0.0F, 2.0F, 7.7F};
+    const float alphas[] = {0.0F, 0.5F};
+
+    float * a = new float[maxN + 8];
+    float * b = new float[maxN + 8];
+    float * c = new float[maxN + 8];
+    float * r = new float[maxN + 8 + guardNum];
+    FillElementWiseInput(a, maxN + 8);
+    for(int i = 0; i < maxN + 8; i++)
+        b[i] = a[(i * 3 + 1) % (maxN + 8)];
+
+    int best = XEWDetectISA();
+
+    for(int isa = XSIMD_SCALAR; isa <= best; isa++){
+        XEWSetISA(isa);
+        ok = ok && XEWGetISA() == isa;
+
+        for(int li = 0; li < sizeof(lens) / sizeof(int); li++){
+            for(int oi = 0; oi < sizeof(offsets) / sizeof(int); oi++){
+                int n = lens[li];
+                int off = offsets[oi];
+
+                /* unary functions */
+                for(int op = 0; op < EW_UNARY_NUM; op++){
+                    int pNum = op == EW_POWER ? sizeof(powers) / sizeof(float) : 1;
+                    for(int k = 0; k < pNum; k++){
+                        float p0 = op == EW_POWER ? powers[k] : 1.5F;
+                        float p1 = -0.25F;
+
+                        for(int i = 0; i < n + guardNum; i++)
+                            r[i] = guard;
+
+                        XEWUnary((EW_UNARY)op, a + off, r, n, p0, p1);
+
+                        for(int i = 0; i < n; i++){
+                            if(ULPDistance(r[i], RefUnary(op, a[off + i], p0, p1)) > MaxULP(op, p0))
+                                ok = false;
+                        }
+                        for(int i = n; i < n + guardNum; i++)
+                            ok = ok && r[i] == guard;
+                    }
+                }
+
+                /* binary functions (c is not read if alpha = 0) */
+                for(int op = 0; op < EW_BINARY_NUM; op++){
+                    for(int k = 0; k < sizeof(alphas) / sizeof(float); k++){
+                        float alpha = alphas[k];
+                        for(int i = 0; i < n; i++)
+                            c[i] = alpha == 0 ? NAN : b[i + 1];
+                        for(int i = 0; i < n + guardNum; i++)
+                            r[i] = i < n ? c[i] : guard;
+
+                        XEWBinary((EW_BINARY)op, a + off, b + off, r, n, alpha);
+
+                        for(int i = 0; i < n; i++){
+                            if(ULPDistance(r[i], RefBinary(op, a[off + i], b[off + i], c[i], alpha)) > 0)
+                                ok = false;
+                        }
+                        for(int i = n; i < n + guardNum; i++)
+                            ok = ok && r[i] == guard;
+                    }
+                }
+
+                /* in place */
+                memcpy(r, a + off, sizeof(float) * n);
+                XEWUnary(EW_SIGMOID, r, r, n);
+                for(int i = 0; i < n; i++)
+                    ok = ok && ULPDistance(r[i], RefUnary(EW_SIGMOID, a[off + i], 0, 0)) <= MaxULP(EW_SIGMOID, 0);
+            }
+        }
+    }
+
+    XEWSetISA(best);
+
+    /* a large array split over the threads gives the same result */
+    int bigN = 200000;
+    float * x = new float[bigN];
+    float * y1 = new float[bigN];
+    float * y2 = new float[bigN];
+    FillElementWiseInput(x, bigN);
+
+    XEWUnary(EW_TANH, x, y1, bigN);
+
+    {
+        TestRunnerScope runnerScope(4);
+        XEWUnary(EW_TANH, x, y2, bigN);
+    }
+
+    ok = ok && memcmp(y1, y2, sizeof(float) * bigN) == 0;
+
+    delete[] x;
+    delete[] y1;
+    delete[] y2;
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    delete[] r;
+
+    return ok;
+}
+
+/*
+case 2: the errors (in ulp, against the double-precision libm) of the
+approximated functions on each instruction set.
+*/
+bool TestXElementWiseCase2()
+{
+    bool ok = true;
+
+    const int funcNum = 8;
+    const int ops[] = {EW_EXP, EW_LOG, EW_TANH, EW_SIGMOID, EW_POWER, EW_POWER, EW_POWER, EW_POWER};
+    const float params[] = {0, 0, 0, 0, 2.5F, -1.5F, 0.3F, 7.7F};
+    const char * names[] = {"exp", "log", "tanh", "sigmoid", "pow 2.5", "pow -1.5", "pow 0.3", "pow 7.7"};
+
+    /* the ranges (log and pow take log-uniform inputs) */
+    const double lows[] = {-87.3, log(1e-37), -10.0, -80.0, log(1e-3), log(1e-3), log(1e-3), log(1e-3)};
+    const double highs[] = {88.7, log(3e38), 10.0, 80.0, log(1e3), log(1e3), log(1e3), log(1e3)};
+    const bool isLog[] = {false, true, false, false, true, true, true, true};
+
+    int n = 1 << 18;
+    float * x = new float[n];
+    float * y = new float[n];
+    float * ref = new float[n];
+    int best = XEWDetectISA();
+    char line[256];
+
+    XPRINT(0, stdout, "    function   ");
+    for(int isa = XSIMD_SCALAR; isa <= best; isa++)
+        XPRINT1(0, stdout, " %8s(max/mean ulp)", XEWGetISAName(isa));
+    XPRINT(0, stdout, "\n");
+
+    for(int f = 0; f < funcNum; f++){
+        for(int i = 0; i < n; i++){
+            double u = lows[f] + (highs[f] - lows[f]) * i / (n - 1);
+            x[i] = (float)(isLog[f] ? exp(u) : u);
+            ref[i] = RefUnary(ops[f], x[i], params[f], 0);
+        }
+
+        sprintf(line, "    %-11s", names[f]);
+        XPRINT1(0, stdout, "%s", line);
+
+        for(int isa = XSIMD_SCALAR; isa <= best; isa++){
+            XEWSetISA(isa);
+            XEWUnary((EW_UNARY)ops[f], x, y, n, params[f]);
+
+            long long maxULP = 0;
+            double sumULP = 0;
+            for(int i = 0; i < n; i++){
+                long long d = ULPDistance(y[i], ref[i]);
+                maxULP = MAX(maxULP, d);
+                sumULP += d;
+            }
+
+            sprintf(line, " %13lld/%-8.3f", maxULP, sumULP / n);
+            XPRINT1(0, stdout, "%s", line);
+
+            ok = ok && maxULP <= MaxULP(ops[f], params[f]);
+        }
+        XPRINT(0, stdout, "\n");
+    }
+
+    XEWSetISA(best);
+
+    delete[] x;
+    delete[] y;
+    delete[] ref;
+
+    return ok;
+}
+
+/* test for the element-wise engine */
+bool TestXElementWise()
+{
+    XPRINT(0, stdout, "[Test] Element-wise engine ... Began\n");
+    bool returnFlag = true;
+    bool caseFlag = true;
+
+    double startT = GetClock();
+
+    /* case 1 test */
+    caseFlag = TestXElementWiseCase1();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 1 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 1 passed!\n");
+
+    /* case 2 test */
+    caseFlag = TestXElementWiseCase2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    if (returnFlag) {
+        XPRINT(0, stdout, ">> All Passed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> Failed!\n");
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Test] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return returnFlag;
+}
+
+/* benchmark for the element-wise engine: its speed against the loops of libm */
+bool BenchXElementWise()
+{
+    XPRINT(0, stdout, "[Bench] Element-wise engine ... Began\n");
+
+    bool ok = true;
+    double benchT = GetClock();
+
+    const int funcNum = 6;
+    const char * names[] = {"exp", "log", "tanh", "sigmoid", "pow 2.5", "multiply"};
+    int n = 1 << 20;
+    int passNum = 10;
+    float * x = new float[n];
+    float * z = new float[n];
+    float * y1 = new float[n];
+    float * y2 = new float[n];
+    char line[256];
+
+    for(int i = 0; i < n; i++){
+        x[i] = (float)rand() / RAND_MAX * 10.0F + 0.01F;
+        z[i] = (float)rand() / RAND_MAX * 2.0F - 1.0F;
+    }
+
+    for(int f = 0; f < funcNum; f++){
+        double startT = GetClock();
+        for(int p = 0; p < passNum; p++){
+            for(int i = 0; i < n; i++){
+                float v = x[i];
+                if(f == 0)
+                    y1[i] = expf(v);
+                else if(f == 1)
+                    y1[i] = logf(v);
+                else if(f == 2)
+                    y1[i] = tanhf(v);
+                else if(f == 3)
+                    y1[i] = 1.0F / (1.0F + expf(-v));
+                else if(f == 4)
+                    y1[i] = powf(v, 2.5F);
+                else
+                    y1[i] = v * z[i];
+            }
+        }
+        double libmT = GetClock() - startT;
+
+        startT = GetClock();
+        for(int p = 0; p < passNum; p++){
+            if(f == 0)
+                XEWUnary(EW_EXP, x, y2, n);
+            else if(f == 1)
+                XEWUnary(EW_LOG, x, y2, n);
+            else if(f == 2)
+                XEWUnary(EW_TANH, x, y2, n);
+            else if(f == 3)
+                XEWUnary(EW_SIGMOID, x, y2, n);
+            else if(f == 4)
+                XEWUnary(EW_POWER, x, y2, n, 2.5F);
+            else
+                XEWBinary(EW_MULTIPLY, x, z, y2, n);
+        }
+        double engineT = GetClock() - startT;
+
+        for(int i = 0; i < n; i++)
+            ok = ok && ULPDistance(y1[i], y2[i]) <= 8;
+
+        double libmSpeed = (double)n * passNum / MAX(libmT, 1e-3) / 1e3;
+        double engineSpeed = (double)n * passNum / MAX(engineT, 1e-3) / 1e3;
+        sprintf(line, "    %-9s libm %8.1f Mitems/s, %s %8.1f Mitems/s (%.1fx)\n",
+                names[f], libmSpeed, XEWGetISAName(XEWGetISA()), engineSpeed,
+                engineSpeed / libmSpeed);
+        XPRINT1(0, stdout, "%s", line);
+    }
+
+    delete[] x;
+    delete[] z;
+    delete[] y1;
+    delete[] y2;
+
+    if (!ok)
+        XPRINT(0, stdout, ">> the results differ from libm!\n");
+
+    XPRINT1(0, stdout, "[Bench] Finished (took %.3lfms)\n\n", GetClock() - benchT);
+
+    return ok;
+}
+
+} // namespace nts(NiuTrans.Tensor)
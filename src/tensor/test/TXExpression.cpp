@@ -0,0 +1,257 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <string.h>
+#include "../XGlobal.h"
+#include "../XUtility.h"
+#include "../core/CHeader.h"
+#include "../function/FHeader.h"
+#include "TUtility.h"
+#include "TXExpression.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/* check whether two tensors have the same shape and the same bits */
+bool IsSameBits(const XTensor &a, const XTensor &b)
+{
+    return _IsSameShaped(&a, &b) && memcmp(a.data, b.data, sizeof(float) * a.unitNum) == 0;
+}
+
+/* a random matrix */
+void InitRandMatrix(XTensor &t, int rowNum, int colNum, float lower, float upper)
+{
+    InitTensor2DV2(&t, rowNum, colNum, X_FLOAT, -1);
+    _SetDataRand(&t, lower, upper);
+}
+
+/*
+case 1: the fused expressions give the same results as the usual operators.
+The size is not a multiple of the tile size.
+*/
+bool TestXExpressionCase1()
+{
+    bool ok = true;
+    int rowNum = 37;
+    int colNum = 129;
+
+    XTensor f, i, g, o, c, x, y, cond;
+    InitRandMatrix(f, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(i, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(g, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(o, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(c, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(x, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(y, rowNum, colNum, 0.5F, 3.0F);
+    InitRandMatrix(cond, rowNum, colNum, 0.0F, 1.0F);
+    float * cp = (float*)cond.data;
+    for(int k = 0; k < cond.unitNum; k++)
+        cp[k] = cp[k] > 0.5F ? 1.0F : 0.0F;
+
+    /* the lstm update */
+    XTensor c1 = Sigmoid(f) * c + Sigmoid(i) * HardTanH(g);
+    XTensor c2 = Sigmoid(Lazy(f)) * c + Sigmoid(Lazy(i)) * HardTanH(Lazy(g));
+    XTensor h1 = HardTanH(c1) * Sigmoid(o);
+    XTensor h2 = HardTanH(Lazy(c2)) * Sigmoid(Lazy(o));
+    ok = ok && IsSameBits(c1, c2) && IsSameBits(h1, h2);
+
+    /* selection */
+    XTensor w1 = cond * x + (1 - cond) * y;
+    XTensor w2 = Lazy(cond) * x + (1 - Lazy(cond)) * y;
+    ok = ok && IsSameBits(w1, w2);
+
+    /* numbers and functions */
+    XTensor u1 = Exp(Log(Absolute(x) + 1.0F)) * 0.5F - Rectify(-y) / 4.0F;
+    XTensor u2 = Exp(Log(Absolute(Lazy(x)) + 1.0F)) * 0.5F - Rectify(-Lazy(y)) / 4.0F;
+    ok = ok && IsSameBits(u1, u2);
+
+    XTensor v1 = Square(x) / y - Sqrt(y) + 2.0F * x;
+    XTensor v2 = Square(Lazy(x)) / y - Sqrt(Lazy(y)) + 2.0F * Lazy(x);
+    ok = ok && IsSameBits(v1, v2);
+
+    /* a number minus an expression */
+    XTensor s1 = 3.0F - Sigmoid(x);
+    XTensor s2 = 3.0F - Sigmoid(Lazy(x));
+    ok = ok && IsSameBits(s1, s2);
+
+    /* a tensor alone */
+    XTensor t = Lazy(x);
+    ok = ok && IsSameBits(t, x);
+
+    /* in place (the result is a tensor of the expression) */
+    XTensor c3;
+    InitTensorV2(&c3, &c);
+    _CopyValues(&c, &c3);
+    void * data = c3.data;
+    Eval(Sigmoid(Lazy(f)) * c3 + Lazy(c3) * 0.5F, c3);
+    XTensor c4 = Sigmoid(f) * c + c * 0.5F;
+    ok = ok && c3.data == data && IsSameBits(c3, c4);
+
+    /* large tensors on the threads */
+    XTensor bigA, bigB;
+    InitRandMatrix(bigA, 300, 1000, -5.0F, 5.0F);
+    InitRandMatrix(bigB, 300, 1000, -5.0F, 5.0F);
+
+    {
+        TestRunnerScope runnerScope(4);
+        XTensor big1 = Sigmoid(bigA) * bigB + HardTanH(bigB);
+        XTensor big2 = Sigmoid(Lazy(bigA)) * bigB + HardTanH(Lazy(bigB));
+        ok = ok && IsSameBits(big1, big2);
+    }
+
+    return ok;
+}
+
+/* case 2: the expressions fall back to the usual operators (broadcasting and gradients) */
+bool TestXExpressionCase2()
+{
+    bool ok = true;
+    int rowNum = 8;
+    int colNum = 33;
+
+    XTensor x, y, bias;
+    InitRandMatrix(x, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(y, rowNum, colNum, -3.0F, 3.0F);
+    InitTensor1DV2(&bias, colNum, X_FLOAT, -1);
+    _SetDataRand(&bias, -1.0F, 1.0F);
+
+    /* broadcasting */
+    XTensor b1 = Sigmoid(x) + bias;
+    XTensor b2 = Sigmoid(Lazy(x)) + bias;
+    ok = ok && IsSameBits(b1, b2);
+
+    /* the tensors need gradients, and the network is built by the usual operators */
+    x.enableGrad = true;
+    y.enableGrad = true;
+    XTensor g1 = Sigmoid(x) * y;
+    XTensor g2 = Sigmoid(Lazy(x)) * y;
+    ok = ok && IsSameBits(g1, g2) && g2.income.tailNum == 2;
+
+    return ok;
+}
+
+/* case 3: a fused lstm update gives the same bits as the usual operators */
+bool TestXExpressionCase3()
+{
+    XTensor f, i, g, c;
+    InitRandMatrix(f, 17, 33, -3.0F, 3.0F);
+    InitRandMatrix(i, 17, 33, -3.0F, 3.0F);
+    InitRandMatrix(g, 17, 33, -3.0F, 3.0F);
+    InitRandMatrix(c, 17, 33, -3.0F, 3.0F);
+
+    XTensor c1 = Sigmoid(f) * c + Sigmoid(i) * HardTanH(g);
+    XTensor c2 = Sigmoid(Lazy(f)) * c + Sigmoid(Lazy(i)) * HardTanH(Lazy(g));
+
+    return IsSameBits(c1, c2);
+}
+
+/* test for the lazy expressions */
+bool TestXExpression()
+{
+    XPRINT(0, stdout, "[Test] Lazy expressions ... Began\n");
+    bool returnFlag = true;
+    bool caseFlag = true;
+
+    double startT = GetClock();
+
+    /* case 1 test */
+    caseFlag = TestXExpressionCase1();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 1 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 1 passed!\n");
+
+    /* case 2 test */
+    caseFlag = TestXExpressionCase2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    /* case 3 test */
+    caseFlag = TestXExpressionCase3();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
+    if (returnFlag) {
+        XPRINT(0, stdout, ">> All Passed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> Failed!\n");
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Test] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return returnFlag;
+}
+
+/* benchmark for the lazy expressions: speed of a fused lstm update against the usual operators */
+bool BenchXExpression()
+{
+    XPRINT(0, stdout, "[Bench] Lazy expressions ... Began\n");
+
+    bool ok = true;
+    double benchT = GetClock();
+    int rowNum = 256;
+    int colNum = 2048;
+    int passNum = 20;
+
+    XTensor f, i, g, c;
+    InitRandMatrix(f, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(i, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(g, rowNum, colNum, -3.0F, 3.0F);
+    InitRandMatrix(c, rowNum, colNum, -3.0F, 3.0F);
+
+    XTensor c1;
+    XTensor c2;
+
+    double startT = GetClock();
+    for(int p = 0; p < passNum; p++)
+        c1 = Sigmoid(f) * c + Sigmoid(i) * HardTanH(g);
+    double eagerT = GetClock() - startT;
+
+    startT = GetClock();
+    for(int p = 0; p < passNum; p++)
+        c2 = Sigmoid(Lazy(f)) * c + Sigmoid(Lazy(i)) * HardTanH(Lazy(g));
+    double lazyT = GetClock() - startT;
+
+    ok = IsSameBits(c1, c2);
+
+    XPRINT3(0, stdout, "    lstm update of %dx%d: usual operators %.2fms, ", rowNum, colNum, eagerT / passNum);
+    XPRINT2(0, stdout, "lazy expression %.2fms (%.1fx)\n", lazyT / passNum, eagerT / MAX(lazyT, 1e-3));
+
+    if (!ok)
+        XPRINT(0, stdout, ">> the results differ!\n");
+
+    XPRINT1(0, stdout, "[Bench] Finished (took %.3lfms)\n\n", GetClock() - benchT);
+
+    return ok;
+}
+
+} // namespace nts(NiuTrans.Tensor)
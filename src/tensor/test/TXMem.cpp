@@ -21,6 +21,8 @@
 
 #include "../XGlobal.h"
 #include "../XUtility.h"
+#include "../XName.h"
+#include "../XMemStat.h"
 #include "TXMem.h"
 
 namespace nts{ // namespace nts(NiuTrans.Tensor)
@@ -159,7 +161,149 @@ bool TestXMemCase1()
 
     delete[] buf;
 
-    return 0;
+    return ok;
+}
+
+/* 
+case 2: test the free lists of the memory pool (FREE_ON_THE_FLY), i.e., 
+the free pieces are merged right away, and the index nodes are recycled 
+*/
+bool TestXMemCase2()
+{
+    bool ok = true;
+    int caseNum = 500;
+    int roundNum = 5;
+
+    XMem mem;
+    mem.Initialize(-1, FREE_ON_THE_FLY, 1 << 16, 1000, 0);
+    mem.SetIndex(10000, 32);
+
+    srand(1);
+
+    char ** p = new char*[caseNum];
+    int * size = new int[caseNum];
+    int * order = new int[caseNum];
+
+    for (int round = 0; round < roundNum; round++) {
+        /* allocate pieces of various sizes (some of them need new blocks) */
+        for (int i = 0; i < caseNum; i++) {
+            size[i] = rand() % 8 == 0 ? rand() % (1 << 17) + 1 : rand() % 2048 + 1;
+            p[i] = (char*)mem.AllocStandard(mem.devID, size[i]);
+            memset(p[i], i % 128, size[i]);
+            order[i] = i;
+        }
+
+        /* the pieces do not overlap */
+        for (int i = 0; i < caseNum; i++) {
+            for (int k = 0; k < size[i]; k++) {
+                if (p[i][k] != i % 128)
+                    ok = false;
+            }
+        }
+
+        /* release them in a random order */
+        for (int i = caseNum - 1; i > 0; i--) {
+            int j = rand() % (i + 1);
+            int tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+        for (int i = 0; i < caseNum; i++)
+            mem.ReleaseStandard(mem.devID, p[order[i]], size[order[i]]);
+
+        /* each block is a single free piece now */
+        int blockInUse = 0;
+        for (int i = 0; i < mem.blockNum; i++) {
+            MHeader * head = mem.blocks[i].head;
+            if (mem.blocks[i].mem == NULL || head == NULL)
+                continue;
+            blockInUse++;
+            if (head->state != 1 || head->next != NULL || mem.blocks[i].used != 0)
+                ok = false;
+        }
+        if (mem.nodeNumUsed - MEM_LIST_NUM - mem.freeNodeNum != blockInUse)
+            ok = false;
+
+        /* the nodes are recycled, i.e., we never use more nodes than
+           the pieces (in use or free) we have at the same time */
+        if (mem.nodeNumUsed - MEM_LIST_NUM > 2 * caseNum + mem.blockAllocNum)
+            ok = false;
+    }
+
+    delete[] p;
+    delete[] size;
+    delete[] order;
+
+    return ok;
+}
+
+/*
+case 3: test the memory accounting, i.e., the bytes are attributed to
+the pools, the ops and the categories
+*/
+bool TestXMemCase3()
+{
+    bool ok = true;
+
+    GMemStat.Clear();
+    GMemStat.Enable(false);
+
+    XMem mem;
+    mem.Initialize(-1, FREE_ON_THE_FLY, 1 << 16, 100, 1 << 12);
+    mem.SetIndex(10000, 32);
+    mem.SetName("test");
+
+    void * param = NULL;
+    void * grad = NULL;
+    {
+        XMemCategoryScope scope(MEM_PARAMETER);
+        param = mem.Alloc(-1, 1000);
+    }
+    {
+        XMemCategoryScope scope(MEM_GRADIENT);
+        grad = XMemAlloc(-1, 500);
+    }
+    void * act = mem.Alloc(-1, 3000);
+    GMemStat.SetOp(act, MATH_SUM);
+    mem.AllocBuf(-1, 200);
+
+    ok = ok && param != NULL && grad != NULL && act != NULL;
+    ok = ok && GMemStat.GetCurrent(-1) == 4700;
+    ok = ok && GMemStat.GetCurrent(-1, MEM_PARAMETER) == 1000;
+    ok = ok && GMemStat.GetCurrent(-1, MEM_GRADIENT) == 500;
+    ok = ok && GMemStat.GetCurrent(-1, MEM_ACTIVATION) == 3000;
+    ok = ok && GMemStat.GetCurrent(-1, MEM_BUFFER) == 200;
+
+    mem.Release(-1, act, 3000);
+    mem.ReleaseBuf(-1, 200);
+    XMemFree(-1, grad);
+
+    ok = ok && GMemStat.GetCurrent(-1) == 1000;
+    ok = ok && GMemStat.GetPeak(-1) == 4700;
+    ok = ok && GMemStat.GetPeak(-1, MEM_ACTIVATION) == 3000;
+
+    /* the piece of the op is counted in its own item */
+    bool found = false;
+    for (int i = 0; i < GMemStat.itemNum; i++) {
+        XMemStatItem &it = GMemStat.items[i];
+        if (it.op == MATH_SUM) {
+            found = true;
+            ok = ok && it.peak == 3000 && it.current == 0;
+            ok = ok && it.allocNum == 1 && it.releaseNum == 1;
+            ok = ok && strcmp(GMemStat.poolNames[it.pool], "test") == 0;
+        }
+    }
+    ok = ok && found;
+
+    /* the pieces are gone with the pool */
+    mem.Clear();
+    ok = ok && GMemStat.GetCurrent(-1) == 0;
+    ok = ok && GMemStat.recordNum == 0;
+
+    GMemStat.Disable();
+    GMemStat.Clear();
+
+    return ok;
 }
 
 /* test for memory pool class */
@@ -180,6 +324,24 @@ bool TestXMem()
     else
         XPRINT(0, stdout, ">> case 1 passed!\n");
 
+    /* case 2 test */
+    caseFlag = TestXMemCase2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    /* case 3 test */
+    caseFlag = TestXMemCase3();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
     if (returnFlag) {
         XPRINT(0, stdout, ">> All Passed!\n");
     }
@@ -0,0 +1,429 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <atomic>
+#include "../XGlobal.h"
+#include "../XUtility.h"
+#include "../XNuma.h"
+#include "../core/shape/IsSameShaped.h"
+#include "../core/utilities/XMatrixSegment.h"
+#include "TXPRunner.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/* number of iterations of a job of about 10us */
+int workUnitNum = 0;
+
+/* some work (the result is kept so that it is not optimized away) */
+volatile float workResult = 0;
+void DoSomeWork(int n)
+{
+    float x = 1.0F;
+    for(int i = 0; i < n; i++)
+        x = x * 1.0000001F + 1e-7F;
+    workResult = x;
+}
+
+/* a job of XPRunner::Run */
+void TestXPRunnerWorkJob(TensorList * args)
+{
+    DoSomeWork(workUnitNum);
+}
+
+/* a job of RunParallel2D that marks the items of a block */
+void TestXPRunnerMarkJob(TensorList * args)
+{
+    IntList * indexArgs = (IntList*)args->GetItem(0);
+    TensorList * markArgs = (TensorList*)args->GetItem(1);
+    int * marks = (int*)markArgs->GetItem(0);
+    int colNum = *(int*)markArgs->GetItem(1);
+
+    for(int i = indexArgs->GetItem(0); i <= indexArgs->GetItem(2); i++){
+        for(int j = indexArgs->GetItem(1); j <= indexArgs->GetItem(3); j++)
+            marks[i * colNum + j]++;
+    }
+}
+
+/* case 1: test ParallelFor (and RunParallel2D on it) */
+bool TestXPRunnerCase1(XPRunner * runner)
+{
+    bool ok = true;
+    int n = 100003;
+    int * marks = new int[n];
+    memset(marks, 0, sizeof(int) * n);
+
+    /* each item is visited once */
+    std::atomic<long long> sum(0);
+    runner->ParallelFor(0, n, 100, [&](int begin, int end) {
+        long long s = 0;
+        for(int i = begin; i < end; i++){
+            marks[i]++;
+            s += i;
+        }
+        sum += s;
+    });
+
+    for(int i = 0; i < n; i++)
+        ok = ok && marks[i] == 1;
+    ok = ok && sum == (long long)n * (n - 1) / 2;
+
+    /* a nested call runs in place */
+    std::atomic<int> count(0);
+    runner->ParallelFor(0, 64, 1, [&](int begin, int end) {
+        for(int i = begin; i < end; i++){
+            runner->ParallelFor(0, 10, 1, [&](int b, int e) {
+                count += e - b;
+            });
+        }
+    });
+    ok = ok && count == 640;
+
+    /* blocks of a matrix */
+    int rowNum = 300;
+    int colNum = 333;
+    memset(marks, 0, sizeof(int) * n);
+    RunParallel2D(runner, (void*)TestXPRunnerMarkJob, runner->minimumOPNum * runner->threadNum,
+                  rowNum, colNum, 2, marks, &colNum);
+
+    for(int i = 0; i < rowNum * colNum; i++)
+        ok = ok && marks[i] == 1;
+
+    delete[] marks;
+
+    return ok;
+}
+
+/* case 2: test the NUMA topology, the lists of nodes and the replicas */
+bool TestXPRunnerCase2()
+{
+    bool ok = true;
+    XNumaTopology * topology = GetNumaTopology();
+
+    /* each cpu is in the list of its node */
+    int cpuCount = 0;
+    for(int i = 0; i < topology->cpuNum; i++){
+        int node = topology->GetNode(i);
+        if(node < 0)
+            continue;
+        bool found = false;
+        for(int j = 0; j < topology->nodeCPUNum[node]; j++)
+            found = found || topology->nodeCPUs[node][j] == i;
+        ok = ok && found;
+        cpuCount++;
+    }
+
+    int listCount = 0;
+    for(int k = 0; k < topology->nodeNum; k++)
+        listCount += topology->nodeCPUNum[k];
+
+    ok = ok && topology->activeNodeNum >= 1 && cpuCount >= 1 && cpuCount == listCount;
+
+    /* the lists */
+    int items[16];
+    int answer[7] = {0, 1, 2, 3, 8, 10, 11};
+    ok = ok && XParseIntList("0-3,8,10-11\n", items, 16) == 7;
+    for(int i = 0; i < 7; i++)
+        ok = ok && items[i] == answer[i];
+
+    int nodes[MAX_NUMA_NODE_NUM];
+    int nodeNum = XParseNumaNodes("all", nodes, MAX_NUMA_NODE_NUM);
+    ok = ok && nodeNum == topology->activeNodeNum && nodes[0] == topology->firstNode;
+
+    int node = XGetThreadNode();
+    ok = ok && node >= 0 && node < topology->nodeNum && topology->nodeCPUNum[node] > 0;
+
+    /* the copies of an array */
+    int n = 100000;
+    int * data = new int[n];
+    for(int i = 0; i < n; i++)
+        data[i] = i;
+
+    XNumaReplica replica;
+    replica.Init(data, sizeof(int) * n);
+    ok = ok && replica.isReady && replica.copyNum == (nodeNum > 1 ? nodeNum : 0);
+    for(int k = 0; k < nodeNum; k++)
+        ok = ok && memcmp(replica.Get(nodes[k]), data, sizeof(int) * n) == 0;
+    ok = ok && memcmp(replica.Get(), data, sizeof(int) * n) == 0;
+
+    /* the source is the copy of its node (so there are nodeNum - 1 new copies) */
+    if(nodeNum > 1)
+        ok = ok && replica.sourceNode >= 0 && replica.Get(replica.sourceNode) == data;
+
+    /* the copies of a tensor */
+    XTensor * a = NewTensor2D(100, 37);
+    a->SetDataRand(-1.0F, 1.0F);
+
+    XNumaReplica tensorReplica;
+    tensorReplica.Init(a);
+    XTensor * b = tensorReplica.GetTensor();
+    ok = ok && b != NULL && _IsSameShaped(a, b);
+    ok = ok && memcmp(b->data, a->data, a->GetDataSizeInChar()) == 0;
+
+    tensorReplica.Clear();
+    ok = ok && !tensorReplica.isReady;
+
+    delete a;
+    delete[] data;
+
+    return ok;
+}
+
+/*
+sum an array many times by ParallelFor (the threads read the copy of
+their node if they are pinned)
+>> runner - the parallel runner
+>> data - the array
+>> n - size of the array
+>> passNum - number of the passes
+>> isPinned - pin the threads to the NUMA nodes or not
+>> speed - the throughput (GB/s)
+<< return - are the sums right
+*/
+bool SumByParallelFor(XPRunner * runner, int * data, int n, int passNum, bool isPinned, double * speed)
+{
+    bool ok = true;
+
+    long long answer = 0;
+    for(int i = 0; i < n; i++)
+        answer += data[i];
+
+    XNumaReplica replica;
+
+    if(isPinned){
+        ok = ok && runner->Pin("all");
+        replica.Init(data, sizeof(int) * (MTYPE)n);
+    }
+
+    double startT = GetClock();
+    for(int p = 0; p < passNum; p++){
+        std::atomic<long long> sum(0);
+        runner->ParallelFor(0, n, 1 << 16, [&](int begin, int end) {
+            const int * d = isPinned ? (const int*)replica.Get() : data;
+            long long s = 0;
+            for(int i = begin; i < end; i++)
+                s += d[i];
+            sum += s;
+        });
+        ok = ok && sum == answer;
+    }
+    double endT = GetClock();
+
+    *speed = (double)n * sizeof(int) * passNum / MAX(endT - startT, 1e-3) / 1e6;
+
+    return ok;
+}
+
+/* the caller is not pinned any more */
+void UnpinCurrentThread()
+{
+    XNumaTopology * topology = GetNumaTopology();
+    int * cpus = new int[topology->cpuNum];
+    int cpuNum = 0;
+    for(int i = 0; i < topology->cpuNum; i++){
+        if(topology->GetNode(i) >= 0)
+            cpus[cpuNum++] = i;
+    }
+    XPinCurrentThread(cpus, cpuNum);
+    XSetThreadNode(-1);
+
+    delete[] cpus;
+}
+
+/*
+case 3: test ParallelFor with the threads pinned to the NUMA nodes, i.e.,
+they read the copies of their nodes and give the same sums
+*/
+bool TestXPRunnerCase3(XPRunner * runner)
+{
+    bool ok = true;
+
+    int n = 1 << 18;
+    int * data = new int[n];
+    for(int i = 0; i < n; i++)
+        data[i] = i % 7;
+
+    double speed;
+    ok = ok && SumByParallelFor(runner, data, n, 2, false, &speed);
+    ok = ok && SumByParallelFor(runner, data, n, 2, true, &speed);
+
+    UnpinCurrentThread();
+
+    delete[] data;
+
+    return ok;
+}
+
+/* test for the parallel runner */
+bool TestXPRunner()
+{
+    XPRINT(0, stdout, "[Test] Parallel runner ... Began\n");
+    bool returnFlag = true;
+    bool caseFlag = true;
+
+    double startT = GetClock();
+
+    XPRunner * runner = new XPRunner();
+    runner->Init(4);
+
+    /* case 1 test */
+    caseFlag = TestXPRunnerCase1(runner);
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 1 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 1 passed!\n");
+
+    /* case 2 test */
+    caseFlag = TestXPRunnerCase2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    /* case 3 test */
+    caseFlag = TestXPRunnerCase3(runner);
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 3 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 3 passed!\n");
+
+    delete runner;
+
+    if (returnFlag) {
+        XPRINT(0, stdout, ">> All Passed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> Failed!\n");
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Test] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return returnFlag;
+}
+
+/*
+dispatch cost. We run one job of about 10us on each thread, by
+XPRunner::Run (with the argument lists made for each call) and by
+ParallelFor.
+*/
+void BenchXPRunnerDispatch(XPRunner * runner)
+{
+    /* the number of iterations of 10us */
+    double startT = GetClock();
+    DoSomeWork(1000000);
+    double endT = GetClock();
+    workUnitNum = (int)(1000000 * 0.01 / MAX(endT - startT, 1e-3));
+    workUnitNum = MAX(workUnitNum, 1);
+
+    int jobNum = runner->threadNum;
+    int runNum = 200;
+
+    /* XPRunner::Run */
+    startT = GetClock();
+    for(int k = 0; k < runNum; k++){
+        TensorList * jobs = new TensorList(jobNum);
+        TensorList * args = new TensorList(jobNum);
+        for(int i = 0; i < jobNum; i++){
+            jobs->Add((XTensor*)TestXPRunnerWorkJob);
+            args->Add((XTensor*)new TensorList(1));
+        }
+
+        runner->Run(jobs, args);
+
+        for(int i = 0; i < jobNum; i++)
+            delete (TensorList*)args->GetItem(i);
+        delete jobs;
+        delete args;
+    }
+    endT = GetClock();
+    double runTime = (endT - startT) * 1000 / runNum;
+
+    /* ParallelFor */
+    startT = GetClock();
+    for(int k = 0; k < runNum; k++){
+        runner->ParallelFor(0, jobNum, 1, [&](int begin, int end) {
+            for(int i = begin; i < end; i++)
+                DoSomeWork(workUnitNum);
+        });
+    }
+    endT = GetClock();
+    double forTime = (endT - startT) * 1000 / runNum;
+
+    XPRINT3(0, stdout, "    %d jobs of 10us: Run %.1fus, ParallelFor %.1fus\n", jobNum, runTime, forTime);
+}
+
+/*
+pinned vs. unpinned throughput. The threads sum a large array (the copy of
+their node if the threads are pinned) many times by ParallelFor.
+*/
+bool BenchXPRunnerBandwidth(XPRunner * runner)
+{
+    bool ok = true;
+    XNumaTopology * topology = GetNumaTopology();
+
+    int n = 1 << 23;
+    int * data = new int[n];
+    for(int i = 0; i < n; i++)
+        data[i] = i % 7;
+
+    double speed[2];
+    ok = ok && SumByParallelFor(runner, data, n, 10, false, &speed[0]);
+    ok = ok && SumByParallelFor(runner, data, n, 10, true, &speed[1]);
+
+    XPRINT3(0, stdout, "    %d node(s), unpinned %.2fGB/s, pinned %.2fGB/s\n",
+            topology->activeNodeNum, speed[0], speed[1]);
+
+    UnpinCurrentThread();
+
+    delete[] data;
+
+    return ok;
+}
+
+/* benchmark for the parallel runner */
+bool BenchXPRunner()
+{
+    XPRINT(0, stdout, "[Bench] Parallel runner ... Began\n");
+
+    double startT = GetClock();
+
+    XPRunner * runner = new XPRunner();
+    runner->Init(4);
+
+    BenchXPRunnerDispatch(runner);
+    bool ok = BenchXPRunnerBandwidth(runner);
+
+    delete runner;
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Bench] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return ok;
+}
+
+} // namespace nts(NiuTrans.Tensor)
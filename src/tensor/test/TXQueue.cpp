@@ -0,0 +1,367 @@
+/* NiuTrans.Tensor - an open-source tensor library
+ * Copyright (C) 2020, Natural Language Processing Lab, Northestern University.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * $Created by: HU Chi (huchinlp@foxmail.com) 2026-10-19
+ */
+
+#include <stdint.h>
+#include "../XGlobal.h"
+#include "../XUtility.h"
+#include "TXQueue.h"
+
+namespace nts{ // namespace nts(NiuTrans.Tensor)
+
+/*
+the queue of the last version (for comparison): the producers share a mutex,
+and the consumers share another one and a condition variable
+*/
+class TMutexQueue
+{
+public:
+    MUTEX_HANDLE enqueueMutex;
+    MUTEX_HANDLE dequeueMutex;
+    COND_HANDLE  queueCond;
+    void ** queue;
+    int size;
+    int itemCount;
+    int head;
+    int tail;
+
+public:
+    TMutexQueue(int mySize)
+    {
+        queue = new void*[mySize];
+        size = mySize;
+        itemCount = 0;
+        head = 0;
+        tail = 0;
+        MUTEX_INIT(enqueueMutex);
+        MUTEX_INIT(dequeueMutex);
+        COND_INIT(queueCond);
+    }
+
+    ~TMutexQueue()
+    {
+        delete[] queue;
+        MUTEX_DELE(enqueueMutex);
+        MUTEX_DELE(dequeueMutex);
+        COND_DELE(queueCond);
+    }
+
+    void Enqueue(void * item)
+    {
+        MUTEX_LOCK(enqueueMutex);
+        MUTEX_LOCK(dequeueMutex);
+
+        CheckNTErrors((itemCount < size), "Put too many items into the queue!");
+
+        queue[tail] = item;
+        tail = (tail + 1) % size;
+        itemCount++;
+
+        COND_SIGNAL(queueCond);
+
+        MUTEX_UNLOCK(dequeueMutex);
+        MUTEX_UNLOCK(enqueueMutex);
+    }
+
+    void * Dequeue()
+    {
+        MUTEX_LOCK(dequeueMutex);
+
+        while(itemCount == 0)
+        {
+#ifdef  WIN32
+            MUTEX_UNLOCK(dequeueMutex);
+#endif
+            COND_WAIT(queueCond, dequeueMutex);
+#ifdef  WIN32
+            MUTEX_LOCK(dequeueMutex);
+#endif
+        }
+
+        void * r = queue[head];
+        head = (head + 1) % size;
+        itemCount--;
+
+        MUTEX_UNLOCK(dequeueMutex);
+
+        return r;
+    }
+};
+
+/* what a producer does */
+struct TXQueueProducer
+{
+    /* the queue (one of them is NULL) */
+    XQueue * q;
+    TMutexQueue * mq;
+
+    /* the items are first, first + 1, ..., first + num - 1 */
+    int first;
+    int num;
+
+    /* the job (and its sum) if we put jobs into the queue */
+    void * job;
+    std::atomic<long long> * sum;
+};
+
+/* a job that adds a number to a sum */
+void TestXQueueAddJob(TensorList * args)
+{
+    std::atomic<long long> * sum = (std::atomic<long long>*)args->GetItem(0);
+    int n = (int)(intptr_t)args->GetItem(1);
+    *sum += n;
+}
+
+/* a producer (run by an XThread) */
+void TestXQueueProduce(volatile TensorList * argv)
+{
+    TensorList * args = (TensorList*)argv;
+    TXQueueProducer * p = (TXQueueProducer*)args->GetItem(0);
+
+    if(p->job != NULL){
+        TensorList jobArgs(2);
+        for(int i = p->first; i < p->first + p->num; i++){
+            jobArgs.Clear();
+            jobArgs.Add((XTensor*)p->sum);
+            jobArgs.Add((XTensor*)(intptr_t)i);
+            p->q->EnqueueJob(p->job, &jobArgs);
+        }
+    }
+    else if(p->q != NULL){
+        for(int i = p->first; i < p->first + p->num; i++)
+            p->q->Enqueue((void*)(intptr_t)i);
+    }
+    else{
+        for(int i = p->first; i < p->first + p->num; i++)
+            p->mq->Enqueue((void*)(intptr_t)i);
+    }
+}
+
+/* start the producers */
+void StartProducers(XThread * threads, TensorList * args, TXQueueProducer * producers, int producerNum)
+{
+    for(int i = 0; i < producerNum; i++){
+        args[i].Add((XTensor*)(producers + i));
+        threads[i].function = (TFunction)TestXQueueProduce;
+        threads[i].argv = args + i;
+        threads[i].Start();
+        threads[i].LetItGo();
+    }
+}
+
+/* wait for the producers */
+void StopProducers(XThread * threads, int producerNum)
+{
+    for(int i = 0; i < producerNum; i++){
+        while(threads[i].jobCount > 0)
+            XSleep(1);
+        threads[i].End();
+    }
+}
+
+/* case 1: test the queue with a single thread */
+bool TestXQueueCase1()
+{
+    bool ok = true;
+
+    /* the size is rounded up to 8 */
+    XQueue q(5);
+
+    ok = ok && q.IsEmpty();
+
+    for(int i = 1; i <= 8; i++)
+        ok = ok && q.TryEnqueue((void*)(intptr_t)i);
+
+    ok = ok && !q.TryEnqueue((void*)(intptr_t)9);
+    ok = ok && !q.IsEmpty();
+
+    /* first in, first out (over a few rounds of the ring) */
+    for(int i = 1; i <= 20; i++){
+        void * item = NULL;
+        ok = ok && q.TryDequeue(&item) && (intptr_t)item == i;
+        q.Enqueue((void*)(intptr_t)(i + 8));
+    }
+
+    for(int i = 21; i <= 28; i++)
+        ok = ok && (intptr_t)q.Dequeue() == i;
+
+    void * item = NULL;
+    ok = ok && !q.TryDequeue(&item);
+    ok = ok && q.IsEmpty();
+
+    return ok;
+}
+
+/*
+case 2: test the job queue with many producers and consumers. The queue is
+small so that the producers have to wait for the consumers.
+*/
+bool TestXQueueCase2()
+{
+    int producerNum = 8;
+    int consumerNum = 4;
+    int jobNum = 5000;
+
+    std::atomic<long long> sum(0);
+
+    XQueue q(16);
+    q.RunJobConsumer(-1, consumerNum);
+
+    XThread * threads = new XThread[producerNum];
+    TensorList * args = new TensorList[producerNum];
+    TXQueueProducer * producers = new TXQueueProducer[producerNum];
+
+    for(int i = 0; i < producerNum; i++){
+        producers[i].q = &q;
+        producers[i].mq = NULL;
+        producers[i].first = i * jobNum;
+        producers[i].num = jobNum;
+        producers[i].job = (void*)TestXQueueAddJob;
+        producers[i].sum = &sum;
+    }
+
+    StartProducers(threads, args, producers, producerNum);
+    StopProducers(threads, producerNum);
+
+    q.WaitForEmptyJobQueue();
+    q.StopJobConsumer();
+
+    long long n = (long long)producerNum * jobNum;
+    bool ok = sum == n * (n - 1) / 2 && q.IsEmpty();
+
+    delete[] threads;
+    delete[] args;
+    delete[] producers;
+
+    return ok;
+}
+
+/* test for the queue class */
+bool TestXQueue()
+{
+    XPRINT(0, stdout, "[Test] Queue ... Began\n");
+    bool returnFlag = true;
+    bool caseFlag = true;
+
+    double startT = GetClock();
+
+    /* case 1 test */
+    caseFlag = TestXQueueCase1();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 1 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 1 passed!\n");
+
+    /* case 2 test */
+    caseFlag = TestXQueueCase2();
+    if (!caseFlag) {
+        returnFlag = false;
+        XPRINT(0, stdout, ">> case 2 failed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> case 2 passed!\n");
+
+    if (returnFlag) {
+        XPRINT(0, stdout, ">> All Passed!\n");
+    }
+    else
+        XPRINT(0, stdout, ">> Failed!\n");
+
+    double endT = GetClock();
+
+    XPRINT1(0, stdout, "[Test] Finished (took %.3lfms)\n\n", endT - startT);
+
+    return returnFlag;
+}
+
+/*
+contention benchmark. 1-64 producers put items into a queue and a consumer
+takes them out. We compare the queue with the mutex-based one of the last
+version.
+*/
+bool BenchXQueue()
+{
+    XPRINT(0, stdout, "[Bench] Queue ... Began\n");
+
+    bool ok = true;
+    int itemNum = 1 << 18;
+
+    double benchT = GetClock();
+
+    XPRINT(0, stdout, "    producers  mutex(Mitems/s)  lock-free(Mitems/s)\n");
+
+    for(int producerNum = 1; producerNum <= 64; producerNum *= 2){
+        double speed[2];
+
+        for(int k = 0; k < 2; k++){
+            XQueue * q = k == 1 ? new XQueue(itemNum) : NULL;
+            TMutexQueue * mq = k == 0 ? new TMutexQueue(itemNum) : NULL;
+
+            XThread * threads = new XThread[producerNum];
+            TensorList * args = new TensorList[producerNum];
+            TXQueueProducer * producers = new TXQueueProducer[producerNum];
+
+            int num = itemNum / producerNum;
+            for(int i = 0; i < producerNum; i++){
+                producers[i].q = q;
+                producers[i].mq = mq;
+                producers[i].first = i * num;
+                producers[i].num = num;
+                producers[i].job = NULL;
+                producers[i].sum = NULL;
+            }
+
+            double startT = GetClock();
+
+            StartProducers(threads, args, producers, producerNum);
+
+            long long sum = 0;
+            for(int i = 0; i < num * producerNum; i++)
+                sum += (intptr_t)(q != NULL ? q->Dequeue() : mq->Dequeue());
+
+            double endT = GetClock();
+
+            StopProducers(threads, producerNum);
+
+            long long n = (long long)num * producerNum;
+            ok = ok && sum == n * (n - 1) / 2;
+            speed[k] = n / MAX(endT - startT, 1e-3) / 1000;
+
+            delete[] threads;
+            delete[] args;
+            delete[] producers;
+            delete q;
+            delete mq;
+        }
+
+        XPRINT3(0, stdout, "    %9d  %15.2f  %19.2f\n", producerNum, speed[0], speed[1]);
+    }
+
+    if (!ok)
+        XPRINT(0, stdout, ">> the items are lost!\n");
+
+    XPRINT1(0, stdout, "[Bench] Finished (took %.3lfms)\n\n", GetClock() - benchT);
+
+    return ok;
+}
+
+} // namespace nts(NiuTrans.Tensor)
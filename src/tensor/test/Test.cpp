@@ -77,6 +77,10 @@ bool Test()
     wrong = !TestTopK() || wrong;
     wrong = !TestUnsqueeze() || wrong;
     wrong = !TestXMem() || wrong;
+    wrong = !TestXQueue() || wrong;
+    wrong = !TestXPRunner() || wrong;
+    wrong = !TestXElementWise() || wrong;
+    wrong = !TestXExpression() || wrong;
     
     wrong = !TestCrossEntropy() || wrong;
     wrong = !TestDropout() || wrong;
@@ -70,6 +70,10 @@
 #include "TTopK.h"
 #include "TUnsqueeze.h"
 #include "TXMem.h"
+#include "TXQueue.h"
+#include "TXPRunner.h"
+#include "TXElementWise.h"
+#include "TXExpression.h"
 
 #include "TCrossEntropy.h"
 #include "TDropout.h"
@@ -0,0 +1,101 @@
+import argparse
+import os
+import subprocess
+import sys
+
+parser = argparse.ArgumentParser(description='Accuracy vs. compression of the product-quantized embeddings')
+parser.add_argument('-bin', help='the SLTK binary', type=str, default='bin/NiuTensor.CPU')
+parser.add_argument('-dev', help='dev set (a token and its gold tag per line)', type=str, default='wnut17.dev')
+parser.add_argument('-emb', help='embedding files', type=str, nargs='+',
+                    default=['wnut17crawl.emb', 'wnut17twitter.emb'])
+parser.add_argument('-settings', help='sub-spaces:centroids of each run', type=str, nargs='+',
+                    default=['25:256', '50:256', '100:256'])
+parser.add_argument('-args', help='other arguments of the tagger', type=str, default='-devID -1')
+args = parser.parse_args()
+
+tool_dir = os.path.dirname(os.path.abspath(__file__))
+
+
+def read_tags(file):
+    sents, sent = [], []
+    with open(file, encoding='utf8') as f:
+        for line in f:
+            items = line.split()
+            if not items:
+                if sent:
+                    sents.append(sent)
+                sent = []
+            else:
+                sent.append((items[0], items[-1]))
+    if sent:
+        sents.append(sent)
+    return sents
+
+
+def get_spans(tags):
+    # spans of BIO/BIOES tags as (begin, end, type)
+    spans, begin, kind = set(), -1, None
+    for i, tag in enumerate(tags + ['O']):
+        prefix, t = (tag[0], tag[2:]) if len(tag) > 2 and tag[1] == '-' else ('O', None)
+        if begin >= 0 and (prefix in 'BSO' or t != kind):
+            spans.add((begin, i, kind))
+            begin = -1
+        if prefix in 'BS' or (prefix in 'IE' and begin < 0):
+            begin, kind = i, t
+        if prefix in 'ES' and begin >= 0:
+            spans.add((begin, i + 1, kind))
+            begin = -1
+    return spans
+
+
+def evaluate(gold, pred):
+    correct, total, tp, gold_num, pred_num = 0, 0, 0, 0, 0
+    for g, p in zip(gold, pred):
+        g_tags, p_tags = [t for _, t in g], [t for _, t in p]
+        correct += sum(a == b for a, b in zip(g_tags, p_tags))
+        total += len(g_tags)
+        g_spans, p_spans = get_spans(g_tags), get_spans(p_tags)
+        tp += len(g_spans & p_spans)
+        gold_num += len(g_spans)
+        pred_num += len(p_spans)
+    precision = tp / pred_num if pred_num else 0
+    recall = tp / gold_num if gold_num else 0
+    f1 = 2 * precision * recall / (precision + recall) if precision + recall else 0
+    return correct / max(total, 1), f1
+
+
+def tag(extra):
+    out = 'pq_report.out'
+    if os.path.exists(out):
+        os.remove(out)
+    cmd = [args.bin] + args.args.split() + extra + ['-src', 'pq_report.src', '-tgt', out]
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return read_tags(out)
+
+
+gold = read_tags(args.dev)
+with open('pq_report.src', 'w', encoding='utf8') as f:
+    for sent in gold:
+        f.write(''.join(token + '\n' for token, _ in sent) + '\n')
+
+fp32_size = sum(os.path.getsize(e) for e in args.emb)
+fp32 = tag([])
+acc, f1 = evaluate(gold, fp32)
+
+print('| setting | size (MB) | compression | token acc. | span F1 | agreement with FP32 |')
+print('|---|---|---|---|---|---|')
+print('| FP32 | {:.2f} | 1.0x | {:.4f} | {:.4f} | 1.0000 |'.format(fp32_size / 2 ** 20, acc, f1))
+sys.stdout.flush()
+
+for setting in args.settings:
+    sub, centroid = setting.split(':')
+    for e in args.emb:
+        subprocess.run([sys.executable, os.path.join(tool_dir, 'quantize_embeddings.py'), '-src', e,
+                        '-sub', sub, '-centroid', centroid], check=True, stdout=subprocess.DEVNULL)
+    pq_size = sum(os.path.getsize(e + '.pq') for e in args.emb)
+    pred = tag(['-pq'])
+    acc, f1 = evaluate(gold, pred)
+    agreement, _ = evaluate(fp32, pred)
+    print('| {} | {:.2f} | {:.1f}x | {:.4f} | {:.4f} | {:.4f} |'.format(
+        setting, pq_size / 2 ** 20, fp32_size / pq_size, acc, f1, agreement))
+    sys.stdout.flush()
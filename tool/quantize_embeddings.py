@@ -0,0 +1,73 @@
+import argparse
+import os
+from struct import pack, unpack
+
+import numpy as np
+
+parser = argparse.ArgumentParser(description='Product-quantize the embeddings of SLTK')
+parser.add_argument('-src', help='embedding file (made by get_embeddings.py)', type=str, default='wnut17crawl.emb')
+parser.add_argument('-tgt', help='quantized embedding file', type=str, default='')
+parser.add_argument('-sub', help='number of sub-spaces (it must divide the embedding size)', type=int, default=0)
+parser.add_argument('-centroid', help='number of centroids in each sub-space (at most 256)', type=int, default=256)
+parser.add_argument('-iter', help='number of k-means iterations', type=int, default=20)
+parser.add_argument('-sample', help='max number of vectors to train the codebooks', type=int, default=100000)
+parser.add_argument('-seed', type=int, default=1)
+args = parser.parse_args()
+
+tgt = args.tgt if args.tgt else args.src + '.pq'
+
+# part 1: load the embeddings
+with open(args.src, 'rb') as f:
+    vocab_size, emb_size = unpack('QQ', f.read(16))
+    emb = np.frombuffer(f.read(4 * vocab_size * emb_size), dtype=np.float32).reshape(vocab_size, emb_size)
+
+sub_num = args.sub if args.sub > 0 else max(emb_size // 4, 1)
+assert emb_size % sub_num == 0, 'the sub-spaces must divide the embedding size'
+assert 0 < args.centroid <= 256, 'the codes are kept in uint8'
+sub_size = emb_size // sub_num
+centroid_num = min(args.centroid, vocab_size)
+
+rng = np.random.RandomState(args.seed)
+train_ids = rng.permutation(vocab_size)[:args.sample]
+
+
+def assign(x, c):
+    # squared distances between the rows of x and the centroids
+    d = (x * x).sum(1)[:, None] - 2 * x.dot(c.T) + (c * c).sum(1)[None, :]
+    return d.argmin(1)
+
+
+def assign_all(x, c, chunk=65536):
+    return np.concatenate([assign(x[i:i + chunk], c) for i in range(0, len(x), chunk)])
+
+
+# part 2: train a codebook for each sub-space by k-means and encode the words
+codebooks = np.zeros((sub_num, centroid_num, sub_size), dtype=np.float32)
+codes = np.zeros((vocab_size, sub_num), dtype=np.uint8)
+for m in range(sub_num):
+    x = emb[:, m * sub_size:(m + 1) * sub_size].astype(np.float32)
+    train = x[train_ids]
+    c = train[rng.choice(len(train), centroid_num, replace=False)].copy()
+    for _ in range(args.iter):
+        a = assign_all(train, c)
+        for k in range(centroid_num):
+            members = train[a == k]
+            if len(members) > 0:
+                c[k] = members.mean(0)
+            else:
+                c[k] = train[rng.randint(len(train))]
+    codebooks[m] = c
+    codes[:, m] = assign_all(x, c)
+
+# part 3: save the quantized embeddings
+with open(tgt, 'wb') as f:
+    f.write(pack('QQQQ', vocab_size, emb_size, sub_num, centroid_num))
+    f.write(codebooks.astype(np.float32).tobytes())
+    f.write(codes.tobytes())
+
+decoded = np.concatenate([codebooks[m][codes[:, m]] for m in range(sub_num)], axis=1)
+error = ((decoded - emb) ** 2).sum() / max((emb ** 2).sum(), 1e-12)
+print('{}: {} x {}, {} sub-spaces x {} centroids'.format(args.src, vocab_size, emb_size, sub_num, centroid_num))
+print('size: {:.2f} MB -> {:.2f} MB ({:.1f}x), relative squared error: {:.4f}'.format(
+    os.path.getsize(args.src) / 2 ** 20, os.path.getsize(tgt) / 2 ** 20,
+    os.path.getsize(args.src) / os.path.getsize(tgt), error))